@@ -0,0 +1,508 @@
+#include "BVH.h"
+#include "WorldBounds.h"
+#include "Mesh.h"
+#include "BuildConfiguration.h"
+
+#include <limits>
+
+
+namespace BlazeEngine
+{
+	#define BVH_MAX_LEAF_PRIMITIVES		4	// Nodes with more primitives than this are always split
+	#define BVH_NUM_SAH_BINS			12	// Number of candidate split planes evaluated per axis
+	#define BVH_MAX_DEPTH				48	// Nodes at this depth are never split. Bounds the traversal stack size
+	#define BVH_STACK_SIZE				(BVH_MAX_DEPTH + 2)
+
+
+	// Helper functions:
+	//------------------
+
+	static float SurfaceArea(vec3 const& boundsMin, vec3 const& boundsMax)
+	{
+		vec3 extent = glm::max(boundsMax - boundsMin, vec3(0.0f));
+		return 2.0f * (extent.x * extent.y + extent.y * extent.z + extent.z * extent.x);
+	}
+
+
+	static bool IntersectsSphere(vec3 const& center, float radius, vec3 const& boundsMin, vec3 const& boundsMax)
+	{
+		vec3 closestPoint	= glm::clamp(center, boundsMin, boundsMax);
+		vec3 delta			= closestPoint - center;
+		return glm::dot(delta, delta) <= radius * radius;
+	}
+
+
+	// BVH member functions:
+	//----------------------
+
+	void BVH::Build(WorldBounds const& worldBounds)
+	{
+		unsigned int numPrimitives = worldBounds.NumBounds();
+
+		this->nodes.clear();
+		this->primitiveIndices.resize(numPrimitives);
+		this->primitiveLeaves.resize(numPrimitives);
+		this->primitiveMeshes.resize(numPrimitives);
+		this->primitiveMin.resize(numPrimitives);
+		this->primitiveMax.resize(numPrimitives);
+		this->primitiveSlots.resize(numPrimitives);
+
+		if (numPrimitives == 0)
+		{
+			StoreQueryBounds();
+			return;
+		}
+
+		for (unsigned int i = 0; i < numPrimitives; i++)
+		{
+			this->primitiveIndices[i]	= i;
+			this->primitiveMeshes[i]	= worldBounds.GetMesh(i);
+			CopyPrimitiveBounds(worldBounds, i);
+		}
+
+		this->nodes.reserve(2 * numPrimitives); // A binary tree with N leaves has at most 2N - 1 nodes
+
+		BVHNode root;
+		root.firstChildOrPrimitive	= 0;
+		root.numPrimitives			= numPrimitives;
+		this->nodes.emplace_back(root);
+
+		UpdateNodeBounds(0);
+		Subdivide(0, 0);
+
+		// Map primitives to their leaves, for refitting:
+		for (unsigned int nodeIndex = 0; nodeIndex < (unsigned int)this->nodes.size(); nodeIndex++)
+		{
+			BVHNode const& currentNode = this->nodes[nodeIndex];
+			for (unsigned int i = 0; i < currentNode.numPrimitives; i++)
+			{
+				this->primitiveLeaves[this->primitiveIndices[currentNode.firstChildOrPrimitive + i]] = nodeIndex;
+			}
+		}
+
+		StoreQueryBounds();
+
+		LOG("Built BVH with " + to_string(this->nodes.size()) + " nodes over " + to_string(numPrimitives) + " meshes");
+	}
+
+
+	void BVH::Refit(WorldBounds const& worldBounds)
+	{
+		if (worldBounds.WasRebuilt() || worldBounds.NumBounds() != (unsigned int)this->primitiveMin.size())
+		{
+			Build(worldBounds);
+			return;
+		}
+
+		// Note: Refitting keeps the topology, so tree quality degrades if meshes move far from where they were when the BVH was built
+		vector<unsigned int> const& updatedIndices = worldBounds.UpdatedIndices();
+		for (unsigned int i = 0; i < (unsigned int)updatedIndices.size(); i++)
+		{
+			unsigned int primitiveIndex = updatedIndices[i];
+			CopyPrimitiveBounds(worldBounds, primitiveIndex);
+			this->leafBounds.Set(this->primitiveSlots[primitiveIndex], this->primitiveMin[primitiveIndex], this->primitiveMax[primitiveIndex]);
+
+			int currentNode = (int)this->primitiveLeaves[primitiveIndex];
+			while (currentNode >= 0)
+			{
+				UpdateNodeBounds((unsigned int)currentNode);
+				this->nodeBounds.Set((unsigned int)currentNode, this->nodes[currentNode].boundsMin, this->nodes[currentNode].boundsMax);
+				currentNode = this->nodes[currentNode].parent;
+			}
+		}
+	}
+
+
+	void BVH::QueryFrustum(vec4 const* frustumPlanes, vector<Mesh*>& results) const
+	{
+		results.clear();
+		if (this->nodes.empty())
+		{
+			return;
+		}
+
+		// Nodes are tested before they're pushed, so the stack only holds nodes that intersect the frustum without being inside it:
+		unsigned int insideMask;
+		unsigned int outsideMask = this->nodeBounds.OutsideFrustumMask(frustumPlanes, 0, &insideMask);
+		if (outsideMask & 1)
+		{
+			return;
+		}
+		if (insideMask & 1)
+		{
+			AppendSubtree(0, results);
+			return;
+		}
+
+		unsigned int stack[BVH_STACK_SIZE];
+		int stackSize		= 0;
+		stack[stackSize++]	= 0;
+		while (stackSize > 0)
+		{
+			BVHNode const& currentNode = this->nodes[stack[--stackSize]];
+
+			if (currentNode.IsLeaf())
+			{
+				// Test the leaf's primitives WORLD_BOUNDS_SIMD_WIDTH at a time:
+				unsigned int first = currentNode.firstChildOrPrimitive;
+				for (unsigned int i = 0; i < currentNode.numPrimitives; i += WORLD_BOUNDS_SIMD_WIDTH)
+				{
+					outsideMask = this->leafBounds.OutsideFrustumMask(frustumPlanes, first + i);
+					for (unsigned int lane = 0; lane < WORLD_BOUNDS_SIMD_WIDTH && i + lane < currentNode.numPrimitives; lane++)
+					{
+						if ((outsideMask & (1u << lane)) == 0)
+						{
+							results.emplace_back(this->primitiveMeshes[this->primitiveIndices[first + i + lane]]);
+						}
+					}
+				}
+			}
+			else
+			{
+				// Siblings are adjacent, so both children are tested at once:
+				unsigned int leftChild	= currentNode.firstChildOrPrimitive;
+				outsideMask				= this->nodeBounds.OutsideFrustumMask(frustumPlanes, leftChild, &insideMask);
+				for (unsigned int child = 0; child < 2; child++)
+				{
+					if (outsideMask & (1u << child))
+					{
+						continue;
+					}
+
+					// Entire subtree is visible: Skip the remaining tests
+					if (insideMask & (1u << child))
+					{
+						AppendSubtree(leftChild + child, results);
+					}
+					else
+					{
+						stack[stackSize++] = leftChild + child;
+					}
+				}
+			}
+		}
+	}
+
+
+	void BVH::QuerySphere(vec3 const& center, float radius, vector<Mesh*>& results) const
+	{
+		results.clear();
+		if (this->nodes.empty())
+		{
+			return;
+		}
+
+		unsigned int stack[BVH_STACK_SIZE];
+		int stackSize		= 0;
+		stack[stackSize++]	= 0;
+		while (stackSize > 0)
+		{
+			BVHNode const& currentNode = this->nodes[stack[--stackSize]];
+
+			if (!IntersectsSphere(center, radius, currentNode.boundsMin, currentNode.boundsMax))
+			{
+				continue;
+			}
+
+			if (currentNode.IsLeaf())
+			{
+				for (unsigned int i = 0; i < currentNode.numPrimitives; i++)
+				{
+					unsigned int primitiveIndex = this->primitiveIndices[currentNode.firstChildOrPrimitive + i];
+					if (IntersectsSphere(center, radius, this->primitiveMin[primitiveIndex], this->primitiveMax[primitiveIndex]))
+					{
+						results.emplace_back(this->primitiveMeshes[primitiveIndex]);
+					}
+				}
+			}
+			else
+			{
+				stack[stackSize++] = currentNode.firstChildOrPrimitive;
+				stack[stackSize++] = currentNode.firstChildOrPrimitive + 1;
+			}
+		}
+	}
+
+
+	Bounds BVH::RootBounds() const
+	{
+		Bounds result;
+		if (!this->nodes.empty())
+		{
+			result.xMin = this->nodes[0].boundsMin.x;
+			result.xMax = this->nodes[0].boundsMax.x;
+			result.yMin = this->nodes[0].boundsMin.y;
+			result.yMax = this->nodes[0].boundsMax.y;
+			result.zMin = this->nodes[0].boundsMin.z;
+			result.zMax = this->nodes[0].boundsMax.z;
+		}
+		return result;
+	}
+
+
+	// Private member functions:
+	//--------------------------
+
+	void BVH::Subdivide(unsigned int nodeIndex, unsigned int depth)
+	{
+		unsigned int first			= this->nodes[nodeIndex].firstChildOrPrimitive;
+		unsigned int numPrimitives	= this->nodes[nodeIndex].numPrimitives;
+		if (numPrimitives <= 1 || depth >= BVH_MAX_DEPTH)
+		{
+			return;
+		}
+
+		// Compute the bounds of the primitive centroids:
+		vec3 centroidMin = vec3(std::numeric_limits<float>::max());
+		vec3 centroidMax = vec3(-std::numeric_limits<float>::max());
+		for (unsigned int i = 0; i < numPrimitives; i++)
+		{
+			unsigned int primitiveIndex = this->primitiveIndices[first + i];
+			vec3 centroid				= (this->primitiveMin[primitiveIndex] + this->primitiveMax[primitiveIndex]) * 0.5f;
+			centroidMin					= glm::min(centroidMin, centroid);
+			centroidMax					= glm::max(centroidMax, centroid);
+		}
+
+		// Evaluate the SAH at the bin boundaries of each axis:
+		int bestAxis	= -1;
+		int bestSplit	= -1;
+		float bestCost	= std::numeric_limits<float>::max();
+		for (int axis = 0; axis < 3; axis++)
+		{
+			float extent = centroidMax[axis] - centroidMin[axis];
+			if (extent <= 0.0f)
+			{
+				continue;
+			}
+			float binScale = BVH_NUM_SAH_BINS / extent;
+
+			vec3 binMin[BVH_NUM_SAH_BINS];
+			vec3 binMax[BVH_NUM_SAH_BINS];
+			unsigned int binCount[BVH_NUM_SAH_BINS];
+			for (int bin = 0; bin < BVH_NUM_SAH_BINS; bin++)
+			{
+				binMin[bin]		= vec3(std::numeric_limits<float>::max());
+				binMax[bin]		= vec3(-std::numeric_limits<float>::max());
+				binCount[bin]	= 0;
+			}
+
+			for (unsigned int i = 0; i < numPrimitives; i++)
+			{
+				unsigned int primitiveIndex = this->primitiveIndices[first + i];
+				float centroid				= (this->primitiveMin[primitiveIndex][axis] + this->primitiveMax[primitiveIndex][axis]) * 0.5f;
+				int bin						= glm::min((int)((centroid - centroidMin[axis]) * binScale), BVH_NUM_SAH_BINS - 1);
+
+				binMin[bin] = glm::min(binMin[bin], this->primitiveMin[primitiveIndex]);
+				binMax[bin] = glm::max(binMax[bin], this->primitiveMax[primitiveIndex]);
+				binCount[bin]++;
+			}
+
+			// Sweep from the left, accumulating the left side's area and count, then from the right, evaluating each split:
+			float leftArea[BVH_NUM_SAH_BINS - 1];
+			unsigned int leftCount[BVH_NUM_SAH_BINS - 1];
+			vec3 sweepMin		= vec3(std::numeric_limits<float>::max());
+			vec3 sweepMax		= vec3(-std::numeric_limits<float>::max());
+			unsigned int count	= 0;
+			for (int split = 0; split < BVH_NUM_SAH_BINS - 1; split++)
+			{
+				sweepMin			= glm::min(sweepMin, binMin[split]);
+				sweepMax			= glm::max(sweepMax, binMax[split]);
+				count				+= binCount[split];
+				leftArea[split]		= SurfaceArea(sweepMin, sweepMax);
+				leftCount[split]	= count;
+			}
+
+			sweepMin	= vec3(std::numeric_limits<float>::max());
+			sweepMax	= vec3(-std::numeric_limits<float>::max());
+			count		= 0;
+			for (int split = BVH_NUM_SAH_BINS - 2; split >= 0; split--)
+			{
+				sweepMin	= glm::min(sweepMin, binMin[split + 1]);
+				sweepMax	= glm::max(sweepMax, binMax[split + 1]);
+				count		+= binCount[split + 1];
+
+				if (leftCount[split] == 0 || count == 0)
+				{
+					continue;
+				}
+
+				float cost = leftArea[split] * leftCount[split] + SurfaceArea(sweepMin, sweepMax) * count;
+				if (cost < bestCost)
+				{
+					bestCost	= cost;
+					bestAxis	= axis;
+					bestSplit	= split;
+				}
+			}
+		}
+
+		// Stop if no split is possible (ie. all centroids are coincident), or splitting is more expensive than a small leaf:
+		float leafCost = SurfaceArea(this->nodes[nodeIndex].boundsMin, this->nodes[nodeIndex].boundsMax) * numPrimitives;
+		if (bestAxis < 0 || (numPrimitives <= BVH_MAX_LEAF_PRIMITIVES && bestCost >= leafCost))
+		{
+			return;
+		}
+
+		// Partition the primitives about the chosen split plane:
+		float binScale	= BVH_NUM_SAH_BINS / (centroidMax[bestAxis] - centroidMin[bestAxis]);
+		unsigned int i	= first;
+		unsigned int j	= first + numPrimitives - 1;
+		while (i <= j)
+		{
+			unsigned int primitiveIndex = this->primitiveIndices[i];
+			float centroid				= (this->primitiveMin[primitiveIndex][bestAxis] + this->primitiveMax[primitiveIndex][bestAxis]) * 0.5f;
+			int bin						= glm::min((int)((centroid - centroidMin[bestAxis]) * binScale), BVH_NUM_SAH_BINS - 1);
+			if (bin <= bestSplit)
+			{
+				i++;
+			}
+			else
+			{
+				std::swap(this->primitiveIndices[i], this->primitiveIndices[j]);
+				if (j == 0)
+				{
+					break;
+				}
+				j--;
+			}
+		}
+
+		unsigned int numLeft = i - first;
+
+		// Create the children. Note: Adding nodes may reallocate, so nodes are always accessed by index
+		unsigned int leftChild = (unsigned int)this->nodes.size();
+
+		BVHNode leftNode;
+		leftNode.firstChildOrPrimitive	= first;
+		leftNode.numPrimitives			= numLeft;
+		leftNode.parent					= (int)nodeIndex;
+		this->nodes.emplace_back(leftNode);
+
+		BVHNode rightNode;
+		rightNode.firstChildOrPrimitive	= first + numLeft;
+		rightNode.numPrimitives			= numPrimitives - numLeft;
+		rightNode.parent				= (int)nodeIndex;
+		this->nodes.emplace_back(rightNode);
+
+		this->nodes[nodeIndex].firstChildOrPrimitive	= leftChild;
+		this->nodes[nodeIndex].numPrimitives			= 0;
+
+		UpdateNodeBounds(leftChild);
+		UpdateNodeBounds(leftChild + 1);
+
+		Subdivide(leftChild, depth + 1);
+		Subdivide(leftChild + 1, depth + 1);
+	}
+
+
+	void BVH::UpdateNodeBounds(unsigned int nodeIndex)
+	{
+		BVHNode& currentNode = this->nodes[nodeIndex];
+
+		if (currentNode.IsLeaf())
+		{
+			currentNode.boundsMin = vec3(std::numeric_limits<float>::max());
+			currentNode.boundsMax = vec3(-std::numeric_limits<float>::max());
+			for (unsigned int i = 0; i < currentNode.numPrimitives; i++)
+			{
+				unsigned int primitiveIndex = this->primitiveIndices[currentNode.firstChildOrPrimitive + i];
+				currentNode.boundsMin		= glm::min(currentNode.boundsMin, this->primitiveMin[primitiveIndex]);
+				currentNode.boundsMax		= glm::max(currentNode.boundsMax, this->primitiveMax[primitiveIndex]);
+			}
+		}
+		else
+		{
+			BVHNode const& leftChild	= this->nodes[currentNode.firstChildOrPrimitive];
+			BVHNode const& rightChild	= this->nodes[currentNode.firstChildOrPrimitive + 1];
+			currentNode.boundsMin		= glm::min(leftChild.boundsMin, rightChild.boundsMin);
+			currentNode.boundsMax		= glm::max(leftChild.boundsMax, rightChild.boundsMax);
+		}
+	}
+
+
+	void BVH::CopyPrimitiveBounds(WorldBounds const& worldBounds, unsigned int index)
+	{
+		Bounds primitiveBounds		= worldBounds.GetBounds(index);
+		this->primitiveMin[index]	= vec3(primitiveBounds.xMin, primitiveBounds.yMin, primitiveBounds.zMin);
+		this->primitiveMax[index]	= vec3(primitiveBounds.xMax, primitiveBounds.yMax, primitiveBounds.zMax);
+	}
+
+
+	void BVH::StoreQueryBounds()
+	{
+		this->nodeBounds.Resize((unsigned int)this->nodes.size());
+		for (unsigned int nodeIndex = 0; nodeIndex < (unsigned int)this->nodes.size(); nodeIndex++)
+		{
+			this->nodeBounds.Set(nodeIndex, this->nodes[nodeIndex].boundsMin, this->nodes[nodeIndex].boundsMax);
+		}
+
+		this->leafBounds.Resize((unsigned int)this->primitiveIndices.size());
+		for (unsigned int slot = 0; slot < (unsigned int)this->primitiveIndices.size(); slot++)
+		{
+			unsigned int primitiveIndex				= this->primitiveIndices[slot];
+			this->primitiveSlots[primitiveIndex]	= slot;
+			this->leafBounds.Set(slot, this->primitiveMin[primitiveIndex], this->primitiveMax[primitiveIndex]);
+		}
+	}
+
+
+	void BVH::AppendSubtree(unsigned int nodeIndex, vector<Mesh*>& results) const
+	{
+		// Leaves reference contiguous ranges of primitiveIndices, so every primitive below a node can be found by walking its leaves:
+		unsigned int stack[BVH_STACK_SIZE];
+		int stackSize		= 0;
+		stack[stackSize++]	= nodeIndex;
+		while (stackSize > 0)
+		{
+			BVHNode const& currentNode = this->nodes[stack[--stackSize]];
+			if (currentNode.IsLeaf())
+			{
+				for (unsigned int i = 0; i < currentNode.numPrimitives; i++)
+				{
+					results.emplace_back(this->primitiveMeshes[this->primitiveIndices[currentNode.firstChildOrPrimitive + i]]);
+				}
+			}
+			else
+			{
+				stack[stackSize++] = currentNode.firstChildOrPrimitive;
+				stack[stackSize++] = currentNode.firstChildOrPrimitive + 1;
+			}
+		}
+	}
+
+
+	// SoABounds member functions:
+	//----------------------------
+
+	void BVH::SoABounds::Resize(unsigned int size)
+	{
+		// Padding entries are empty (inverted) bounds, which are outside of every plane. A test reads up to WORLD_BOUNDS_SIMD_WIDTH - 1
+		// entries past the last one:
+		size_t paddedSize = (size_t)size + WORLD_BOUNDS_SIMD_WIDTH - 1;
+
+		this->xMin.assign(paddedSize, std::numeric_limits<float>::max());
+		this->yMin.assign(paddedSize, std::numeric_limits<float>::max());
+		this->zMin.assign(paddedSize, std::numeric_limits<float>::max());
+		this->xMax.assign(paddedSize, -std::numeric_limits<float>::max());
+		this->yMax.assign(paddedSize, -std::numeric_limits<float>::max());
+		this->zMax.assign(paddedSize, -std::numeric_limits<float>::max());
+	}
+
+
+	void BVH::SoABounds::Set(unsigned int index, vec3 const& boundsMin, vec3 const& boundsMax)
+	{
+		this->xMin[index] = boundsMin.x;
+		this->yMin[index] = boundsMin.y;
+		this->zMin[index] = boundsMin.z;
+		this->xMax[index] = boundsMax.x;
+		this->yMax[index] = boundsMax.y;
+		this->zMax[index] = boundsMax.z;
+	}
+
+
+	unsigned int BVH::SoABounds::OutsideFrustumMask(vec4 const* frustumPlanes, unsigned int first, unsigned int* insideMask /*= nullptr*/) const
+	{
+		return WorldBounds::OutsideFrustumMask(frustumPlanes, &this->xMin[first], &this->xMax[first], &this->yMin[first], &this->yMax[first],
+			&this->zMin[first], &this->zMax[first], insideMask);
+	}
+}
@@ -0,0 +1,111 @@
+// Bounding volume hierarchy
+// A binary BVH over the world-space mesh bounds cached by a WorldBounds. Built with a binned surface area heuristic (SAH), and
+// refit incrementally as meshes move. Supports frustum and sphere queries. Frustum queries test sibling nodes, and the primitives
+// of each leaf, together with WorldBounds' SIMD plane test
+
+#pragma once
+
+#define GLM_FORCE_SWIZZLE
+#include "glm.hpp"
+
+#include <vector>
+
+using glm::vec3;
+using glm::vec4;
+using std::vector;
+
+
+namespace BlazeEngine
+{
+	// Pre-declarations:
+	class Mesh;
+	class WorldBounds;
+	struct Bounds;
+
+
+	class BVH
+	{
+	public:
+		BVH() {}
+
+		// (Re)build the hierarchy over every entry in worldBounds
+		void Build(WorldBounds const& worldBounds);
+
+		// Refit the nodes containing the entries changed by the last WorldBounds::Update(). Rebuilds if WorldBounds was rebuilt
+		void Refit(WorldBounds const& worldBounds);
+
+		// Queries: Append every mesh with bounds intersecting the volume to results (which is cleared first)
+		void QueryFrustum(vec4 const* frustumPlanes, vector<Mesh*>& results) const;	// Planes as per Camera::FrustumPlanes()
+		void QuerySphere(vec3 const& center, float radius, vector<Mesh*>& results) const;
+
+		// Get the bounds of every mesh in the hierarchy. Empty (inverted) bounds if the hierarchy is empty
+		Bounds RootBounds() const;
+
+		inline unsigned int NumNodes() const { return (unsigned int)nodes.size(); }
+
+
+	private:
+		struct BVHNode
+		{
+			vec3			boundsMin;
+			vec3			boundsMax;
+
+			unsigned int	firstChildOrPrimitive	= 0;	// Interior: Index of the left child (right child == left + 1). Leaf: Index into primitiveIndices
+			unsigned int	numPrimitives			= 0;	// 0 == interior node
+			int				parent					= -1;	// -1 == root
+
+			inline bool IsLeaf() const { return numPrimitives > 0; }
+		};
+
+		// Structure-of-arrays copy of a set of AABBs, for WorldBounds::OutsideFrustumMask(). Padded with empty bounds, so a test can
+		// start at any entry
+		struct SoABounds
+		{
+			vector<float>	xMin;
+			vector<float>	xMax;
+			vector<float>	yMin;
+			vector<float>	yMax;
+			vector<float>	zMin;
+			vector<float>	zMax;
+
+			void Resize(unsigned int size);
+			void Set(unsigned int index, vec3 const& boundsMin, vec3 const& boundsMax);
+			unsigned int OutsideFrustumMask(vec4 const* frustumPlanes, unsigned int first, unsigned int* insideMask = nullptr) const;
+		};
+
+		vector<BVHNode>			nodes;				// nodes[0] is the root
+		vector<unsigned int>	primitiveIndices;	// WorldBounds indexes, ordered so each leaf references a contiguous range
+		vector<unsigned int>	primitiveLeaves;	// Maps WorldBounds indexes to the leaf node that contains them
+		vector<Mesh*>			primitiveMeshes;	// Mesh of each WorldBounds index
+
+		// Working copy of the primitive bounds, indexed by WorldBounds index:
+		vector<vec3>			primitiveMin;
+		vector<vec3>			primitiveMax;
+
+		// Copies of the node and primitive bounds for frustum queries. Primitives are in leaf order, so each leaf is a contiguous range:
+		SoABounds				nodeBounds;			// Indexed like nodes
+		SoABounds				leafBounds;			// Indexed like primitiveIndices
+		vector<unsigned int>	primitiveSlots;		// Maps WorldBounds indexes to their position in primitiveIndices
+
+
+		// Private member functions:
+		//--------------------------
+
+		// Recursively split a node, using the SAH to choose the split plane
+		void Subdivide(unsigned int nodeIndex, unsigned int depth);
+
+		// Recompute a node's bounds from its primitives (leaf) or children (interior)
+		void UpdateNodeBounds(unsigned int nodeIndex);
+
+		// Copy the bounds of a WorldBounds entry into the working copy
+		void CopyPrimitiveBounds(WorldBounds const& worldBounds, unsigned int index);
+
+		// Copy the bounds of every node and primitive into nodeBounds and leafBounds
+		void StoreQueryBounds();
+
+		// Helper function: Append every mesh below a node to results
+		void AppendSubtree(unsigned int nodeIndex, vector<Mesh*>& results) const;
+	};
+}
+
+
@@ -50,6 +50,13 @@
 	//#define DEBUG_LOG_RENDERMANAGER
 	#if defined(DEBUG_LOG_RENDERMANAGER)
 		#define DEBUG_RENDERMANAGER_SHADER_LOGGING		// Enable logging of shader setup
+		//#define DEBUG_RENDERMANAGER_GL_STATE_LOGGING	// Enable per-frame logging of GL state cache statistics
+		//#define DEBUG_RENDERMANAGER_OCCLUSION_LOGGING	// Enable per-frame logging of software occlusion culling results
+		//#define DEBUG_RENDERMANAGER_SHADOW_CACHE_LOGGING	// Enable logging of static shadow caster cache rebuilds
+		//#define DEBUG_RENDERMANAGER_PASS_TIMING		// Enable periodic logging of per-pass GPU times
+		//#define DEBUG_RENDERMANAGER_RENDER_GRAPH_LOGGING	// Enable logging of the compiled render graph whenever it changes
+		//#define DEBUG_RENDERMANAGER_DYNAMIC_RESOLUTION_LOGGING	// Enable logging of dynamic resolution scale changes
+		//#define DEBUG_RENDERMANAGER_TEXTURE_STREAMING_LOGGING	// Enable logging of texture mip levels streamed in/evicted
 	#endif
 
 	//#define DEBUG_LOG_SHADERS
@@ -4,6 +4,9 @@
 #include "Texture.h"
 #include "RenderTexture.h"
 #include "Material.h"
+#include "Mesh.h"
+#include "Shader.h"
+#include "MaterialTextureArrays.h"
 
 
 #include "glm.hpp"
@@ -97,50 +100,154 @@ namespace BlazeEngine
 
 	mat4 const* Camera::CubeView()
 	{
-		// If we've never allocated cubeView, do it now:
-		if (cubeView.size() == 0)
+		// Rebuild the cube views if they've never been allocated, or if the camera has moved:
+		unsigned int currentRevision = this->transform.Revision();
+		if (cubeView.size() == 0 || currentRevision != this->cubeViewRevision)
 		{
+			vec3 worldPosition = this->transform.WorldPosition();
+
+			cubeView.clear();
 			cubeView.reserve(6);
 
-			cubeView.emplace_back( glm::lookAt(this->transform.WorldPosition(), this->transform.WorldPosition() + Transform::WORLD_X, -Transform::WORLD_Y) );			
-			cubeView.emplace_back( glm::lookAt(this->transform.WorldPosition(), this->transform.WorldPosition() - Transform::WORLD_X, -Transform::WORLD_Y) );
+			cubeView.emplace_back( glm::lookAt(worldPosition, worldPosition + Transform::WORLD_X, -Transform::WORLD_Y) );			
+			cubeView.emplace_back( glm::lookAt(worldPosition, worldPosition - Transform::WORLD_X, -Transform::WORLD_Y) );
 
-			cubeView.emplace_back( glm::lookAt(this->transform.WorldPosition(), this->transform.WorldPosition() + Transform::WORLD_Y, Transform::WORLD_Z) );
-			cubeView.emplace_back( glm::lookAt(this->transform.WorldPosition(), this->transform.WorldPosition() - Transform::WORLD_Y, -Transform::WORLD_Z) );
+			cubeView.emplace_back( glm::lookAt(worldPosition, worldPosition + Transform::WORLD_Y, Transform::WORLD_Z) );
+			cubeView.emplace_back( glm::lookAt(worldPosition, worldPosition - Transform::WORLD_Y, -Transform::WORLD_Z) );
 
-			cubeView.emplace_back( glm::lookAt(this->transform.WorldPosition(), this->transform.WorldPosition() + Transform::WORLD_Z, -Transform::WORLD_Y) );
-			cubeView.emplace_back( glm::lookAt(this->transform.WorldPosition(), this->transform.WorldPosition() - Transform::WORLD_Z, -Transform::WORLD_Y) );
-		}
+			cubeView.emplace_back( glm::lookAt(worldPosition, worldPosition + Transform::WORLD_Z, -Transform::WORLD_Y) );
+			cubeView.emplace_back( glm::lookAt(worldPosition, worldPosition - Transform::WORLD_Z, -Transform::WORLD_Y) );
 
-		// TODO: Recalculate this if the camera has moved
+			this->cubeViewRevision = currentRevision;
+		}
 
 		return &cubeView[0];
 	}
 
 	mat4 const* Camera::CubeViewProjection()
 	{
-		// If we've never allocated cubeViewProjection, do it now:
-		if (cubeViewProjection.size() == 0)
+		// Rebuild the cube view projections if they've never been allocated, or if the camera has moved:
+		unsigned int currentRevision = this->transform.Revision();
+		if (cubeViewProjection.size() == 0 || currentRevision != this->cubeViewProjectionRevision)
 		{
+			mat4 const* ourCubeViews = this->CubeView(); // Call this to ensure cubeView is up to date
+
+			cubeViewProjection.clear();
 			cubeViewProjection.reserve(6);
 
-			mat4 const* ourCubeViews = this->CubeView(); // Call this to ensure cubeView has been initialized
+			for (int i = 0; i < 6; i++)
+			{
+				cubeViewProjection.emplace_back(this->projection * ourCubeViews[i]);
+			}
 
-			cubeViewProjection.emplace_back(this->projection * ourCubeViews[0]);
-			cubeViewProjection.emplace_back(this->projection * ourCubeViews[1]);
-			cubeViewProjection.emplace_back(this->projection * ourCubeViews[2]);
-			cubeViewProjection.emplace_back(this->projection * ourCubeViews[3]);
-			cubeViewProjection.emplace_back(this->projection * ourCubeViews[4]);
-			cubeViewProjection.emplace_back(this->projection * ourCubeViews[5]);
+			this->cubeViewProjectionRevision = currentRevision;
 		}
 
 		return &cubeViewProjection[0];
 	}
 
 
+	vec4 const* Camera::FrustumPlanes()
+	{
+		unsigned int currentRevision = this->transform.Revision();
+		if (currentRevision != this->frustumRevision)
+		{
+			ExtractFrustumPlanes(ViewProjection(), &frustumPlanes[0]);
+
+			this->frustumRevision = currentRevision;
+		}
+
+		return &frustumPlanes[0];
+	}
+
+
+	vec4 const* Camera::CubeFrustumPlanes()
+	{
+		unsigned int currentRevision = this->transform.Revision();
+		if (currentRevision != this->cubeFrustumRevision)
+		{
+			mat4 const* cubeViewProjections = CubeViewProjection();
+			for (int i = 0; i < 6; i++)
+			{
+				ExtractFrustumPlanes(cubeViewProjections[i], &cubeFrustumPlanes[i * 6]);
+			}
+
+			this->cubeFrustumRevision = currentRevision;
+		}
+
+		return &cubeFrustumPlanes[0];
+	}
+
+
+	void Camera::ExtractFrustumPlanes(mat4 const& viewProjection, vec4* planes)
+	{
+		// Extract the planes from the rows of the view projection matrix (Gribb/Hartmann):
+		vec4 row0 = vec4(viewProjection[0][0], viewProjection[1][0], viewProjection[2][0], viewProjection[3][0]);
+		vec4 row1 = vec4(viewProjection[0][1], viewProjection[1][1], viewProjection[2][1], viewProjection[3][1]);
+		vec4 row2 = vec4(viewProjection[0][2], viewProjection[1][2], viewProjection[2][2], viewProjection[3][2]);
+		vec4 row3 = vec4(viewProjection[0][3], viewProjection[1][3], viewProjection[2][3], viewProjection[3][3]);
+
+		planes[0] = row3 + row0;	// Left
+		planes[1] = row3 - row0;	// Right
+		planes[2] = row3 + row1;	// Bottom
+		planes[3] = row3 - row1;	// Top
+		planes[4] = row3 + row2;	// Near
+		planes[5] = row3 - row2;	// Far
+
+		for (int i = 0; i < 6; i++)
+		{
+			planes[i] /= glm::length(planes[i].xyz());
+		}
+	}
+
+
+	bool Camera::ScreenRect(Bounds const& worldBounds, int xRes, int yRes, glm::ivec4& rect)
+	{
+		mat4 const& viewProjection = ViewProjection();
+
+		vec2 ndcMin(1.0f);
+		vec2 ndcMax(-1.0f);
+		for (int corner = 0; corner < 8; corner++)
+		{
+			vec4 worldCorner
+			(
+				(corner & 1) ? worldBounds.xMax : worldBounds.xMin,
+				(corner & 2) ? worldBounds.yMax : worldBounds.yMin,
+				(corner & 4) ? worldBounds.zMax : worldBounds.zMin,
+				1.0f
+			);
+
+			vec4 clipCorner = viewProjection * worldCorner;
+			if (clipCorner.w <= 0.0f)
+			{
+				// The bounds cross the camera plane: Conservatively cover the entire target
+				rect = glm::ivec4(0, 0, xRes, yRes);
+				return true;
+			}
+
+			vec2 ndcCorner	= vec2(clipCorner.x, clipCorner.y) / clipCorner.w;
+			ndcMin			= glm::min(ndcMin, ndcCorner);
+			ndcMax			= glm::max(ndcMax, ndcCorner);
+		}
+
+		ndcMin = glm::clamp(ndcMin, vec2(-1.0f), vec2(1.0f));
+		ndcMax = glm::clamp(ndcMax, vec2(-1.0f), vec2(1.0f));
+
+		// [-1, 1] -> Pixels:
+		int xMin = (int)glm::floor((ndcMin.x * 0.5f + 0.5f) * xRes);
+		int yMin = (int)glm::floor((ndcMin.y * 0.5f + 0.5f) * yRes);
+		int xMax = (int)glm::ceil((ndcMax.x * 0.5f + 0.5f) * xRes);
+		int yMax = (int)glm::ceil((ndcMax.y * 0.5f + 0.5f) * yRes);
+
+		rect = glm::ivec4(xMin, yMin, xMax - xMin, yMax - yMin);
+
+		return rect.z > 0 && rect.w > 0;
+	}
+
+
 	void Camera::AttachGBuffer()
 	{
-		Material* gBufferMaterial	= new Material(this->GetName() + "_Material", CoreEngine::GetCoreEngine()->GetConfig()->GetValue<string>("gBufferFillShaderName"), RENDER_TEXTURE_COUNT, true);
+		Material* gBufferMaterial	= new Material(this->GetName() + "_Material", CreateGBufferShader(), RENDER_TEXTURE_COUNT, true);
 		this->renderMaterial		= gBufferMaterial;
 
 		// We use the albedo texture as a basis for the others
@@ -150,8 +257,9 @@ namespace BlazeEngine
 			CoreEngine::GetCoreEngine()->GetConfig()->GetValue<int>("windowYRes"),
 			this->GetName() + "_" + Material::RENDER_TEXTURE_SAMPLER_NAMES[RENDER_TEXTURE_ALBEDO]
 		);
-		gBuffer_albedo->Format()			= GL_RGBA;		// Note: Using 4 channels for future flexibility
-		gBuffer_albedo->InternalFormat()	= GL_RGBA32F;		
+		gBuffer_albedo->Format()			= GL_RGBA;
+		gBuffer_albedo->InternalFormat()	= GL_SRGB8_ALPHA8;	// Note: Encoded on write (GL_FRAMEBUFFER_SRGB is enabled while the GBuffer is filled), and linearized when sampled
+		gBuffer_albedo->Type()				= GL_UNSIGNED_BYTE;
 		
 		gBuffer_albedo->TextureMinFilter()	= GL_LINEAR;	// Note: Output is black if this is GL_NEAREST_MIPMAP_LINEAR
 		gBuffer_albedo->TextureMaxFilter()	= GL_LINEAR;
@@ -168,21 +276,48 @@ namespace BlazeEngine
 		gBufferMaterial->AccessTexture(RENDER_TEXTURE_ALBEDO) = gBuffer_albedo;
 
 		// Store references to our additonal RenderTextures:
-		int numAdditionalRTs			= (int)RENDER_TEXTURE_COUNT - 2; // -2 b/c we already have 1, and we'll add the depth texture last
+		int numAdditionalRTs			= (int)RENDER_TEXTURE_COUNT - 3; // -3 b/c we already have 1, world position is reconstructed from depth, and we'll add the depth texture last
 		vector<RenderTexture*> additionalRTs(numAdditionalRTs, nullptr);
 
 		int insertIndex				= 0;
 		int attachmentIndexOffset	= 1;
 		for (int currentType = 1; currentType < (int)RENDER_TEXTURE_COUNT; currentType++)
 		{
-			if ((TEXTURE_TYPE)currentType == RENDER_TEXTURE_DEPTH)
+			if ((TEXTURE_TYPE)currentType == RENDER_TEXTURE_DEPTH || (TEXTURE_TYPE)currentType == RENDER_TEXTURE_WORLD_POSITION)
 			{
 				continue;
 			}
 
-			RenderTexture* currentRT		= new RenderTexture(*gBuffer_albedo);	// We're creating the same type of textures, attached to the same framebuffer
+			RenderTexture* currentRT		= new RenderTexture(*gBuffer_albedo);	// We're attaching the textures to the same framebuffer
 			currentRT->TexturePath()		= this->GetName() + "_" + Material::RENDER_TEXTURE_SAMPLER_NAMES[(TEXTURE_TYPE)currentType];
 
+			// Use the smallest format that holds each GBuffer channel:
+			switch ((TEXTURE_TYPE)currentType)
+			{
+			case RENDER_TEXTURE_WORLD_NORMAL:
+			{
+				currentRT->Format()			= GL_RG;			// Octahedral encoded, mapped to [0,1]
+				currentRT->InternalFormat()	= GL_RG16;
+				currentRT->Type()			= GL_UNSIGNED_SHORT;
+			}
+			break;
+			case RENDER_TEXTURE_EMISSIVE:
+			{
+				currentRT->Format()			= GL_RGB;			// HDR: Emissive intensity is applied during the GBuffer fill
+				currentRT->InternalFormat()	= GL_R11F_G11F_B10F;
+				currentRT->Type()			= GL_FLOAT;
+			}
+			break;
+			case RENDER_TEXTURE_RMAO:
+			case RENDER_TEXTURE_MATERIAL_PROPERTY_0:
+			default:
+			{
+				currentRT->Format()			= GL_RGBA;
+				currentRT->InternalFormat()	= GL_RGBA8;
+				currentRT->Type()			= GL_UNSIGNED_BYTE;
+			}
+			}
+
 			currentRT->FBO()				= gBufferFBO;
 			currentRT->AttachmentPoint()	= gBuffer_albedo->AttachmentPoint() + attachmentIndexOffset;
 			currentRT->ReadBuffer()			= gBuffer_albedo->AttachmentPoint() + attachmentIndexOffset;
@@ -218,12 +353,42 @@ namespace BlazeEngine
 
 		depth->Texture::Buffer(RENDER_TEXTURE_0 + RENDER_TEXTURE_DEPTH);
 
-		glBindTexture(depth->TextureTarget(), 0); // Cleanup: Texture was never unbound in Texture::Buffer, so we must unbind it here
+		depth->Bind(RENDER_TEXTURE_0 + RENDER_TEXTURE_DEPTH, false); // Cleanup: Texture was never unbound in Texture::Buffer, so we must unbind it here
 
 		gBuffer_albedo->AttachAdditionalRenderTexturesToFramebuffer(&depth, 1, true);
 	}
 
 
+	void Camera::ReloadGBufferShader()
+	{
+		if (this->renderMaterial == nullptr)
+		{
+			LOG_ERROR("Cannot reload the GBuffer shader of camera \"" + this->GetName() + "\": It doesn't have a GBuffer");
+			return;
+		}
+
+		Shader*& gBufferShader = this->renderMaterial->GetShader();
+		if (gBufferShader != nullptr)
+		{
+			gBufferShader->Destroy();
+			delete gBufferShader;
+		}
+		gBufferShader = CreateGBufferShader();
+	}
+
+
+	Shader* Camera::CreateGBufferShader()
+	{
+		// Material textures are sampled from texture arrays, if they're in use:
+		vector<string> shaderKeywords;
+		if (MaterialTextureArrays::IsEnabled())
+		{
+			shaderKeywords.push_back(MaterialTextureArrays::MATERIAL_TEXTURE_ARRAYS_KEYWORD);
+		}
+		return Shader::CreateShader(CoreEngine::GetCoreEngine()->GetConfig()->GetValue<string>("gBufferFillShaderName"), &shaderKeywords);
+	}
+
+
 	void Camera::DebugPrint()
 	{
 		#if defined(DEBUG_TRANSFORMS)
@@ -10,6 +10,8 @@ namespace BlazeEngine
 {
 	// Pre-declarations:
 	class Material;
+	class Shader;
+	struct Bounds;
 
 	// Contains configuration specific to a cameras rendering
 	struct CameraConfig
@@ -56,7 +58,7 @@ namespace BlazeEngine
 		inline float const& Far() const				{ return cameraConfig.far; }
 
 		mat4 const&			View();
-		mat4 const*			CubeView(); // TODO: Recompute this if the camera has moved
+		mat4 const*			CubeView();				// Recomputed when the camera's transform has changed
 
 
 		inline mat4 const&	Projection() const		{ return projection; }
@@ -64,6 +66,20 @@ namespace BlazeEngine
 		inline mat4 const&	ViewProjection()		{ return viewProjection = projection * View(); } // TODO: Only compute this if something has changed
 		mat4 const*			CubeViewProjection();
 
+		// World-space frustum planes, as (normal.xyz, distance) with normals pointing inwards. Ordered left, right, bottom, top, near, far.
+		// Planes are cached, and only re-extracted when the camera's transform has changed
+		vec4 const*			FrustumPlanes();
+
+		// World-space frustum planes of each cube map face: 6 consecutive planes per face (ordered as per FrustumPlanes()), in cube face order
+		vec4 const*			CubeFrustumPlanes();
+
+		// Extract 6 normalized, inward facing frustum planes from a view projection matrix
+		static void			ExtractFrustumPlanes(mat4 const& viewProjection, vec4* planes);
+
+		// Get the pixel rectangle (x, y, width, height) of an xRes x yRes target covered by world-space bounds. Bounds crossing the
+		// camera plane conservatively cover the whole target. Returns false if the bounds are entirely off screen
+		bool				ScreenRect(Bounds const& worldBounds, int xRes, int yRes, glm::ivec4& rect);
+
 		Material*&			RenderMaterial()		{ return renderMaterial; }
 
 		float& Exposure()							{ return cameraConfig.exposure; }
@@ -72,6 +88,9 @@ namespace BlazeEngine
 		// Configure this camera for deferred rendering
 		void				AttachGBuffer();
 
+		// Recreate the GBuffer fill shader, so it matches the current material texture source (eg. after texture arrays failed to build)
+		void				ReloadGBufferShader();
+
 		void				DebugPrint();
 	protected:
 
@@ -80,6 +99,9 @@ namespace BlazeEngine
 		// Helper function: Configures the camera based on the cameraConfig. MUST be called at least once during setup
 		void Initialize();
 
+		// Helper function: Creates the GBuffer fill shader, sampling material texture arrays if MaterialTextureArrays::IsEnabled()
+		static Shader* CreateGBufferShader();
+
 		CameraConfig cameraConfig;
 
 		mat4 view					= mat4();
@@ -88,6 +110,14 @@ namespace BlazeEngine
 
 		vector<mat4> cubeView;
 		vector<mat4> cubeViewProjection;
+		unsigned int cubeViewRevision			= 0;	// Transform revisions the cube matrices were computed from
+		unsigned int cubeViewProjectionRevision	= 0;
+
+		vec4 frustumPlanes[6];
+		unsigned int frustumRevision	= 0;	// Transform revision the frustum planes were extracted from. Transform revisions start at 1
+
+		vec4 cubeFrustumPlanes[36];
+		unsigned int cubeFrustumRevision = 0;
 		
 		Material* renderMaterial	= nullptr;	// Deallocated by Destroy()
 
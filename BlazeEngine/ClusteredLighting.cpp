@@ -0,0 +1,230 @@
+#include "ClusteredLighting.h"
+#include "CoreEngine.h"
+#include "BuildConfiguration.h"
+#include "Camera.h"
+#include "Light.h"
+#include "Shader.h"
+#include "Mesh.h"
+#include "Material.h"
+#include "RenderTexture.h"
+#include "ShadowMap.h"
+#include "Transform.h"
+
+#include <string>
+
+using std::string;
+using std::to_string;
+
+
+namespace BlazeEngine
+{
+	ClusteredLighting::ClusteredLighting(int gridX, int gridY, int gridZ, int maxLightsPerCluster)
+	{
+		this->gridX					= glm::max(gridX, 1);
+		this->gridY					= glm::max(gridY, 1);
+		this->gridZ					= glm::max(gridZ, 1);
+		this->maxLightsPerCluster	= glm::max(maxLightsPerCluster, 1);
+
+		this->assignmentShader	= Shader::CreateComputeShader(CoreEngine::GetCoreEngine()->GetConfig()->GetValue<string>("clusterLightAssignmentShaderName"));
+		this->lightingShader	= Shader::CreateShader(CoreEngine::GetCoreEngine()->GetConfig()->GetValue<string>("deferredClusteredLightShaderName"));
+
+		glGenBuffers(CLUSTER_BUFFER_COUNT, &this->buffers[0]);
+		for (int i = 0; i < CLUSTER_BUFFER_COUNT; i++)
+		{
+			this->bufferSizes[i] = 0;
+		}
+
+		// Allocate every buffer, so they can always be bound. The per-cluster buffers have a fixed size:
+		int numClusters = this->gridX * this->gridY * this->gridZ;
+		UploadBuffer(CLUSTER_BUFFER_LIGHTS,			nullptr, sizeof(ClusterLight));
+		UploadBuffer(CLUSTER_BUFFER_SHADOWS,		nullptr, sizeof(ClusterShadow));
+		UploadBuffer(CLUSTER_BUFFER_LIGHT_COUNTS,	nullptr, numClusters * sizeof(GLuint));
+		UploadBuffer(CLUSTER_BUFFER_LIGHT_INDICES,	nullptr, numClusters * this->maxLightsPerCluster * sizeof(GLuint));
+
+		LOG("Created " + to_string(this->gridX) + "x" + to_string(this->gridY) + "x" + to_string(this->gridZ) + " light cluster grid");
+	}
+
+
+	ClusteredLighting::~ClusteredLighting()
+	{
+		glDeleteBuffers(CLUSTER_BUFFER_COUNT, &this->buffers[0]);
+
+		if (this->assignmentShader != nullptr)
+		{
+			this->assignmentShader->Destroy();
+			delete this->assignmentShader;
+			this->assignmentShader = nullptr;
+		}
+
+		if (this->lightingShader != nullptr)
+		{
+			this->lightingShader->Destroy();
+			delete this->lightingShader;
+			this->lightingShader = nullptr;
+		}
+	}
+
+
+	void ClusteredLighting::Update(Camera* renderCam, vector<Light*> const& lights)
+	{
+		this->lightData.clear();
+		this->shadowData.clear();
+
+		if (!IsValid())
+		{
+			return;
+		}
+
+		// Gather the point lights with a volume intersecting the frustum:
+		vec4 const* frustumPlanes = renderCam->FrustumPlanes();
+		for (unsigned int i = 0; i < (unsigned int)lights.size(); i++)
+		{
+			Light* currentLight = lights[i];
+			if (currentLight->Type() != LIGHT_POINT)
+			{
+				continue;
+			}
+
+			vec3 lightPosition	= currentLight->GetTransform().WorldPosition();
+			float radius		= currentLight->Radius();
+
+			bool isVisible = true;
+			for (int plane = 0; plane < 6 && isVisible; plane++)
+			{
+				isVisible = glm::dot(vec3(frustumPlanes[plane]), lightPosition) + frustumPlanes[plane].w >= -radius;
+			}
+			if (!isVisible)
+			{
+				continue;
+			}
+
+			ClusterLight newLight;
+			newLight.positionRadius	= vec4(lightPosition, radius);
+			newLight.color			= currentLight->Color();
+			newLight.shadowIndex	= -1;
+
+			// Lights without shadow atlas tiles this frame are unshadowed:
+			ShadowMap* shadowMap = currentLight->ActiveShadowMap();
+			if (shadowMap != nullptr && shadowMap->NumTiles() > 0)
+			{
+				Camera* shadowCam = shadowMap->ShadowCamera();
+
+				ClusterShadow newShadow;
+				for (int tile = 0; tile < 6; tile++)
+				{
+					newShadow.faceViewProjections[tile]	= shadowCam->CubeViewProjection()[tile];
+					newShadow.tiles[tile]				= tile < shadowMap->NumTiles() ? shadowMap->Tiles()[tile] : vec4(0.0f);
+				}
+				newShadow.params = vec4((float)shadowMap->NumTiles(), shadowCam->Far(), shadowMap->MinShadowBias(), shadowMap->MaxShadowBias());
+
+				newLight.shadowIndex = (int)this->shadowData.size();
+				this->shadowData.emplace_back(newShadow);
+			}
+
+			this->lightData.emplace_back(newLight);
+		}
+
+		if (this->lightData.empty())
+		{
+			return;
+		}
+
+		UploadBuffer(CLUSTER_BUFFER_LIGHTS, &this->lightData[0], this->lightData.size() * sizeof(ClusterLight));
+		if (!this->shadowData.empty())
+		{
+			UploadBuffer(CLUSTER_BUFFER_SHADOWS, &this->shadowData[0], this->shadowData.size() * sizeof(ClusterShadow));
+		}
+
+		// Cluster grid parameters, shared by both shaders:
+		int numLights			= (int)this->lightData.size();
+		float nearDist			= renderCam->Near();
+		float farDist			= renderCam->Far();
+		vec4 clusterGridSize	= vec4((float)this->gridX, (float)this->gridY, (float)this->gridZ, (float)this->maxLightsPerCluster);
+		vec4 clusterDepthParams	= vec4(nearDist, farDist, (float)this->gridZ / glm::log(farDist / nearDist), 0.0f);
+
+		Shader* shaders[] = { this->assignmentShader, this->lightingShader };
+		for (Shader* currentShader : shaders)
+		{
+			currentShader->UploadUniform("numClusterLights",	&numLights,					UNIFORM_Int);
+			currentShader->UploadUniform("clusterGridSize",		&clusterGridSize.x,			UNIFORM_Vec4fv);
+			currentShader->UploadUniform("clusterDepthParams",	&clusterDepthParams.x,		UNIFORM_Vec4fv);
+		}
+
+		mat4 view				= renderCam->View();
+		mat4 inverseProjection	= glm::inverse(renderCam->Projection());
+		this->assignmentShader->UploadUniform("in_view",				&view[0][0],				UNIFORM_Matrix4fv);
+		this->assignmentShader->UploadUniform("in_inverse_projection",	&inverseProjection[0][0],	UNIFORM_Matrix4fv);
+
+		// Assign lights to clusters:
+		BindBuffers();
+		this->assignmentShader->Bind(true);
+
+		int numClusters = this->gridX * this->gridY * this->gridZ;
+		glDispatchCompute((numClusters + CLUSTER_ASSIGNMENT_GROUP_SIZE - 1) / CLUSTER_ASSIGNMENT_GROUP_SIZE, 1, 1);
+
+		// Make the light lists visible to the lighting pass:
+		glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+	}
+
+
+	void ClusteredLighting::Render(Camera* renderCam, Mesh* screenAlignedQuad, RenderTexture* shadowAtlasTexture)
+	{
+		if (!IsValid() || this->lightData.empty())
+		{
+			return;
+		}
+
+		this->lightingShader->Bind(true);
+
+		mat4 view					= renderCam->View();
+		mat4 inverseViewProjection	= glm::inverse(renderCam->ViewProjection());
+		this->lightingShader->UploadUniform("in_view",			&view[0][0],					UNIFORM_Matrix4fv);
+		this->lightingShader->UploadUniform("in_inverse_vp",	&inverseViewProjection[0][0],	UNIFORM_Matrix4fv);
+
+		// Every shadowed light samples the shadow atlas:
+		vec4 texelSize(0.0f);
+		if (shadowAtlasTexture != nullptr)
+		{
+			shadowAtlasTexture->Bind(DEPTH_TEXTURE_0 + DEPTH_TEXTURE_SHADOW, true);
+			texelSize = shadowAtlasTexture->TexelSize();
+		}
+		this->lightingShader->UploadUniform("texelSize", &texelSize.x, UNIFORM_Vec4fv);
+
+		BindBuffers();
+
+		screenAlignedQuad->Bind(true);
+		glDrawElements(GL_TRIANGLES, screenAlignedQuad->NumIndices(), GL_UNSIGNED_INT, (void*)(0));
+	}
+
+
+	void ClusteredLighting::UploadBuffer(CLUSTER_BUFFER buffer, void const* data, size_t numBytes)
+	{
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, this->buffers[buffer]);
+
+		if (numBytes > this->bufferSizes[buffer])
+		{
+			// Grow geometrically, so adding lights doesn't reallocate every frame:
+			size_t newSize = glm::max(numBytes, this->bufferSizes[buffer] * 2);
+			glBufferData(GL_SHADER_STORAGE_BUFFER, newSize, nullptr, GL_DYNAMIC_DRAW);
+			this->bufferSizes[buffer] = newSize;
+		}
+
+		if (data != nullptr)
+		{
+			glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, numBytes, data);
+		}
+
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	}
+
+
+	void ClusteredLighting::BindBuffers()
+	{
+		for (int i = 0; i < CLUSTER_BUFFER_COUNT; i++)
+		{
+			glBindBufferBase(GL_SHADER_STORAGE_BUFFER, i, this->buffers[i]);
+		}
+	}
+}
+
+
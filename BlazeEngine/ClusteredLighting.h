@@ -0,0 +1,101 @@
+// Clustered lighting
+// Shades every point light in a single fullscreen pass. Lights are packed into shader storage buffers, and a compute shader assigns
+// them to a grid of view-space clusters (froxels): Screen tiles, split into exponential depth slices. Each fragment only evaluates
+// the lights assigned to its cluster, so the cost no longer scales with light volume overdraw
+
+#pragma once
+
+#include "glm.hpp"
+
+#include <GL/glew.h>
+
+#include <vector>
+
+using glm::vec3;
+using glm::vec4;
+using glm::mat4;
+using std::vector;
+
+
+#define CLUSTER_ASSIGNMENT_GROUP_SIZE	64	// Must match CLUSTER_ASSIGNMENT_GROUP_SIZE in clusterLightAssignment.comp
+
+
+namespace BlazeEngine
+{
+	// Pre-declarations:
+	class Camera;
+	class Light;
+	class Shader;
+	class Mesh;
+	class RenderTexture;
+
+
+	class ClusteredLighting
+	{
+	public:
+		ClusteredLighting(int gridX, int gridY, int gridZ, int maxLightsPerCluster);
+
+		~ClusteredLighting();
+
+		// Upload the point lights intersecting renderCam's frustum, and assign them to clusters
+		void Update(Camera* renderCam, vector<Light*> const& lights);
+
+		// Shade every assigned light. Note: The output FBO and GBuffer textures must be bound, and additive blending enabled
+		void Render(Camera* renderCam, Mesh* screenAlignedQuad, RenderTexture* shadowAtlasTexture);
+
+		// Returns false if the shaders failed to load: Point lights must be rendered individually instead
+		inline bool				IsValid() const		{ return assignmentShader != nullptr && lightingShader != nullptr; }
+		inline unsigned int		NumLights() const	{ return (unsigned int)lightData.size(); }
+		inline Shader*			LightingShader()	{ return lightingShader; }
+
+
+	private:
+		// Note: Layouts must match BlazeClustering.glsl (std430)
+		struct ClusterLight
+		{
+			vec4	positionRadius;				// .xyz = World position, .w = Radius
+			vec3	color;
+			int		shadowIndex;				// Index into shadowData, or -1 if the light is unshadowed
+		};
+
+		struct ClusterShadow
+		{
+			mat4	faceViewProjections[6];
+			vec4	tiles[6];
+			vec4	params;						// .x = Number of tiles, .y = Far, .z = Min bias, .w = Max bias
+		};
+
+		// SSBO binding points:
+		enum CLUSTER_BUFFER
+		{
+			CLUSTER_BUFFER_LIGHTS			= 0,
+			CLUSTER_BUFFER_SHADOWS			= 1,
+			CLUSTER_BUFFER_LIGHT_COUNTS		= 2,
+			CLUSTER_BUFFER_LIGHT_INDICES	= 3,
+
+			CLUSTER_BUFFER_COUNT
+		};
+
+		int gridX					= 16;
+		int gridY					= 9;
+		int gridZ					= 24;
+		int maxLightsPerCluster		= 128;
+
+		Shader* assignmentShader	= nullptr;	// Deallocated in ~ClusteredLighting()
+		Shader* lightingShader		= nullptr;	// Deallocated in ~ClusteredLighting()
+
+		GLuint buffers[CLUSTER_BUFFER_COUNT];
+		size_t bufferSizes[CLUSTER_BUFFER_COUNT];	// Allocated sizes, in bytes
+
+		vector<ClusterLight>	lightData;
+		vector<ClusterShadow>	shadowData;
+
+		// Helper function: Upload data to a buffer, growing it if required
+		void UploadBuffer(CLUSTER_BUFFER buffer, void const* data, size_t numBytes);
+
+		// Helper function: Bind every buffer to its SSBO binding point
+		void BindBuffers();
+	};
+}
+
+
@@ -0,0 +1,94 @@
+#include "DynamicResolution.h"
+#include "BuildConfiguration.h"
+
+#include <string>
+
+using std::to_string;
+
+
+namespace BlazeEngine
+{
+	DynamicResolution::DynamicResolution(int maxXRes, int maxYRes, float minScale, float maxScale, float targetFrameTimeMs)
+	{
+		this->maxXRes			= maxXRes;
+		this->maxYRes			= maxYRes;
+
+		this->maxScale			= glm::clamp(maxScale, 0.1f, 1.0f);
+		this->minScale			= glm::clamp(minScale, 0.1f, this->maxScale);
+		this->targetFrameTimeMs	= glm::max(targetFrameTimeMs, 0.1f);
+
+		// Start at the maximum scale, and let the controller find the budget:
+		this->scale				= this->maxScale;
+		this->viewportXRes		= ScaledResolution(maxXRes, this->scale);
+		this->viewportYRes		= ScaledResolution(maxYRes, this->scale);
+
+		LOG("Dynamic resolution: " + to_string(this->minScale) + "x to " + to_string(this->maxScale) + "x of " + to_string(maxXRes) + "x" + to_string(maxYRes) +
+			", targeting " + to_string(this->targetFrameTimeMs) + "ms");
+	}
+
+
+	bool DynamicResolution::Update(float frameTimeMs, float fixedTimeMs)
+	{
+		// Wait until the timings reflect the current scale:
+		if (this->settleFrames > 0)
+		{
+			this->settleFrames--;
+			return false;
+		}
+
+		if (frameTimeMs <= 0.0f)
+		{
+			return false; // No timings yet
+		}
+
+		// Hold the scale while the frame is within the target band:
+		bool isOverBudget	= frameTimeMs > this->targetFrameTimeMs;
+		bool isUnderBudget	= frameTimeMs < this->targetFrameTimeMs * (1.0f - DYNAMIC_RESOLUTION_HEADROOM);
+		if (!isOverBudget && !isUnderBudget)
+		{
+			return false;
+		}
+
+		// The scaled part of the frame costs ~scale^2: Find the scale that fits it into whatever the fixed cost leaves of the budget
+		float scaledTimeMs	= glm::max(frameTimeMs - fixedTimeMs, 0.01f);
+		float budgetMs		= this->targetFrameTimeMs - fixedTimeMs;
+
+		float targetScale	= budgetMs > 0.0f ? this->scale * glm::sqrt(budgetMs / scaledTimeMs) : this->minScale;
+		float newScale		= glm::clamp(this->scale + (targetScale - this->scale) * DYNAMIC_RESOLUTION_DAMPING, this->minScale, this->maxScale);
+
+		// Ignore small changes, unless they reach a limit:
+		if (glm::abs(newScale - this->scale) < DYNAMIC_RESOLUTION_MIN_STEP && newScale != this->minScale && newScale != this->maxScale)
+		{
+			return false;
+		}
+
+		int newXRes = ScaledResolution(this->maxXRes, newScale);
+		int newYRes = ScaledResolution(this->maxYRes, newScale);
+		if (newXRes == this->viewportXRes && newYRes == this->viewportYRes)
+		{
+			return false;
+		}
+
+		#if defined(DEBUG_RENDERMANAGER_DYNAMIC_RESOLUTION_LOGGING)
+			LOG("Dynamic resolution: " + to_string(frameTimeMs) + "ms (" + to_string(fixedTimeMs) + "ms fixed), scale " + to_string(this->scale) +
+				" -> " + to_string(newScale) + " (" + to_string(newXRes) + "x" + to_string(newYRes) + ")");
+		#endif
+
+		this->scale			= newScale;
+		this->viewportXRes	= newXRes;
+		this->viewportYRes	= newYRes;
+		this->settleFrames	= DYNAMIC_RESOLUTION_SETTLE_FRAMES;
+
+		return true;
+	}
+
+
+	int DynamicResolution::ScaledResolution(int maxRes, float scale)
+	{
+		int scaledRes = (int)glm::round((maxRes * scale) / (float)DYNAMIC_RESOLUTION_ALIGNMENT) * DYNAMIC_RESOLUTION_ALIGNMENT;
+
+		return glm::clamp(scaledRes, glm::min(DYNAMIC_RESOLUTION_ALIGNMENT, maxRes), maxRes);
+	}
+}
+
+
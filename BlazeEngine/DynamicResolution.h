@@ -0,0 +1,63 @@
+// Dynamic resolution controller
+// Scene passes render into targets sized for the maximum resolution, but only within a scaled viewport anchored at the origin. Each
+// frame, the scale is chosen from the GPU pass timings so the frame fits a target time. Pixel cost is modelled as proportional to
+// the viewport area, so only the resolution dependent part of the frame is scaled. The result is upscaled to the window when tone mapping
+
+#pragma once
+
+#define GLM_FORCE_SWIZZLE
+#include "glm.hpp"
+
+using glm::vec2;
+
+
+#define DYNAMIC_RESOLUTION_SETTLE_FRAMES	16		// Frames to wait after a change, so the (latent, smoothed) GPU timings reflect the new scale
+#define DYNAMIC_RESOLUTION_HEADROOM			0.1f	// Only scale up if the frame is this fraction under the target time
+#define DYNAMIC_RESOLUTION_DAMPING			0.5f	// Fraction of the way to the estimated scale to move per change
+#define DYNAMIC_RESOLUTION_MIN_STEP			0.02f	// Smaller scale changes are ignored
+#define DYNAMIC_RESOLUTION_ALIGNMENT		8		// Viewport dimensions are rounded to multiples of this many pixels
+
+
+namespace BlazeEngine
+{
+	class DynamicResolution
+	{
+	public:
+		// Scales are fractions of the maximum resolution, per axis
+		DynamicResolution(int maxXRes, int maxYRes, float minScale, float maxScale, float targetFrameTimeMs);
+
+		~DynamicResolution() {}
+
+		// Choose the scale for the next frame. frameTimeMs is the GPU time of the whole frame, and fixedTimeMs the part of it that
+		// doesn't depend on the viewport size (eg. shadows, and passes at window resolution). Returns true if the viewport changed
+		bool Update(float frameTimeMs, float fixedTimeMs);
+
+		// Getters:
+		inline float	Scale() const			{ return scale; }
+		inline int		ViewportXRes() const	{ return viewportXRes; }
+		inline int		ViewportYRes() const	{ return viewportYRes; }
+
+		// Fraction of the maximum resolution targets covered by the viewport. Exact, as the viewport is rounded to whole pixels
+		inline vec2		RenderScale() const		{ return vec2((float)viewportXRes / (float)maxXRes, (float)viewportYRes / (float)maxYRes); }
+
+
+	private:
+		int		maxXRes;
+		int		maxYRes;
+
+		float	minScale;
+		float	maxScale;
+		float	targetFrameTimeMs;
+
+		float	scale;
+		int		viewportXRes;
+		int		viewportYRes;
+
+		int		settleFrames	= DYNAMIC_RESOLUTION_SETTLE_FRAMES;
+
+		// Round a scaled dimension to the viewport alignment, clamped to [1, maxRes]
+		static int ScaledResolution(int maxRes, float scale);
+	};
+}
+
+
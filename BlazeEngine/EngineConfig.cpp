@@ -28,7 +28,39 @@ namespace BlazeEngine
 			// Quality settings:
 			{"useForwardRendering",					false},
 
-			{"numIEMSamples",						20000},	// Number of samples to use when generating IBL IEM texture
+			// Clustered lighting: Shades every point light in a single pass (deferred rendering only)
+			{"useClusteredLighting",				true},
+			{"clusterGridX",						16},	// Screen tiles
+			{"clusterGridY",						9},
+			{"clusterGridZ",						24},	// Exponential depth slices
+			{"maxLightsPerCluster",					128},
+
+			// Visibility buffer: Rasterize instance/triangle IDs, and resolve the GBuffer once per pixel (deferred rendering only)
+			{"useVisibilityBuffer",					false},
+
+			// Depth pre-pass: Lay down depth with a position-only pass, so the GBuffer pass shades each pixel once (deferred rendering only)
+			{"useDepthPrepass",						true},
+			{"depthPrepassOverdrawThreshold",		1.5f},	// Only pre-pass when the visible meshes' screen bounds cover the screen this many times
+
+			// Dynamic resolution: Scale the scene viewport to hold a GPU frame time budget, and upscale when tone mapping (deferred rendering only)
+			{"useDynamicResolution",				true},
+			{"dynamicResolutionMinScale",			0.5f},	// Fraction of windowXRes/windowYRes, per axis
+			{"dynamicResolutionMaxScale",			1.0f},
+			{"dynamicResolutionTargetMs",			16.6f},	// Target GPU frame time
+
+			// Bloom:
+			{"bloomLevels",							5},		// Number of half resolution bloom levels: Controls the bloom radius. Minimum 2
+			{"bloomIntensity",						1.0f},
+
+			// Textures:
+			{"releaseTextureCPUData",				true},	// Free textures' CPU texels once they're uploaded to the GPU
+			{"useTextureCompression",				true},	// Block compress material textures, and cache the results in containers next to the source images
+			{"textureCompressionQuality",			1},		// 0 = fast, 1 = normal, 2 = high (also uses BC7 for color). Changing this re-encodes cached containers
+			{"useTextureStreaming",					true},	// Stream in the finer mip levels of compressed textures as they're needed on screen
+			{"textureStreamingBudgetMB",				256},	// GPU memory the streamed textures may use. The least recently used levels are evicted beyond this
+			{"textureStreamingTailSize",				64},	// Streamed textures keep their levels of this size (and smaller) resident at all times
+			{"useMaterialTextureArrays",			false},	// Copy same size/format material textures into shared texture arrays, and draw materials in batches (deferred rendering only). Streaming is disabled for these textures
+
 			{"numPMREMSamples",						4096},	// Number of samples to use when generating IBL PMREM texture
 			
 			{"defaultIBLPath",						string("IBL\\ibl.hdr")},
@@ -45,6 +77,20 @@ namespace BlazeEngine
 			{"defaultMinShadowBias",				0.01f},
 			{"defaultMaxShadowBias",				0.05f},
 
+			// Cascaded shadow maps:
+			{"numShadowCascades",					4},		// Key light shadow cascades: 2-4, or 0/1 to fit a single shadow map to the scene
+			{"shadowCascadeSplitLambda",			0.75f},	// Practical split scheme blend: 0 = uniform splits, 1 = logarithmic splits
+			{"shadowCascadeMaxDistance",			100.0f},	// Key light shadows are not rendered beyond this distance from the camera
+
+			// Shadow map update rate:
+			{"shadowUpdateScreenSizeThreshold",		0.25f},	// Point lights with a (radius / distance) ratio below this are updated less frequently
+			{"maxShadowUpdateInterval",				4},		// Maximum number of frames between point light shadow map updates
+
+			// Shadow atlas (point lights):
+			{"shadowAtlasSize",						4096},	// Must be a power of two
+			{"minShadowAtlasTileResolution",		64},	// Must be a power of two. Max tile resolution is defaultShadowCubeMapthWidth
+			{"defaultPointShadowMode",				string("geometryShader")},	// geometryShader, instanced, multiPass, or dualParaboloid. Overridden by "shadowMode" light metadata
+
 			// Texture dimensions:
 			{"defaultShadowMapWidth",				2048},
 			{"defaultShadowMapHeight",				2048},
@@ -59,17 +105,22 @@ namespace BlazeEngine
 			// Depth map rendering:
 			{"depthShaderName",						string("depthShader")},
 			{"cubeDepthShaderName",					string("cubeDepthShader")},
+			{"pointShadowDepthShaderName",			string("pointShadowDepthShader")},
 
 			// Deferred rendering:
 			{"gBufferFillShaderName",				string("gBufferFillShader")},
 			{"deferredAmbientLightShaderName",		string("deferredAmbientLightShader")},
 			{"deferredKeylightShaderName",			string("deferredKeyLightShader")},
 			{"deferredPointLightShaderName",		string("deferredPointLightShader")},
+			{"deferredClusteredLightShaderName",	string("deferredClusteredLightShader")},
+			{"clusterLightAssignmentShaderName",	string("clusterLightAssignment")},
+			{"visibilityBufferShaderName",			string("visibilityBufferShader")},
+			{"visibilityResolveShaderName",			string("visibilityResolveShader")},
 			{"skyboxShaderName",					string("skyboxShader")},
 			{"equilinearToCubemapBlitShaderName",	string("equilinearToCubemapBlitShader")},
 			{"BRDFIntegrationMapShaderName",		string("BRDFIntegrationMapShader")},
 			{"blitShader",							string("blitShader")},
-			{"blurShader",							string("blurShader")},
+			{"bloomShader",							string("bloomShader")},
 			{"toneMapShader",						string("toneMapShader")},
 			{"defaultSceneEmissiveIntensity",		2.0f},	// Multiplier used to scale [0,1] emissive values when writing to GBuffer, so they'll bloom
 
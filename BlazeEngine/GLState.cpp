@@ -0,0 +1,392 @@
+#include "GLState.h"
+#include "BuildConfiguration.h"
+
+
+namespace BlazeEngine
+{
+	// Sentinel value used to mark a cached object binding as unknown:
+	#define GL_STATE_UNKNOWN_OBJECT		0xFFFFFFFF
+	#define GL_STATE_UNKNOWN_ENUM		GL_INVALID_ENUM
+
+
+	GLState::GLState()
+	{
+		Invalidate();
+	}
+
+
+	GLState& GLState::Instance()
+	{
+		static GLState* instance = new GLState();
+		return *instance;
+	}
+
+
+	void GLState::Invalidate()
+	{
+		this->program			= GL_STATE_UNKNOWN_OBJECT;
+		this->vertexArray		= GL_STATE_UNKNOWN_OBJECT;
+		this->framebuffer		= GL_STATE_UNKNOWN_OBJECT;
+
+		this->activeTextureUnit	= -1;
+		for (int currentUnit = 0; currentUnit < GL_STATE_NUM_TEXTURE_UNITS; currentUnit++)
+		{
+			for (int currentTarget = 0; currentTarget < GL_STATE_TEXTURE_TARGET_COUNT; currentTarget++)
+			{
+				this->textures[currentUnit][currentTarget] = GL_STATE_UNKNOWN_OBJECT;
+			}
+			this->samplers[currentUnit] = GL_STATE_UNKNOWN_OBJECT;
+		}
+
+		for (int i = 0; i < 4; i++)
+		{
+			this->viewport[i]	= -1;
+			this->scissor[i]	= -1;
+		}
+
+		this->blendEnabled				= -1;
+		this->depthTestEnabled			= -1;
+		this->cullFaceEnabled			= -1;
+		this->scissorTestEnabled		= -1;
+		this->framebufferSRGBEnabled	= -1;
+
+		this->blendSrcFactor	= GL_STATE_UNKNOWN_ENUM;
+		this->blendDstFactor	= GL_STATE_UNKNOWN_ENUM;
+		this->depthFunc			= GL_STATE_UNKNOWN_ENUM;
+		this->depthWriteEnabled	= -1;
+		this->cullMode			= GL_STATE_UNKNOWN_ENUM;
+	}
+
+
+	void GLState::EndFrame()
+	{
+		this->lastFrameCallsIssued	= this->callsIssued;
+		this->lastFrameCallsSaved	= this->callsSaved;
+
+		this->callsIssued			= 0;
+		this->callsSaved			= 0;
+
+		#if defined(DEBUG_RENDERMANAGER_GL_STATE_LOGGING)
+			LOG("GL state cache: " + to_string(this->lastFrameCallsIssued) + " state changes issued, " + to_string(this->lastFrameCallsSaved) + " redundant calls filtered");
+		#endif
+	}
+
+
+	// Bound objects:
+	//---------------
+
+	void GLState::UseProgram(GLuint program)
+	{
+		if (UpdateCachedValue(this->program, program))
+		{
+			glUseProgram(program);
+		}
+	}
+
+
+	void GLState::BindVertexArray(GLuint vertexArray)
+	{
+		if (UpdateCachedValue(this->vertexArray, vertexArray))
+		{
+			glBindVertexArray(vertexArray);
+		}
+	}
+
+
+	void GLState::BindFramebuffer(GLuint framebuffer)
+	{
+		if (UpdateCachedValue(this->framebuffer, framebuffer))
+		{
+			glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+		}
+	}
+
+
+	void GLState::ActiveTexture(int textureUnit)
+	{
+		if (UpdateCachedValue(this->activeTextureUnit, textureUnit))
+		{
+			glActiveTexture(GL_TEXTURE0 + textureUnit);
+		}
+	}
+
+
+	void GLState::BindTexture(int textureUnit, GLenum textureTarget, GLuint texture)
+	{
+		GL_STATE_TEXTURE_TARGET targetIndex = GetTextureTargetIndex(textureTarget);
+
+		if (textureUnit < 0 || textureUnit >= GL_STATE_NUM_TEXTURE_UNITS || targetIndex == GL_STATE_TEXTURE_TARGET_COUNT)
+		{
+			// Untracked unit/target: Always forward the call
+			ActiveTexture(textureUnit);
+			glBindTexture(textureTarget, texture);
+			this->callsIssued++;
+			return;
+		}
+
+		if (this->textures[textureUnit][targetIndex] == texture)
+		{
+			this->callsSaved++;
+			return;
+		}
+
+		ActiveTexture(textureUnit);
+		glBindTexture(textureTarget, texture);
+
+		this->textures[textureUnit][targetIndex] = texture;
+		this->callsIssued++;
+	}
+
+
+	void GLState::BindSampler(int textureUnit, GLuint sampler)
+	{
+		if (textureUnit < 0 || textureUnit >= GL_STATE_NUM_TEXTURE_UNITS)
+		{
+			glBindSampler(textureUnit, sampler);
+			this->callsIssued++;
+			return;
+		}
+
+		if (UpdateCachedValue(this->samplers[textureUnit], sampler))
+		{
+			glBindSampler(textureUnit, sampler);
+		}
+	}
+
+
+	void GLState::OnProgramDeleted(GLuint program)
+	{
+		// Deleted programs remain in use until they're no longer part of the current rendering state: Release it now
+		if (this->program == program)
+		{
+			glUseProgram(0);
+			this->program = 0;
+		}
+	}
+
+
+	void GLState::OnVertexArrayDeleted(GLuint vertexArray)
+	{
+		if (this->vertexArray == vertexArray)
+		{
+			this->vertexArray = 0;
+		}
+	}
+
+
+	void GLState::OnFramebufferDeleted(GLuint framebuffer)
+	{
+		if (this->framebuffer == framebuffer)
+		{
+			this->framebuffer = 0;
+		}
+	}
+
+
+	void GLState::OnTextureDeleted(GLuint texture)
+	{
+		for (int currentUnit = 0; currentUnit < GL_STATE_NUM_TEXTURE_UNITS; currentUnit++)
+		{
+			for (int currentTarget = 0; currentTarget < GL_STATE_TEXTURE_TARGET_COUNT; currentTarget++)
+			{
+				if (this->textures[currentUnit][currentTarget] == texture)
+				{
+					this->textures[currentUnit][currentTarget] = 0;
+				}
+			}
+		}
+	}
+
+
+	void GLState::OnSamplerDeleted(GLuint sampler)
+	{
+		for (int currentUnit = 0; currentUnit < GL_STATE_NUM_TEXTURE_UNITS; currentUnit++)
+		{
+			if (this->samplers[currentUnit] == sampler)
+			{
+				this->samplers[currentUnit] = 0;
+			}
+		}
+	}
+
+
+	// Fixed function state:
+	//----------------------
+
+	void GLState::Viewport(GLint x, GLint y, GLsizei width, GLsizei height)
+	{
+		if (this->viewport[0] == x && this->viewport[1] == y && this->viewport[2] == width && this->viewport[3] == height)
+		{
+			this->callsSaved++;
+			return;
+		}
+
+		glViewport(x, y, width, height);
+
+		this->viewport[0] = x;
+		this->viewport[1] = y;
+		this->viewport[2] = width;
+		this->viewport[3] = height;
+		this->callsIssued++;
+	}
+
+
+	void GLState::ViewportIndexed(GLuint index, GLint x, GLint y, GLsizei width, GLsizei height)
+	{
+		if (index == 0)
+		{
+			Viewport(x, y, width, height); // glViewport sets viewport 0
+			return;
+		}
+
+		glViewportIndexedf(index, (GLfloat)x, (GLfloat)y, (GLfloat)width, (GLfloat)height);
+		this->callsIssued++;
+	}
+
+
+	void GLState::Scissor(GLint x, GLint y, GLsizei width, GLsizei height)
+	{
+		if (this->scissor[0] == x && this->scissor[1] == y && this->scissor[2] == width && this->scissor[3] == height)
+		{
+			this->callsSaved++;
+			return;
+		}
+
+		glScissor(x, y, width, height);
+
+		this->scissor[0] = x;
+		this->scissor[1] = y;
+		this->scissor[2] = width;
+		this->scissor[3] = height;
+		this->callsIssued++;
+	}
+
+
+	void GLState::SetCapability(GLenum capability, bool enable)
+	{
+		int* cachedValue = nullptr;
+		switch (capability)
+		{
+		case GL_BLEND:
+			cachedValue = &this->blendEnabled;
+			break;
+
+		case GL_DEPTH_TEST:
+			cachedValue = &this->depthTestEnabled;
+			break;
+
+		case GL_CULL_FACE:
+			cachedValue = &this->cullFaceEnabled;
+			break;
+
+		case GL_SCISSOR_TEST:
+			cachedValue = &this->scissorTestEnabled;
+			break;
+
+		case GL_FRAMEBUFFER_SRGB:
+			cachedValue = &this->framebufferSRGBEnabled;
+			break;
+
+		default:
+			break;
+		}
+
+		if (cachedValue == nullptr || UpdateCachedValue(*cachedValue, (int)enable))
+		{
+			if (enable)
+			{
+				glEnable(capability);
+			}
+			else
+			{
+				glDisable(capability);
+			}
+
+			if (cachedValue == nullptr)
+			{
+				this->callsIssued++; // Untracked capability: Always forwarded
+			}
+		}
+	}
+
+
+	void GLState::BlendFunc(GLenum srcFactor, GLenum dstFactor)
+	{
+		if (this->blendSrcFactor == srcFactor && this->blendDstFactor == dstFactor)
+		{
+			this->callsSaved++;
+			return;
+		}
+
+		glBlendFunc(srcFactor, dstFactor);
+
+		this->blendSrcFactor	= srcFactor;
+		this->blendDstFactor	= dstFactor;
+		this->callsIssued++;
+	}
+
+
+	void GLState::DepthFunc(GLenum depthFunc)
+	{
+		if (UpdateCachedValue(this->depthFunc, depthFunc))
+		{
+			glDepthFunc(depthFunc);
+		}
+	}
+
+
+	void GLState::DepthMask(bool depthWrite)
+	{
+		if (UpdateCachedValue(this->depthWriteEnabled, (int)depthWrite))
+		{
+			glDepthMask(depthWrite ? GL_TRUE : GL_FALSE);
+		}
+	}
+
+
+	void GLState::CullFace(GLenum cullMode)
+	{
+		if (UpdateCachedValue(this->cullMode, cullMode))
+		{
+			glCullFace(cullMode);
+		}
+	}
+
+
+	// Private member functions:
+	//--------------------------
+
+	template <typename T>
+	bool GLState::UpdateCachedValue(T& cachedValue, T const& newValue)
+	{
+		if (cachedValue == newValue)
+		{
+			this->callsSaved++;
+			return false;
+		}
+
+		cachedValue = newValue;
+		this->callsIssued++;
+
+		return true;
+	}
+
+
+	GL_STATE_TEXTURE_TARGET GLState::GetTextureTargetIndex(GLenum textureTarget)
+	{
+		switch (textureTarget)
+		{
+		case GL_TEXTURE_2D:
+			return GL_STATE_TEXTURE_2D;
+
+		case GL_TEXTURE_CUBE_MAP:
+			return GL_STATE_TEXTURE_CUBE_MAP;
+
+		case GL_TEXTURE_2D_ARRAY:
+			return GL_STATE_TEXTURE_2D_ARRAY;
+
+		default:
+			return GL_STATE_TEXTURE_TARGET_COUNT;
+		}
+	}
+}
@@ -0,0 +1,125 @@
+// OpenGL state cache
+// Tracks bound objects and fixed-function state, and filters out redundant OpenGL calls.
+// NOTE: All engine code should modify the state tracked here via the GLState. If OpenGL state is changed directly, call Invalidate()
+
+#pragma once
+
+#include <GL/glew.h>
+
+
+// Number of texture units tracked by the state cache. Must be large enough to contain every TEXTURE_TYPE unit defined in Material.h
+#define GL_STATE_NUM_TEXTURE_UNITS	32
+
+
+namespace BlazeEngine
+{
+	// Texture targets tracked per texture unit:
+	enum GL_STATE_TEXTURE_TARGET
+	{
+		GL_STATE_TEXTURE_2D,
+		GL_STATE_TEXTURE_CUBE_MAP,
+		GL_STATE_TEXTURE_2D_ARRAY,
+
+		GL_STATE_TEXTURE_TARGET_COUNT	// RESERVED: Number of tracked texture targets
+	};
+
+
+	class GLState
+	{
+	public:
+		GLState();
+
+		// Singleton functionality:
+		static GLState& Instance();
+		GLState(GLState const&) = delete; // Disallow copying of our Singleton
+		void operator=(GLState const&) = delete;
+
+		// Forget all cached state: The next call to each function will always be forwarded to OpenGL
+		void Invalidate();
+
+		// Finish recording statistics for the current frame
+		void EndFrame();
+
+		inline unsigned int CallsIssuedLastFrame() const	{ return lastFrameCallsIssued; }
+		inline unsigned int CallsSavedLastFrame() const		{ return lastFrameCallsSaved; }
+
+
+		// Bound objects:
+		//---------------
+		void UseProgram(GLuint program);
+		void BindVertexArray(GLuint vertexArray);
+		void BindFramebuffer(GLuint framebuffer);
+
+		void ActiveTexture(int textureUnit);
+		void BindTexture(int textureUnit, GLenum textureTarget, GLuint texture);	// Note: Also makes textureUnit the active texture unit
+		void BindSampler(int textureUnit, GLuint sampler);
+
+		inline int ActiveTextureUnit() const { return activeTextureUnit; }
+
+		// Notify the cache that an object has been deleted. OpenGL silently unbinds deleted objects, and their names may be reused
+		void OnProgramDeleted(GLuint program);
+		void OnVertexArrayDeleted(GLuint vertexArray);
+		void OnFramebufferDeleted(GLuint framebuffer);
+		void OnTextureDeleted(GLuint texture);
+		void OnSamplerDeleted(GLuint sampler);
+
+
+		// Fixed function state:
+		//----------------------
+		void Viewport(GLint x, GLint y, GLsizei width, GLsizei height);
+		void ViewportIndexed(GLuint index, GLint x, GLint y, GLsizei width, GLsizei height);	// Viewport arrays: Only index 0 is cached
+		void Scissor(GLint x, GLint y, GLsizei width, GLsizei height);
+
+		void SetCapability(GLenum capability, bool enable);	// GL_BLEND, GL_DEPTH_TEST, GL_CULL_FACE, GL_SCISSOR_TEST, GL_FRAMEBUFFER_SRGB
+		void BlendFunc(GLenum srcFactor, GLenum dstFactor);
+		void DepthFunc(GLenum depthFunc);
+		void DepthMask(bool depthWrite);
+		void CullFace(GLenum cullMode);
+
+
+	private:
+		// Bound objects:
+		GLuint	program;
+		GLuint	vertexArray;
+		GLuint	framebuffer;
+
+		int		activeTextureUnit;
+		GLuint	textures[GL_STATE_NUM_TEXTURE_UNITS][GL_STATE_TEXTURE_TARGET_COUNT];
+		GLuint	samplers[GL_STATE_NUM_TEXTURE_UNITS];
+
+		// Fixed function state:
+		GLint	viewport[4];
+		GLint	scissor[4];
+
+		int		blendEnabled;	// -1 == unknown, 0 == disabled, 1 == enabled
+		int		depthTestEnabled;
+		int		cullFaceEnabled;
+		int		scissorTestEnabled;
+		int		framebufferSRGBEnabled;
+
+		GLenum	blendSrcFactor;
+		GLenum	blendDstFactor;
+		GLenum	depthFunc;
+		int		depthWriteEnabled;
+		GLenum	cullMode;
+
+		// Statistics:
+		unsigned int callsIssued			= 0;
+		unsigned int callsSaved				= 0;
+		unsigned int lastFrameCallsIssued	= 0;
+		unsigned int lastFrameCallsSaved	= 0;
+
+
+		// Private member functions:
+		//--------------------------
+
+		// Helper function: Returns true (and counts the issued call) if the cached value differs from newValue, and updates the cache
+		template <typename T>
+		bool UpdateCachedValue(T& cachedValue, T const& newValue);
+
+		// Helper function: Maps an OpenGL texture target to a GL_STATE_TEXTURE_TARGET. Returns GL_STATE_TEXTURE_TARGET_COUNT if untracked
+		static GL_STATE_TEXTURE_TARGET GetTextureTargetIndex(GLenum textureTarget);
+	};
+}
+
+
@@ -0,0 +1,145 @@
+#include "GPUTimer.h"
+#include "BuildConfiguration.h"
+
+#include <string>
+
+using std::to_string;
+
+
+namespace BlazeEngine
+{
+	GPUTimer::~GPUTimer()
+	{
+		for (unsigned int i = 0; i < (unsigned int)this->passes.size(); i++)
+		{
+			glDeleteQueries(GPU_TIMER_FRAME_LATENCY, &this->passes[i].queries[0]);
+		}
+		this->passes.clear();
+		this->passIndices.clear();
+	}
+
+
+	void GPUTimer::BeginPass(string const& passName)
+	{
+		if (this->activePass >= 0)
+		{
+			LOG_ERROR("Cannot begin timing pass \"" + passName + "\" before the previous pass has ended");
+			return;
+		}
+
+		auto result = this->passIndices.find(passName);
+		if (result == this->passIndices.end())
+		{
+			PassTimer newPass;
+			newPass.name = passName;
+			glGenQueries(GPU_TIMER_FRAME_LATENCY, &newPass.queries[0]);
+			for (int i = 0; i < GPU_TIMER_FRAME_LATENCY; i++)
+			{
+				newPass.isPending[i] = false;
+			}
+
+			result = this->passIndices.emplace(passName, (unsigned int)this->passes.size()).first;
+			this->passes.emplace_back(newPass);
+		}
+
+		this->activePass = (int)result->second;
+
+		PassTimer& currentPass		= this->passes[this->activePass];
+		unsigned int queryIndex		= this->frameCount % GPU_TIMER_FRAME_LATENCY;
+		currentPass.isPending[queryIndex] = true;
+		currentPass.lastFrame				= this->frameCount;
+
+		glBeginQuery(GL_TIME_ELAPSED, currentPass.queries[queryIndex]);
+	}
+
+
+	void GPUTimer::EndPass()
+	{
+		if (this->activePass < 0)
+		{
+			return;
+		}
+
+		glEndQuery(GL_TIME_ELAPSED);
+		this->activePass = -1;
+	}
+
+
+	void GPUTimer::EndFrame()
+	{
+		this->frameCount++;
+
+		// The next frame reuses the oldest queries: Read them back if they've finished. Unfinished results are discarded, rather than
+		// stalling until they're available
+		unsigned int queryIndex = this->frameCount % GPU_TIMER_FRAME_LATENCY;
+		for (unsigned int i = 0; i < (unsigned int)this->passes.size(); i++)
+		{
+			PassTimer& currentPass = this->passes[i];
+			if (!currentPass.isPending[queryIndex])
+			{
+				continue;
+			}
+			currentPass.isPending[queryIndex] = false;
+
+			GLint isAvailable = GL_FALSE;
+			glGetQueryObjectiv(currentPass.queries[queryIndex], GL_QUERY_RESULT_AVAILABLE, &isAvailable);
+			if (isAvailable == GL_FALSE)
+			{
+				continue;
+			}
+
+			GLuint64 elapsedNs = 0;
+			glGetQueryObjectui64v(currentPass.queries[queryIndex], GL_QUERY_RESULT, &elapsedNs);
+
+			float elapsedMs = (float)((double)elapsedNs * 0.000001);
+			if (currentPass.hasResult)
+			{
+				currentPass.averageTimeMs += (elapsedMs - currentPass.averageTimeMs) * GPU_TIMER_SMOOTHING;
+			}
+			else
+			{
+				currentPass.averageTimeMs	= elapsedMs;
+				currentPass.hasResult		= true;
+			}
+		}
+	}
+
+
+	float GPUTimer::PassTime(string const& passName) const
+	{
+		auto result = this->passIndices.find(passName);
+		if (result == this->passIndices.end())
+		{
+			return 0.0f;
+		}
+		return this->passes[result->second].averageTimeMs;
+	}
+
+
+	float GPUTimer::TotalTime() const
+	{
+		float totalMs = 0.0f;
+		for (unsigned int i = 0; i < (unsigned int)this->passes.size(); i++)
+		{
+			if (this->passes[i].hasResult && this->frameCount - this->passes[i].lastFrame <= GPU_TIMER_FRAME_LATENCY)
+			{
+				totalMs += this->passes[i].averageTimeMs;
+			}
+		}
+		return totalMs;
+	}
+
+
+	void GPUTimer::LogPassTimes() const
+	{
+		float totalMs = 0.0f;
+		for (unsigned int i = 0; i < (unsigned int)this->passes.size(); i++)
+		{
+			LOG("GPU pass \"" + this->passes[i].name + "\": " + to_string(this->passes[i].averageTimeMs) + "ms");
+			totalMs += this->passes[i].averageTimeMs;
+		}
+		LOG("GPU total (timed passes): " + to_string(totalMs) + "ms");
+	}
+}
+
+
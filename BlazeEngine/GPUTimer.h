@@ -0,0 +1,71 @@
+// GPU pass timer
+// Measures the GPU time of render passes with GL_TIME_ELAPSED queries. Each pass keeps a small ring of queries, and results are
+// only read back once they're available (a few frames later), so timing never stalls the pipeline
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+using std::string;
+using std::vector;
+using std::unordered_map;
+
+
+#define GPU_TIMER_FRAME_LATENCY		3		// Number of frames of queries in flight per pass
+#define GPU_TIMER_SMOOTHING			0.1f	// Weight of the newest sample in each pass' running average
+
+
+namespace BlazeEngine
+{
+	class GPUTimer
+	{
+	public:
+		GPUTimer() {}
+
+		~GPUTimer();
+
+		// Time the GL commands issued between BeginPass() and EndPass(). Note: Passes can't be nested or overlap
+		void BeginPass(string const& passName);
+		void EndPass();
+
+		// Collect any finished results, and advance to the next frame. Call once per frame
+		void EndFrame();
+
+		// Running average of a pass' GPU time, in ms. Returns 0 for passes that haven't been timed (yet)
+		float PassTime(string const& passName) const;
+
+		// Sum of the running averages of the passes timed within the last GPU_TIMER_FRAME_LATENCY frames, in ms. Passes that have
+		// stopped running (eg. a pass the render graph culled) aren't counted
+		float TotalTime() const;
+
+		// Log the GPU time of every pass
+		void LogPassTimes() const;
+
+		// Getters:
+		inline unsigned int FrameCount() const	{ return frameCount; }
+
+
+	private:
+		struct PassTimer
+		{
+			string	name;
+			GLuint	queries[GPU_TIMER_FRAME_LATENCY];
+			bool	isPending[GPU_TIMER_FRAME_LATENCY];	// Query was issued, and its result hasn't been read yet
+			float	averageTimeMs	= 0.0f;
+			bool	hasResult		= false;
+			GLuint	lastFrame		= 0;	// Frame the pass was last timed
+		};
+
+		vector<PassTimer>					passes;		// In the order they were first timed
+		unordered_map<string, unsigned int>	passIndices;
+
+		unsigned int	frameCount	= 0;
+		int				activePass	= -1;
+	};
+}
+
+
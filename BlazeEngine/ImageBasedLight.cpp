@@ -7,25 +7,151 @@
 #include "Texture.h"
 #include "Material.h"
 #include "RenderTexture.h"
+#include "GLState.h"
 
 #include "glm.hpp"
+#include "gtc/constants.hpp"
 
+#include <vector>
+#include <thread>
+#include <emmintrin.h>	// SSE2
 
-namespace BlazeEngine
+using glm::dvec3;
+using std::vector;
+using std::to_string;
+
+
+namespace
 {
-	ImageBasedLight::ImageBasedLight(string lightName, string relativeHDRPath) : Light(lightName, LIGHT_AMBIENT_IBL, vec3(0))
+	// Real spherical harmonics basis constants, for the polynomials in the order of ImageBasedLight::ProjectIrradianceSH():
+	const float SH_BASIS[IBL_SH_COEFFICIENT_COUNT] =
 	{
-		// IEM setup:
-		this->IEM_Material = new Material("IEM_Material", nullptr, CUBE_MAP_NUM_FACES, true);
+		0.282095f,								// Band 0: 1
+		0.488603f, 0.488603f, 0.488603f,		// Band 1: y, z, x
+		1.092548f, 1.092548f, 0.315392f, 1.092548f, 0.546274f	// Band 2: xy, yz, 3z^2 - 1, xz, x^2 - y^2
+	};
+
+	// Convolution of each band with the clamped cosine lobe, divided by PI. The result is the cosine weighted mean radiance that
+	// deferred ambient light shader multiplies with albedo, without a 1/PI factor
+	const float SH_COSINE_LOBE[IBL_SH_COEFFICIENT_COUNT] =
+	{
+		1.0f,
+		2.0f / 3.0f, 2.0f / 3.0f, 2.0f / 3.0f,
+		0.25f, 0.25f, 0.25f, 0.25f, 0.25f
+	};
 
-		Texture** IEM_Textures = (Texture**)ConvertEquirectangularToCubemap(CoreEngine::GetSceneManager()->GetCurrentSceneName(), relativeHDRPath, this->xRes, this->yRes, IBL_IEM);
 
-		if (IEM_Textures != nullptr)
+	inline float HorizontalSum(__m128 value)
+	{
+		__m128 shuffled	= _mm_shuffle_ps(value, value, _MM_SHUFFLE(2, 3, 0, 1));
+		__m128 sums		= _mm_add_ps(value, shuffled);
+		shuffled		= _mm_movehl_ps(shuffled, sums);
+		sums			= _mm_add_ss(sums, shuffled);
+		return _mm_cvtss_f32(sums);
+	}
+
+
+	// Project rows [firstRow, lastRow) of an equirectangular RGBA float image onto the SH polynomials (without their constants).
+	// sums receives IBL_SH_COEFFICIENT_COUNT RGB triplets, weighted by the solid angle of each texel. cosPhi/sinPhi hold the
+	// azimuth of each column. 4 texels are processed at a time
+	void ProjectRows(float const* texels, unsigned int width, unsigned int height, float const* cosPhi, float const* sinPhi, unsigned int firstRow, unsigned int lastRow, double* sums)
+	{
+		float const texelArea	= (glm::two_pi<float>() / (float)width) * (glm::pi<float>() / (float)height);
+
+		__m128 const one		= _mm_set1_ps(1.0f);
+		__m128 const three		= _mm_set1_ps(3.0f);
+
+		for (unsigned int row = firstRow; row < lastRow; row++)
 		{
-			this->IEM_isValid = true;
+			// Inverse of DirectionToEquirectangularUV() in BlazeGlobals.glsl: v = asin(y) / PI + 0.5
+			float elevation		= (((float)row + 0.5f) / (float)height - 0.5f) * glm::pi<float>();
+			float y				= glm::sin(elevation);
+			float cosElevation	= glm::cos(elevation);
+
+			__m128 const y4				= _mm_set1_ps(y);
+			__m128 const cosElevation4	= _mm_set1_ps(cosElevation);
 
-			this->IEM_Material->AttachCubeMapTextures(IEM_Textures);
+			__m128 rowSums[IBL_SH_COEFFICIENT_COUNT * 3];
+			for (int i = 0; i < IBL_SH_COEFFICIENT_COUNT * 3; i++)
+			{
+				rowSums[i] = _mm_setzero_ps();
+			}
+
+			float const* rowTexels = texels + (size_t)row * width * 4;
+
+			unsigned int col = 0;
+			for (; col + 4 <= width; col += 4)
+			{
+				// Deinterleave 4 RGBA texels:
+				__m128 r = _mm_loadu_ps(rowTexels + col * 4);
+				__m128 g = _mm_loadu_ps(rowTexels + col * 4 + 4);
+				__m128 b = _mm_loadu_ps(rowTexels + col * 4 + 8);
+				__m128 a = _mm_loadu_ps(rowTexels + col * 4 + 12);
+				_MM_TRANSPOSE4_PS(r, g, b, a);
+
+				__m128 x = _mm_mul_ps(cosElevation4, _mm_loadu_ps(cosPhi + col));
+				__m128 z = _mm_mul_ps(cosElevation4, _mm_loadu_ps(sinPhi + col));
+
+				__m128 const basis[IBL_SH_COEFFICIENT_COUNT] =
+				{
+					one,
+					y4,
+					z,
+					x,
+					_mm_mul_ps(x, y4),
+					_mm_mul_ps(y4, z),
+					_mm_sub_ps(_mm_mul_ps(three, _mm_mul_ps(z, z)), one),
+					_mm_mul_ps(x, z),
+					_mm_sub_ps(_mm_mul_ps(x, x), _mm_mul_ps(y4, y4))
+				};
+
+				for (int i = 0; i < IBL_SH_COEFFICIENT_COUNT; i++)
+				{
+					rowSums[i * 3]		= _mm_add_ps(rowSums[i * 3],		_mm_mul_ps(basis[i], r));
+					rowSums[i * 3 + 1]	= _mm_add_ps(rowSums[i * 3 + 1],	_mm_mul_ps(basis[i], g));
+					rowSums[i * 3 + 2]	= _mm_add_ps(rowSums[i * 3 + 2],	_mm_mul_ps(basis[i], b));
+				}
+			}
+
+			float rowTotals[IBL_SH_COEFFICIENT_COUNT * 3];
+			for (int i = 0; i < IBL_SH_COEFFICIENT_COUNT * 3; i++)
+			{
+				rowTotals[i] = HorizontalSum(rowSums[i]);
+			}
+
+			// Remaining columns:
+			for (; col < width; col++)
+			{
+				float x = cosElevation * cosPhi[col];
+				float z = cosElevation * sinPhi[col];
+
+				float const basis[IBL_SH_COEFFICIENT_COUNT] = { 1.0f, y, z, x, x * y, y * z, 3.0f * z * z - 1.0f, x * z, x * x - y * y };
+
+				for (int i = 0; i < IBL_SH_COEFFICIENT_COUNT; i++)
+				{
+					rowTotals[i * 3]		+= basis[i] * rowTexels[col * 4];
+					rowTotals[i * 3 + 1]	+= basis[i] * rowTexels[col * 4 + 1];
+					rowTotals[i * 3 + 2]	+= basis[i] * rowTexels[col * 4 + 2];
+				}
+			}
+
+			// Texels shrink towards the poles:
+			double rowWeight = (double)(cosElevation * texelArea);
+			for (int i = 0; i < IBL_SH_COEFFICIENT_COUNT * 3; i++)
+			{
+				sums[i] += rowTotals[i] * rowWeight;
+			}
 		}
+	}
+}
+
+
+namespace BlazeEngine
+{
+	ImageBasedLight::ImageBasedLight(string lightName, string relativeHDRPath) : Light(lightName, LIGHT_AMBIENT_IBL, vec3(0))
+	{
+		// Diffuse irradiance setup: Projected first, while the HDR image's CPU texels are still available
+		this->irradiance_isValid = ProjectIrradianceSH(CoreEngine::GetSceneManager()->GetCurrentSceneName(), relativeHDRPath, this->irradianceSH);
 
 		// PMREM setup:
 		this->PMREM_Material = new Material("PMREM_Material", nullptr, CUBE_MAP_NUM_FACES, true);
@@ -48,6 +174,7 @@ namespace BlazeEngine
 		if (this->DeferredMaterial() != nullptr && this->DeferredMaterial()->GetShader() != nullptr)
 		{
 			this->DeferredMaterial()->GetShader()->UploadUniform("maxMipLevel", &this->maxMipLevel, UNIFORM_Int);
+			this->DeferredMaterial()->GetShader()->UploadUniform("irradianceSH", &this->irradianceSH[0].x, UNIFORM_Vec3fv, IBL_SH_COEFFICIENT_COUNT);
 		}
 		else
 		{
@@ -58,14 +185,6 @@ namespace BlazeEngine
 	
 	ImageBasedLight::~ImageBasedLight()
 	{
-		if (this->IEM_Material != nullptr)
-		{
-			this->IEM_Material->Destroy();
-			delete this->IEM_Material;
-			this->IEM_Material	= nullptr;
-			this->IEM_isValid	= false;
-		}
-
 		if (this->PMREM_Material != nullptr)
 		{
 			this->PMREM_Material->Destroy();
@@ -88,13 +207,7 @@ namespace BlazeEngine
 		string cubemapName;
 		vector<string> shaderKeywords;
 		int textureUnit = -1;	// For now, derrive the cube map texture unit based on the type of texture
-		if (iblType == IBL_IEM)
-		{
-			cubemapName = "IBL_IEM";
-			shaderKeywords.push_back("BLIT_IEM");
-			textureUnit = (int)CUBE_MAP_0;
-		}
-		else if (iblType == IBL_PMREM)
+		if (iblType == IBL_PMREM)
 		{
 			cubemapName = "IBL_PMREM";
 			shaderKeywords.push_back("BLIT_PMREM");
@@ -187,16 +300,11 @@ namespace BlazeEngine
 
 		// Set shader parameters:
 		//-----------------------
-		int numSamples;
-		if (iblType == IBL_IEM)
-		{
-			numSamples = CoreEngine::GetCoreEngine()->GetConfig()->GetValue<int>("numIEMSamples");
-		}
-		else if (iblType == IBL_PMREM)
+		if (iblType == IBL_PMREM)
 		{
-			numSamples = CoreEngine::GetCoreEngine()->GetConfig()->GetValue<int>("numPMREMSamples");
+			int numSamples = CoreEngine::GetCoreEngine()->GetConfig()->GetValue<int>("numPMREMSamples");
+			equirectangularToCubemapBlitShader->UploadUniform("numSamples", &numSamples, UNIFORM_Int); // "numSamples" is defined directly in equilinearToCubemapBlitShader.frag
 		}
-		equirectangularToCubemapBlitShader->UploadUniform("numSamples", &numSamples, UNIFORM_Int); // "numSamples" is defined directly in equilinearToCubemapBlitShader.frag
 
 		// Upload the texel size for the hdr texture:
 		vec4 texelSize = hdrTexture->TexelSize();
@@ -220,9 +328,11 @@ namespace BlazeEngine
 
 		// Render into the cube map:
 		//--------------------------
-		glViewport(0, 0, xRes, yRes);	// Configure viewport to match the cubemap dimensions
-		glDepthFunc(GL_LEQUAL);			// Ensure we can render on the far plane
-		glDisable(GL_CULL_FACE);		// Disable back-face culling, since we're rendering a cube from the inside
+		GLState& glState = GLState::Instance();
+
+		glState.Viewport(0, 0, xRes, yRes);				// Configure viewport to match the cubemap dimensions
+		glState.DepthFunc(GL_LEQUAL);					// Ensure we can render on the far plane
+		glState.SetCapability(GL_CULL_FACE, false);		// Disable back-face culling, since we're rendering a cube from the inside
 
 		cubeFaces[0]->BindFramebuffer(true);
 		
@@ -242,7 +352,7 @@ namespace BlazeEngine
 
 				cubeFaces[0]->CreateRenderbuffer(true, mipSize, mipSize);
 
-				glViewport(0, 0, mipSize, mipSize);
+				glState.Viewport(0, 0, mipSize, mipSize);
 
 				// Compute the roughness for the current mip level, and upload it to the shader:
 				float roughness = (float)currentMipLevel / (float)(numMipLevels - 1);
@@ -276,19 +386,15 @@ namespace BlazeEngine
 			}
 		}
 		
-		cubeFaces[0]->BindFramebuffer(false);
-
 		// Restore defaults:
-		glDepthFunc(GL_LESS);
-		glEnable(GL_CULL_FACE);
+		glState.DepthFunc(GL_LESS);
+		glState.SetCapability(GL_CULL_FACE, true);
 
 		// Cleanup:
 		hdrTexture->Bind(TEXTURE_0 + TEXTURE_ALBEDO, false); // Unbind: Texture will be destroyed/deleted by the SceneManager
 		
-		cubeMesh.Bind(false);
 		cubeMesh.Destroy();
 
-		equirectangularToCubemapBlitShader->Bind(false);
 		equirectangularToCubemapBlitShader->Destroy();
 		delete equirectangularToCubemapBlitShader;
 
@@ -298,6 +404,96 @@ namespace BlazeEngine
 	}
 
 
+	bool ImageBasedLight::ProjectIrradianceSH(string sceneName, string relativeHDRPath, vec3* coefficients)
+	{
+		for (int i = 0; i < IBL_SH_COEFFICIENT_COUNT; i++)
+		{
+			coefficients[i] = vec3(0.0f);
+		}
+
+		string iblTexturePath	= CoreEngine::GetCoreEngine()->GetConfig()->GetValue<string>("sceneRoot") + sceneName + "\\" + relativeHDRPath;
+		Texture* hdrTexture		= CoreEngine::GetSceneManager()->FindLoadTextureByPath(iblTexturePath); // Deallocated by SceneManager
+		if (hdrTexture == nullptr)
+		{
+			LOG_ERROR("Failed to load HDR texture \"" + iblTexturePath + "\" for image-based lighting");
+			return false;
+		}
+
+		unsigned int width	= hdrTexture->Width();
+		unsigned int height	= hdrTexture->Height();
+
+		vector<float> texels((size_t)width * height * 4);
+		if (!hdrTexture->GetTexelsRGBA(&texels[0]))
+		{
+			// The shared texture was already uploaded and its texels released (eg. by the skybox): Decode a temporary copy
+			Texture* hdrCopy = Texture::LoadTextureFileFromPath(iblTexturePath, false);
+			bool isLoaded = hdrCopy != nullptr && hdrCopy->Width() == width && hdrCopy->Height() == height && hdrCopy->GetTexelsRGBA(&texels[0]);
+
+			if (hdrCopy != nullptr)
+			{
+				hdrCopy->Destroy();
+				delete hdrCopy;
+			}
+
+			if (!isLoaded)
+			{
+				LOG_ERROR("Could not read the texels of HDR texture \"" + iblTexturePath + "\" for image-based lighting");
+				return false;
+			}
+		}
+
+		LOG("Projecting " + to_string(width) + "x" + to_string(height) + " HDR image into irradiance spherical harmonics");
+
+		// Azimuth of each column. Inverse of DirectionToEquirectangularUV() in BlazeGlobals.glsl: u = atan(z, x) / (2 PI) + 0.5
+		vector<float> cosPhi(width);
+		vector<float> sinPhi(width);
+		for (unsigned int col = 0; col < width; col++)
+		{
+			float phi		= (((float)col + 0.5f) / (float)width - 0.5f) * glm::two_pi<float>();
+			cosPhi[col]		= glm::cos(phi);
+			sinPhi[col]		= glm::sin(phi);
+		}
+
+		// Project in parallel. Threads process disjoint bands of rows into their own sums:
+		unsigned int numThreads		= glm::max(glm::min<unsigned int>(std::thread::hardware_concurrency(), height / IBL_SH_MIN_ROWS_PER_THREAD), 1u);
+		unsigned int rowsPerThread	= (height + numThreads - 1) / numThreads;
+
+		vector<double> threadSums((size_t)numThreads * IBL_SH_COEFFICIENT_COUNT * 3, 0.0);
+
+		vector<std::thread> workers;
+		workers.reserve(numThreads - 1);
+		for (unsigned int currentThread = 1; currentThread < numThreads; currentThread++)
+		{
+			unsigned int firstRow	= glm::min(currentThread * rowsPerThread, height);
+			unsigned int lastRow	= glm::min(firstRow + rowsPerThread, height);
+
+			workers.emplace_back(ProjectRows, &texels[0], width, height, &cosPhi[0], &sinPhi[0], firstRow, lastRow, &threadSums[(size_t)currentThread * IBL_SH_COEFFICIENT_COUNT * 3]);
+		}
+
+		ProjectRows(&texels[0], width, height, &cosPhi[0], &sinPhi[0], 0, glm::min(rowsPerThread, height), &threadSums[0]); // The calling thread projects the first band
+
+		for (size_t i = 0; i < workers.size(); i++)
+		{
+			workers[i].join();
+		}
+
+		// Combine the bands, and fold in the basis constants (once for the projection, once for the evaluation) and cosine lobe:
+		for (int i = 0; i < IBL_SH_COEFFICIENT_COUNT; i++)
+		{
+			dvec3 sum(0.0);
+			for (unsigned int currentThread = 0; currentThread < numThreads; currentThread++)
+			{
+				double const* currentSums = &threadSums[((size_t)currentThread * IBL_SH_COEFFICIENT_COUNT + i) * 3];
+				sum += dvec3(currentSums[0], currentSums[1], currentSums[2]);
+			}
+
+			coefficients[i] = vec3(sum * (double)(SH_BASIS[i] * SH_BASIS[i] * SH_COSINE_LOBE[i]));
+		}
+
+		return true;
+	}
+
+
 	void ImageBasedLight::GenerateBRDFIntegrationMap()
 	{
 		// Destroy any existing map
@@ -359,8 +555,8 @@ namespace BlazeEngine
 
 		// Render into the quad:
 		//--------------------------
-		glViewport(0, 0, this->xRes, this->yRes);	// Configure viewport to match the cubemap dimensions
-		glDepthFunc(GL_LEQUAL);						// Ensure we can render on the far plane
+		GLState::Instance().Viewport(0, 0, this->xRes, this->yRes);	// Configure viewport to match the cubemap dimensions
+		GLState::Instance().DepthFunc(GL_LEQUAL);						// Ensure we can render on the far plane
 
 		this->BRDF_integrationMap->BindFramebuffer(true);
 		this->BRDF_integrationMap->CreateRenderbuffer();
@@ -369,14 +565,14 @@ namespace BlazeEngine
 		glDrawElements(GL_TRIANGLES, quad.NumIndices(), GL_UNSIGNED_INT, (void*)(0)); // (GLenum mode, GLsizei count, GLenum type, const GLvoid* indices);
 
 
+		// Restore defaults:
+		GLState::Instance().DepthFunc(GL_LESS);
+
 		// Cleanup:
 		quad.Bind(false);
 
-		this->BRDF_integrationMap->BindFramebuffer(false);
 		this->BRDF_integrationMap->DeleteRenderbuffer();
-		this->BRDF_integrationMap->Bind(GENERIC_TEXTURE_0, false);
 
-		BRDFIntegrationMapShader->Bind(false);
 		BRDFIntegrationMapShader->Destroy();
 		delete BRDFIntegrationMapShader;		
 	}
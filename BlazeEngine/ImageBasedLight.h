@@ -7,6 +7,10 @@
 using std::string;
 
 
+#define IBL_SH_COEFFICIENT_COUNT		9	// 3 bands of spherical harmonics. Must match deferredAmbientLightShader.frag
+#define IBL_SH_MIN_ROWS_PER_THREAD		32	// Minimum number of HDR image rows to give a worker thread
+
+
 namespace BlazeEngine
 {
 	// Predeclarations:
@@ -16,7 +20,6 @@ namespace BlazeEngine
 
 	enum IBL_TYPE
 	{
-		IBL_IEM,		// Irradience Environment Map
 		IBL_PMREM,		// Pre-filtered Mipmapped Radience Environment Map
 
 		RAW_HDR,		// Unfiltered: Used for straight conversion of equirectangular map to cubemap
@@ -32,13 +35,13 @@ namespace BlazeEngine
 
 		~ImageBasedLight();
 
-		// Get the Irradiance Environment Map material:
-		Material*		GetIEMMaterial()		{ return this->IEM_Material; }
+		// Diffuse irradiance, as IBL_SH_COEFFICIENT_COUNT spherical harmonics coefficients (see ProjectIrradianceSH()):
+		vec3 const*		GetIrradianceSH() const	{ return this->irradianceSH; }
 		Material*		GetPMREMMaterial()		{ return this->PMREM_Material; }
 		RenderTexture*	GetBRDFIntegrationMap() { return this->BRDF_integrationMap; }
 
 		// Check if an IBL was successfully loaded
-		bool IsValid() const		{ return this->IEM_isValid && this->PMREM_isValid; }
+		bool IsValid() const		{ return this->irradiance_isValid && this->PMREM_isValid; }
 
 
 		// Public static functions:
@@ -46,12 +49,18 @@ namespace BlazeEngine
 
 		// Convert an equirectangular HDR image to a cubemap
 		// hdrPath is relative to the scene path, with no leading slash eg. "IBL\\ibl.hdr"
-		// iblType controls the filtering (IEM/PMREM/None) applied to the converted cubemap 
+		// iblType controls the filtering (PMREM/None) applied to the converted cubemap 
 		// Returns an array of 6 textures
 		static RenderTexture** ConvertEquirectangularToCubemap(string sceneName, string relativeHDRPath, int xRes, int yRes, IBL_TYPE iblType = RAW_HDR);
 
+		// Project an equirectangular HDR image's diffuse irradiance into IBL_SH_COEFFICIENT_COUNT spherical harmonics coefficients, on
+		// the CPU. The coefficients are pre-scaled by the basis constants and the cosine lobe convolution: The irradiance / PI for a
+		// normal n is c0 + c1 n.y + c2 n.z + c3 n.x + c4 n.x n.y + c5 n.y n.z + c6 (3 n.z^2 - 1) + c7 n.x n.z + c8 (n.x^2 - n.y^2).
+		// hdrPath is relative to the scene path, as for ConvertEquirectangularToCubemap(). Returns true if successful
+		static bool ProjectIrradianceSH(string sceneName, string relativeHDRPath, vec3* coefficients);
+
 	private:
-		Material* IEM_Material				= nullptr;	// Irradiance Environment Map (IEM) Material: Deallocated in destructor
+		vec3 irradianceSH[IBL_SH_COEFFICIENT_COUNT];	// Diffuse irradiance spherical harmonics coefficients
 		Material* PMREM_Material			= nullptr;	// Pre-filtered Mip-mapped Radiance Environment Map (PMREM) Material: Deallocated in destructor
 
 		int maxMipLevel						= -1;		// Highest valid mip level for the PMREM cube map
@@ -62,7 +71,7 @@ namespace BlazeEngine
 		int xRes							= 512;
 		int yRes							= 512;
 
-		bool IEM_isValid					= false; // Is the IEM valid? (Ie. Were IBL textures successfully loaded?)
+		bool irradiance_isValid				= false; // Is the irradiance valid? (Ie. Was the HDR image successfully projected?)
 		bool PMREM_isValid					= false; // Is the PMREM valid? (Ie. Were IBL textures successfully loaded?)
 
 		// Private helper functions:
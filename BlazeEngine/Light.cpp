@@ -15,6 +15,7 @@ namespace BlazeEngine
 		this->lightName		= lightName;
 		this->type			= lightType;
 		this->color			= color;
+		this->radius		= radius;
 
 		this->shadowMap		= shadowMap;
 
@@ -60,6 +60,8 @@ namespace BlazeEngine
 		inline Transform&			GetTransform()							{ return transform; }	// Directional lights shine forward (Z+)
 
 		inline string const&		Name() const							{ return lightName; }
+
+		inline float				Radius() const							{ return radius; }		// Point lights: Distance at which the light's contribution is cut off
 		
 		ShadowMap*&					ActiveShadowMap(ShadowMap* newShadowMap = nullptr);				// Get/set the current shadow map
 
@@ -76,6 +78,8 @@ namespace BlazeEngine
 
 		string lightName			= "unnamed_directional_light";
 
+		float radius				= 1.0f;
+
 		ShadowMap* shadowMap		= nullptr;							// Deallocated by calling Destroy() during SceneManager.Shutdown()
 
 		// Deferred light setup:
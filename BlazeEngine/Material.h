@@ -37,7 +37,7 @@ namespace BlazeEngine
 		RENDER_TEXTURE_WORLD_NORMAL			= 1,
 		RENDER_TEXTURE_RMAO					= 2,
 		RENDER_TEXTURE_EMISSIVE				= 3,
-		RENDER_TEXTURE_WORLD_POSITION		= 4,
+		RENDER_TEXTURE_WORLD_POSITION		= 4,	// Not allocated in the GBuffer: Reconstructed from depth
 		RENDER_TEXTURE_MATERIAL_PROPERTY_0	= 5,	// MATERIAL_PROPERTY_0
 		RENDER_TEXTURE_DEPTH				= 6,	// Make this the last element
 
@@ -0,0 +1,301 @@
+// Member class of the RenderManager. Copies material textures into shared texture arrays, and binds them per batch of materials
+
+#include "MaterialTextureArrays.h"
+#include "CoreEngine.h"
+#include "BuildConfiguration.h"
+#include "Texture.h"
+#include "Shader.h"
+#include "GLState.h"
+
+#include "glm.hpp"
+
+#include <algorithm>
+
+using glm::ivec4;
+using glm::vec4;
+using std::to_string;
+
+
+namespace BlazeEngine
+{
+	const string MaterialTextureArrays::MATERIAL_TEXTURE_ARRAYS_KEYWORD = "MATERIAL_TEXTURE_ARRAYS";
+
+	bool MaterialTextureArrays::hasBuildFailed = false;
+
+
+	// Material parameter buffer element. Must match the MaterialParameters struct in BlazeCommon.glsl (std430)
+	struct MaterialParameters
+	{
+		ivec4	textureLayers;	// Layer of each material texture slot in its array
+		vec4	matProperty0;
+	};
+
+
+	MaterialTextureArrays::~MaterialTextureArrays()
+	{
+		for (unsigned int i = 0; i < (unsigned int)this->textureArrays.size(); i++)
+		{
+			glDeleteTextures(1, &this->textureArrays[i].textureID);
+			GLState::Instance().OnTextureDeleted(this->textureArrays[i].textureID);
+		}
+		this->textureArrays.clear();
+
+		if (this->parameterBuffer != 0)
+		{
+			glDeleteBuffers(1, &this->parameterBuffer);
+			this->parameterBuffer = 0;
+		}
+	}
+
+
+	bool MaterialTextureArrays::Build(unordered_map<string, Material*> const& materials)
+	{
+		GLState& glState = GLState::Instance();
+
+		GLint maxLayers = 0;
+		glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+
+		// Assign each unique texture a layer in an array with a matching signature. Textures can be shared between materials and slots:
+		struct TextureLocation
+		{
+			int arrayIndex;
+			int layer;
+		};
+		unordered_map<Texture*, TextureLocation> textureLocations;
+		unordered_map<string, int> openArrays;	// Signature -> index of the last array created for it
+		vector<vector<Texture*>> arrayTextures;	// Textures copied into each array, in layer order
+
+		for (auto const& currentMaterial : materials)
+		{
+			for (int i = 0; i < currentMaterial.second->NumTextureSlots() && i < TEXTURE_COUNT; i++)
+			{
+				Texture* currentTexture = currentMaterial.second->AccessTexture((TEXTURE_TYPE)i);
+				if (currentTexture == nullptr || textureLocations.find(currentTexture) != textureLocations.end())
+				{
+					continue;
+				}
+
+				// Only whole, buffered 2D textures can be copied into a layer. The shaders have no fallback for a slot without a layer, so
+				// fail before anything is created: The materials' textures are then bound individually
+				if (currentTexture->TextureID() == 0 || currentTexture->TextureTarget() != GL_TEXTURE_2D || currentTexture->ResidentLevel() != 0)
+				{
+					LOG_ERROR("Texture \"" + currentTexture->TexturePath() + "\" can't be added to a material texture array");
+
+					this->textureArrays.clear(); // No GL objects have been created yet
+					hasBuildFailed = true;
+
+					return false;
+				}
+
+				unsigned int numMipLevels = currentTexture->IsCompressed() ?
+					currentTexture->NumMipLevels() : (unsigned int)glm::log2((float)glm::max(currentTexture->Width(), currentTexture->Height())) + 1;
+
+				string signature =
+					to_string(currentTexture->Width()) + "x" + to_string(currentTexture->Height()) + "_" +
+					to_string(currentTexture->InternalFormat()) + "_" + to_string(numMipLevels) + "_" +
+					to_string(currentTexture->TextureWrap_S()) + "_" + to_string(currentTexture->TextureWrap_T()) + "_" +
+					to_string(currentTexture->TextureMinFilter()) + "_" + to_string(currentTexture->TextureMaxFilter());
+
+				// Start a new array if there isn't one for this signature, or the last one is full:
+				unordered_map<string, int>::iterator result = openArrays.find(signature);
+				if (result == openArrays.end() || this->textureArrays[result->second].numLayers >= (unsigned int)maxLayers)
+				{
+					TextureArray newArray;
+					newArray.width			= currentTexture->Width();
+					newArray.height			= currentTexture->Height();
+					newArray.internalFormat	= currentTexture->InternalFormat();
+					newArray.numMipLevels	= numMipLevels;
+
+					openArrays[signature] = (int)this->textureArrays.size();
+					this->textureArrays.push_back(newArray);
+					arrayTextures.emplace_back();
+
+					result = openArrays.find(signature);
+				}
+
+				TextureArray& currentArray = this->textureArrays[result->second];
+				textureLocations[currentTexture] = { result->second, (int)currentArray.numLayers };
+				arrayTextures[result->second].push_back(currentTexture);
+				currentArray.numLayers++;
+			}
+		}
+
+		// Create the arrays, and copy each texture's levels into its layer on the GPU. This works for block compressed textures, whose
+		// CPU texels may have been released after they were uploaded:
+		while (glGetError() != GL_NO_ERROR); // Clear any earlier errors, so failures can be attributed to the copies
+
+		int const textureUnit = glm::max(glState.ActiveTextureUnit(), 0);
+		for (unsigned int i = 0; i < (unsigned int)this->textureArrays.size(); i++)
+		{
+			TextureArray& currentArray	= this->textureArrays[i];
+			Texture* firstTexture		= arrayTextures[i][0];
+
+			glGenTextures(1, &currentArray.textureID);
+			glState.BindTexture(textureUnit, GL_TEXTURE_2D_ARRAY, currentArray.textureID);
+
+			glTexStorage3D(GL_TEXTURE_2D_ARRAY, currentArray.numMipLevels, currentArray.internalFormat, currentArray.width, currentArray.height, currentArray.numLayers);
+
+			// Array textures are sampled without a sampler object, so they hold their own sampling parameters:
+			glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S,		firstTexture->TextureWrap_S());
+			glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T,		firstTexture->TextureWrap_T());
+			glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER,	firstTexture->TextureMinFilter());
+			glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER,	firstTexture->TextureMaxFilter());
+
+			glState.BindTexture(textureUnit, GL_TEXTURE_2D_ARRAY, 0);
+
+			for (unsigned int layer = 0; layer < currentArray.numLayers; layer++)
+			{
+				for (unsigned int level = 0; level < currentArray.numMipLevels; level++)
+				{
+					GLsizei levelWidth	= glm::max(currentArray.width >> level, 1u);
+					GLsizei levelHeight	= glm::max(currentArray.height >> level, 1u);
+
+					glCopyImageSubData
+					(
+						arrayTextures[i][layer]->TextureID(), GL_TEXTURE_2D, level, 0, 0, 0,
+						currentArray.textureID, GL_TEXTURE_2D_ARRAY, level, 0, 0, layer,
+						levelWidth, levelHeight, 1
+					);
+				}
+			}
+
+			#if defined(DEBUG_SCENEMANAGER_TEXTURE_LOGGING)
+				LOG("Material texture array " + to_string(i) + ": " + to_string(currentArray.numLayers) + " layers of " + to_string(currentArray.width) + "x" + to_string(currentArray.height));
+			#endif
+		}
+
+		GLenum error = glGetError();
+		if (error != GL_NO_ERROR)
+		{
+			LOG_ERROR("Failed to copy the material textures into texture arrays. OpenGL error " + to_string(error));
+
+			for (unsigned int i = 0; i < (unsigned int)this->textureArrays.size(); i++)
+			{
+				glDeleteTextures(1, &this->textureArrays[i].textureID);
+				glState.OnTextureDeleted(this->textureArrays[i].textureID);
+			}
+			this->textureArrays.clear();
+
+			hasBuildFailed = true;
+
+			return false;
+		}
+
+		// The arrays hold the only copy the GBuffer shaders sample: Free the individual textures
+		for (std::pair<Texture* const, TextureLocation>& currentTexture : textureLocations)
+		{
+			currentTexture.first->ReleaseGPUTexture();
+		}
+
+		// Assign each material a parameter buffer entry, and a batch for its set of arrays:
+		this->batches.clear();
+		this->materialEntries.clear();
+
+		vector<MaterialParameters> parameters;
+		parameters.reserve(materials.size());
+
+		for (auto const& currentMaterial : materials)
+		{
+			MaterialParameters newParameters;
+			newParameters.textureLayers	= ivec4(0, 0, 0, 0);
+			newParameters.matProperty0	= currentMaterial.second->Property(MATERIAL_PROPERTY_0);
+
+			Batch newBatch;
+			for (int i = 0; i < TEXTURE_COUNT; i++)
+			{
+				newBatch.arrayIndexes[i] = -1;
+
+				Texture* currentTexture = i < currentMaterial.second->NumTextureSlots() ? currentMaterial.second->AccessTexture((TEXTURE_TYPE)i) : nullptr;
+				unordered_map<Texture*, TextureLocation>::const_iterator result = textureLocations.find(currentTexture);
+				if (result != textureLocations.end())
+				{
+					newBatch.arrayIndexes[i]		= result->second.arrayIndex;
+					newParameters.textureLayers[i]	= result->second.layer;
+				}
+			}
+
+			unsigned int batchIndex = 0;
+			while (batchIndex < (unsigned int)this->batches.size() &&
+				!std::equal(newBatch.arrayIndexes, newBatch.arrayIndexes + TEXTURE_COUNT, this->batches[batchIndex].arrayIndexes))
+			{
+				batchIndex++;
+			}
+			if (batchIndex == (unsigned int)this->batches.size())
+			{
+				this->batches.push_back(newBatch);
+			}
+
+			this->materialEntries[currentMaterial.second] = { batchIndex, (int)parameters.size() };
+			parameters.push_back(newParameters);
+		}
+
+		// Upload the material parameters. Note: Properties are captured here; materials changed afterwards must rebuild the arrays
+		glGenBuffers(1, &this->parameterBuffer);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, this->parameterBuffer);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, glm::max(parameters.size(), (size_t)1) * sizeof(MaterialParameters), parameters.empty() ? nullptr : &parameters[0], GL_STATIC_DRAW);
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+		LOG("Copied " + to_string(textureLocations.size()) + " material textures into " + to_string(this->textureArrays.size()) +
+			" texture arrays. " + to_string(materials.size()) + " materials are drawn in " + to_string(this->batches.size()) + " batches");
+
+		return true;
+	}
+
+
+	void MaterialTextureArrays::BeginPass()
+	{
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, MATERIAL_PARAMETER_BUFFER_BINDING, this->parameterBuffer);
+		this->currentBatch	= -1;
+		this->currentShader	= nullptr;
+	}
+
+
+	void MaterialTextureArrays::BindMaterial(Material* material, Shader* shader)
+	{
+		unordered_map<Material*, MaterialEntry>::const_iterator result = this->materialEntries.find(material);
+		if (result == this->materialEntries.end())
+		{
+			LOG_ERROR("Material \"" + material->Name() + "\" is not in the material texture arrays");
+			return;
+		}
+
+		if ((int)result->second.batchIndex != this->currentBatch)
+		{
+			this->currentBatch = (int)result->second.batchIndex;
+
+			GLState& glState	= GLState::Instance();
+			Batch const& batch	= this->batches[this->currentBatch];
+			for (int i = 0; i < TEXTURE_COUNT; i++)
+			{
+				GLuint textureID = batch.arrayIndexes[i] < 0 ? 0 : this->textureArrays[batch.arrayIndexes[i]].textureID;
+
+				glState.BindTexture(TEXTURE_0 + i, GL_TEXTURE_2D_ARRAY, textureID);
+				glState.BindSampler(TEXTURE_0 + i, 0);
+			}
+		}
+
+		if (shader != this->currentShader)
+		{
+			this->currentShader			= shader;
+			this->materialIndexHandle	= shader->GetUniformHandle("materialIndex", UNIFORM_Int);
+		}
+		shader->UploadUniform(this->materialIndexHandle, &result->second.parameterIndex);
+	}
+
+
+	int MaterialTextureArrays::BatchIndex(Material* material) const
+	{
+		unordered_map<Material*, MaterialEntry>::const_iterator result = this->materialEntries.find(material);
+		return result == this->materialEntries.end() ? -1 : (int)result->second.batchIndex;
+	}
+
+
+	bool MaterialTextureArrays::IsEnabled()
+	{
+		return !hasBuildFailed &&
+			CoreEngine::GetCoreEngine()->GetConfig()->GetValue<bool>("useMaterialTextureArrays") &&
+			!CoreEngine::GetCoreEngine()->GetConfig()->GetValue<bool>("useForwardRendering");
+	}
+}
+
+
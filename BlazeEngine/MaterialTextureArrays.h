@@ -0,0 +1,107 @@
+// Material texture arrays
+// Material textures with the same size, format, mip count and sampling parameters are copied into layers of shared GL_TEXTURE_2D_ARRAYs
+// when a scene is loaded. Each material's texture layers and properties are stored in a material parameter buffer, indexed by the
+// material. Materials whose slots map to the same arrays form a batch: Within a batch, changing material only uploads an index, and the
+// textures are bound once per batch rather than once per material
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include "Material.h"
+#include "Shader.h"	// UniformHandle
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+using std::string;
+using std::vector;
+using std::unordered_map;
+
+
+#define MATERIAL_PARAMETER_BUFFER_BINDING	4	// SSBO binding point of the material parameter buffer. Must match BlazeCommon.glsl
+
+
+namespace BlazeEngine
+{
+	// Pre-declarations:
+	class Texture;
+
+
+	class MaterialTextureArrays
+	{
+	public:
+		MaterialTextureArrays() {}
+
+		~MaterialTextureArrays(); // Deletes the texture arrays and parameter buffer
+
+		// Copy the materials' textures into texture arrays, assign each material a batch and parameter index, and upload the parameter
+		// buffer. The individual GPU textures are deleted once copied. Call after the scene's textures have been buffered, before the
+		// RenderQueue is initialized (so its material IDs follow the batches). Returns false if the arrays couldn't be created
+		bool Build(unordered_map<string, Material*> const& materials);
+
+		// Bind the parameter buffer. Call at the start of each pass that draws with BindMaterial()
+		void BeginPass();
+
+		// Bind a material's texture arrays if its batch differs from the previous material's, and upload its parameter index to the
+		// (array keyword) shader. Materials that weren't part of Build() are logged and skipped
+		void BindMaterial(Material* material, Shader* shader);
+
+		// Batch of a material, or -1 if it wasn't part of Build()
+		int BatchIndex(Material* material) const;
+
+		// Getters:
+		inline unsigned int NumArrays() const		{ return (unsigned int)textureArrays.size(); }
+		inline unsigned int NumBatches() const		{ return (unsigned int)batches.size(); }
+
+
+		// Public static functions:
+		//-------------------------
+
+		// Returns true if the "useMaterialTextureArrays" config value is set, the GBuffer is used, and Build() hasn't failed. Shaders that
+		// sample material textures in the deferred pipeline must be created with the MATERIAL_TEXTURE_ARRAYS_KEYWORD keyword if this is
+		// true, and recreated without it if a Build() fails
+		static bool IsEnabled();
+
+		static const string MATERIAL_TEXTURE_ARRAYS_KEYWORD;
+
+
+	private:
+		struct TextureArray
+		{
+			GLuint			textureID		= 0;
+			unsigned int	width			= 0;
+			unsigned int	height			= 0;
+			GLenum			internalFormat	= GL_RGBA8;
+			unsigned int	numMipLevels	= 0;
+			unsigned int	numLayers		= 0;
+		};
+		vector<TextureArray> textureArrays;
+
+		// A set of arrays bound to the material texture slots. -1 if a slot is empty
+		struct Batch
+		{
+			int arrayIndexes[TEXTURE_COUNT];
+		};
+		vector<Batch> batches;
+
+		// Per material batch and parameter buffer index:
+		struct MaterialEntry
+		{
+			unsigned int	batchIndex;
+			int				parameterIndex;
+		};
+		unordered_map<Material*, MaterialEntry> materialEntries;
+
+		GLuint parameterBuffer		= 0;
+		int currentBatch			= -1;	// Batch bound since the last BeginPass(), -1 if none
+
+		Shader* currentShader		= nullptr;	// Shader materialIndexHandle was resolved for since the last BeginPass()
+		UniformHandle materialIndexHandle;
+
+		static bool hasBuildFailed;	// Once a Build() fails, material textures are bound individually for the rest of the session
+	};
+}
+
+
@@ -1,6 +1,7 @@
 #include "Mesh.h"
 
 #include "BuildConfiguration.h"
+#include "GLState.h"
 
 #include "glm.hpp"
 #include "gtc/constants.hpp"
@@ -31,7 +32,7 @@ namespace BlazeEngine
 
 		// Create and bind our Vertex Array Object:
 		glGenVertexArrays(1, &meshVAO);
-		glBindVertexArray(meshVAO);
+		GLState::Instance().BindVertexArray(meshVAO);
 
 		// Create and bind a vertex buffer:
 		glGenBuffers(1, &meshVBOs[BUFFER_VERTICES]);
@@ -81,7 +82,28 @@ namespace BlazeEngine
 		glBufferData(GL_ELEMENT_ARRAY_BUFFER, numIndices * sizeof(GLuint), &indices[0], GL_DYNAMIC_DRAW);
 
 
-		// Cleanup:
+		// Position-only stream: Depth-only passes fetch 12 bytes per vertex instead of the full interleaved vertex
+		vector<vec3> positions(numVerts);
+		for (unsigned int i = 0; i < numVerts; i++)
+		{
+			positions[i] = vertices[i].position;
+		}
+
+		glGenVertexArrays(1, &positionsVAO);
+		GLState::Instance().BindVertexArray(positionsVAO);
+
+		glGenBuffers(1, &meshVBOs[BUFFER_POSITIONS]);
+		glBindBuffer(GL_ARRAY_BUFFER, meshVBOs[BUFFER_POSITIONS]);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, meshVBOs[BUFFER_INDEXES]);	// Shares the index buffer
+
+		glEnableVertexAttribArray(VERTEX_POSITION);
+		glVertexAttribPointer(VERTEX_POSITION, 3, GL_FLOAT, GL_FALSE, sizeof(vec3), (void*)0);
+
+		glBufferData(GL_ARRAY_BUFFER, numVerts * sizeof(vec3), &positions[0].x, GL_DYNAMIC_DRAW);
+
+
+		// Cleanup: Unbind the VAO first, so it retains its element array buffer binding
+		GLState::Instance().BindVertexArray(0);
 		glBindBuffer(GL_ARRAY_BUFFER, 0);
 		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 	}
@@ -89,21 +111,24 @@ namespace BlazeEngine
 
 	void Mesh::Bind(bool doBind)
 	{
+		// Note: Our VAO captures the vertex attribute and element array buffer bindings, so we only need to bind the VAO to draw
 		if (doBind)
 		{
-			glBindVertexArray(this->VAO());
-			glBindBuffer(GL_ARRAY_BUFFER, this->VBO(BUFFER_VERTICES));
-			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->VBO(BUFFER_INDEXES));
+			GLState::Instance().BindVertexArray(this->VAO());
 		}
 		else
 		{
-			glBindVertexArray(0);
-			glBindBuffer(GL_ARRAY_BUFFER, 0);
-			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+			GLState::Instance().BindVertexArray(0);
 		}
 	}
 
 
+	void Mesh::BindPositionsOnly(bool doBind)
+	{
+		GLState::Instance().BindVertexArray(doBind ? this->positionsVAO : 0);
+	}
+
+
 	void Mesh::Destroy()
 	{
 		#if defined(DEBUG_LOG_OUTPUT)
@@ -124,6 +149,9 @@ namespace BlazeEngine
 		}
 
 		glDeleteVertexArrays(1, &this->meshVAO);
+		GLState::Instance().OnVertexArrayDeleted(this->meshVAO);
+		glDeleteVertexArrays(1, &this->positionsVAO);
+		GLState::Instance().OnVertexArrayDeleted(this->positionsVAO);
 		glDeleteBuffers(BUFFER_COUNT, this->meshVBOs);
 
 		this->meshMaterial = nullptr;		// Note: Material MUST be cleaned up elsewhere!
@@ -179,6 +179,7 @@ namespace BlazeEngine
 	{
 		BUFFER_VERTICES,
 		BUFFER_INDEXES,
+		BUFFER_POSITIONS,	// Tightly packed positions only, for depth-only passes
 
 		BUFFER_COUNT, // Reserved: Number of buffers to allocate
 	};
@@ -232,6 +233,9 @@ namespace BlazeEngine
 		
 		void Bind(bool doBind);
 
+		// Bind the position-only vertex stream (VERTEX_POSITION only). Used by depth-only passes, to minimize vertex fetch bandwidth
+		void BindPositionsOnly(bool doBind);
+
 		// Deallocate and unbind this mesh object
 		void Destroy();
 
@@ -260,6 +264,7 @@ namespace BlazeEngine
 		unsigned int numIndices = 0;
 
 		GLuint meshVAO			= 0;
+		GLuint positionsVAO		= 0;			// Position-only stream: BUFFER_POSITIONS + BUFFER_INDEXES
 		GLuint meshVBOs[BUFFER_COUNT];			// Buffer objects that hold vertices in GPU memory
 
 		Material* meshMaterial	= nullptr;
@@ -0,0 +1,408 @@
+#include "OcclusionCuller.h"
+#include "WorldBounds.h"
+#include "Mesh.h"
+#include "Camera.h"
+#include "WorkerPool.h"
+#include "BuildConfiguration.h"
+
+#include <xmmintrin.h>	// SSE is always available on x64
+#include <algorithm>
+#include <limits>
+#include <utility>
+
+
+namespace BlazeEngine
+{
+	#define OCCLUSION_MIN_ROWS_PER_THREAD		16		// Minimum height of the band of rows each rasterizer thread processes
+	#define OCCLUSION_MIN_TRIANGLES_PER_THREAD	256		// Rasterize on a single thread if there are fewer triangles than this per thread
+
+
+	OcclusionCuller::OcclusionCuller(WorkerPool* workerPool /*= nullptr*/) : workerPool(workerPool)
+	{
+		// Allocate the depth pyramid, down to 1x1:
+		unsigned int width	= OCCLUSION_BUFFER_WIDTH;
+		unsigned int height	= OCCLUSION_BUFFER_HEIGHT;
+		while (true)
+		{
+			this->depthPyramid.emplace_back(vector<float>(width * height, 1.0f));
+			this->pyramidWidths.emplace_back(width);
+			this->pyramidHeights.emplace_back(height);
+
+			if (width == 1 && height == 1)
+			{
+				break;
+			}
+			width	= glm::max(width / 2, 1u);
+			height	= glm::max(height / 2, 1u);
+		}
+
+		this->triangles.reserve(OCCLUSION_MAX_OCCLUDER_TRIANGLES);
+	}
+
+
+	void OcclusionCuller::RenderOccluders(Camera* renderCam, vector<Mesh*> const& visibleMeshes, WorldBounds const& worldBounds)
+	{
+		this->viewProjection	= renderCam->ViewProjection();
+		vec3 cameraPosition		= renderCam->GetTransform()->WorldPosition();
+
+		// Rank the visible meshes by their approximate projected size (squared bounds radius / squared distance):
+		vector<std::pair<float, Mesh*>> candidates;
+		candidates.reserve(visibleMeshes.size());
+		for (unsigned int i = 0; i < (unsigned int)visibleMeshes.size(); i++)
+		{
+			int boundsIndex = worldBounds.IndexOf(visibleMeshes[i]);
+			if (boundsIndex < 0 || visibleMeshes[i]->Vertices() == nullptr || visibleMeshes[i]->Indices() == nullptr)
+			{
+				continue;
+			}
+
+			Bounds meshBounds		= worldBounds.GetBounds(boundsIndex);
+			vec3 boundsMin			= vec3(meshBounds.xMin, meshBounds.yMin, meshBounds.zMin);
+			vec3 boundsMax			= vec3(meshBounds.xMax, meshBounds.yMax, meshBounds.zMax);
+			vec3 halfExtent			= (boundsMax - boundsMin) * 0.5f;
+			vec3 toCenter			= (boundsMin + halfExtent) - cameraPosition;
+
+			float radiusSquared		= glm::dot(halfExtent, halfExtent);
+			float distanceSquared	= glm::max(glm::dot(toCenter, toCenter), 0.0001f);
+
+			candidates.emplace_back(radiusSquared / distanceSquared, visibleMeshes[i]);
+		}
+
+		size_t numCandidates = glm::min<size_t>(candidates.size(), OCCLUSION_MAX_OCCLUDERS);
+		std::partial_sort
+		(
+			candidates.begin(),
+			candidates.begin() + numCandidates,
+			candidates.end(),
+			[](std::pair<float, Mesh*> const& lhs, std::pair<float, Mesh*> const& rhs) { return lhs.first > rhs.first; }
+		);
+
+		// Setup the occluder triangles, within our triangle budget:
+		this->triangles.clear();
+		for (size_t i = 0; i < numCandidates; i++)
+		{
+			Mesh* currentOccluder = candidates[i].second;
+			if (this->triangles.size() + currentOccluder->NumIndices() / 3 <= OCCLUSION_MAX_OCCLUDER_TRIANGLES)
+			{
+				SetupTriangles(currentOccluder);
+			}
+		}
+
+		// Clear, and rasterize. Threads process disjoint bands of rows, so they never write to the same pixels:
+		std::fill(this->depthPyramid[0].begin(), this->depthPyramid[0].end(), 1.0f);
+
+		int numThreads = this->workerPool == nullptr ? 1 : (int)glm::min<size_t>
+		(
+			glm::min<size_t>(this->workerPool->NumThreads(), OCCLUSION_BUFFER_HEIGHT / OCCLUSION_MIN_ROWS_PER_THREAD),
+			this->triangles.size() / OCCLUSION_MIN_TRIANGLES_PER_THREAD
+		);
+		if (numThreads > 1)
+		{
+			int rowsPerThread = (OCCLUSION_BUFFER_HEIGHT + numThreads - 1) / numThreads;
+
+			this->workerPool->ParallelFor((unsigned int)numThreads, [this, rowsPerThread](unsigned int currentThread)
+			{
+				int firstRow	= (int)currentThread * rowsPerThread;
+				int lastRow		= glm::min(firstRow + rowsPerThread, OCCLUSION_BUFFER_HEIGHT);
+
+				RasterizeRows(firstRow, lastRow);
+			});
+		}
+		else
+		{
+			RasterizeRows(0, OCCLUSION_BUFFER_HEIGHT);
+		}
+
+		BuildDepthPyramid();
+	}
+
+
+	void OcclusionCuller::CullOccluded(vector<Mesh*>& visibleMeshes, WorldBounds const& worldBounds) const
+	{
+		if (this->triangles.empty())
+		{
+			return;
+		}
+
+		#if defined(DEBUG_RENDERMANAGER_OCCLUSION_LOGGING)
+			size_t numTested = visibleMeshes.size();
+		#endif
+
+		visibleMeshes.erase
+		(
+			std::remove_if
+			(
+				visibleMeshes.begin(),
+				visibleMeshes.end(),
+				[this, &worldBounds](Mesh* currentMesh)
+				{
+					int boundsIndex = worldBounds.IndexOf(currentMesh);
+					return boundsIndex >= 0 && IsOccluded(worldBounds.GetBounds(boundsIndex));
+				}
+			),
+			visibleMeshes.end()
+		);
+
+		#if defined(DEBUG_RENDERMANAGER_OCCLUSION_LOGGING)
+			LOG("Occlusion culling: " + to_string(this->triangles.size()) + " occluder triangles, " + to_string(numTested - visibleMeshes.size()) + " of " + to_string(numTested) + " meshes culled");
+		#endif
+	}
+
+
+	bool OcclusionCuller::IsOccluded(Bounds const& bounds) const
+	{
+		// Project the corners, finding the screen-space rectangle and the nearest depth of the bounds:
+		float minX = std::numeric_limits<float>::max();
+		float maxX = -std::numeric_limits<float>::max();
+		float minY = std::numeric_limits<float>::max();
+		float maxY = -std::numeric_limits<float>::max();
+		float minZ = std::numeric_limits<float>::max();
+		for (int corner = 0; corner < 8; corner++)
+		{
+			vec4 worldPosition = vec4
+			(
+				(corner & 1) ? bounds.xMax : bounds.xMin,
+				(corner & 2) ? bounds.yMax : bounds.yMin,
+				(corner & 4) ? bounds.zMax : bounds.zMin,
+				1.0f
+			);
+			vec4 clipPosition = this->viewProjection * worldPosition;
+
+			// Bounds crossing the near plane are always visible:
+			if (clipPosition.w <= 0.0f || clipPosition.z < -clipPosition.w)
+			{
+				return false;
+			}
+
+			vec3 ndcPosition = clipPosition.xyz() / clipPosition.w;
+			minX = glm::min(minX, (ndcPosition.x * 0.5f + 0.5f) * OCCLUSION_BUFFER_WIDTH);
+			maxX = glm::max(maxX, (ndcPosition.x * 0.5f + 0.5f) * OCCLUSION_BUFFER_WIDTH);
+			minY = glm::min(minY, (ndcPosition.y * 0.5f + 0.5f) * OCCLUSION_BUFFER_HEIGHT);
+			maxY = glm::max(maxY, (ndcPosition.y * 0.5f + 0.5f) * OCCLUSION_BUFFER_HEIGHT);
+			minZ = glm::min(minZ, ndcPosition.z * 0.5f + 0.5f);
+		}
+
+		// Bounds outside of the buffer are left to frustum culling:
+		if (maxX < 0.0f || maxY < 0.0f || minX >= OCCLUSION_BUFFER_WIDTH || minY >= OCCLUSION_BUFFER_HEIGHT)
+		{
+			return false;
+		}
+
+		int x0 = glm::clamp((int)minX, 0, OCCLUSION_BUFFER_WIDTH - 1);
+		int x1 = glm::clamp((int)maxX, 0, OCCLUSION_BUFFER_WIDTH - 1);
+		int y0 = glm::clamp((int)minY, 0, OCCLUSION_BUFFER_HEIGHT - 1);
+		int y1 = glm::clamp((int)maxY, 0, OCCLUSION_BUFFER_HEIGHT - 1);
+
+		// Find the finest pyramid level where the rectangle covers at most 2x2 texels:
+		int level		= 0;
+		int lastLevel	= (int)this->depthPyramid.size() - 1;
+		while (level < lastLevel && ((x1 >> level) - (x0 >> level) > 1 || (y1 >> level) - (y0 >> level) > 1))
+		{
+			level++;
+		}
+
+		// The bounds are occluded if they're behind the furthest occluder depth in every texel they cover:
+		int levelWidth	= (int)this->pyramidWidths[level];
+		int levelHeight	= (int)this->pyramidHeights[level];
+		float maxDepth	= 0.0f;
+		for (int y = y0 >> level; y <= glm::min(y1 >> level, levelHeight - 1); y++)
+		{
+			for (int x = x0 >> level; x <= glm::min(x1 >> level, levelWidth - 1); x++)
+			{
+				maxDepth = glm::max(maxDepth, this->depthPyramid[level][y * levelWidth + x]);
+			}
+		}
+
+		return minZ > maxDepth;
+	}
+
+
+	// Private member functions:
+	//--------------------------
+
+	void OcclusionCuller::SetupTriangles(Mesh* occluder)
+	{
+		mat4 mvp				= this->viewProjection * occluder->GetTransform().Model();
+		Vertex const* vertices	= occluder->Vertices();
+		GLuint const* indices	= occluder->Indices();
+
+		this->clipVertices.resize(occluder->NumVerts());
+		for (unsigned int i = 0; i < occluder->NumVerts(); i++)
+		{
+			this->clipVertices[i] = mvp * vec4(vertices[i].position, 1.0f);
+		}
+
+		unsigned int numTriangles = occluder->NumIndices() / 3;
+		for (unsigned int i = 0; i < numTriangles; i++)
+		{
+			vec4 const* clip[3] =
+			{
+				&this->clipVertices[indices[i * 3 + 0]],
+				&this->clipVertices[indices[i * 3 + 1]],
+				&this->clipVertices[indices[i * 3 + 2]]
+			};
+
+			// Skip triangles crossing the near plane. We don't clip: Dropping occluder triangles is always conservative
+			bool isClipped = false;
+			vec3 screen[3];
+			for (int v = 0; v < 3; v++)
+			{
+				if (clip[v]->w <= 0.0f || clip[v]->z < -clip[v]->w)
+				{
+					isClipped = true;
+					break;
+				}
+
+				vec3 ndc	= clip[v]->xyz() / clip[v]->w;
+				screen[v]	= vec3
+				(
+					(ndc.x * 0.5f + 0.5f) * OCCLUSION_BUFFER_WIDTH,
+					(ndc.y * 0.5f + 0.5f) * OCCLUSION_BUFFER_HEIGHT,
+					ndc.z * 0.5f + 0.5f
+				);
+			}
+			if (isClipped)
+			{
+				continue;
+			}
+
+			// Occluders are rasterized double-sided: Flip back facing triangles so the edge functions are positive inside
+			float area = (screen[1].x - screen[0].x) * (screen[2].y - screen[0].y) - (screen[1].y - screen[0].y) * (screen[2].x - screen[0].x);
+			if (glm::abs(area) < 1e-6f)
+			{
+				continue;
+			}
+			if (area < 0.0f)
+			{
+				std::swap(screen[1], screen[2]);
+				area = -area;
+			}
+
+			ScreenTriangle newTriangle;
+			newTriangle.minX = glm::max((int)glm::floor(glm::min(screen[0].x, glm::min(screen[1].x, screen[2].x))), 0);
+			newTriangle.maxX = glm::min((int)glm::ceil(glm::max(screen[0].x, glm::max(screen[1].x, screen[2].x))), OCCLUSION_BUFFER_WIDTH - 1);
+			newTriangle.minY = glm::max((int)glm::floor(glm::min(screen[0].y, glm::min(screen[1].y, screen[2].y))), 0);
+			newTriangle.maxY = glm::min((int)glm::ceil(glm::max(screen[0].y, glm::max(screen[1].y, screen[2].y))), OCCLUSION_BUFFER_HEIGHT - 1);
+			if (newTriangle.minX > newTriangle.maxX || newTriangle.minY > newTriangle.maxY)
+			{
+				continue;
+			}
+
+			// Edge functions: edges[0] == v0->v1, edges[1] == v1->v2, edges[2] == v2->v0
+			for (int edge = 0; edge < 3; edge++)
+			{
+				vec3 const& a	= screen[edge];
+				vec3 const& b	= screen[(edge + 1) % 3];
+				float edgeA		= a.y - b.y;
+				float edgeB		= b.x - a.x;
+				newTriangle.edges[edge] = vec3(edgeA, edgeB, -(edgeA * a.x + edgeB * a.y));
+			}
+
+			// Interpolate depth with the (normalized) edge functions as barycentric weights. Each vertex is weighted by its opposite edge:
+			newTriangle.depthPlane = (screen[0].z * newTriangle.edges[1] + screen[1].z * newTriangle.edges[2] + screen[2].z * newTriangle.edges[0]) / area;
+
+			// Rasterize conservatively, as a partially covered pixel may still show what's behind the occluder. A plane's extremes within
+			// a pixel are at its corners, 0.5 * (|a| + |b|) from its value at the center. Shrink the edges by this, so a pixel is only
+			// covered if it's entirely inside the triangle, and store the furthest depth within the pixel:
+			for (int edge = 0; edge < 3; edge++)
+			{
+				newTriangle.edges[edge].z -= 0.5f * (glm::abs(newTriangle.edges[edge].x) + glm::abs(newTriangle.edges[edge].y));
+			}
+			newTriangle.depthPlane.z += 0.5f * (glm::abs(newTriangle.depthPlane.x) + glm::abs(newTriangle.depthPlane.y));
+
+			this->triangles.emplace_back(newTriangle);
+		}
+	}
+
+
+	void OcclusionCuller::RasterizeRows(int firstRow, int lastRow)
+	{
+		float* depthBuffer			= &this->depthPyramid[0][0];
+		const __m128 laneOffsets	= _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);	// Pixel centers
+		const __m128 zero			= _mm_setzero_ps();
+
+		for (size_t i = 0; i < this->triangles.size(); i++)
+		{
+			ScreenTriangle const& currentTriangle = this->triangles[i];
+
+			int rowStart = glm::max(currentTriangle.minY, firstRow);
+			int rowEnd = glm::min(currentTriangle.maxY, lastRow - 1);
+			if (rowStart > rowEnd)
+			{
+				continue;
+			}
+
+			int columnStart = currentTriangle.minX & ~3; // Align to the SIMD width. The buffer width is a multiple of 4
+
+			__m128 edgeA0 = _mm_set1_ps(currentTriangle.edges[0].x);
+			__m128 edgeA1 = _mm_set1_ps(currentTriangle.edges[1].x);
+			__m128 edgeA2 = _mm_set1_ps(currentTriangle.edges[2].x);
+			__m128 depthA = _mm_set1_ps(currentTriangle.depthPlane.x);
+
+			for (int y = rowStart; y <= rowEnd; y++)
+			{
+				// Row-constant terms:
+				float pixelY	= (float)y + 0.5f;
+				__m128 edgeRow0	= _mm_set1_ps(currentTriangle.edges[0].y * pixelY + currentTriangle.edges[0].z);
+				__m128 edgeRow1	= _mm_set1_ps(currentTriangle.edges[1].y * pixelY + currentTriangle.edges[1].z);
+				__m128 edgeRow2	= _mm_set1_ps(currentTriangle.edges[2].y * pixelY + currentTriangle.edges[2].z);
+				__m128 depthRow	= _mm_set1_ps(currentTriangle.depthPlane.y * pixelY + currentTriangle.depthPlane.z);
+
+				float* depthRowPtr = depthBuffer + y * OCCLUSION_BUFFER_WIDTH;
+
+				for (int x = columnStart; x <= currentTriangle.maxX; x += 4)
+				{
+					__m128 pixelX = _mm_add_ps(_mm_set1_ps((float)x), laneOffsets);
+
+					__m128 edge0 = _mm_add_ps(_mm_mul_ps(edgeA0, pixelX), edgeRow0);
+					__m128 edge1 = _mm_add_ps(_mm_mul_ps(edgeA1, pixelX), edgeRow1);
+					__m128 edge2 = _mm_add_ps(_mm_mul_ps(edgeA2, pixelX), edgeRow2);
+
+					__m128 coverage = _mm_and_ps(_mm_cmpge_ps(edge0, zero), _mm_and_ps(_mm_cmpge_ps(edge1, zero), _mm_cmpge_ps(edge2, zero)));
+					if (_mm_movemask_ps(coverage) == 0)
+					{
+						continue;
+					}
+
+					__m128 depth		= _mm_add_ps(_mm_mul_ps(depthA, pixelX), depthRow);
+					__m128 oldDepth		= _mm_loadu_ps(depthRowPtr + x);
+					__m128 newDepth		= _mm_min_ps(oldDepth, depth);
+
+					_mm_storeu_ps(depthRowPtr + x, _mm_or_ps(_mm_and_ps(coverage, newDepth), _mm_andnot_ps(coverage, oldDepth)));
+				}
+			}
+		}
+	}
+
+
+	void OcclusionCuller::BuildDepthPyramid()
+	{
+		for (size_t level = 1; level < this->depthPyramid.size(); level++)
+		{
+			vector<float> const& source	= this->depthPyramid[level - 1];
+			vector<float>& destination	= this->depthPyramid[level];
+
+			unsigned int sourceWidth	= this->pyramidWidths[level - 1];
+			unsigned int sourceHeight	= this->pyramidHeights[level - 1];
+			unsigned int width			= this->pyramidWidths[level];
+			unsigned int height			= this->pyramidHeights[level];
+
+			for (unsigned int y = 0; y < height; y++)
+			{
+				unsigned int y0 = glm::min(y * 2, sourceHeight - 1);
+				unsigned int y1 = glm::min(y * 2 + 1, sourceHeight - 1);
+				for (unsigned int x = 0; x < width; x++)
+				{
+					unsigned int x0 = glm::min(x * 2, sourceWidth - 1);
+					unsigned int x1 = glm::min(x * 2 + 1, sourceWidth - 1);
+
+					destination[y * width + x] = glm::max
+					(
+						glm::max(source[y0 * sourceWidth + x0], source[y0 * sourceWidth + x1]),
+						glm::max(source[y1 * sourceWidth + x0], source[y1 * sourceWidth + x1])
+					);
+				}
+			}
+		}
+	}
+}
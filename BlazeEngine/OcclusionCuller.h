@@ -0,0 +1,96 @@
+// Software occlusion culling
+// Rasterizes the largest visible meshes into a low resolution CPU depth buffer, builds a hierarchical (max) depth pyramid from it,
+// and tests mesh bounds against the pyramid so occluded meshes can be skipped before they're submitted to the GPU
+
+#pragma once
+
+#define GLM_FORCE_SWIZZLE
+#include "glm.hpp"
+
+#include <vector>
+
+using glm::vec3;
+using glm::vec4;
+using glm::mat4;
+using std::vector;
+
+
+// Depth buffer resolution. Width must be a multiple of the SIMD width (4)
+#define OCCLUSION_BUFFER_WIDTH				256
+#define OCCLUSION_BUFFER_HEIGHT				128
+
+// Occluder selection limits:
+#define OCCLUSION_MAX_OCCLUDERS				32
+#define OCCLUSION_MAX_OCCLUDER_TRIANGLES	65536
+
+
+namespace BlazeEngine
+{
+	// Pre-declarations:
+	class Mesh;
+	class Camera;
+	class WorldBounds;
+	class WorkerPool;
+	struct Bounds;
+
+
+	class OcclusionCuller
+	{
+	public:
+		// workerPool: Splits rasterization across threads, in bands of rows. Not owned. If null, occluders are rasterized serially
+		OcclusionCuller(WorkerPool* workerPool = nullptr);
+
+		// Select the largest of the visible meshes as occluders, rasterize them from renderCam, and build the depth pyramid
+		void RenderOccluders(Camera* renderCam, vector<Mesh*> const& visibleMeshes, WorldBounds const& worldBounds);
+
+		// Remove every mesh with bounds hidden behind the occluders from visibleMeshes
+		void CullOccluded(vector<Mesh*>& visibleMeshes, WorldBounds const& worldBounds) const;
+
+		// Test world-space bounds against the depth pyramid. Conservative: Returns false if there's any doubt
+		bool IsOccluded(Bounds const& bounds) const;
+
+		// Getters:
+		inline vector<float> const& DepthBuffer() const			{ return depthPyramid[0]; } // Normalized [0, 1] depth, cleared to 1
+		inline unsigned int			NumOccluderTriangles() const { return (unsigned int)triangles.size(); }
+
+
+	private:
+		// A triangle in depth buffer space, stored as edge and depth plane equations: value(x, y) = a*x + b*y + c, evaluated at pixel
+		// centers. Both are offset to be conservative for the whole pixel: Edges are moved inwards, so only pixels entirely inside the
+		// triangle are covered, and depth is the furthest depth within the pixel
+		struct ScreenTriangle
+		{
+			vec3 edges[3];				// (a, b, c) per edge. A pixel is covered if all 3 edge values are >= 0
+			vec3 depthPlane;			// (a, b, c)
+
+			int minX, maxX, minY, maxY;	// Pixel bounds, clamped to the buffer
+		};
+
+		WorkerPool*				workerPool = nullptr;	// Owned by the RenderManager
+
+		vector<ScreenTriangle>	triangles;
+		vector<vec4>			clipVertices;	// Scratch space for transforming occluder vertices
+
+		// Depth pyramid: Level 0 is the rasterized depth buffer. Each subsequent level stores the maximum (furthest) depth of 2x2 texels
+		vector<vector<float>>	depthPyramid;
+		vector<unsigned int>	pyramidWidths;
+		vector<unsigned int>	pyramidHeights;
+
+		mat4 viewProjection		= mat4(1.0f);
+
+
+		// Private member functions:
+		//--------------------------
+
+		// Transform an occluder's triangles into screen space, and append them to triangles
+		void SetupTriangles(Mesh* occluder);
+
+		// Rasterize all triangles, writing rows [firstRow, lastRow) of the depth buffer. Disjoint row ranges can be rasterized concurrently
+		void RasterizeRows(int firstRow, int lastRow);
+
+		// Build levels 1+ of the depth pyramid from level 0
+		void BuildDepthPyramid();
+	};
+}
+
+
@@ -3,12 +3,11 @@
 #include "PostFXManager.h"
 #include "BuildConfiguration.h"
 #include "CoreEngine.h"
-#include "Mesh.h"
 #include "RenderTexture.h"
 #include "Shader.h"
 #include "Camera.h"
 #include "Material.h"
-#include "RenderTexture.h"
+#include "GLState.h"
 
 #include <vector>
 
@@ -17,23 +16,6 @@ namespace BlazeEngine
 {
 	PostFXManager::~PostFXManager()
 	{
-		if (pingPongTextures != nullptr)
-		{
-			for (int i = 0; i < NUM_DOWN_SAMPLES; i++)
-			{
-				pingPongTextures[i].Destroy();
-			}
-			delete [] pingPongTextures;
-			pingPongTextures	= nullptr;
-		}
-
-		if (blitShader != nullptr)
-		{
-			blitShader->Destroy();
-			delete blitShader;
-			blitShader = nullptr;
-		}
-
 		if (toneMapShader != nullptr)
 		{
 			toneMapShader->Destroy();
@@ -41,223 +23,162 @@ namespace BlazeEngine
 			toneMapShader = nullptr;
 		}
 
-		if (blurShaders != nullptr)
+		for (int i = 0; i < BLOOM_PASS_COUNT; i++)
 		{
-			for (int i = 0; i < BLUR_SHADER_COUNT; i++)
+			if (bloomShaders[i] != nullptr)
 			{
-				if (blurShaders[i] != nullptr)
-				{
-					blurShaders[i]->Destroy();
-					delete blurShaders[i];
-					blurShaders[i] = nullptr;
-				}				
+				bloomShaders[i]->Destroy();
+				delete bloomShaders[i];
+				bloomShaders[i] = nullptr;
 			}
 		}
-
-		if (screenAlignedQuad != nullptr)
-		{
-			screenAlignedQuad->Destroy();
-			delete screenAlignedQuad;
-			screenAlignedQuad = nullptr;
-		}		
 	}
 
-	void PostFXManager::Initialize(Material* outputMaterial)
+	void PostFXManager::Initialize()
 	{
-		// Cache the output material
-		this->outputMaterial = outputMaterial;
+		// Bloom targets are render graph transients, sized relative to the frame:
+		this->xRes				= CoreEngine::GetCoreEngine()->GetConfig()->GetValue<int>("windowXRes");
+		this->yRes				= CoreEngine::GetCoreEngine()->GetConfig()->GetValue<int>("windowYRes");
+		this->numBloomLevels	= glm::max(CoreEngine::GetCoreEngine()->GetConfig()->GetValue<int>("bloomLevels"), 2);	// The composite reads levels 0 and 1
+		this->bloomIntensity	= CoreEngine::GetCoreEngine()->GetConfig()->GetValue<float>("bloomIntensity");
 
-		// Configure render buffers:
-		this->pingPongTextures = new RenderTexture[NUM_DOWN_SAMPLES + 1]; // +1 so we have an extra RenderTexture to pingpong between at the lowest res
 
-		int currentXRes = CoreEngine::GetCoreEngine()->GetConfig()->GetValue<int>("windowXRes") / 2;
-		int currentYRes = CoreEngine::GetCoreEngine()->GetConfig()->GetValue<int>("windowYRes") / 2;
-
-		for (int i = 0; i <= NUM_DOWN_SAMPLES; i++)
+		// Configure shaders:
+		const string bloomKeywords[BLOOM_PASS_COUNT] = { "BLOOM_PREFILTER", "BLOOM_DOWNSAMPLE", "BLOOM_UPSAMPLE", "BLOOM_COMPOSITE" };
+		for (int i = 0; i < BLOOM_PASS_COUNT; i++)
 		{
-			pingPongTextures[i] = RenderTexture
-			(
-				currentXRes,
-				currentYRes,
-				"PostFX_PingPongTexture_" + to_string(currentXRes) + "x" + to_string(currentYRes)
-			);
+			vector<string> keywords(1, bloomKeywords[i]);
+			bloomShaders[i] = Shader::CreateComputeShader(CoreEngine::GetCoreEngine()->GetConfig()->GetValue<string>("bloomShader"), &keywords);
+		}
 
-			pingPongTextures[i].Format() = GL_RGBA;		// Note: Using 4 channels for future flexibility
-			pingPongTextures[i].InternalFormat() = GL_RGBA32F;
+		toneMapShader = Shader::CreateShader(CoreEngine::GetCoreEngine()->GetConfig()->GetValue<string>("toneMapShader"));
 
-			pingPongTextures[i].TextureMinFilter() = GL_LINEAR;
-			pingPongTextures[i].TextureMaxFilter() = GL_LINEAR;
 
-			pingPongTextures[i].AttachmentPoint() = GL_COLOR_ATTACHMENT0 + 0;
+		// Upload Shader parameters:
+		toneMapShader->UploadUniform("exposure", &CoreEngine::GetSceneManager()->GetMainCamera()->Exposure(), UNIFORM_Float);
 
-			pingPongTextures[i].ReadBuffer() = GL_COLOR_ATTACHMENT0 + 0;
-			pingPongTextures[i].DrawBuffer() = GL_COLOR_ATTACHMENT0 + 0;
+		// Each upsample adds another level's contribution: Normalize, so the intensity doesn't depend on the number of levels
+		float compositeIntensity = this->bloomIntensity / (float)this->numBloomLevels;
+		bloomShaders[BLOOM_PASS_COMPOSITE]->UploadUniform("bloomIntensity", &compositeIntensity, UNIFORM_Float);
+	}
 
-			// Assign and buffer texture:
-			pingPongTextures[i].Buffer(RENDER_TEXTURE_0 + RENDER_TEXTURE_ALBEDO);
 
-			// Don't halve the resolution for the last 2 iterations:
-			if (i < NUM_DOWN_SAMPLES - 1)
-			{
-				currentXRes /= 2;
-				currentYRes /= 2;
-			}
-		}
+	RenderGraphResource PostFXManager::AddPostFXPasses(RenderGraph* renderGraph, RenderGraphResource sceneColor, Shader*& finalFrameShader)
+	{
+		vector<RenderGraphResource> levels(this->numBloomLevels);
 
+		// Luminance threshold, fused with the first downsample: Scene color -> Level 0
+		levels[0] = renderGraph->CreateTexture("Bloom level 0", BloomTextureDesc(0));
 
-		// Configure shaders:
-		vector<string> luminanceThresholdKeywords(1,	"BLUR_SHADER_LUMINANCE_THRESHOLD");
-		vector<string> horizontalBlurKeywords(1,		"BLUR_SHADER_HORIZONTAL");
-		vector<string> verticalBlurKeywords(1,			"BLUR_SHADER_VERTICAL");
-		
-		blurShaders[BLUR_SHADER_LUMINANCE_THRESHOLD]	= Shader::CreateShader(CoreEngine::GetCoreEngine()->GetConfig()->GetValue<string>("blurShader"), &luminanceThresholdKeywords);
-		blurShaders[BLUR_SHADER_HORIZONTAL]				= Shader::CreateShader(CoreEngine::GetCoreEngine()->GetConfig()->GetValue<string>("blurShader"), &horizontalBlurKeywords);
-		blurShaders[BLUR_SHADER_VERTICAL]				= Shader::CreateShader(CoreEngine::GetCoreEngine()->GetConfig()->GetValue<string>("blurShader"), &verticalBlurKeywords);
+		int prefilterPass = renderGraph->AddPass("Bloom prefilter", [this, sceneColor, levels](RenderGraph& graph)
+		{
+			Dispatch(BLOOM_PASS_PREFILTER, graph.GetTexture(sceneColor), nullptr, graph.GetTexture(levels[0]));
+		});
+		renderGraph->Read(prefilterPass, sceneColor);
+		levels[0] = renderGraph->Write(prefilterPass, levels[0]);
 
-		blitShader										= Shader::CreateShader(CoreEngine::GetCoreEngine()->GetConfig()->GetValue<string>("blitShader"));
-		toneMapShader									= Shader::CreateShader(CoreEngine::GetCoreEngine()->GetConfig()->GetValue<string>("toneMapShader"));
+		// Downsample: The 13-tap filter footprint blurs as it goes, so no separate blur passes are needed
+		for (int i = 1; i < this->numBloomLevels; i++)
+		{
+			levels[i] = renderGraph->CreateTexture("Bloom level " + to_string(i), BloomTextureDesc(i));
 
+			int downsamplePass = renderGraph->AddPass("Bloom downsample " + to_string(i), [this, i, levels](RenderGraph& graph)
+			{
+				Dispatch(BLOOM_PASS_DOWNSAMPLE, graph.GetTexture(levels[i - 1]), nullptr, graph.GetTexture(levels[i]));
+			});
+			renderGraph->Read(downsamplePass, levels[i - 1]);
+			levels[i] = renderGraph->Write(downsamplePass, levels[i]);
+		}
 
-		// Upload Shader parameters:
-		toneMapShader->UploadUniform("exposure", &CoreEngine::GetSceneManager()->GetMainCamera()->Exposure(), UNIFORM_Float);
+		// Upsample: Accumulate each level into the next largest, down to level 1
+		for (int i = this->numBloomLevels - 1; i > 1; i--)
+		{
+			int upsamplePass = renderGraph->AddPass("Bloom upsample " + to_string(i), [this, i, levels](RenderGraph& graph)
+			{
+				Dispatch(BLOOM_PASS_UPSAMPLE, graph.GetTexture(levels[i]), nullptr, graph.GetTexture(levels[i - 1]));
+			});
+			renderGraph->Read(upsamplePass, levels[i]);
+			renderGraph->Read(upsamplePass, levels[i - 1]);
+			levels[i - 1] = renderGraph->Write(upsamplePass, levels[i - 1]);
+		}
 
-		// Upload the texel size for the SMALLEST pingpong textures:
-		vec4 texelSize = this->pingPongTextures[NUM_DOWN_SAMPLES].TexelSize();
-		blurShaders[BLUR_SHADER_HORIZONTAL]->UploadUniform("texelSize", &texelSize.x, UNIFORM_Vec4fv);
-		blurShaders[BLUR_SHADER_VERTICAL]->UploadUniform("texelSize", &texelSize.x, UNIFORM_Vec4fv);
+		// Upsample level 1 into level 0, and additively composite the result into the full-sized scene color:
+		int compositePass = renderGraph->AddPass("Bloom composite", [this, sceneColor, levels](RenderGraph& graph)
+		{
+			Dispatch(BLOOM_PASS_COMPOSITE, graph.GetTexture(levels[0]), graph.GetTexture(levels[1]), graph.GetTexture(sceneColor));
+		});
+		renderGraph->Read(compositePass, levels[0]);
+		renderGraph->Read(compositePass, levels[1]);
+		renderGraph->Read(compositePass, sceneColor);
+		sceneColor = renderGraph->Write(compositePass, sceneColor);
 
+		// Set the final frame shader to apply tone mapping:
+		finalFrameShader = this->toneMapShader;
 
-		screenAlignedQuad = new Mesh	// TODO: Use the RenderManager's instead of duplicating it here?
-		(
-			Mesh::CreateQuad
-			(
-				vec3(-1.0f, 1.0f, 0.0f),	// TL
-				vec3(1.0f, 1.0f, 0.0f),		// TR
-				vec3(-1.0f, -1.0f, 0.0f),	// BL
-				vec3(1.0f, -1.0f, 0.0f)		// BR
-			)
-		);
+		return sceneColor;
 	}
 
 
-	void PostFXManager::ApplyPostFX(Material*& finalFrameMaterial, Shader*& finalFrameShader)
+	void PostFXManager::SetRenderScale(vec2 renderScale)
 	{
-		// Pass 1: Apply luminance threshold: Finished frame -> 1/2 res
-		this->screenAlignedQuad->Bind(true);
-		glViewport(0, 0, this->pingPongTextures[0].Width(), this->pingPongTextures[0].Height());
-
-		// Bind the target FBO, luminance threshold shader, and source texture:
-		this->pingPongTextures[0].BindFramebuffer(true);
-		this->blurShaders[BLUR_SHADER_LUMINANCE_THRESHOLD]->Bind(true);
-		this->outputMaterial->AccessTexture(RENDER_TEXTURE_ALBEDO)->Bind(RENDER_TEXTURE_0 + RENDER_TEXTURE_ALBEDO, true);
-
-		// Draw!
-		glDrawElements(GL_TRIANGLES, screenAlignedQuad->NumIndices(), GL_UNSIGNED_INT, (void*)(0)); // (GLenum mode, GLsizei count, GLenum type, const GLvoid* indices);
-
-		// Cleanup:
-		this->blurShaders[BLUR_SHADER_LUMINANCE_THRESHOLD]->Bind(false);
-		this->outputMaterial->AccessTexture(RENDER_TEXTURE_ALBEDO)->Bind(RENDER_TEXTURE_0 + RENDER_TEXTURE_ALBEDO, false);
-		this->pingPongTextures[0].BindFramebuffer(false);
-
-		// Continue downsampling: Blit to the remaining textures:
-		this->blitShader->Bind(true);
-		for (int i = 1; i < NUM_DOWN_SAMPLES; i++)
-		{
-			// Configure the viewport:
-			glViewport(0, 0, this->pingPongTextures[i].Width(), this->pingPongTextures[i].Height());
-
-			// Bind the target FBO, and source texture to the shader
-			this->pingPongTextures[i].BindFramebuffer(true);
-			this->pingPongTextures[i - 1].Bind(RENDER_TEXTURE_0 + RENDER_TEXTURE_ALBEDO, true);
-
-			// Draw!
-			glDrawElements(GL_TRIANGLES, screenAlignedQuad->NumIndices(), GL_UNSIGNED_INT, (void*)(0)); // (GLenum mode, GLsizei count, GLenum type, const GLvoid* indices);
+		this->renderScale = renderScale;
 
-			// Cleanup:
-			this->pingPongTextures[i - 1].Bind(RENDER_TEXTURE_0 + RENDER_TEXTURE_ALBEDO, false);
-			this->pingPongTextures[i].BindFramebuffer(false);
+		toneMapShader->UploadUniform("renderScale", &this->renderScale.x, UNIFORM_Vec2fv);
+		for (int i = 0; i < BLOOM_PASS_COUNT; i++)
+		{
+			bloomShaders[i]->UploadUniform("renderScale", &this->renderScale.x, UNIFORM_Vec2fv);
 		}
+	}
 
-		// Cleanup:
-		this->blitShader->Bind(false);
-
-		// Blur the final low-res image:
-		glViewport(0, 0, this->pingPongTextures[NUM_DOWN_SAMPLES].Width(), this->pingPongTextures[NUM_DOWN_SAMPLES].Height());
-		for (int i = 0; i < this->NUM_BLUR_PASSES; i++)
-		{
-			// Horizontal pass: (NUM_DOWN_SAMPLES - 1) -> NUM_DOWN_SAMPLES
 
-			// Bind the target FBO, shader, and source texture:
-			this->pingPongTextures[NUM_DOWN_SAMPLES].BindFramebuffer(true);
-			blurShaders[BLUR_SHADER_HORIZONTAL]->Bind(true);
-			this->pingPongTextures[NUM_DOWN_SAMPLES - 1].Bind(RENDER_TEXTURE_0 + RENDER_TEXTURE_ALBEDO, true);
+	RenderGraphTextureDesc PostFXManager::BloomTextureDesc(int level) const
+	{
+		RenderGraphTextureDesc desc;
+		desc.width			= glm::max(this->xRes >> (level + 1), 1);
+		desc.height			= glm::max(this->yRes >> (level + 1), 1);
 
-			// Draw!
-			glDrawElements(GL_TRIANGLES, screenAlignedQuad->NumIndices(), GL_UNSIGNED_INT, (void*)(0));
+		desc.internalFormat	= GL_R11F_G11F_B10F;	// Note: Bloom only needs HDR color, so we use a packed float format
+		desc.format			= GL_RGB;
+		desc.type			= GL_FLOAT;
+		desc.filter			= GL_LINEAR;			// The bloom filters rely on bilinear fetches
 
-			// Cleanup:
-			this->pingPongTextures[NUM_DOWN_SAMPLES - 1].Bind(RENDER_TEXTURE_0 + RENDER_TEXTURE_ALBEDO, false);
-			blurShaders[BLUR_SHADER_HORIZONTAL]->Bind(false);
-			this->pingPongTextures[NUM_DOWN_SAMPLES].BindFramebuffer(false);
+		return desc;
+	}
 
 
-			// Vertical pass: NUM_DOWN_SAMPLES -> (NUM_DOWN_SAMPLES - 1)
-			
-			// Bind the target FBO, shader, and source texture:
-			this->pingPongTextures[NUM_DOWN_SAMPLES - 1].BindFramebuffer(true);
-			blurShaders[BLUR_SHADER_VERTICAL]->Bind(true);
-			this->pingPongTextures[NUM_DOWN_SAMPLES].Bind(RENDER_TEXTURE_0 + RENDER_TEXTURE_ALBEDO, true);
+	void PostFXManager::Dispatch(BLOOM_PASS pass, RenderTexture* source, RenderTexture* lower, RenderTexture* target)
+	{
+		Shader* currentShader = this->bloomShaders[pass];
 
-			// Draw!
-			glDrawElements(GL_TRIANGLES, screenAlignedQuad->NumIndices(), GL_UNSIGNED_INT, (void*)(0));
+		vec4 sourceTexelSize = source->TexelSize();
+		vec4 targetTexelSize = target->TexelSize();
+		currentShader->UploadUniform("sourceTexelSize", &sourceTexelSize.x, UNIFORM_Vec4fv);
+		currentShader->UploadUniform("targetTexelSize", &targetTexelSize.x, UNIFORM_Vec4fv);
 
-			// Cleanup:
-			this->pingPongTextures[NUM_DOWN_SAMPLES].Bind(RENDER_TEXTURE_0 + RENDER_TEXTURE_ALBEDO, false);
-			blurShaders[BLUR_SHADER_VERTICAL]->Bind(false);
-			this->pingPongTextures[NUM_DOWN_SAMPLES - 1].BindFramebuffer(false);
-		}
+		currentShader->Bind(true);
 
-		// Up-sample: Blit to successively larger textures:
-		this->blitShader->Bind(true);
-		for (int i = NUM_DOWN_SAMPLES - 1; i > 0; i--)
+		source->Bind(RENDER_TEXTURE_0 + RENDER_TEXTURE_ALBEDO, true);
+		if (lower != nullptr)
 		{
-			// Configure the viewport for the next, larger texture:
-			glViewport(0, 0, this->pingPongTextures[i - 1].Width(), this->pingPongTextures[i - 1].Height());
-
-			// Bind the target FBO, and source texture to the shader:
-			this->pingPongTextures[i - 1].BindFramebuffer(true);
-			this->pingPongTextures[i].Bind(RENDER_TEXTURE_0 + RENDER_TEXTURE_ALBEDO, true);
-
-			// Draw!
-			glDrawElements(GL_TRIANGLES, screenAlignedQuad->NumIndices(), GL_UNSIGNED_INT, (void*)(0));
-
-			// Cleanup:
-			this->pingPongTextures[i].Bind(RENDER_TEXTURE_0 + RENDER_TEXTURE_ALBEDO, false);
-			this->pingPongTextures[i - 1].BindFramebuffer(false);
+			lower->Bind(RENDER_TEXTURE_0 + RENDER_TEXTURE_WORLD_NORMAL, true);
 		}
 
-		// Additively blit final blurred result (ie. half res) to the original, full-sized image: [0] -> output material
-		glViewport(0, 0, this->outputMaterial->AccessTexture(RENDER_TEXTURE_ALBEDO)->Width(), this->outputMaterial->AccessTexture(RENDER_TEXTURE_ALBEDO)->Height());
-		((RenderTexture*)this->outputMaterial->AccessTexture(RENDER_TEXTURE_ALBEDO))->BindFramebuffer(true);
-
-		// Bind source:
-		this->pingPongTextures[0].Bind(RENDER_TEXTURE_0 + RENDER_TEXTURE_ALBEDO, true);
-		
-		glEnable(GL_BLEND);
-		glDrawElements(GL_TRIANGLES, screenAlignedQuad->NumIndices(), GL_UNSIGNED_INT, (void*)(0)); // (GLenum mode, GLsizei count, GLenum type, const GLvoid* indices);
-		glDisable(GL_BLEND);
+		// The prefilter and downsample passes overwrite every target texel, so they don't need to read it:
+		GLenum access = (pass == BLOOM_PASS_UPSAMPLE || pass == BLOOM_PASS_COMPOSITE) ? GL_READ_WRITE : GL_WRITE_ONLY;
+		glBindImageTexture(0, target->TextureID(), 0, GL_FALSE, 0, access, target->InternalFormat());
 
-		// Set the final frame material and shader to apply tone mapping:
-		finalFrameMaterial	= this->outputMaterial;
-		finalFrameShader	= this->toneMapShader;
+		// Only the texels inside the dynamic resolution viewport are processed:
+		int numTexelsX = (int)glm::ceil((float)target->Width() * this->renderScale.x);
+		int numTexelsY = (int)glm::ceil((float)target->Height() * this->renderScale.y);
 
-		// Cleanup:
-		blitShader->Bind(false);
-		this->pingPongTextures[0].Bind(RENDER_TEXTURE_0 + RENDER_TEXTURE_ALBEDO, false);
-		((RenderTexture*)outputMaterial->AccessTexture(RENDER_TEXTURE_ALBEDO))->BindFramebuffer(false);
+		glDispatchCompute
+		(
+			(numTexelsX + BLOOM_GROUP_SIZE - 1) / BLOOM_GROUP_SIZE,
+			(numTexelsY + BLOOM_GROUP_SIZE - 1) / BLOOM_GROUP_SIZE,
+			1
+		);
 
-		screenAlignedQuad->Bind(false);
+		// Make the image writes visible to the next pass's texture fetches and image loads:
+		glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
 	}
 }
-
-
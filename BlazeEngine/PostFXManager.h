@@ -1,24 +1,33 @@
 #pragma once
 
+#include "RenderGraph.h"
+
 #include <string>
 
+#define GLM_FORCE_SWIZZLE
+#include "glm.hpp"
+
+using glm::vec2;
+
 
 namespace BlazeEngine
 {
 	// Pre-declarations:
-	class Mesh;
 	class Shader;
-	class Material;
 	class RenderTexture;
 
 
-	enum BLUR_PASS
+	#define BLOOM_GROUP_SIZE	8	// Compute work group width and height. Must match BLOOM_GROUP_SIZE in bloomShader.comp
+
+
+	enum BLOOM_PASS
 	{
-		BLUR_SHADER_LUMINANCE_THRESHOLD,
-		BLUR_SHADER_HORIZONTAL,
-		BLUR_SHADER_VERTICAL,
+		BLOOM_PASS_PREFILTER,		// Luminance threshold + first downsample
+		BLOOM_PASS_DOWNSAMPLE,
+		BLOOM_PASS_UPSAMPLE,
+		BLOOM_PASS_COMPOSITE,		// Last upsample + additive composite into the scene color
 
-		BLUR_SHADER_COUNT			// RESERVED: Number of blur passes in total
+		BLOOM_PASS_COUNT			// RESERVED: Number of bloom shader variants in total
 	};
 
 	class PostFXManager
@@ -29,29 +38,35 @@ namespace BlazeEngine
 		~PostFXManager();
 
 		// Initialize PostFX. Must be called after the scene has been loaded and the RenderManager has finished initializing OpenGL
-		void Initialize(Material* outputMaterial);
+		void Initialize();
 
-		// Apply post processing. Modifies finalFrameMaterial and finalFrameShader to contain the material & shader required to blit the final image to screen
-		void ApplyPostFX(Material*& finalFrameMaterial, Shader*& finalFrameShader);
+		// Add the post processing passes to the render graph. Returns the new version of sceneColor, and modifies finalFrameShader
+		// to contain the shader required to blit the final image to screen. Intermediate targets are render graph transients
+		RenderGraphResource AddPostFXPasses(RenderGraph* renderGraph, RenderGraphResource sceneColor, Shader*& finalFrameShader);
 
 		// Getters/Setters:
 
+		// Set the fraction of the frame sized targets covered by the dynamic resolution viewport. Bloom only processes the covered
+		// texels, and the final frame shader upscales them to the window
+		void SetRenderScale(vec2 renderScale);
 
 
 	private:
 
-		Material* outputMaterial		= nullptr;	// Recieved from RenderManager
-
-		RenderTexture* pingPongTextures = nullptr;	// Deallocated in destructor
-		const int NUM_DOWN_SAMPLES		= 2;		// Scaling factor: We half the frame size this many times
-		const int NUM_BLUR_PASSES		= 3;		// How many pairs of horizontal + vertical blur passes to perform
+		int xRes						= 0;
+		int yRes						= 0;
+		int numBloomLevels				= 5;		// Each level is half the size of the previous. Level 0 is half the frame size
+		float bloomIntensity			= 1.0f;
+		vec2 renderScale				= vec2(1.0f, 1.0f);
 
-		Shader* blitShader				= nullptr;	// Deallocated in destructor
 		Shader* toneMapShader			= nullptr;	// Deallocated in destructor
-		Shader* blurShaders[BLUR_SHADER_COUNT];		// Deallocated in destructor
-		
-		
-		Mesh* screenAlignedQuad			= nullptr;	// Deallocated in destructor
+		Shader* bloomShaders[BLOOM_PASS_COUNT] = {};	// Deallocated in destructor
+
+		// Description of the transient bloom target for a level
+		RenderGraphTextureDesc BloomTextureDesc(int level) const;
+
+		// Bind source (and optionally lower) for sampling and target as image 0, then dispatch 1 invocation per target texel
+		void Dispatch(BLOOM_PASS pass, RenderTexture* source, RenderTexture* lower, RenderTexture* target);
 	};
 }
 
@@ -0,0 +1,542 @@
+#include "RenderGraph.h"
+#include "RenderTexture.h"
+#include "GPUTimer.h"
+#include "Material.h"
+#include "BuildConfiguration.h"
+
+#include <string>
+#include <algorithm>
+
+using std::to_string;
+
+
+namespace BlazeEngine
+{
+	bool RenderGraphTextureDesc::operator==(RenderGraphTextureDesc const& rhs) const
+	{
+		return
+			this->width				== rhs.width			&&
+			this->height			== rhs.height			&&
+			this->internalFormat	== rhs.internalFormat	&&
+			this->format			== rhs.format			&&
+			this->type				== rhs.type				&&
+			this->filter			== rhs.filter;
+	}
+
+
+	RenderGraph::~RenderGraph()
+	{
+		Reset();
+
+		for (unsigned int i = 0; i < (unsigned int)this->physicalTextures.size(); i++)
+		{
+			this->physicalTextures[i].texture->Destroy();
+			delete this->physicalTextures[i].texture;
+			this->physicalTextures[i].texture = nullptr;
+		}
+		this->physicalTextures.clear();
+	}
+
+
+	void RenderGraph::Reset()
+	{
+		this->passes.clear();
+		this->textures.clear();
+		this->resources.clear();
+		this->passOrder.clear();
+		this->currentPass = -1;
+	}
+
+
+	RenderGraphResource RenderGraph::ImportTexture(string const& name, RenderTexture* texture)
+	{
+		VirtualTexture newTexture;
+		newTexture.name				= name;
+		newTexture.isImported		= true;
+		newTexture.importedTexture	= texture;
+		if (texture != nullptr)
+		{
+			newTexture.desc.width	= texture->Width();
+			newTexture.desc.height	= texture->Height();
+		}
+
+		this->textures.emplace_back(newTexture);
+
+		return AddResourceNode((int)this->textures.size() - 1, 0);
+	}
+
+
+	RenderGraphResource RenderGraph::CreateTexture(string const& name, RenderGraphTextureDesc const& desc)
+	{
+		VirtualTexture newTexture;
+		newTexture.name	= name;
+		newTexture.desc	= desc;
+
+		this->textures.emplace_back(newTexture);
+
+		return AddResourceNode((int)this->textures.size() - 1, 0);
+	}
+
+
+	int RenderGraph::AddPass(string const& name, RenderGraphExecuteFunction execute, bool hasSideEffects /*= false*/)
+	{
+		Pass newPass;
+		newPass.name			= name;
+		newPass.execute			= execute;
+		newPass.hasSideEffects	= hasSideEffects;
+
+		this->passes.emplace_back(newPass);
+
+		return (int)this->passes.size() - 1;
+	}
+
+
+	void RenderGraph::Read(int pass, RenderGraphResource resource)
+	{
+		this->passes[pass].reads.emplace_back(resource);
+		this->resources[resource].readers.emplace_back(pass);
+	}
+
+
+	RenderGraphResource RenderGraph::Write(int pass, RenderGraphResource resource)
+	{
+		RenderGraphResource newVersion = AddResourceNode(this->resources[resource].textureIndex, this->resources[resource].version + 1);
+
+		this->resources[newVersion].producer	= pass;
+		this->resources[newVersion].previous	= resource;
+
+		this->passes[pass].writes.emplace_back(newVersion);
+
+		return newVersion;
+	}
+
+
+	bool RenderGraph::Compile()
+	{
+		CullPasses();
+
+		if (!SortPasses())
+		{
+			LOG_ERROR("Render graph contains a cycle, and cannot be executed");
+			this->passOrder.clear();
+			return false;
+		}
+
+		AllocateTransients();
+
+		// Track changes, so the compiled graph is only logged when it differs:
+		string signature;
+		for (unsigned int i = 0; i < (unsigned int)this->passOrder.size(); i++)
+		{
+			signature += this->passes[this->passOrder[i]].name + ";";
+		}
+		for (unsigned int i = 0; i < (unsigned int)this->textures.size(); i++)
+		{
+			signature += to_string(this->textures[i].physicalIndex) + ";";
+		}
+
+		this->hasChanged		= signature != this->compiledSignature;
+		this->compiledSignature	= signature;
+
+		return true;
+	}
+
+
+	void RenderGraph::Execute(GPUTimer* timer /*= nullptr*/)
+	{
+		for (this->currentPass = 0; this->currentPass < (int)this->passOrder.size(); this->currentPass++)
+		{
+			Pass const& pass = this->passes[this->passOrder[this->currentPass]];
+
+			if (timer != nullptr)
+			{
+				timer->BeginPass(pass.name);
+			}
+
+			pass.execute(*this);
+
+			if (timer != nullptr)
+			{
+				timer->EndPass();
+			}
+		}
+		this->currentPass = -1;
+	}
+
+
+	RenderTexture* RenderGraph::GetTexture(RenderGraphResource resource) const
+	{
+		if (resource < 0 || resource >= (int)this->resources.size())
+		{
+			LOG_ERROR("Invalid render graph resource requested by pass \"" + (this->currentPass >= 0 ? this->passes[this->passOrder[this->currentPass]].name : string("none")) + "\"");
+			return nullptr;
+		}
+
+		VirtualTexture const& texture = this->textures[this->resources[resource].textureIndex];
+		if (texture.isImported)
+		{
+			return texture.importedTexture;
+		}
+		return texture.physicalIndex >= 0 ? this->physicalTextures[texture.physicalIndex].texture : nullptr;
+	}
+
+
+	void RenderGraph::LogCompiledGraph() const
+	{
+		LOG("Compiled render graph: " + to_string(this->passOrder.size()) + " of " + to_string(this->passes.size()) + " passes, " + to_string(this->textures.size()) + " textures");
+
+		auto ResourceName = [&](RenderGraphResource resource)
+		{
+			return this->textures[this->resources[resource].textureIndex].name + " (v" + to_string(this->resources[resource].version) + ")";
+		};
+
+		for (unsigned int i = 0; i < (unsigned int)this->passOrder.size(); i++)
+		{
+			Pass const& currentPass = this->passes[this->passOrder[i]];
+
+			string passDescription = "\t" + to_string(i) + ": \"" + currentPass.name + "\"" + (currentPass.hasSideEffects ? " [side effects]" : "");
+			for (unsigned int j = 0; j < (unsigned int)currentPass.reads.size(); j++)
+			{
+				passDescription += (j == 0 ? "\n\t\tReads: " : ", ") + ResourceName(currentPass.reads[j]);
+			}
+			for (unsigned int j = 0; j < (unsigned int)currentPass.writes.size(); j++)
+			{
+				passDescription += (j == 0 ? "\n\t\tWrites: " : ", ") + ResourceName(currentPass.writes[j]);
+			}
+			LOG(passDescription);
+		}
+
+		for (unsigned int i = 0; i < (unsigned int)this->passes.size(); i++)
+		{
+			if (this->passes[i].isCulled)
+			{
+				LOG("\tCulled: \"" + this->passes[i].name + "\"");
+			}
+		}
+
+		// Transient lifetimes and aliasing:
+		size_t virtualBytes = 0;
+		for (unsigned int i = 0; i < (unsigned int)this->textures.size(); i++)
+		{
+			VirtualTexture const& currentTexture = this->textures[i];
+			if (currentTexture.isImported || currentTexture.physicalIndex < 0)
+			{
+				continue;
+			}
+
+			virtualBytes += TextureSize(currentTexture.desc);
+
+			LOG
+			(
+				"\tTransient \"" + currentTexture.name + "\" " + to_string(currentTexture.desc.width) + "x" + to_string(currentTexture.desc.height) +
+				": Passes " + to_string(currentTexture.firstPass) + "-" + to_string(currentTexture.lastPass) +
+				" -> Physical texture " + to_string(currentTexture.physicalIndex)
+			);
+		}
+
+		size_t physicalBytes = 0;
+		for (unsigned int i = 0; i < (unsigned int)this->physicalTextures.size(); i++)
+		{
+			if (this->physicalTextures[i].lastPass >= 0)
+			{
+				physicalBytes += TextureSize(this->physicalTextures[i].desc);
+			}
+		}
+
+		const float bytesPerMB = 1024.0f * 1024.0f;
+		LOG
+		(
+			"\tTransient memory: " + to_string(virtualBytes / bytesPerMB) + "MB virtual, " + to_string(physicalBytes / bytesPerMB) +
+			"MB physical. Aliasing saved " + to_string((virtualBytes - physicalBytes) / bytesPerMB) + "MB"
+		);
+	}
+
+
+	RenderGraphResource RenderGraph::AddResourceNode(int textureIndex, int version)
+	{
+		ResourceNode newNode;
+		newNode.textureIndex	= textureIndex;
+		newNode.version			= version;
+
+		this->resources.emplace_back(newNode);
+
+		return (RenderGraphResource)this->resources.size() - 1;
+	}
+
+
+	void RenderGraph::CullPasses()
+	{
+		// Reference count passes by the resources they write, and resources by the passes that read them:
+		vector<RenderGraphResource> unreferenced;
+		for (unsigned int i = 0; i < (unsigned int)this->resources.size(); i++)
+		{
+			this->resources[i].refCount = (int)this->resources[i].readers.size();
+			if (this->resources[i].refCount == 0 && this->resources[i].producer >= 0)
+			{
+				unreferenced.emplace_back(i);
+			}
+		}
+
+		vector<int> culledPasses;
+		for (unsigned int i = 0; i < (unsigned int)this->passes.size(); i++)
+		{
+			this->passes[i].refCount = (int)this->passes[i].writes.size();
+			this->passes[i].isCulled = false;
+
+			if (this->passes[i].refCount == 0 && !this->passes[i].hasSideEffects)
+			{
+				culledPasses.emplace_back(i);
+			}
+		}
+
+		// Flood fill from the unused resources: A pass is culled once none of its outputs are used
+		while (!unreferenced.empty() || !culledPasses.empty())
+		{
+			if (!unreferenced.empty())
+			{
+				int producer = this->resources[unreferenced.back()].producer;
+				unreferenced.pop_back();
+
+				if (!this->passes[producer].hasSideEffects && --this->passes[producer].refCount == 0)
+				{
+					culledPasses.emplace_back(producer);
+				}
+				continue;
+			}
+
+			Pass& culledPass = this->passes[culledPasses.back()];
+			culledPasses.pop_back();
+			culledPass.isCulled = true;
+
+			for (unsigned int i = 0; i < (unsigned int)culledPass.reads.size(); i++)
+			{
+				ResourceNode& input = this->resources[culledPass.reads[i]];
+				if (--input.refCount == 0 && input.producer >= 0)
+				{
+					unreferenced.emplace_back(culledPass.reads[i]);
+				}
+			}
+		}
+	}
+
+
+	bool RenderGraph::SortPasses()
+	{
+		// Build the dependency edges between the remaining passes:
+		size_t numPasses = this->passes.size();
+		vector<vector<int>> dependents(numPasses);
+		vector<int> numDependencies(numPasses, 0);
+
+		auto AddDependency = [&](int first, int second)
+		{
+			if (first < 0 || first == second || this->passes[first].isCulled)
+			{
+				return;
+			}
+			dependents[first].emplace_back(second);
+			numDependencies[second]++;
+		};
+
+		for (int i = 0; i < (int)numPasses; i++)
+		{
+			Pass const& currentPass = this->passes[i];
+			if (currentPass.isCulled)
+			{
+				continue;
+			}
+
+			// Read after write:
+			for (unsigned int j = 0; j < (unsigned int)currentPass.reads.size(); j++)
+			{
+				AddDependency(this->resources[currentPass.reads[j]].producer, i);
+			}
+
+			// Write after write, and write after read: Writes must follow the previous version's producer and readers
+			for (unsigned int j = 0; j < (unsigned int)currentPass.writes.size(); j++)
+			{
+				ResourceNode const& previousVersion = this->resources[this->resources[currentPass.writes[j]].previous];
+
+				AddDependency(previousVersion.producer, i);
+				for (unsigned int k = 0; k < (unsigned int)previousVersion.readers.size(); k++)
+				{
+					AddDependency(previousVersion.readers[k], i);
+				}
+			}
+		}
+
+		// Kahn's algorithm. Ready passes are taken in declaration order, so the declared order is kept wherever it's valid:
+		this->passOrder.clear();
+		vector<bool> isScheduled(numPasses, false);
+		size_t numRemaining = 0;
+		for (size_t i = 0; i < numPasses; i++)
+		{
+			numRemaining += this->passes[i].isCulled ? 0 : 1;
+		}
+
+		while (this->passOrder.size() < numRemaining)
+		{
+			int nextPass = -1;
+			for (int i = 0; i < (int)numPasses; i++)
+			{
+				if (!this->passes[i].isCulled && !isScheduled[i] && numDependencies[i] == 0)
+				{
+					nextPass = i;
+					break;
+				}
+			}
+
+			if (nextPass < 0)
+			{
+				return false;
+			}
+
+			isScheduled[nextPass] = true;
+			this->passOrder.emplace_back(nextPass);
+
+			for (unsigned int i = 0; i < (unsigned int)dependents[nextPass].size(); i++)
+			{
+				numDependencies[dependents[nextPass][i]]--;
+			}
+		}
+
+		return true;
+	}
+
+
+	void RenderGraph::AllocateTransients()
+	{
+		// Compute the lifetime of each texture over the ordered passes:
+		for (int i = 0; i < (int)this->passOrder.size(); i++)
+		{
+			Pass const& currentPass = this->passes[this->passOrder[i]];
+
+			for (int j = 0; j < (int)(currentPass.reads.size() + currentPass.writes.size()); j++)
+			{
+				RenderGraphResource resource = j < (int)currentPass.reads.size() ? currentPass.reads[j] : currentPass.writes[j - currentPass.reads.size()];
+				VirtualTexture& texture = this->textures[this->resources[resource].textureIndex];
+
+				if (texture.firstPass < 0)
+				{
+					texture.firstPass = i;
+				}
+				texture.lastPass = i;
+			}
+		}
+
+		// Release pooled textures that haven't been used recently:
+		for (int i = (int)this->physicalTextures.size() - 1; i >= 0; i--)
+		{
+			if (this->physicalTextures[i].framesUnused > RENDER_GRAPH_MAX_UNUSED_FRAMES)
+			{
+				this->physicalTextures[i].texture->Destroy();
+				delete this->physicalTextures[i].texture;
+				this->physicalTextures.erase(this->physicalTextures.begin() + i);
+			}
+			else
+			{
+				this->physicalTextures[i].lastPass = -1;
+			}
+		}
+
+		// Assign transients to physical textures in order of their first use. A physical texture can be reused once the
+		// lifetime of its current occupant has ended:
+		vector<int> transients;
+		for (int i = 0; i < (int)this->textures.size(); i++)
+		{
+			if (!this->textures[i].isImported && this->textures[i].firstPass >= 0)
+			{
+				transients.emplace_back(i);
+			}
+		}
+		std::stable_sort(transients.begin(), transients.end(), [&](int lhs, int rhs)
+		{
+			return this->textures[lhs].firstPass < this->textures[rhs].firstPass;
+		});
+
+		for (unsigned int i = 0; i < (unsigned int)transients.size(); i++)
+		{
+			VirtualTexture& currentTexture = this->textures[transients[i]];
+
+			for (int j = 0; j < (int)this->physicalTextures.size(); j++)
+			{
+				if (this->physicalTextures[j].desc == currentTexture.desc && this->physicalTextures[j].lastPass < currentTexture.firstPass)
+				{
+					currentTexture.physicalIndex = j;
+					break;
+				}
+			}
+
+			if (currentTexture.physicalIndex < 0)
+			{
+				RenderTexture* newTexture = new RenderTexture
+				(
+					currentTexture.desc.width,
+					currentTexture.desc.height,
+					"RenderGraph_Transient_" + to_string(this->physicalTextures.size())
+				);
+
+				newTexture->InternalFormat()	= currentTexture.desc.internalFormat;
+				newTexture->Format()			= currentTexture.desc.format;
+				newTexture->Type()				= currentTexture.desc.type;
+
+				newTexture->TextureMinFilter()	= currentTexture.desc.filter;
+				newTexture->TextureMaxFilter()	= currentTexture.desc.filter;
+
+				newTexture->AttachmentPoint()	= GL_COLOR_ATTACHMENT0 + 0;
+				newTexture->ReadBuffer()		= GL_COLOR_ATTACHMENT0 + 0;
+				newTexture->DrawBuffer()		= GL_COLOR_ATTACHMENT0 + 0;
+
+				newTexture->Buffer(RENDER_TEXTURE_0 + RENDER_TEXTURE_ALBEDO);
+
+				PhysicalTexture newPhysicalTexture;
+				newPhysicalTexture.desc		= currentTexture.desc;
+				newPhysicalTexture.texture	= newTexture;
+
+				currentTexture.physicalIndex = (int)this->physicalTextures.size();
+				this->physicalTextures.emplace_back(newPhysicalTexture);
+			}
+
+			this->physicalTextures[currentTexture.physicalIndex].lastPass = currentTexture.lastPass;
+		}
+
+		for (unsigned int i = 0; i < (unsigned int)this->physicalTextures.size(); i++)
+		{
+			this->physicalTextures[i].framesUnused = this->physicalTextures[i].lastPass >= 0 ? 0 : this->physicalTextures[i].framesUnused + 1;
+		}
+	}
+
+
+	size_t RenderGraph::TextureSize(RenderGraphTextureDesc const& desc)
+	{
+		size_t bytesPerPixel = 4;
+		switch (desc.internalFormat)
+		{
+		case GL_R8:
+			bytesPerPixel = 1;
+			break;
+		case GL_RG8:
+		case GL_R16F:
+			bytesPerPixel = 2;
+			break;
+		case GL_RGB16F:
+			bytesPerPixel = 6;
+			break;
+		case GL_RGBA16F:
+		case GL_RG32F:
+			bytesPerPixel = 8;
+			break;
+		case GL_RGB32F:
+			bytesPerPixel = 12;
+			break;
+		case GL_RGBA32F:
+			bytesPerPixel = 16;
+			break;
+		default:
+			bytesPerPixel = 4;	// RGBA8, RG16, R11F_G11F_B10F, R32F, R32UI, etc
+		}
+
+		return (size_t)desc.width * (size_t)desc.height * bytesPerPixel;
+	}
+}
+
+
@@ -0,0 +1,163 @@
+// Render graph
+// Passes declare the virtual resources they read and write, and are executed by the graph rather than being hand-sequenced.
+// Each frame, the graph is rebuilt then compiled:
+//	1) Passes that don't contribute to a pass with side effects (eg. presenting to the screen) are culled
+//	2) The remaining passes are topologically sorted, respecting read-after-write and write-after-read hazards
+//	3) Transient textures are assigned to pooled physical render textures. Transients with matching descriptions and
+//	   non-overlapping lifetimes alias the same physical texture. The pool persists across frames
+// Writing a resource creates a new version of it, so passes that modify a texture in place (eg. additive blending) stay ordered.
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include <string>
+#include <vector>
+#include <functional>
+
+using std::string;
+using std::vector;
+
+
+namespace BlazeEngine
+{
+	// Pre-declarations:
+	class RenderTexture;
+	class RenderGraph;
+	class GPUTimer;
+
+
+	// Handle to a version of a virtual resource
+	typedef int RenderGraphResource;
+	#define RENDER_GRAPH_INVALID_RESOURCE	-1
+
+	// Pooled physical textures that aren't used for this many frames are deallocated (eg. after a resolution change)
+	#define RENDER_GRAPH_MAX_UNUSED_FRAMES	8
+
+
+	// Description of a transient (color) texture. Transients alias only if their descriptions are identical. Note: An aliased
+	// texture contains the previous occupant's data, so the first pass to write a transient must overwrite all of it
+	struct RenderGraphTextureDesc
+	{
+		int		width			= 0;
+		int		height			= 0;
+
+		GLenum	internalFormat	= GL_RGBA16F;
+		GLenum	format			= GL_RGBA;
+		GLenum	type			= GL_FLOAT;
+		GLenum	filter			= GL_LINEAR;
+
+		bool operator==(RenderGraphTextureDesc const& rhs) const;
+	};
+
+
+	// Pass execution callback. Textures are accessed via RenderGraph::GetTexture()
+	typedef std::function<void(RenderGraph&)> RenderGraphExecuteFunction;
+
+
+	class RenderGraph
+	{
+	public:
+		RenderGraph() {}
+
+		~RenderGraph();
+
+		// Clear the passes and resources of the previous frame. The physical texture pool is kept
+		void Reset();
+
+		// Declare resources. Imported textures are owned externally, and are never aliased. texture may be null for external
+		// resources that only order passes (eg. the set of shadow maps, or the default framebuffer)
+		RenderGraphResource ImportTexture(string const& name, RenderTexture* texture);
+		RenderGraphResource CreateTexture(string const& name, RenderGraphTextureDesc const& desc);
+
+		// Declare a pass. Passes with side effects (eg. writing to the default framebuffer) are never culled. Returns the pass index
+		int AddPass(string const& name, RenderGraphExecuteFunction execute, bool hasSideEffects = false);
+
+		// Declare pass dependencies. Write() returns the new version of the resource, which subsequent readers must use
+		void Read(int pass, RenderGraphResource resource);
+		RenderGraphResource Write(int pass, RenderGraphResource resource);
+
+		// Cull, order, and allocate. Returns false (and logs an error) if the graph contains a cycle
+		bool Compile();
+
+		// Execute the compiled passes, in order. If timer is not null, each pass is timed under its name
+		void Execute(GPUTimer* timer = nullptr);
+
+		// Get the physical texture backing a resource. Only valid during Execute(), for resources the current pass declared
+		RenderTexture* GetTexture(RenderGraphResource resource) const;
+
+		// Log the compiled pass order, culled passes, transient lifetimes and aliasing, and the memory saved by aliasing
+		void LogCompiledGraph() const;
+
+		// Returns true if the compiled passes or aliasing differ from the previous compilation
+		inline bool HasChanged() const	{ return hasChanged; }
+
+
+	private:
+		struct Pass
+		{
+			string						name;
+			RenderGraphExecuteFunction	execute;
+			bool						hasSideEffects	= false;
+
+			vector<RenderGraphResource>	reads;
+			vector<RenderGraphResource>	writes;
+
+			int							refCount		= 0;		// Number of written versions that are still used
+			bool						isCulled		= false;
+		};
+
+		// A virtual texture. Each version of it is a separate resource node
+		struct VirtualTexture
+		{
+			string					name;
+			RenderGraphTextureDesc	desc;
+			bool					isImported		= false;
+			RenderTexture*			importedTexture	= nullptr;
+
+			int						firstPass		= -1;		// Lifetime, as indices into passOrder
+			int						lastPass		= -1;
+			int						physicalIndex	= -1;		// Index into physicalTextures, for transients
+		};
+
+		struct ResourceNode
+		{
+			int			textureIndex	= -1;
+			int			version			= 0;
+			int			producer		= -1;	// Index of the pass that wrote this version, or -1
+			int			previous		= RENDER_GRAPH_INVALID_RESOURCE;	// The version this one overwrites
+			vector<int>	readers;
+			int			refCount		= 0;	// Number of non-culled readers
+		};
+
+		struct PhysicalTexture
+		{
+			RenderGraphTextureDesc	desc;
+			RenderTexture*			texture			= nullptr;	// Deallocated in ~RenderGraph(), or once unused for RENDER_GRAPH_MAX_UNUSED_FRAMES
+			int						lastPass		= -1;		// Last pass (this frame) to use the current occupant
+			int						framesUnused	= 0;
+		};
+
+		vector<Pass>			passes;
+		vector<VirtualTexture>	textures;
+		vector<ResourceNode>	resources;
+		vector<int>				passOrder;			// Non-culled pass indices, in execution order
+		int						currentPass		= -1;	// Index into passOrder, during Execute()
+
+		vector<PhysicalTexture>	physicalTextures;	// Pool of transient render textures, persistent across frames
+
+		string					compiledSignature;	// Pass order and aliasing of the last compilation
+		bool					hasChanged		= true;
+
+		RenderGraphResource AddResourceNode(int textureIndex, int version);
+
+		void CullPasses();
+		bool SortPasses();
+		void AllocateTransients();
+
+		// Estimated GPU memory of a texture, in bytes
+		static size_t TextureSize(RenderGraphTextureDesc const& desc);
+	};
+}
+
+
@@ -15,8 +15,23 @@
 #include "ShadowMap.h"
 #include "Scene.h"
 #include "EventManager.h"
+#include "GLState.h"
+#include "RenderQueue.h"
+#include "WorkerPool.h"
+#include "WorldBounds.h"
+#include "BVH.h"
+#include "OcclusionCuller.h"
+#include "ShadowAtlas.h"
+#include "ClusteredLighting.h"
+#include "VisibilityBuffer.h"
+#include "GPUTimer.h"
+#include "RenderGraph.h"
+#include "DynamicResolution.h"
+#include "TextureStreamer.h"
+#include "MaterialTextureArrays.h"
 
 #include <string>
+#include <algorithm>
 
 #include "SDL.h"
 #include "GL/glew.h"
@@ -27,6 +42,7 @@
 
 #undef main // Required to prevent SDL from redefining main...
 
+using glm::vec2;
 using glm::vec3;
 using glm::vec4;
 using glm::mat3;
@@ -158,6 +174,16 @@ namespace BlazeEngine
 		this->xRes					= CoreEngine::GetCoreEngine()->GetConfig()->GetValue<int>("windowXRes");
 		this->yRes					= CoreEngine::GetCoreEngine()->GetConfig()->GetValue<int>("windowYRes");
 		this->useForwardRendering	= CoreEngine::GetCoreEngine()->GetConfig()->GetValue<bool>("useForwardRendering");
+		this->useClusteredLighting	= CoreEngine::GetCoreEngine()->GetConfig()->GetValue<bool>("useClusteredLighting");
+		this->useVisibilityBuffer	= CoreEngine::GetCoreEngine()->GetConfig()->GetValue<bool>("useVisibilityBuffer");
+		this->useDepthPrepass		= CoreEngine::GetCoreEngine()->GetConfig()->GetValue<bool>("useDepthPrepass");
+
+		this->depthPrepassOverdrawThreshold		= CoreEngine::GetCoreEngine()->GetConfig()->GetValue<float>("depthPrepassOverdrawThreshold");
+
+		this->shadowUpdateScreenSizeThreshold	= CoreEngine::GetCoreEngine()->GetConfig()->GetValue<float>("shadowUpdateScreenSizeThreshold");
+		this->maxShadowUpdateInterval			= CoreEngine::GetCoreEngine()->GetConfig()->GetValue<int>("maxShadowUpdateInterval");
+		this->shadowAtlasSize					= CoreEngine::GetCoreEngine()->GetConfig()->GetValue<int>("shadowAtlasSize");
+		this->minShadowAtlasTileResolution		= CoreEngine::GetCoreEngine()->GetConfig()->GetValue<int>("minShadowAtlasTileResolution");
 
 		// Configure SDL before creating a window:
 		SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 4);
@@ -221,6 +247,10 @@ namespace BlazeEngine
 			return;
 		}
 
+		// The context is new: Ensure our state cache doesn't make any assumptions about it
+		GLState& glState = GLState::Instance();
+		glState.Invalidate();
+
 		// Configure OpenGL logging:
 		#if defined(DEBUG_LOG_OPENGL)		// Defined in BuildConfiguration.h
 			glEnable(GL_DEBUG_OUTPUT);
@@ -229,12 +259,14 @@ namespace BlazeEngine
 
 		// Configure other OpenGL settings:
 		glFrontFace(GL_CCW);				// Counter-clockwise vertex winding (OpenGL default)
-		glEnable(GL_DEPTH_TEST);			// Enable Z depth testing
-		glDepthFunc(GL_LESS);				// How to sort Z
-		glEnable(GL_CULL_FACE);				// Enable face culling
-		glCullFace(GL_BACK);				// Cull back faces
+		glState.SetCapability(GL_DEPTH_TEST, true);	// Enable Z depth testing
+		glState.DepthFunc(GL_LESS);					// How to sort Z
+		glState.SetCapability(GL_CULL_FACE, true);	// Enable face culling
+		glState.CullFace(GL_BACK);					// Cull back faces
 
 		glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
+
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);	// Texture rows are tightly packed in their native channel count (eg. 3 byte RGB texels)
 		
 		// Set the default buffer clear values:
 		glClearColor(GLclampf(windowClearColor.r), GLclampf(windowClearColor.g), GLclampf(windowClearColor.b), GLclampf(windowClearColor.a));
@@ -252,7 +284,7 @@ namespace BlazeEngine
 		);
 		
 		outputTexture->Format()				= GL_RGBA;		// Note: Using 4 channels for future flexibility
-		outputTexture->InternalFormat()		= GL_RGBA32F;		
+		outputTexture->InternalFormat()		= GL_RGBA16F;	// Half precision is plenty for accumulating HDR lighting
 
 		outputTexture->TextureMinFilter()	= GL_LINEAR;	// Note: Output is black if this is GL_NEAREST_MIPMAP_LINEAR
 		outputTexture->TextureMaxFilter()	= GL_LINEAR;
@@ -269,6 +301,73 @@ namespace BlazeEngine
 		// PostFX Manager:
 		postFXManager = new PostFXManager(); // Initialized when RenderManager.Initialize() is called
 
+		// Render queue:
+		workerPool	= new WorkerPool();
+		renderQueue	= new RenderQueue(workerPool); // Initialized when RenderManager.Initialize() is called
+
+		// Frame passes and transient targets:
+		renderGraph = new RenderGraph();
+
+		// Visibility:
+		worldBounds		= new WorldBounds();
+		sceneBVH		= new BVH();	// Built when RenderManager.Initialize() is called
+		occlusionCuller	= new OcclusionCuller(workerPool);
+
+		// Texture streaming:
+		if (CoreEngine::GetCoreEngine()->GetConfig()->GetValue<bool>("useTextureStreaming"))
+		{
+			size_t budgetBytes	= (size_t)glm::max(CoreEngine::GetCoreEngine()->GetConfig()->GetValue<int>("textureStreamingBudgetMB"), 0) * 1024 * 1024;
+			textureStreamer		= new TextureStreamer(budgetBytes); // Initialized when RenderManager.Initialize() is called
+		}
+
+		// Point lights:
+		shadowAtlas		= new ShadowAtlas(this->shadowAtlasSize, this->minShadowAtlasTileResolution);
+
+		if (this->useClusteredLighting && !this->useForwardRendering)
+		{
+			clusteredLighting = new ClusteredLighting
+			(
+				CoreEngine::GetCoreEngine()->GetConfig()->GetValue<int>("clusterGridX"),
+				CoreEngine::GetCoreEngine()->GetConfig()->GetValue<int>("clusterGridY"),
+				CoreEngine::GetCoreEngine()->GetConfig()->GetValue<int>("clusterGridZ"),
+				CoreEngine::GetCoreEngine()->GetConfig()->GetValue<int>("maxLightsPerCluster")
+			);
+
+			// Fall back to rendering point lights individually if the clustered shaders failed to load:
+			if (!clusteredLighting->IsValid())
+			{
+				LOG_ERROR("Clustered lighting shaders failed to load. Point lights will be rendered individually");
+				delete clusteredLighting;
+				clusteredLighting = nullptr;
+			}
+		}
+
+		// Depth pre-pass: Position-only, so the trivial depth shader is sufficient
+		if (this->useDepthPrepass && !this->useForwardRendering)
+		{
+			depthPrepassShader = Shader::CreateShader(CoreEngine::GetCoreEngine()->GetConfig()->GetValue<string>("depthShaderName"));
+		}
+
+		// Profiling:
+		gpuTimer = new GPUTimer();
+
+		// Dynamic resolution: The GBuffer and frame targets keep their full size, and only the viewport is scaled
+		this->viewportXRes = this->xRes;
+		this->viewportYRes = this->yRes;
+		if (CoreEngine::GetCoreEngine()->GetConfig()->GetValue<bool>("useDynamicResolution") && !this->useForwardRendering)
+		{
+			dynamicResolution = new DynamicResolution
+			(
+				this->xRes,
+				this->yRes,
+				CoreEngine::GetCoreEngine()->GetConfig()->GetValue<float>("dynamicResolutionMinScale"),
+				CoreEngine::GetCoreEngine()->GetConfig()->GetValue<float>("dynamicResolutionMaxScale"),
+				CoreEngine::GetCoreEngine()->GetConfig()->GetValue<float>("dynamicResolutionTargetMs")
+			);
+			this->viewportXRes = dynamicResolution->ViewportXRes();
+			this->viewportYRes = dynamicResolution->ViewportYRes();
+		}
+
 		screenAlignedQuad = new Mesh
 		(
 			Mesh::CreateQuad
@@ -305,6 +404,92 @@ namespace BlazeEngine
 			delete postFXManager;
 			postFXManager = nullptr;
 		}
+
+		if (renderQueue != nullptr)
+		{
+			delete renderQueue;
+			renderQueue = nullptr;
+		}
+
+		if (renderGraph != nullptr)
+		{
+			delete renderGraph;
+			renderGraph = nullptr;
+		}
+
+		if (worldBounds != nullptr)
+		{
+			delete worldBounds;
+			worldBounds = nullptr;
+		}
+
+		if (sceneBVH != nullptr)
+		{
+			delete sceneBVH;
+			sceneBVH = nullptr;
+		}
+
+		if (occlusionCuller != nullptr)
+		{
+			delete occlusionCuller;
+			occlusionCuller = nullptr;
+		}
+
+		// Deleted after the members that use it:
+		if (workerPool != nullptr)
+		{
+			delete workerPool;
+			workerPool = nullptr;
+		}
+
+		if (shadowAtlas != nullptr)
+		{
+			delete shadowAtlas;
+			shadowAtlas = nullptr;
+		}
+
+		if (clusteredLighting != nullptr)
+		{
+			delete clusteredLighting;
+			clusteredLighting = nullptr;
+		}
+
+		if (visibilityBuffer != nullptr)
+		{
+			delete visibilityBuffer;
+			visibilityBuffer = nullptr;
+		}
+
+		if (depthPrepassShader != nullptr)
+		{
+			depthPrepassShader->Destroy();
+			delete depthPrepassShader;
+			depthPrepassShader = nullptr;
+		}
+
+		if (gpuTimer != nullptr)
+		{
+			delete gpuTimer;
+			gpuTimer = nullptr;
+		}
+
+		if (dynamicResolution != nullptr)
+		{
+			delete dynamicResolution;
+			dynamicResolution = nullptr;
+		}
+
+		if (textureStreamer != nullptr)
+		{
+			delete textureStreamer;
+			textureStreamer = nullptr;
+		}
+
+		if (materialTextureArrays != nullptr)
+		{
+			delete materialTextureArrays;
+			materialTextureArrays = nullptr;
+		}
 	}
 
 
@@ -314,20 +499,85 @@ namespace BlazeEngine
 
 		Camera* mainCam = CoreEngine::GetSceneManager()->GetCameras(CAMERA_TYPE_MAIN).at(0);
 
+		GLState& glState = GLState::Instance();
+
+		// Update world-space mesh bounds, and refit the BVH to match. Shadow caster culling and main camera culling both query it:
+		worldBounds->Update(*CoreEngine::GetSceneManager()->GetRenderMeshes(nullptr));
+		sceneBVH->Refit(*worldBounds);
+
+		// Fit the key light's shadow cascades to the main camera:
+		Light* keyLight = CoreEngine::GetSceneManager()->GetKeyLight();
+		if (keyLight != nullptr && keyLight->ActiveShadowMap() != nullptr)
+		{
+			keyLight->ActiveShadowMap()->UpdateCascades(mainCam, sceneBVH->RootBounds());
+		}
+
+		// Assign the point light shadow atlas tiles for this frame:
+		UpdateShadowAtlas(mainCam);
+
+		// Scale the viewport to fit the frame time budget. Shadows and tone mapping don't depend on the viewport size:
+		if (dynamicResolution != nullptr)
+		{
+			float fixedTimeMs = gpuTimer->PassTime("Shadows") + gpuTimer->PassTime("Tone map");
+			if (dynamicResolution->Update(gpuTimer->TotalTime(), fixedTimeMs))
+			{
+				this->viewportXRes = dynamicResolution->ViewportXRes();
+				this->viewportYRes = dynamicResolution->ViewportYRes();
+				UploadViewportParams();
+			}
+		}
+
+		// Cull against the main camera frustum:
+		sceneBVH->QueryFrustum(mainCam->FrustumPlanes(), this->visibleMeshes);
+
+		// Rasterize the largest visible meshes on the CPU, and skip any meshes hidden behind them:
+		occlusionCuller->RenderOccluders(mainCam, this->visibleMeshes, *worldBounds);
+		occlusionCuller->CullOccluded(this->visibleMeshes, *worldBounds);
+
+		// Stream the texture mip levels the visible meshes need:
+		if (textureStreamer != nullptr)
+		{
+			float projectionScale = mainCam->Projection()[1][1] * 0.5f * (float)this->viewportYRes; // cot(fovY / 2) * (viewportYRes / 2)
+			textureStreamer->Update(this->visibleMeshes, *worldBounds, mainCam->GetTransform()->WorldPosition(), projectionScale, (float)glm::max(this->viewportXRes, this->viewportYRes));
+		}
+
+
+		// Declare the frame's passes. The render graph culls, orders, and allocates transient targets for them:
+		renderGraph->Reset();
+
+		RenderGraphResource shadowMaps	= renderGraph->ImportTexture("Shadow maps", nullptr);
+		RenderGraphResource backbuffer	= renderGraph->ImportTexture("Backbuffer", nullptr);
+
 		// Fill shadow maps:
-		glDisable(GL_CULL_FACE);
-		vector<Light*>const* deferredLights = &CoreEngine::GetSceneManager()->GetDeferredLights();
-		if (deferredLights)
+		int shadowPass = renderGraph->AddPass("Shadows", [this, mainCam](RenderGraph&)
 		{
-			for (int i = 0; i < (int)deferredLights->size(); i++)
+			GLState& glState = GLState::Instance();
+
+			glState.SetCapability(GL_CULL_FACE, false);
+			vector<Light*>const* deferredLights = &CoreEngine::GetSceneManager()->GetDeferredLights();
+			if (deferredLights)
 			{
-				if (deferredLights->at(i)->ActiveShadowMap() != nullptr)
+				for (int i = 0; i < (int)deferredLights->size(); i++)
 				{
-					RenderLightShadowMap(deferredLights->at(i));
+					ShadowMap* shadowMap = deferredLights->at(i)->ActiveShadowMap();
+					if (shadowMap != nullptr)
+					{
+						// Distant or small point lights are updated less frequently:
+						if (deferredLights->at(i)->Type() == LIGHT_POINT)
+						{
+							shadowMap->UpdateInterval() = ComputeShadowUpdateInterval(deferredLights->at(i), mainCam);
+						}
+
+						if (shadowMap->ShouldUpdate())
+						{
+							RenderLightShadowMap(deferredLights->at(i));
+						}
+					}
 				}
 			}
-		}
-		glEnable(GL_CULL_FACE);
+			glState.SetCapability(GL_CULL_FACE, true);
+		});
+		shadowMaps = renderGraph->Write(shadowPass, shadowMaps);
 
 
 		// TODO: Render reflection probes
@@ -336,103 +586,229 @@ namespace BlazeEngine
 		// Forward rendering:
 		if (this->useForwardRendering) // TODO: Split forward rendering into another function, and access via a function pointer
 		{
-			RenderForward(mainCam);
+			int forwardPass = renderGraph->AddPass("Forward", [this, mainCam](RenderGraph&)
+			{
+				RenderForward(mainCam, this->visibleMeshes);
+			}, true);
+			renderGraph->Read(forwardPass, shadowMaps);
+			renderGraph->Write(forwardPass, backbuffer);
 		}
 		// Deferred rendering:
 		else 
 		{
-			// Fill GBuffer:
-			RenderToGBuffer(mainCam);
+			RenderGraphResource gBuffer		= renderGraph->ImportTexture("GBuffer", (RenderTexture*)mainCam->RenderMaterial()->AccessTexture(RENDER_TEXTURE_ALBEDO));
+			RenderGraphResource sceneColor	= renderGraph->ImportTexture("Scene color", (RenderTexture*)this->outputMaterial->AccessTexture(TEXTURE_ALBEDO));
+
+			// Fill GBuffer: Resolved from the visibility buffer if it's enabled and can encode the visible meshes, or directly otherwise
+			if (visibilityBuffer != nullptr && visibilityBuffer->CanRender(this->visibleMeshes))
+			{
+				RenderGraphResource visibilityIDs = renderGraph->ImportTexture("Visibility IDs", nullptr);
+
+				int visibilityPass = renderGraph->AddPass("Visibility buffer", [this, mainCam](RenderGraph&)
+				{
+					visibilityBuffer->Render(mainCam, this->visibleMeshes, this->viewportXRes, this->viewportYRes);
+				});
+				visibilityIDs	= renderGraph->Write(visibilityPass, visibilityIDs);
+				gBuffer			= renderGraph->Write(visibilityPass, gBuffer);	// Depth
+
+				int resolvePass = renderGraph->AddPass("GBuffer", [this, mainCam](RenderGraph&)
+				{
+					visibilityBuffer->Resolve(mainCam, this->visibleMeshes, this->screenAlignedQuad, this->viewportXRes, this->viewportYRes, materialTextureArrays);
+				});
+				renderGraph->Read(resolvePass, visibilityIDs);
+				renderGraph->Read(resolvePass, gBuffer);
+				gBuffer = renderGraph->Write(resolvePass, gBuffer);
+			}
+			else
+			{
+				// Lay down depth first if the visible meshes are likely to overdraw enough to pay for the extra geometry pass:
+				bool hasDepthPrepass = depthPrepassShader != nullptr && EstimateOverdraw(mainCam, this->visibleMeshes) >= this->depthPrepassOverdrawThreshold;
+				if (hasDepthPrepass)
+				{
+					int depthPrepass = renderGraph->AddPass("Depth pre-pass", [this, mainCam](RenderGraph&)
+					{
+						RenderDepthPrepass(mainCam, this->visibleMeshes);
+					});
+					gBuffer = renderGraph->Write(depthPrepass, gBuffer);
+				}
+
+				int gBufferPass = renderGraph->AddPass("GBuffer", [this, mainCam, hasDepthPrepass](RenderGraph&)
+				{
+					RenderToGBuffer(mainCam, this->visibleMeshes, hasDepthPrepass);
+				});
+				if (hasDepthPrepass)
+				{
+					renderGraph->Read(gBufferPass, gBuffer);
+				}
+				gBuffer = renderGraph->Write(gBufferPass, gBuffer);
+			}
 
 			// Render deferred lights:
-			((RenderTexture*)this->outputMaterial->AccessTexture((TEXTURE_TYPE)0))->BindFramebuffer(true);
+			int lightingPass = renderGraph->AddPass("Deferred lighting", [this, mainCam, sceneColor](RenderGraph& graph)
+			{
+				GLState& glState = GLState::Instance();
+
+				graph.GetTexture(sceneColor)->BindFramebuffer(true);
 			
-			glViewport(0, 0, this->xRes, this->yRes);
-			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT); // Clear the currently bound FBO
+				glState.Viewport(0, 0, this->viewportXRes, this->viewportYRes);
+				glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT); // Clear the currently bound FBO
 
-			vector<Light*>const* deferredLights = &CoreEngine::GetSceneManager()->GetDeferredLights();
+				vector<Light*>const* deferredLights = &CoreEngine::GetSceneManager()->GetDeferredLights();
 
-			// Render additive contributions:
-			glEnable(GL_BLEND);
+				// Bind the GBuffer textures once, for all deferred lights:
+				mainCam->RenderMaterial()->BindAllTextures(RENDER_TEXTURE_0, true);
 
-			if (deferredLights->size() > 0)
-			{
-				// Render the first light
-				RenderDeferredLight(deferredLights->at(0));
-				
-				glBlendFunc(GL_ONE, GL_ONE); // TODO: Can we just set this once somewhere, instead of calling each frame?
-				glDepthFunc(GL_GEQUAL);
+				// Render additive contributions:
+				glState.SetCapability(GL_BLEND, true);
 
-				for (int i = 1; i < deferredLights->size(); i++)
+				if (deferredLights->size() > 0)
 				{
-					// Select face culling:
-					if (deferredLights->at(i)->Type() == LIGHT_AMBIENT_COLOR || deferredLights->at(i)->Type() == LIGHT_AMBIENT_IBL || deferredLights->at(i)->Type() == LIGHT_DIRECTIONAL)
+					// Render the first light
+					if (clusteredLighting == nullptr || deferredLights->at(0)->Type() != LIGHT_POINT)
 					{
-						glCullFace(GL_BACK);
+						RenderDeferredLight(deferredLights->at(0));
 					}
-					else
+				
+					glState.BlendFunc(GL_ONE, GL_ONE);
+					glState.DepthFunc(GL_GEQUAL);
+
+					for (int i = 1; i < deferredLights->size(); i++)
 					{
-						glCullFace(GL_FRONT);	// For 3D deferred light meshes, we render back faces so something is visible even while we're inside the mesh		
+						// Point lights are shaded together by the clustered lighting pass:
+						if (clusteredLighting != nullptr && deferredLights->at(i)->Type() == LIGHT_POINT)
+						{
+							continue;
+						}
+
+						// Select face culling:
+						if (deferredLights->at(i)->Type() == LIGHT_AMBIENT_COLOR || deferredLights->at(i)->Type() == LIGHT_AMBIENT_IBL || deferredLights->at(i)->Type() == LIGHT_DIRECTIONAL)
+						{
+							glState.CullFace(GL_BACK);
+						}
+						else
+						{
+							glState.CullFace(GL_FRONT);	// For 3D deferred light meshes, we render back faces so something is visible even while we're inside the mesh		
+						}
+
+						RenderDeferredLight(deferredLights->at(i));
 					}
+				}
+				glState.CullFace(GL_BACK);
 
-					RenderDeferredLight(deferredLights->at(i));
+				// Clustered point lights: Assign the lights to clusters, and shade them all in a single fullscreen pass
+				if (clusteredLighting != nullptr)
+				{
+					clusteredLighting->Update(mainCam, *deferredLights);
+
+					glState.BlendFunc(GL_ONE, GL_ONE);
+					glState.SetCapability(GL_DEPTH_TEST, false);
+
+					clusteredLighting->Render(mainCam, this->screenAlignedQuad, shadowAtlas->DepthTexture());
+
+					glState.SetCapability(GL_DEPTH_TEST, true);
 				}
-			}
-			glCullFace(GL_BACK);
+			});
+			renderGraph->Read(lightingPass, gBuffer);
+			renderGraph->Read(lightingPass, shadowMaps);
+			sceneColor = renderGraph->Write(lightingPass, sceneColor);
 
 			// Render the skybox on top of the frame:
-			glDisable(GL_BLEND);
-			RenderSkybox(CoreEngine::GetSceneManager()->GetSkybox());
+			int skyboxPass = renderGraph->AddPass("Skybox", [this, sceneColor](RenderGraph& graph)
+			{
+				graph.GetTexture(sceneColor)->BindFramebuffer(true);
 
-			// Unbind the output framebuffer
-			((RenderTexture*)this->outputMaterial->AccessTexture((TEXTURE_TYPE)0))->BindFramebuffer(false);
+				GLState::Instance().SetCapability(GL_BLEND, false);
+				RenderSkybox(CoreEngine::GetSceneManager()->GetSkybox());
+			});
+			renderGraph->Read(skyboxPass, gBuffer);
+			renderGraph->Read(skyboxPass, sceneColor);
+			sceneColor = renderGraph->Write(skyboxPass, sceneColor);
 
 			// Additively blit the emissive GBuffer texture to screen:
-			glEnable(GL_BLEND);
-			Blit(mainCam->RenderMaterial(), TEXTURE_EMISSIVE, this->outputMaterial, TEXTURE_ALBEDO);
-			glDisable(GL_BLEND);			
+			int emissivePass = renderGraph->AddPass("Emissive", [this, mainCam](RenderGraph&)
+			{
+				GLState::Instance().SetCapability(GL_BLEND, true);
+				Blit(mainCam->RenderMaterial(), TEXTURE_EMISSIVE, this->outputMaterial, TEXTURE_ALBEDO);
+				GLState::Instance().SetCapability(GL_BLEND, false);
+			});
+			renderGraph->Read(emissivePass, gBuffer);
+			renderGraph->Read(emissivePass, sceneColor);
+			sceneColor = renderGraph->Write(emissivePass, sceneColor);
 
 			// Post process finished frame:
-			Material* finalFrameMaterial	= nullptr;	// References updated in ApplyPostFX...
-			Shader* finalFrameShader		= nullptr;
-			postFXManager->ApplyPostFX(finalFrameMaterial, finalFrameShader);
-
-			// Cleanup:
-			glEnable(GL_DEPTH_TEST);
-			glDepthFunc(GL_LESS);
-			glCullFace(GL_BACK);
+			Shader* finalFrameShader = nullptr;	// Reference updated in AddPostFXPasses...
+			sceneColor = postFXManager->AddPostFXPasses(renderGraph, sceneColor, finalFrameShader);
 
 			// Blit results to screen (Using the final post processing shader pass supplied by the PostProcessingManager):
-			BlitToScreen(finalFrameMaterial, finalFrameShader);
+			int presentPass = renderGraph->AddPass("Tone map", [this, finalFrameShader](RenderGraph&)
+			{
+				// Cleanup:
+				GLState& glState = GLState::Instance();
+				glState.SetCapability(GL_DEPTH_TEST, true);
+				glState.DepthFunc(GL_LESS);
+				glState.CullFace(GL_BACK);
+
+				BlitToScreen(this->outputMaterial, finalFrameShader);
+			}, true);
+			renderGraph->Read(presentPass, sceneColor);
+			renderGraph->Write(presentPass, backbuffer);
+		}
+
+		if (renderGraph->Compile())
+		{
+			#if defined(DEBUG_RENDERMANAGER_RENDER_GRAPH_LOGGING)
+				if (renderGraph->HasChanged())
+				{
+					renderGraph->LogCompiledGraph();
+				}
+			#endif
+
+			renderGraph->Execute(gpuTimer);
 		}
 		
 		// Display the final frame:
 		SDL_GL_SwapWindow(glWindow);
+
+		glState.EndFrame();
+
+		gpuTimer->EndFrame();
+		#if defined(DEBUG_RENDERMANAGER_PASS_TIMING)
+			if (gpuTimer->FrameCount() % 120 == 0)
+			{
+				gpuTimer->LogPassTimes();
+			}
+		#endif
 	}
 
 
 	void RenderManager::RenderLightShadowMap(Light* currentLight)
 	{
-		Camera* shadowCam = currentLight->ActiveShadowMap()->ShadowCamera();
+		ShadowMap* shadowMap	= currentLight->ActiveShadowMap();
+		Camera* shadowCam		= shadowMap->ShadowCamera();
 
 		// Bind:
 		Shader* lightShader = shadowCam->RenderMaterial()->GetShader();
 		lightShader->Bind(true);
 		
 		// Configure the FrameBuffer:
-		RenderTexture* lightDepthTexture = nullptr;
+		RenderTexture* lightDepthTexture = shadowMap->DepthTexture();
 
 		switch (currentLight->Type())
 		{
 		case LIGHT_DIRECTIONAL:
 		{
-			lightDepthTexture = (RenderTexture*)shadowCam->RenderMaterial()->AccessTexture(RENDER_TEXTURE_DEPTH);
+			// Only meshes inside the orthographic shadow volume (or the volume enclosing every cascade) can cast shadows into the map:
+			vec4 const* shadowVolumePlanes = shadowMap->NumCascades() > 0 ? shadowMap->CascadeCasterPlanes() : shadowCam->FrustumPlanes();
+			sceneBVH->QueryFrustum(shadowVolumePlanes, this->shadowCasters);
 		}
 		break;
 
 		case LIGHT_POINT:
 		{
-			lightDepthTexture = (RenderTexture*)shadowCam->RenderMaterial()->AccessTexture(CUBE_MAP_RIGHT);
+			if (shadowMap->NumTiles() == 0)
+			{
+				return; // Not allocated any shadow atlas tiles this frame
+			}
 
 			mat4 shadowCamProjection	= shadowCam->Projection();
 			vec3 lightWorldPos			= currentLight->GetTransform().WorldPosition();
@@ -443,6 +819,9 @@ namespace BlazeEngine
 			lightShader->UploadUniform("lightWorldPos",			&lightWorldPos.x,		UNIFORM_Vec3fv);
 			lightShader->UploadUniform("shadowCam_near",		&shadowCam->Near(),		UNIFORM_Float);
 			lightShader->UploadUniform("shadowCam_far",			&shadowCam->Far(),		UNIFORM_Float);
+
+			// Only meshes within the light's radius (the shadow camera's far plane) can cast shadows into the cube map:
+			sceneBVH->QuerySphere(lightWorldPos, shadowCam->Far(), this->shadowCasters);
 		}
 		break;
 
@@ -452,42 +831,184 @@ namespace BlazeEngine
 		case LIGHT_SPOT:
 		case LIGHT_TUBE:
 		default: // This should never happen...
-			lightShader->Bind(false);
 			return; 
 		}
 
 		if (lightDepthTexture == nullptr)
 		{
-			lightShader->Bind(false);
 			return;
 		}
 
-		glViewport(0, 0, lightDepthTexture->Width(), lightDepthTexture->Height());
+		// Split the casters into static and dynamic meshes:
+		this->staticShadowCasters.clear();
+		this->dynamicShadowCasters.clear();
+		for (unsigned int i = 0; i < (unsigned int)this->shadowCasters.size(); i++)
+		{
+			if (worldBounds->IsDynamic(worldBounds->IndexOf(this->shadowCasters[i])))
+			{
+				this->dynamicShadowCasters.emplace_back(this->shadowCasters[i]);
+			}
+			else
+			{
+				this->staticShadowCasters.emplace_back(this->shadowCasters[i]);
+			}
+		}
+
+		// The static casters only need to be re-rendered if the light has moved, or the set of static meshes has changed:
+		unsigned int lightRevision	= shadowCam->GetTransform()->Revision();
+		unsigned int staticRevision	= worldBounds->StaticRevision();
+		bool isStaticCacheValid		= shadowMap->IsStaticCacheValid(lightRevision, staticRevision);
+
+		// If nothing has changed, and there were no dynamic casters to remove from the previous update, the shadow map is unchanged:
+		if (isStaticCacheValid && this->dynamicShadowCasters.empty() && shadowMap->NumDynamicCasters() == 0)
+		{
+			return;
+		}
+
+		GLState& glState = GLState::Instance();
 		lightDepthTexture->BindFramebuffer(true);
-		glClear(GL_DEPTH_BUFFER_BIT); // Clear the currently bound FBO	
 
-		// Loop through each mesh:			
-		vector<Mesh*> const* meshes = CoreEngine::GetSceneManager()->GetRenderMeshes(nullptr); // Get ALL meshes
-		unsigned int numMeshes	= (unsigned int)meshes->size();
-		for (unsigned int j = 0; j < numMeshes; j++)
+		POINT_SHADOW_MODE pointShadowMode = shadowMap->PointShadowMode();
+		if (currentLight->Type() == LIGHT_POINT && (pointShadowMode == POINT_SHADOW_GEOMETRY_SHADER || pointShadowMode == POINT_SHADOW_INSTANCED))
 		{
-			Mesh* currentMesh = meshes->at(j);
+			// Render each cube face into its atlas tile: The geometry/vertex shader selects the viewport via gl_ViewportIndex
+			for (int tile = 0; tile < shadowMap->NumTiles(); tile++)
+			{
+				ivec4 const& tileViewport = shadowMap->TileViewport(tile);
+				glState.ViewportIndexed(tile, tileViewport.x, tileViewport.y, tileViewport.z, tileViewport.w);
+			}
+		}
+		else if (currentLight->Type() != LIGHT_POINT)
+		{
+			glState.Viewport(0, 0, lightDepthTexture->Width(), lightDepthTexture->Height());
+		}
+		// Else: Multi-pass point lights set the tile viewport per pass
 
-			currentMesh->Bind(true);
+		if (isStaticCacheValid)
+		{
+			shadowMap->RestoreStaticCache();
+		}
+		else
+		{
+			if (currentLight->Type() == LIGHT_POINT)
+			{
+				// Only clear our own tiles: The rest of the atlas belongs to other lights
+				glState.SetCapability(GL_SCISSOR_TEST, true);
+				for (int tile = 0; tile < shadowMap->NumTiles(); tile++)
+				{
+					ivec4 const& tileViewport = shadowMap->TileViewport(tile);
+					glState.Scissor(tileViewport.x, tileViewport.y, tileViewport.z, tileViewport.w);
+					glClear(GL_DEPTH_BUFFER_BIT);
+				}
+				glState.SetCapability(GL_SCISSOR_TEST, false);
+			}
+			else
+			{
+				glClear(GL_DEPTH_BUFFER_BIT); // Clear the currently bound FBO	
+			}
+
+			RenderShadowCasters(currentLight, this->staticShadowCasters);
+
+			shadowMap->StoreStaticCache(lightRevision, staticRevision);
+
+			#if defined(DEBUG_RENDERMANAGER_SHADOW_CACHE_LOGGING)
+				LOG("Rebuilt static shadow cache for light \"" + currentLight->Name() + "\" with " + to_string(this->staticShadowCasters.size()) + " static casters");
+			#endif
+		}
+
+		// Draw the dynamic casters on top of the static casters:
+		RenderShadowCasters(currentLight, this->dynamicShadowCasters);
+
+		shadowMap->NumDynamicCasters() = (unsigned int)this->dynamicShadowCasters.size();
+	}
+
+
+	void RenderManager::RenderShadowCasters(Light* currentLight, vector<Mesh*> const& casters)
+	{
+		ShadowMap* shadowMap	= currentLight->ActiveShadowMap();
+		Camera* shadowCam		= shadowMap->ShadowCamera();
+		Shader* lightShader = shadowCam->RenderMaterial()->GetShader();
+
+		if (currentLight->Type() == LIGHT_POINT && 
+			(shadowMap->PointShadowMode() == POINT_SHADOW_MULTIPASS || shadowMap->PointShadowMode() == POINT_SHADOW_DUAL_PARABOLOID))
+		{
+			RenderPointShadowPasses(currentLight, casters);
+			return;
+		}
+
+		// Point lights: Test each caster against the 6 cube face frusta, so the geometry/vertex shader only emits it to the faces it touches
+		vec4 const* cubeFacePlanes = currentLight->Type() == LIGHT_POINT ? shadowCam->CubeFrustumPlanes() : nullptr;
+
+		// Resolve the per-caster uniforms once, rather than by name for every draw:
+		UniformHandle const mvpHandle			= lightShader->GetUniformHandle("in_mvp",			UNIFORM_Matrix4fv);
+		UniformHandle const modelHandle			= lightShader->GetUniformHandle("in_model",		UNIFORM_Matrix4fv);
+		UniformHandle const cubeFaceMaskHandle	= lightShader->GetUniformHandle("cubeFaceMask",	UNIFORM_Int);
+
+		// Loop through each shadow caster:
+		unsigned int numMeshes	= (unsigned int)casters.size();
+		for (unsigned int j = 0; j < numMeshes; j++)
+		{
+			Mesh* currentMesh = casters[j];
 
 			switch (currentLight->Type())
 			{
 			case LIGHT_DIRECTIONAL:
 			{
+				currentMesh->Bind(true);
+
+				// Cascaded: Draw the caster into the tile of each cascade it touches
+				if (shadowMap->NumCascades() > 0)
+				{
+					unsigned int cascadeMask = worldBounds->FrustaMask(worldBounds->IndexOf(currentMesh), shadowMap->CascadeFrustumPlanes(), shadowMap->NumCascades());
+					for (int cascade = 0; cascade < shadowMap->NumCascades(); cascade++)
+					{
+						if ((cascadeMask & (1u << cascade)) == 0)
+						{
+							continue;
+						}
+
+						ivec4 const& tileViewport = shadowMap->TileViewport(cascade);
+						GLState::Instance().Viewport(tileViewport.x, tileViewport.y, tileViewport.z, tileViewport.w);
+
+						mat4 mvp = shadowMap->CascadeViewProjections()[cascade] * currentMesh->GetTransform().Model();
+						lightShader->UploadUniform(mvpHandle, &mvp[0][0]);
+
+						glDrawElements(GL_TRIANGLES, currentMesh->NumIndices(), GL_UNSIGNED_INT, (void*)(0));
+					}
+					continue;
+				}
+
 				mat4 mvp			= shadowCam->ViewProjection() * currentMesh->GetTransform().Model();
-				lightShader->UploadUniform("in_mvp",	&mvp[0][0],		UNIFORM_Matrix4fv);
+				lightShader->UploadUniform(mvpHandle, &mvp[0][0]);
 			}
 			break;
 
 			case LIGHT_POINT:
 			{
+				int cubeFaceMask = (int)worldBounds->FrustaMask(worldBounds->IndexOf(currentMesh), cubeFacePlanes, 6);
+				if (cubeFaceMask == 0)
+				{
+					continue; // Inside the radius, but outside every face (eg. behind the near planes)
+				}
+
+				currentMesh->Bind(true);
+
 				mat4 model = currentMesh->GetTransform().Model();
-				lightShader->UploadUniform("in_model",	&model[0][0],	UNIFORM_Matrix4fv);
+				lightShader->UploadUniform(modelHandle,			&model[0][0]);
+				lightShader->UploadUniform(cubeFaceMaskHandle,	&cubeFaceMask);
+
+				// Instanced: Draw 1 instance per cube face the caster touches
+				if (shadowMap->PointShadowMode() == POINT_SHADOW_INSTANCED)
+				{
+					int numInstances = 0;
+					for (int face = 0; face < CUBE_MAP_NUM_FACES; face++)
+					{
+						numInstances += (cubeFaceMask >> face) & 1;
+					}
+
+					glDrawElementsInstanced(GL_TRIANGLES, currentMesh->NumIndices(), GL_UNSIGNED_INT, (void*)(0), numInstances);
+					continue;
+				}
 			}
 			break;
 
@@ -503,17 +1024,270 @@ namespace BlazeEngine
 
 			// Draw!
 			glDrawElements(GL_TRIANGLES, currentMesh->NumIndices(), GL_UNSIGNED_INT, (void*)(0)); // (GLenum mode, GLsizei count, GLenum type, const GLvoid* indices);
-						
-			// Cleanup current mesh:
-			currentMesh->Bind(false);
+		}
+	}
+
+
+	void RenderManager::RenderPointShadowPasses(Light* currentLight, vector<Mesh*> const& casters)
+	{
+		ShadowMap* shadowMap	= currentLight->ActiveShadowMap();
+		Camera* shadowCam		= shadowMap->ShadowCamera();
+		Shader* lightShader		= shadowCam->RenderMaterial()->GetShader();
+
+		bool isParaboloid		= shadowMap->PointShadowMode() == POINT_SHADOW_DUAL_PARABOLOID;
+		vec3 lightWorldPos		= currentLight->GetTransform().WorldPosition();
+		mat4 const* cubeMap_vps	= shadowCam->CubeViewProjection();
+
+		// Find the passes (cube faces, or paraboloid hemispheres) each caster touches:
+		this->shadowCasterPassMasks.resize(casters.size());
+		for (unsigned int i = 0; i < (unsigned int)casters.size(); i++)
+		{
+			unsigned int boundsIndex = worldBounds->IndexOf(casters[i]);
+			if (isParaboloid)
+			{
+				Bounds casterBounds = worldBounds->GetBounds(boundsIndex);
+				this->shadowCasterPassMasks[i] = (casterBounds.zMax >= lightWorldPos.z ? 1u : 0u) | (casterBounds.zMin <= lightWorldPos.z ? 2u : 0u);
+			}
+			else
+			{
+				this->shadowCasterPassMasks[i] = worldBounds->FrustaMask(boundsIndex, shadowCam->CubeFrustumPlanes(), CUBE_MAP_NUM_FACES);
+			}
+		}
+
+		UniformHandle const modelHandle	= lightShader->GetUniformHandle("in_model",	UNIFORM_Matrix4fv);
+		UniformHandle const mvpHandle	= lightShader->GetUniformHandle("in_mvp",		UNIFORM_Matrix4fv);
+
+		if (isParaboloid)
+		{
+			glEnable(GL_CLIP_DISTANCE0); // Clips geometry behind the current paraboloid
+		}
+
+		for (int pass = 0; pass < shadowMap->NumTiles(); pass++)
+		{
+			ivec4 const& tileViewport = shadowMap->TileViewport(pass);
+			GLState::Instance().Viewport(tileViewport.x, tileViewport.y, tileViewport.z, tileViewport.w);
+
+			if (isParaboloid)
+			{
+				float paraboloidDirection = pass == 0 ? 1.0f : -1.0f;
+				lightShader->UploadUniform("paraboloidDirection", &paraboloidDirection, UNIFORM_Float);
+			}
+
+			for (unsigned int i = 0; i < (unsigned int)casters.size(); i++)
+			{
+				if ((this->shadowCasterPassMasks[i] & (1u << pass)) == 0)
+				{
+					continue;
+				}
+
+				Mesh* currentMesh = casters[i];
+				currentMesh->Bind(true);
+
+				mat4 model = currentMesh->GetTransform().Model();
+				lightShader->UploadUniform(modelHandle, &model[0][0]);
+				if (!isParaboloid)
+				{
+					mat4 mvp = cubeMap_vps[pass] * model;
+					lightShader->UploadUniform(mvpHandle, &mvp[0][0]);
+				}
+
+				glDrawElements(GL_TRIANGLES, currentMesh->NumIndices(), GL_UNSIGNED_INT, (void*)(0));
+			}
+		}
+
+		if (isParaboloid)
+		{
+			glDisable(GL_CLIP_DISTANCE0);
+		}
+	}
+
+
+	void RenderManager::UploadShadowCascades(Shader* shader, ShadowMap* shadowMap)
+	{
+		int numCascades = shadowMap->NumCascades();
+		shader->UploadUniform("numShadowCascades",	&numCascades,	UNIFORM_Int);
+
+		if (numCascades > 0)
+		{
+			shader->UploadUniform("shadowCascade_vp",		&shadowMap->CascadeViewProjections()[0][0][0],	UNIFORM_Matrix4fv,	numCascades);
+			shader->UploadUniform("shadowTiles",			&shadowMap->Tiles()[0].x,						UNIFORM_Vec4fv,		numCascades);
+			shader->UploadUniform("shadowCascadeSplits",	&shadowMap->CascadeSplits().x,					UNIFORM_Vec4fv);
+		}
+	}
+
+
+	int RenderManager::ComputeShadowUpdateInterval(Light* pointLight, Camera* renderCam)
+	{
+		// Approximate the light's screen size by the ratio of its radius to its distance from the camera:
+		float radius	= pointLight->ActiveShadowMap()->ShadowCamera()->Far();
+		float distance	= glm::length(pointLight->GetTransform().WorldPosition() - renderCam->GetTransform()->WorldPosition());
+		if (distance <= radius)
+		{
+			return 1; // The camera is inside the light's volume
+		}
+
+		float screenSize	= radius / distance;
+		int interval		= (int)glm::ceil(this->shadowUpdateScreenSizeThreshold / screenSize);
+
+		return glm::clamp(interval, 1, this->maxShadowUpdateInterval);
+	}
+
+
+	void RenderManager::UpdateShadowAtlas(Camera* renderCam)
+	{
+		vector<Light*> const& deferredLights = CoreEngine::GetSceneManager()->GetDeferredLights();
+
+		vec3 camPosition			= renderCam->GetTransform()->WorldPosition();
+		vec4 const* frustumPlanes	= renderCam->FrustumPlanes();
+		float projectionScale		= renderCam->Projection()[1][1] * 0.5f * (float)this->yRes; // cot(fovY / 2) * (yRes / 2)
+
+		// Compute the desired tile resolution of each point light shadow from its projected radius:
+		this->shadowAtlasRequests.clear();
+		for (unsigned int i = 0; i < (unsigned int)deferredLights.size(); i++)
+		{
+			Light* currentLight		= deferredLights[i];
+			ShadowMap* shadowMap	= currentLight->ActiveShadowMap();
+			if (currentLight->Type() != LIGHT_POINT || shadowMap == nullptr)
+			{
+				continue;
+			}
+
+			vec3 lightPosition	= currentLight->GetTransform().WorldPosition();
+			float radius		= shadowMap->ShadowCamera()->Far();
+
+			// Evict lights whose volume is entirely outside the frustum: They can't affect anything on screen
+			bool isVisible = true;
+			for (int plane = 0; plane < 6 && isVisible; plane++)
+			{
+				isVisible = glm::dot(vec3(frustumPlanes[plane]), lightPosition) + frustumPlanes[plane].w >= -radius;
+			}
+			if (!isVisible)
+			{
+				shadowAtlas->Release(shadowMap);
+				continue;
+			}
+
+			float distance		= glm::length(lightPosition - camPosition);
+			float screenSize	= distance <= radius ? (float)this->yRes : glm::min((radius / distance) * projectionScale, (float)this->yRes);
+
+			// Each cube face/paraboloid covers a slice of the light's volume: Size the tiles to the projected diameter
+			ShadowAtlasRequest request;
+			request.light			= currentLight;
+			request.screenSize		= screenSize;
+			request.tileResolution	= shadowAtlas->ClampTileResolution(2.0f * screenSize, shadowMap->MaxTileResolution());
+
+			this->shadowAtlasRequests.emplace_back(request);
+		}
+
+		// Allocate the largest lights first, so they get the best tiles when space runs out:
+		std::sort(this->shadowAtlasRequests.begin(), this->shadowAtlasRequests.end(), 
+			[](ShadowAtlasRequest const& a, ShadowAtlasRequest const& b) { return a.screenSize > b.screenSize; });
+
+		// Release allocations that are changing size first, so their space can be reused:
+		for (unsigned int i = 0; i < (unsigned int)this->shadowAtlasRequests.size(); i++)
+		{
+			ShadowMap* shadowMap = this->shadowAtlasRequests[i].light->ActiveShadowMap();
+			if (shadowAtlas->TileResolution(shadowMap) != this->shadowAtlasRequests[i].tileResolution)
+			{
+				shadowAtlas->Release(shadowMap);
+			}
+		}
+
+		for (unsigned int i = 0; i < (unsigned int)this->shadowAtlasRequests.size(); i++)
+		{
+			ShadowMap* shadowMap	= this->shadowAtlasRequests[i].light->ActiveShadowMap();
+			int tileResolution		= this->shadowAtlasRequests[i].tileResolution;
+			bool isAllocated		= shadowAtlas->Allocate(shadowMap, tileResolution, shadowMap->NumAtlasTiles());
+
+			// Out of space: Evict the lower priority lights, and retry
+			if (!isAllocated)
+			{
+				for (unsigned int j = i + 1; j < (unsigned int)this->shadowAtlasRequests.size(); j++)
+				{
+					shadowAtlas->Release(this->shadowAtlasRequests[j].light->ActiveShadowMap());
+				}
+				isAllocated = shadowAtlas->Allocate(shadowMap, tileResolution, shadowMap->NumAtlasTiles());
+			}
+
+			// Still out of space: Fall back to smaller tiles. If even the smallest don't fit, the light is unshadowed this frame
+			while (!isAllocated && tileResolution > this->minShadowAtlasTileResolution)
+			{
+				tileResolution /= 2;
+				isAllocated = shadowAtlas->Allocate(shadowMap, tileResolution, shadowMap->NumAtlasTiles());
+			}
+
+			#if defined(DEBUG_RENDERMANAGER_SHADOW_CACHE_LOGGING)
+				if (!isAllocated)
+				{
+					LOG("Shadow atlas is full: Light \"" + this->shadowAtlasRequests[i].light->Name() + "\" is unshadowed this frame");
+				}
+			#endif
+		}
+	}
+
+
+	void RenderManager::RenderDepthPrepass(Camera* const renderCam, vector<Mesh*> const& meshes)
+	{
+		GLState& glState = GLState::Instance();
+
+		RenderTexture* gBufferTarget = (RenderTexture*)renderCam->RenderMaterial()->AccessTexture(RENDER_TEXTURE_ALBEDO);
+		gBufferTarget->BindFramebuffer(true);
+		glState.Viewport(0, 0, this->viewportXRes, this->viewportYRes);
+
+		glClear(GL_DEPTH_BUFFER_BIT);
+		glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+
+		depthPrepassShader->Bind(true);
+
+		mat4 const& viewProjection = renderCam->ViewProjection();
+
+		// Depth-only commands are sorted strictly front-to-back, to maximize early-z rejection within the pre-pass itself:
+		renderQueue->Build(RENDER_PASS_DEPTH_PREPASS, renderCam, meshes, depthPrepassShader);
+
+		UniformHandle const mvpHandle = depthPrepassShader->GetUniformHandle("in_mvp", UNIFORM_Matrix4fv);
+
+		unsigned int numCommands = renderQueue->NumCommands();
+		for (unsigned int i = 0; i < numCommands; i++)
+		{
+			RenderCommand const& currentCommand = renderQueue->GetCommand(i);
+
+			Mesh* currentMesh = currentCommand.mesh;
+			currentMesh->BindPositionsOnly(true);
+
+			mat4 mvp = viewProjection * currentCommand.model;
+			depthPrepassShader->UploadUniform(mvpHandle, &mvp[0][0]);
+
+			glDrawElements(GL_TRIANGLES, currentMesh->NumIndices(), GL_UNSIGNED_INT, (void*)(0));
 		}
 
 		// Cleanup:
-		lightShader->Bind(false);
+		glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+	}
+
+
+	float RenderManager::EstimateOverdraw(Camera* renderCam, vector<Mesh*> const& meshes)
+	{
+		float coveredPixels = 0.0f;
+		for (unsigned int i = 0; i < (unsigned int)meshes.size(); i++)
+		{
+			int boundsIndex = worldBounds->IndexOf(meshes[i]);
+			if (boundsIndex < 0)
+			{
+				continue;
+			}
+
+			ivec4 rect;
+			if (renderCam->ScreenRect(worldBounds->GetBounds(boundsIndex), this->xRes, this->yRes, rect))
+			{
+				coveredPixels += (float)rect.z * (float)rect.w;
+			}
+		}
+
+		return coveredPixels / ((float)this->xRes * (float)this->yRes);
 	}
 
 
-	void BlazeEngine::RenderManager::RenderToGBuffer(Camera* const renderCam)
+	void BlazeEngine::RenderManager::RenderToGBuffer(Camera* const renderCam, vector<Mesh*> const& meshes, bool hasDepthPrepass /*= false*/)
 	{
 		// For now, we just find the first valid texture, and assume it's FBO is the one we want to bind:
 		RenderTexture* renderTexture	= (RenderTexture*)renderCam->RenderMaterial()->AccessTexture((TEXTURE_TYPE)0);
@@ -530,74 +1304,100 @@ namespace BlazeEngine
 		}
 
 		renderTexture->BindFramebuffer(true);
-		glViewport(0, 0, renderTexture->Width(), renderTexture->Height());
-		
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT); // Clear the currently bound FBO
+		GLState::Instance().Viewport(0, 0, this->viewportXRes, this->viewportYRes);
 
-		// Assemble common (model independent) matrices:
-		mat4 view			= renderCam->View();
+		// The fill shader writes linear albedo: Encode it into the sRGB albedo target
+		GLState::Instance().SetCapability(GL_FRAMEBUFFER_SRGB, true);
 
-		// Loop by material (+shader), mesh:
-		std::unordered_map<string, Material*> const sceneMaterials = CoreEngine::GetSceneManager()->GetMaterials();
-		for (std::pair<string, Material*> currentElement : sceneMaterials)
+		if (hasDepthPrepass)
 		{
-			// Setup the current material and shader:
-			Material* currentMaterial	= currentElement.second;
-			Shader* currentShader		= renderCam->RenderMaterial()->GetShader();
-
-			vector<Mesh*> const* meshes;
+			// Keep the pre-pass depth, and only shade the fragments that wrote it:
+			glClear(GL_COLOR_BUFFER_BIT);
+			GLState::Instance().DepthFunc(GL_EQUAL);
+			GLState::Instance().DepthMask(false);
+		}
+		else
+		{
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT); // Clear the currently bound FBO
+		}
 
-			// Bind:
-			currentShader->Bind(true);
-			currentMaterial->BindAllTextures(TEXTURE_0, true);
+		// Assemble common (model independent) matrices:
+		mat4 view			= renderCam->View();
 
-			// Upload material properties:
-			currentShader->UploadUniform(Material::MATERIAL_PROPERTY_NAMES[MATERIAL_PROPERTY_0].c_str(), &currentMaterial->Property(MATERIAL_PROPERTY_0).x, UNIFORM_Vec4fv);
-			currentShader->UploadUniform("in_view", &view[0][0], UNIFORM_Matrix4fv);
+		// All materials are rendered with the GBuffer fill shader:
+		Shader* currentShader = renderCam->RenderMaterial()->GetShader();
+		currentShader->Bind(true);
+		currentShader->UploadUniform("in_view", &view[0][0], UNIFORM_Matrix4fv);
 
-			// Get all meshes that use the current material
-			meshes = CoreEngine::GetSceneManager()->GetRenderMeshes(currentMaterial);
+		mat4 const& viewProjection = renderCam->ViewProjection();
 
-			// Loop through each mesh:			
-			unsigned int numMeshes	= (unsigned int)meshes->size();
-			for (unsigned int j = 0; j < numMeshes; j++)
-			{
-				Mesh* currentMesh = meshes->at(j);
+		// Build the sorted queue, and walk it. Material state is only changed when it differs from the previous command:
+		renderQueue->Build(RENDER_PASS_GBUFFER, renderCam, meshes, currentShader);
 
-				currentMesh->Bind(true);
+		// Resolve the per-draw uniforms once, rather than by name for every command:
+		UniformHandle const modelHandle			= currentShader->GetUniformHandle("in_model",			UNIFORM_Matrix4fv);
+		UniformHandle const modelRotationHandle	= currentShader->GetUniformHandle("in_modelRotation",	UNIFORM_Matrix4fv);
+		UniformHandle const mvpHandle			= currentShader->GetUniformHandle("in_mvp",			UNIFORM_Matrix4fv);
+		UniformHandle const matProperty0Handle	= currentShader->GetUniformHandle(Material::MATERIAL_PROPERTY_NAMES[MATERIAL_PROPERTY_0].c_str(), UNIFORM_Vec4fv);
 
-				// Assemble model-specific matrices:
-				mat4 model			= currentMesh->GetTransform().Model();
-				mat4 modelRotation	= currentMesh->GetTransform().Model(WORLD_ROTATION);
-				mat4 mvp			= renderCam->ViewProjection() * model;
+		if (materialTextureArrays != nullptr)
+		{
+			materialTextureArrays->BeginPass();
+		}
 
-				// Upload mesh-specific matrices:
-				currentShader->UploadUniform("in_model",			&model[0][0],			UNIFORM_Matrix4fv);
-				currentShader->UploadUniform("in_modelRotation",	&modelRotation[0][0],	UNIFORM_Matrix4fv);
-				currentShader->UploadUniform("in_mvp",				&mvp[0][0],				UNIFORM_Matrix4fv);
-				// TODO: Only upload these matrices if they've changed ^^^^
+		Material* currentMaterial	= nullptr;
+		unsigned int numCommands	= renderQueue->NumCommands();
+		for (unsigned int i = 0; i < numCommands; i++)
+		{
+			RenderCommand const& currentCommand = renderQueue->GetCommand(i);
 
-				// Draw!
-				glDrawElements(GL_TRIANGLES, currentMesh->NumIndices(), GL_UNSIGNED_INT, (void*)(0)); // (GLenum mode, GLsizei count, GLenum type, const GLvoid* indices);
+			// Setup the current material:
+			if (currentCommand.material != currentMaterial)
+			{
+				currentMaterial = currentCommand.material;
 
-				// Cleanup current mesh: 
-				currentMesh->Bind(false);
+				// Materials in the same texture array batch only differ by their parameter index:
+				if (materialTextureArrays != nullptr)
+				{
+					materialTextureArrays->BindMaterial(currentMaterial, currentShader);
+				}
+				else
+				{
+					currentMaterial->BindAllTextures(TEXTURE_0, true);
+					currentShader->UploadUniform(matProperty0Handle, &currentMaterial->Property(MATERIAL_PROPERTY_0).x);
+				}
 			}
 
-			// Cleanup:
-			currentMaterial->BindAllTextures(TEXTURE_0, false);
-			currentShader->Bind(false);
+			Mesh* currentMesh = currentCommand.mesh;
+			currentMesh->Bind(true);
+
+			// Assemble model-specific matrices:
+			mat4 modelRotation	= currentMesh->GetTransform().Model(WORLD_ROTATION);
+			mat4 mvp			= viewProjection * currentCommand.model;
 
-		} // End Material loop
+			// Upload mesh-specific matrices:
+			currentShader->UploadUniform(modelHandle,			&currentCommand.model[0][0]);
+			currentShader->UploadUniform(modelRotationHandle,	&modelRotation[0][0]);
+			currentShader->UploadUniform(mvpHandle,				&mvp[0][0]);
 
-		renderTexture->BindFramebuffer(false);
+			// Draw!
+			glDrawElements(GL_TRIANGLES, currentMesh->NumIndices(), GL_UNSIGNED_INT, (void*)(0)); // (GLenum mode, GLsizei count, GLenum type, const GLvoid* indices);
+		}
+
+		// Cleanup:
+		if (hasDepthPrepass)
+		{
+			GLState::Instance().DepthFunc(GL_LESS);
+			GLState::Instance().DepthMask(true);
+		}
+		GLState::Instance().SetCapability(GL_FRAMEBUFFER_SRGB, false);
 	}
 
 
-	void RenderManager::RenderForward(Camera* renderCam)
+	void RenderManager::RenderForward(Camera* renderCam, vector<Mesh*> const& meshes)
 	{
-		glViewport(0, 0, this->xRes, this->yRes);
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		GLState::Instance().Viewport(0, 0, this->xRes, this->yRes);
+		GLState::Instance().BindFramebuffer(0);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT); // Clear the currently bound FBO
 
 		// Assemble common (model independent) matrices:
@@ -619,75 +1419,77 @@ namespace BlazeEngine
 			return;
 		}
 
-		// Loop by material (+shader), mesh:
-		std::unordered_map<string, Material*> const sceneMaterials = CoreEngine::GetSceneManager()->GetMaterials();
-		for (std::pair<string, Material*> currentElement : sceneMaterials)
+		// Bind the key light depth buffer once, for all shaders:
+		vec4 texelSize(0, 0, 0, 0);
+		RenderTexture* depthTexture = (RenderTexture*)keyLight->ActiveShadowMap()->ShadowCamera()->RenderMaterial()->AccessTexture(RENDER_TEXTURE_DEPTH);
+		if (depthTexture)
 		{
-			// Setup the current material and shader:
-			Material* currentMaterial = currentElement.second;
-			Shader* currentShader		= currentMaterial->GetShader();		
+			depthTexture->Bind(DEPTH_TEXTURE_0 + DEPTH_TEXTURE_SHADOW, true);
 
-			// Bind:
-			currentShader->Bind(true);
-			currentMaterial->BindAllTextures(TEXTURE_0, true);
+			texelSize = depthTexture->TexelSize();
+		}
 
-			// Bind the key light depth buffer and related data:
-			vec4 texelSize(0, 0, 0, 0);
-			RenderTexture* depthTexture = (RenderTexture*)keyLight->ActiveShadowMap()->ShadowCamera()->RenderMaterial()->AccessTexture(RENDER_TEXTURE_DEPTH);
-			if (depthTexture)
-			{
-				depthTexture->Bind(DEPTH_TEXTURE_0 + DEPTH_TEXTURE_SHADOW, true);
+		mat4 const& viewProjection = renderCam->ViewProjection();
 
-				texelSize = depthTexture->TexelSize();
-			}
-			currentShader->UploadUniform("maxShadowBias",			&keyLight->ActiveShadowMap()->MaxShadowBias(),	UNIFORM_Float);
-			currentShader->UploadUniform("minShadowBias",			&keyLight->ActiveShadowMap()->MinShadowBias(),	UNIFORM_Float);
-			currentShader->UploadUniform("texelSize",				&texelSize.x,									UNIFORM_Vec4fv);
+		// Build the sorted queue, and walk it. Shader and material state is only changed when it differs from the previous command:
+		renderQueue->Build(RENDER_PASS_FORWARD, renderCam, meshes);
 
-			// Get all meshes that use the current material
-			vector<Mesh*> const* meshes = CoreEngine::GetSceneManager()->GetRenderMeshes(currentMaterial);
+		Shader* currentShader		= nullptr;
+		Material* currentMaterial	= nullptr;
+		unsigned int numCommands	= renderQueue->NumCommands();
 
-			// Upload common shader matrices:
-			currentShader->UploadUniform("in_view", &view[0][0], UNIFORM_Matrix4fv);
-			currentShader->UploadUniform("shadowCam_vp", &shadowCam_vp[0][0], UNIFORM_Matrix4fv);
+		// Per-draw uniform handles, resolved each time the shader changes:
+		UniformHandle modelHandle, modelRotationHandle, mvHandle, mvpHandle;
+		for (unsigned int i = 0; i < numCommands; i++)
+		{
+			RenderCommand const& currentCommand = renderQueue->GetCommand(i);
 
-			// Loop through each mesh:			
-			unsigned int numMeshes	= (unsigned int)meshes->size();
-			for (unsigned int j = 0; j < numMeshes; j++)
+			// Setup the current shader:
+			if (currentCommand.shader != currentShader)
 			{
-				Mesh* currentMesh = meshes->at(j);
-				currentMesh->Bind(true);
+				currentShader = currentCommand.shader;
+				currentShader->Bind(true);
 
-				// Assemble model-specific matrices:
-				mat4 model			= currentMesh->GetTransform().Model();
-				mat4 modelRotation	= currentMesh->GetTransform().Model(WORLD_ROTATION);
-				mat4 mv				= view * model;
-				mat4 mvp			= renderCam->ViewProjection() * model;
+				// Upload key light shadow data and common shader matrices:
+				currentShader->UploadUniform("maxShadowBias",	&keyLight->ActiveShadowMap()->MaxShadowBias(),	UNIFORM_Float);
+				currentShader->UploadUniform("minShadowBias",	&keyLight->ActiveShadowMap()->MinShadowBias(),	UNIFORM_Float);
+				currentShader->UploadUniform("texelSize",		&texelSize.x,									UNIFORM_Vec4fv);
 
-				// Upload mesh-specific matrices:
-				currentShader->UploadUniform("in_model",			&model[0][0],			UNIFORM_Matrix4fv);
-				currentShader->UploadUniform("in_modelRotation",	&modelRotation[0][0],	UNIFORM_Matrix4fv);
-				currentShader->UploadUniform("in_mv",				&mv[0][0],				UNIFORM_Matrix4fv);
-				currentShader->UploadUniform("in_mvp",				&mvp[0][0],				UNIFORM_Matrix4fv);
+				currentShader->UploadUniform("in_view",			&view[0][0],									UNIFORM_Matrix4fv);
+				currentShader->UploadUniform("shadowCam_vp",	&shadowCam_vp[0][0],							UNIFORM_Matrix4fv);
 
-				// TODO: Only upload these matrices if they've changed ^^^^
+				UploadShadowCascades(currentShader, keyLight->ActiveShadowMap());
 
-				// Draw!
-				glDrawElements(GL_TRIANGLES, currentMesh->NumIndices(), GL_UNSIGNED_INT, (void*)(0)); // (GLenum mode, GLsizei count, GLenum type, const GLvoid* indices);
-
-				// Cleanup current mesh: 
-				currentMesh->Bind(false);
+				modelHandle			= currentShader->GetUniformHandle("in_model",			UNIFORM_Matrix4fv);
+				modelRotationHandle	= currentShader->GetUniformHandle("in_modelRotation",	UNIFORM_Matrix4fv);
+				mvHandle			= currentShader->GetUniformHandle("in_mv",				UNIFORM_Matrix4fv);
+				mvpHandle			= currentShader->GetUniformHandle("in_mvp",			UNIFORM_Matrix4fv);
 			}
 
-			// Cleanup current material and shader:
-			currentMaterial->BindAllTextures(TEXTURE_0, false);
-			if (depthTexture)
+			// Setup the current material:
+			if (currentCommand.material != currentMaterial)
 			{
-				depthTexture->Bind(DEPTH_TEXTURE_0 + DEPTH_TEXTURE_SHADOW, false);
+				currentMaterial = currentCommand.material;
+				currentMaterial->BindAllTextures(TEXTURE_0, true);
 			}
-			currentShader->Bind(false);
 
-		} // End Material loop
+			Mesh* currentMesh = currentCommand.mesh;
+			currentMesh->Bind(true);
+
+			// Assemble model-specific matrices:
+			mat4 modelRotation	= currentMesh->GetTransform().Model(WORLD_ROTATION);
+			mat4 mv				= view * currentCommand.model;
+			mat4 mvp			= viewProjection * currentCommand.model;
+
+			// Upload mesh-specific matrices:
+			currentShader->UploadUniform(modelHandle,			&currentCommand.model[0][0]);
+			currentShader->UploadUniform(modelRotationHandle,	&modelRotation[0][0]);
+			currentShader->UploadUniform(mvHandle,				&mv[0][0]);
+			currentShader->UploadUniform(mvpHandle,				&mvp[0][0]);
+
+			// Draw!
+			glDrawElements(GL_TRIANGLES, currentMesh->NumIndices(), GL_UNSIGNED_INT, (void*)(0)); // (GLenum mode, GLsizei count, GLenum type, const GLvoid* indices);
+		}
 	}
 
 
@@ -698,8 +1500,7 @@ namespace BlazeEngine
 		// Bind:
 		Shader* currentShader	= deferredLight->DeferredMaterial()->GetShader();
 
-		currentShader->Bind(true);
-		renderCam->RenderMaterial()->BindAllTextures(RENDER_TEXTURE_0, true);	// Bind GBuffer textures
+		currentShader->Bind(true);	// Note: GBuffer textures are bound once for all lights, in Update()
 		
 		// Assemble common (model independent) matrices:
 		bool hasShadowMap = deferredLight->ActiveShadowMap() != nullptr;
@@ -708,32 +1509,30 @@ namespace BlazeEngine
 		mat4 view			= renderCam->View();
 		mat4 mv				= view * model;
 		mat4 mvp			= renderCam->ViewProjection() * deferredLight->GetTransform().Model();
+		mat4 inverse_vp		= glm::inverse(renderCam->ViewProjection()); // Reconstructs world positions from GBuffer depth
 		vec3 cameraPosition = renderCam->GetTransform()->WorldPosition();
 
-		currentShader->UploadUniform("in_model",		&model[0][0],			UNIFORM_Matrix4fv);
-		currentShader->UploadUniform("in_view",			&view[0][0],			UNIFORM_Matrix4fv);
-		currentShader->UploadUniform("in_mv",			&mv[0][0],				UNIFORM_Matrix4fv);
-		currentShader->UploadUniform("in_mvp",			&mvp[0][0],				UNIFORM_Matrix4fv);
-		currentShader->UploadUniform("cameraWorldPos",	&cameraPosition,		UNIFORM_Vec3fv);
+		DeferredLightUniforms const& uniforms = GetDeferredLightUniforms(currentShader);
+
+		currentShader->UploadUniform(uniforms.model,			&model[0][0]);
+		currentShader->UploadUniform(uniforms.view,				&view[0][0]);
+		currentShader->UploadUniform(uniforms.inverse_vp,		&inverse_vp[0][0]);
+		currentShader->UploadUniform(uniforms.mv,				&mv[0][0]);
+		currentShader->UploadUniform(uniforms.mvp,				&mvp[0][0]);
+		currentShader->UploadUniform(uniforms.cameraWorldPos,	&cameraPosition);
 		// TODO: Only upload these matrices if they've changed ^^^^
 		// TODO: Break this out into a function: ALL of our render functions have a similar setup		
 
 		// Light properties:
-		currentShader->UploadUniform("lightColor", &deferredLight->Color().r, UNIFORM_Vec3fv);
+		currentShader->UploadUniform(uniforms.lightColor, &deferredLight->Color().r);
 
 		switch (deferredLight->Type())
 		{
 		case LIGHT_AMBIENT_IBL:
 		{
-			// Bind IBL cubemaps:
+			// Bind IBL cubemaps. Note: Diffuse irradiance is evaluated from spherical harmonics uploaded by the ImageBasedLight
 			if (!this->useForwardRendering)
 			{
-				Texture* IEMCubemap = ((ImageBasedLight*)deferredLight)->GetIEMMaterial()->AccessTexture(CUBE_MAP_RIGHT);
-				if (IEMCubemap != nullptr)
-				{
-					IEMCubemap->Bind(CUBE_MAP_0 + CUBE_MAP_RIGHT, true);
-				}
-
 				Texture* PMREM_Cubemap = ((ImageBasedLight*)deferredLight)->GetPMREMMaterial()->AccessTexture(CUBE_MAP_RIGHT);
 				if (PMREM_Cubemap != nullptr)
 				{
@@ -752,10 +1551,10 @@ namespace BlazeEngine
 
 		case LIGHT_DIRECTIONAL:
 		{
-			currentShader->UploadUniform("keylightWorldDir", &deferredLight->GetTransform().Forward().x, UNIFORM_Vec3fv);
+			currentShader->UploadUniform(uniforms.keylightWorldDir, &deferredLight->GetTransform().Forward().x);
 
 			vec3 keylightViewDir = glm::normalize(view * vec4(deferredLight->GetTransform().Forward(), 0.0f));
-			currentShader->UploadUniform("keylightViewDir", &keylightViewDir.x, UNIFORM_Vec3fv);
+			currentShader->UploadUniform(uniforms.keylightViewDir, &keylightViewDir.x);
 		}
 			break;
 
@@ -765,7 +1564,7 @@ namespace BlazeEngine
 		case LIGHT_AREA:
 		case LIGHT_TUBE:
 		{
-			currentShader->UploadUniform("lightWorldPos", &deferredLight->GetTransform().WorldPosition().x, UNIFORM_Vec3fv);
+			currentShader->UploadUniform(uniforms.lightWorldPos, &deferredLight->GetTransform().WorldPosition().x);
 
 			// TODO: Can we just upload this once when the light is created (and its shader is created)?  (And also update it if the light is ever moved)
 		}
@@ -785,13 +1584,18 @@ namespace BlazeEngine
 			if (shadowCam != nullptr)
 			{
 				// Upload common shadow properties:
-				currentShader->UploadUniform("shadowCam_vp",	&shadowCam->ViewProjection()[0][0],	UNIFORM_Matrix4fv);
+				currentShader->UploadUniform(uniforms.shadowCam_vp,		&shadowCam->ViewProjection()[0][0]);
 				
-				currentShader->UploadUniform("maxShadowBias",	&activeShadowMap->MaxShadowBias(),	UNIFORM_Float);
-				currentShader->UploadUniform("minShadowBias",	&activeShadowMap->MinShadowBias(),	UNIFORM_Float);
+				currentShader->UploadUniform(uniforms.maxShadowBias,	&activeShadowMap->MaxShadowBias());
+				currentShader->UploadUniform(uniforms.minShadowBias,	&activeShadowMap->MinShadowBias());
 
-				currentShader->UploadUniform("shadowCam_near",	&shadowCam->Near(),					UNIFORM_Float);
-				currentShader->UploadUniform("shadowCam_far",	&shadowCam->Far(),					UNIFORM_Float);
+				currentShader->UploadUniform(uniforms.shadowCam_near,	&shadowCam->Near());
+				currentShader->UploadUniform(uniforms.shadowCam_far,	&shadowCam->Far());
+
+				if (deferredLight->Type() == LIGHT_DIRECTIONAL)
+				{
+					UploadShadowCascades(currentShader, activeShadowMap);
+				}
 
 				// Bind shadow depth textures:
 				RenderTexture* depthTexture = nullptr;
@@ -799,7 +1603,7 @@ namespace BlazeEngine
 				{
 				case LIGHT_DIRECTIONAL:
 				{
-					depthTexture = (RenderTexture*)activeShadowMap->ShadowCamera()->RenderMaterial()->AccessTexture(RENDER_TEXTURE_DEPTH);
+					depthTexture = activeShadowMap->DepthTexture();
 					if (depthTexture)
 					{
 						depthTexture->Bind(DEPTH_TEXTURE_0 + DEPTH_TEXTURE_SHADOW, true);
@@ -809,10 +1613,17 @@ namespace BlazeEngine
 
 				case LIGHT_POINT:
 				{
-					depthTexture = (RenderTexture*)activeShadowMap->ShadowCamera()->RenderMaterial()->AccessTexture(CUBE_MAP_RIGHT);
-					if (depthTexture)
+					// Point light shadows live in the shadow atlas: Upload the cube face tiles, or 0 tiles if the light wasn't allocated any
+					int numShadowTiles = activeShadowMap->NumTiles();
+					currentShader->UploadUniform(uniforms.numShadowTiles, &numShadowTiles);
+
+					depthTexture = activeShadowMap->DepthTexture();
+					if (depthTexture && numShadowTiles > 0)
 					{
-						depthTexture->Bind(CUBE_MAP_0 + CUBE_MAP_RIGHT, true);
+						currentShader->UploadUniform(uniforms.shadowCamCubeMap_vp,	&shadowCam->CubeViewProjection()[0][0][0],	6);
+						currentShader->UploadUniform(uniforms.shadowTiles,			&activeShadowMap->Tiles()[0].x,				numShadowTiles);
+
+						depthTexture->Bind(DEPTH_TEXTURE_0 + DEPTH_TEXTURE_SHADOW, true);
 					}
 				}
 				break;
@@ -832,7 +1643,7 @@ namespace BlazeEngine
 				{
 					texelSize = depthTexture->TexelSize();
 				}
-				currentShader->UploadUniform("texelSize", &texelSize.x, UNIFORM_Vec4fv);
+				currentShader->UploadUniform(uniforms.texelSize, &texelSize.x);
 			}
 		}
 		
@@ -840,63 +1651,39 @@ namespace BlazeEngine
 
 		// Draw!
 		glDrawElements(GL_TRIANGLES, deferredLight->DeferredMesh()->NumIndices(), GL_UNSIGNED_INT, (void*)(0)); // (GLenum mode, GLsizei count, GLenum type, const GLvoid* indices);
+	}
 
 
-		// Cleanup:
-		renderCam->RenderMaterial()->BindAllTextures(RENDER_TEXTURE_0, false);
-
-		if (activeShadowMap != nullptr)
+	RenderManager::DeferredLightUniforms const& RenderManager::GetDeferredLightUniforms(Shader* shader)
+	{
+		unordered_map<Shader*, DeferredLightUniforms>::const_iterator result = this->deferredLightUniforms.find(shader);
+		if (result != this->deferredLightUniforms.end())
 		{
-			switch (deferredLight->Type())
-			{
-			case LIGHT_DIRECTIONAL:
-			{
-				activeShadowMap->ShadowCamera()->RenderMaterial()->AccessTexture(RENDER_TEXTURE_DEPTH)->Bind(DEPTH_TEXTURE_0 + DEPTH_TEXTURE_SHADOW, false);
-			}			
-			break;
-
-			case LIGHT_POINT:
-			{
-				activeShadowMap->ShadowCamera()->RenderMaterial()->AccessTexture(CUBE_MAP_RIGHT)->Bind(CUBE_MAP_0 + CUBE_MAP_RIGHT, false);
-			}
-			break;
-
-			// Other light types don't support shadows, yet:
-			case LIGHT_AMBIENT_COLOR:
-			case LIGHT_AMBIENT_IBL:
-			case LIGHT_AREA:
-			case LIGHT_SPOT:
-			case LIGHT_TUBE:
-			default:
-				break;
-			}
+			return result->second;
 		}
 
-		if (deferredLight->Type() == LIGHT_AMBIENT_IBL && !this->useForwardRendering)
-		{
-			// Unbind IBL cubemaps:
-			Texture* IEMCubemap = ((ImageBasedLight*)deferredLight)->GetIEMMaterial()->AccessTexture(CUBE_MAP_RIGHT);
-			if (IEMCubemap != nullptr)
-			{
-				IEMCubemap->Bind(CUBE_MAP_0 + CUBE_MAP_RIGHT, false);
-			}
-
-			Texture* PMREM_Cubemap = ((ImageBasedLight*)deferredLight)->GetPMREMMaterial()->AccessTexture(CUBE_MAP_RIGHT);
-			if (PMREM_Cubemap != nullptr)
-			{
-				PMREM_Cubemap->Bind(CUBE_MAP_1 + CUBE_MAP_RIGHT, false);
-			}
-
-			// Unbind BRDF Integration map:
-			RenderTexture* BRDFIntegrationMap = ((ImageBasedLight*)deferredLight)->GetBRDFIntegrationMap();
-			if (BRDFIntegrationMap != nullptr)
-			{
-				BRDFIntegrationMap->Bind(GENERIC_TEXTURE_0, false);
-			}
-		}
-		
-		currentShader->Bind(false);
-		deferredLight->DeferredMesh()->Bind(false);
+		DeferredLightUniforms& uniforms	= this->deferredLightUniforms[shader];
+		uniforms.model					= shader->GetUniformHandle("in_model",				UNIFORM_Matrix4fv);
+		uniforms.view					= shader->GetUniformHandle("in_view",				UNIFORM_Matrix4fv);
+		uniforms.inverse_vp				= shader->GetUniformHandle("in_inverse_vp",			UNIFORM_Matrix4fv);
+		uniforms.mv						= shader->GetUniformHandle("in_mv",					UNIFORM_Matrix4fv);
+		uniforms.mvp					= shader->GetUniformHandle("in_mvp",				UNIFORM_Matrix4fv);
+		uniforms.cameraWorldPos			= shader->GetUniformHandle("cameraWorldPos",		UNIFORM_Vec3fv);
+		uniforms.lightColor				= shader->GetUniformHandle("lightColor",			UNIFORM_Vec3fv);
+		uniforms.keylightWorldDir		= shader->GetUniformHandle("keylightWorldDir",		UNIFORM_Vec3fv);
+		uniforms.keylightViewDir		= shader->GetUniformHandle("keylightViewDir",		UNIFORM_Vec3fv);
+		uniforms.lightWorldPos			= shader->GetUniformHandle("lightWorldPos",			UNIFORM_Vec3fv);
+		uniforms.shadowCam_vp			= shader->GetUniformHandle("shadowCam_vp",			UNIFORM_Matrix4fv);
+		uniforms.maxShadowBias			= shader->GetUniformHandle("maxShadowBias",			UNIFORM_Float);
+		uniforms.minShadowBias			= shader->GetUniformHandle("minShadowBias",			UNIFORM_Float);
+		uniforms.shadowCam_near			= shader->GetUniformHandle("shadowCam_near",		UNIFORM_Float);
+		uniforms.shadowCam_far			= shader->GetUniformHandle("shadowCam_far",			UNIFORM_Float);
+		uniforms.numShadowTiles			= shader->GetUniformHandle("numShadowTiles",		UNIFORM_Int);
+		uniforms.shadowCamCubeMap_vp	= shader->GetUniformHandle("shadowCamCubeMap_vp",	UNIFORM_Matrix4fv);
+		uniforms.shadowTiles			= shader->GetUniformHandle("shadowTiles",			UNIFORM_Vec4fv);
+		uniforms.texelSize				= shader->GetUniformHandle("texelSize",				UNIFORM_Vec4fv);
+
+		return uniforms;
 	}
 
 
@@ -932,22 +1719,13 @@ namespace BlazeEngine
 
 		// Draw!
 		glDrawElements(GL_TRIANGLES, skybox->GetSkyMesh()->NumIndices(), GL_UNSIGNED_INT, (void*)(0)); // (GLenum mode, GLsizei count, GLenum type, const GLvoid* indices);
-
-		// Cleanup:
-		skybox->GetSkyMesh()->Bind(false);
-		if (depthTexture)
-		{
-			depthTexture->Bind(RENDER_TEXTURE_0 + RENDER_TEXTURE_DEPTH, false);
-		}		
-		skyboxCubeMap->Bind(CUBE_MAP_0 + CUBE_MAP_RIGHT, false);
-		currentShader->Bind(false);		
 	}
 
 
 	void BlazeEngine::RenderManager::BlitToScreen()
 	{
-		glViewport(0, 0, this->xRes, this->yRes);
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		GLState::Instance().Viewport(0, 0, this->xRes, this->yRes);
+		GLState::Instance().BindFramebuffer(0);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 		outputMaterial->GetShader()->Bind(true);
@@ -955,18 +1733,13 @@ namespace BlazeEngine
 		screenAlignedQuad->Bind(true);
 
 		glDrawElements(GL_TRIANGLES, screenAlignedQuad->NumIndices(), GL_UNSIGNED_INT, (void*)(0)); // (GLenum mode, GLsizei count, GLenum type, const GLvoid* indices);
-
-		// Cleanup:
-		outputMaterial->BindAllTextures(RENDER_TEXTURE_0, false);
-		outputMaterial->GetShader()->Bind(false);
-		screenAlignedQuad->Bind(false);
 	}
 
 
 	void BlazeEngine::RenderManager::BlitToScreen(Material* srcMaterial, Shader* blitShader)
 	{
-		glViewport(0, 0, this->xRes, this->yRes);
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		GLState::Instance().Viewport(0, 0, this->xRes, this->yRes);
+		GLState::Instance().BindFramebuffer(0);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
 		blitShader->Bind(true);
@@ -974,11 +1747,6 @@ namespace BlazeEngine
 		screenAlignedQuad->Bind(true);
 
 		glDrawElements(GL_TRIANGLES, screenAlignedQuad->NumIndices(), GL_UNSIGNED_INT, (void*)(0)); // (GLenum mode, GLsizei count, GLenum type, const GLvoid* indices);
-
-		// Cleanup:
-		srcMaterial->BindAllTextures(RENDER_TEXTURE_0, false);
-		blitShader->Bind(false);
-		screenAlignedQuad->Bind(false);
 	}
 
 
@@ -992,7 +1760,7 @@ namespace BlazeEngine
 
 		// Bind the output FBO: (Textures MUST already be attached...)
 		((RenderTexture*)dstMat->AccessTexture((TEXTURE_TYPE)dstTex))->BindFramebuffer(true);
-		glViewport(0, 0, dstMat->AccessTexture((TEXTURE_TYPE)dstTex)->Width(), dstMat->AccessTexture((TEXTURE_TYPE)dstTex)->Height());
+		GLState::Instance().Viewport(0, 0, this->viewportXRes, this->viewportYRes);
 
 		// Bind the blit shader and screen aligned quad:
 		currentShader->Bind(true);
@@ -1002,12 +1770,21 @@ namespace BlazeEngine
 		srcMat->AccessTexture((TEXTURE_TYPE)srcTex)->Bind(RENDER_TEXTURE_0 + RENDER_TEXTURE_ALBEDO, true); // Note: Blit shader reads from this texture unit (for now)
 		
 		glDrawElements(GL_TRIANGLES, screenAlignedQuad->NumIndices(), GL_UNSIGNED_INT, (void*)(0)); // (GLenum mode, GLsizei count, GLenum type, const GLvoid* indices);
+	}
 
-		// Cleanup:
-		srcMat->AccessTexture((TEXTURE_TYPE)dstTex)->Bind(TEXTURE_ALBEDO, false);
-		screenAlignedQuad->Bind(false);
-		currentShader->Bind(false);
-		((RenderTexture*)dstMat->AccessTexture((TEXTURE_TYPE)dstTex))->BindFramebuffer(false);
+	
+	void RenderManager::UploadViewportParams()
+	{
+		vec4 screenParams	= vec4(this->viewportXRes, this->viewportYRes, 1.0f / this->viewportXRes, 1.0f / this->viewportYRes);
+		vec2 renderScale	= vec2((float)this->viewportXRes / (float)this->xRes, (float)this->viewportYRes / (float)this->yRes);
+
+		for (unsigned int i = 0; i < (unsigned int)this->viewportShaders.size(); i++)
+		{
+			this->viewportShaders[i]->UploadUniform("screenParams",	&screenParams.x,	UNIFORM_Vec4fv);
+			this->viewportShaders[i]->UploadUniform("renderScale",	&renderScale.x,		UNIFORM_Vec2fv);
+		}
+
+		postFXManager->SetRenderScale(renderScale);
 	}
 
 	
@@ -1028,6 +1805,39 @@ namespace BlazeEngine
 		SceneManager* sceneManager	= CoreEngine::GetSceneManager();
 		unsigned int numMaterials	= sceneManager->NumMaterials();
 
+		this->deferredLightUniforms.clear(); // The scene's light shaders have been (re)created
+
+		// Copy the material textures into texture arrays. Must precede the render queue, so its material IDs follow the batches, the
+		// texture streamer, which skips the copied textures, and the creation and configuration of the shaders that sample them:
+		if (MaterialTextureArrays::IsEnabled())
+		{
+			delete materialTextureArrays; // Arrays of any previously loaded scene
+			materialTextureArrays = new MaterialTextureArrays();
+			if (!materialTextureArrays->Build(sceneManager->GetMaterials()))
+			{
+				LOG_ERROR("Material texture arrays failed to build. Material textures will be bound individually");
+				delete materialTextureArrays;
+				materialTextureArrays = nullptr;
+
+				// The GBuffer shader was created to sample the arrays: Recreate it to sample the individual textures, which still exist
+				sceneManager->GetMainCamera()->ReloadGBufferShader();
+			}
+		}
+
+		// The visibility buffer shares the main camera's GBuffer depth, so it can only be created once the scene is loaded:
+		delete visibilityBuffer; // Buffer of any previously loaded scene
+		visibilityBuffer = nullptr;
+		if (this->useVisibilityBuffer && !this->useForwardRendering)
+		{
+			visibilityBuffer = new VisibilityBuffer(sceneManager->GetMainCamera());
+			if (!visibilityBuffer->IsValid())
+			{
+				LOG_ERROR("Visibility buffer failed to initialize. The GBuffer will be filled directly");
+				delete visibilityBuffer;
+				visibilityBuffer = nullptr;
+			}
+		}
+
 		// Legacy forward rendering params:
 		Light const* ambientLight	= nullptr;
 		vec3 const* ambientColor	= nullptr;
@@ -1052,11 +1862,11 @@ namespace BlazeEngine
 			LOG("Key Col: " + to_string(keyCol->r) + ", " + to_string(keyCol->g) + ", " + to_string(keyCol->b));
 		#endif
 
-		vec4 screenParams		= vec4(this->xRes, this->yRes, 1.0f / this->xRes, 1.0f / this->yRes);
 		vec4 projectionParams	= vec4(1.0f, CoreEngine::GetSceneManager()->GetMainCamera()->Near(), CoreEngine::GetSceneManager()->GetMainCamera()->Far(), 1.0f / CoreEngine::GetSceneManager()->GetMainCamera()->Far());
 
 		// Add all Material Shaders to a list:
-		vector<Shader*> shaders;
+		vector<Shader*>& shaders = this->viewportShaders;
+		shaders.clear();
 		std::unordered_map<string, Material*> const sceneMaterials = CoreEngine::GetSceneManager()->GetMaterials();
 		for (std::pair<string, Material*> currentElement : sceneMaterials)
 		{
@@ -1096,12 +1906,19 @@ namespace BlazeEngine
 		
 		// Add RenderManager shaders:
 		shaders.push_back(outputMaterial->GetShader());
+		if (clusteredLighting != nullptr)
+		{
+			shaders.push_back(clusteredLighting->LightingShader());
+		}
+		if (visibilityBuffer != nullptr)
+		{
+			shaders.push_back(visibilityBuffer->ResolveShader());
+		}
 
 		// Configure all of the shaders:
+		// Note: Uniforms are uploaded directly to each program object, so the shaders don't need to be bound
 		for (unsigned int i = 0; i < (int)shaders.size(); i++)
 		{
-			shaders.at(i)->Bind(true);
-
 			// Upload light direction (world space) and color, and ambient light color:
 			if (ambientLight != nullptr)
 			{
@@ -1119,7 +1936,6 @@ namespace BlazeEngine
 			// TODO: Shift more value uploads into the shader creation flow
 			
 			// Other params:
-			shaders.at(i)->UploadUniform("screenParams", &(screenParams.x), UNIFORM_Vec4fv);
 			shaders.at(i)->UploadUniform("projectionParams", &(projectionParams.x), UNIFORM_Vec4fv);
 
 			float emissiveIntensity = CoreEngine::GetCoreEngine()->GetConfig()->GetValue<float>("defaultSceneEmissiveIntensity");
@@ -1130,12 +1946,26 @@ namespace BlazeEngine
 			// Upload matrices:
 			mat4 projection = sceneManager->GetMainCamera()->Projection();
 			shaders.at(i)->UploadUniform("in_projection", &projection[0][0], UNIFORM_Matrix4fv);
-
-			shaders.at(i)->Bind(false);
 		}
 
 		// Initialize PostFX:
-		postFXManager->Initialize(outputMaterial);
+		postFXManager->Initialize();
+
+		// Upload the initial viewport:
+		UploadViewportParams();
+
+		// Initialize the render queue:
+		renderQueue->Initialize(materialTextureArrays);
+
+		// Build the scene BVH:
+		worldBounds->Update(*sceneManager->GetRenderMeshes(nullptr));
+		sceneBVH->Build(*worldBounds);
+
+		// Register the streamed textures:
+		if (textureStreamer != nullptr)
+		{
+			textureStreamer->Initialize(sceneManager->GetMaterials());
+		}
 	}
 
 
@@ -3,8 +3,11 @@
 #pragma once
 
 #include "EngineComponent.h"	// Base class
+#include "Shader.h"				// UniformHandle
 
 #include <string>
+#include <vector>
+#include <unordered_map>
 
 #include <GL/glew.h>
 
@@ -14,6 +17,8 @@
 #include "glm.hpp"
 
 using glm::vec4;
+using std::vector;
+using std::unordered_map;
 
 
 namespace BlazeEngine
@@ -27,6 +32,20 @@ namespace BlazeEngine
 	class Light;
 	class Skybox;
 	class PostFXManager;
+	class RenderQueue;
+	class WorkerPool;
+	class WorldBounds;
+	class BVH;
+	class OcclusionCuller;
+	class ShadowMap;
+	class ShadowAtlas;
+	class ClusteredLighting;
+	class VisibilityBuffer;
+	class GPUTimer;
+	class RenderGraph;
+	class DynamicResolution;
+	class TextureStreamer;
+	class MaterialTextureArrays;
 
 
 	enum SHADER // Guaranteed shaders
@@ -65,21 +84,55 @@ namespace BlazeEngine
 
 	private:
 		void RenderLightShadowMap(Light* currentLight);
+		void RenderShadowCasters(Light* currentLight, vector<Mesh*> const& casters);	// Note: Shadow map FBO and shader must be bound
+
+		// Multi-pass and dual-paraboloid point light shadows: Draw the casters once per atlas tile they touch
+		void RenderPointShadowPasses(Light* currentLight, vector<Mesh*> const& casters);
+
+		// Upload a directional light's shadow cascade uniforms
+		void UploadShadowCascades(Shader* shader, ShadowMap* shadowMap);
+
+		// Shadow map update rate policy: Returns the number of frames between updates of a point light's shadow map
+		int ComputeShadowUpdateInterval(Light* pointLight, Camera* renderCam);
+
+		// (Re)allocate the point light shadow atlas tiles, sized by each light's screen coverage. Off-screen lights are evicted
+		void UpdateShadowAtlas(Camera* renderCam);
 		//void RenderReflectionProbe();
 
-		void RenderToGBuffer(Camera* const renderCam);	// Note: renderCam MUST have an attached GBuffer
+		// Fill the GBuffer depth only, using the position-only vertex streams. Note: renderCam MUST have an attached GBuffer
+		void RenderDepthPrepass(Camera* const renderCam, vector<Mesh*> const& meshes);
+
+		// Estimate the overdraw of the meshes: The sum of their screen bounds areas, as a fraction of the screen area
+		float EstimateOverdraw(Camera* renderCam, vector<Mesh*> const& meshes);
+
+		// Note: renderCam MUST have an attached GBuffer. If hasDepthPrepass, the GBuffer depth is kept and only equal depths are shaded
+		void RenderToGBuffer(Camera* const renderCam, vector<Mesh*> const& meshes, bool hasDepthPrepass = false);
 
-		void RenderForward(Camera* renderCam);
+		void RenderForward(Camera* renderCam, vector<Mesh*> const& meshes);
 
 		void RenderDeferredLight(Light* deferredLight); // Note: FBO, viewport
 
+		// Handles to the uniforms RenderDeferredLight() uploads. Resolved the first time each light's shader is drawn
+		struct DeferredLightUniforms
+		{
+			UniformHandle model, view, inverse_vp, mv, mvp, cameraWorldPos, lightColor;
+			UniformHandle keylightWorldDir, keylightViewDir, lightWorldPos;
+			UniformHandle shadowCam_vp, maxShadowBias, minShadowBias, shadowCam_near, shadowCam_far;
+			UniformHandle numShadowTiles, shadowCamCubeMap_vp, shadowTiles, texelSize;
+		};
+		DeferredLightUniforms const& GetDeferredLightUniforms(Shader* shader);
+
 		void RenderSkybox(Skybox* skybox);
 
 		void BlitToScreen();
 		void BlitToScreen(Material* srcMaterial, Shader* blitShader);
 
+		// Note: Blits cover the dynamic resolution viewport of the destination, as the blit shader samples the source within it
 		void Blit(Material* srcMat, int srcTex, Material* dstMat, int dstTex, Shader* shaderOverride = nullptr);
 
+		// Upload the current viewport's screenParams and renderScale to every shader that samples screen-sized render targets
+		void UploadViewportParams();
+
 
 		// Configuration:
 		//---------------
@@ -88,6 +141,17 @@ namespace BlazeEngine
 		string windowTitle			= "Default BlazeEngine window title";
 
 		bool useForwardRendering	= false;
+		bool useClusteredLighting	= true;
+		bool useVisibilityBuffer	= false;
+		bool useDepthPrepass		= true;
+
+		float depthPrepassOverdrawThreshold		= 1.5f;
+
+		float shadowUpdateScreenSizeThreshold	= 0.25f;
+		int maxShadowUpdateInterval				= 4;
+
+		int shadowAtlasSize						= 4096;
+		int minShadowAtlasTileResolution		= 64;
 
 		vec4 windowClearColor		= vec4(0.0f, 0.0f, 0.0f, 0.0f);
 		float depthClearColor		= 1.0f;
@@ -102,6 +166,59 @@ namespace BlazeEngine
 		// PostFX:
 		PostFXManager* postFXManager = nullptr;	// Deallocated in Shutdown()
 
+		// Sorted draw calls for the current pass:
+		RenderQueue* renderQueue	= nullptr;	// Deallocated in Shutdown()
+
+		// Persistent threads for per-frame CPU work:
+		WorkerPool* workerPool		= nullptr;	// Deallocated in Shutdown()
+
+		// Frame passes, and their transient render targets:
+		RenderGraph* renderGraph	= nullptr;	// Deallocated in Shutdown()
+
+		// Visibility:
+		WorldBounds* worldBounds			= nullptr;	// Deallocated in Shutdown()
+		BVH* sceneBVH						= nullptr;	// Deallocated in Shutdown()
+		OcclusionCuller* occlusionCuller	= nullptr;	// Deallocated in Shutdown()
+		vector<Mesh*> visibleMeshes;					// Meshes visible to the main camera this frame
+		vector<Mesh*> shadowCasters;					// Meshes that can cast shadows into the shadow map currently being rendered
+		vector<Mesh*> staticShadowCasters;				// shadowCasters, split by WorldBounds::IsDynamic()
+		vector<Mesh*> dynamicShadowCasters;
+		vector<unsigned int> shadowCasterPassMasks;	// Per caster: Bit i is set if it touches point shadow pass i
+
+		// Deferred lights:
+		unordered_map<Shader*, DeferredLightUniforms> deferredLightUniforms;	// Cleared in Initialize(), as scene shaders are recreated
+
+		// Point lights:
+		ShadowAtlas* shadowAtlas			= nullptr;	// Deallocated in Shutdown()
+		ClusteredLighting* clusteredLighting = nullptr;	// Deallocated in Shutdown(). nullptr if point lights are rendered individually
+
+		// GBuffer fill:
+		VisibilityBuffer* visibilityBuffer	= nullptr;	// Created in Initialize(), deallocated in Shutdown(). nullptr if the GBuffer is filled directly
+		Shader* depthPrepassShader			= nullptr;	// Deallocated in Shutdown(). nullptr if the depth pre-pass is disabled
+
+		// Profiling:
+		GPUTimer* gpuTimer					= nullptr;	// Deallocated in Shutdown()
+
+		// Dynamic resolution: Scene passes render within the viewportXRes x viewportYRes corner of the xRes x yRes targets
+		DynamicResolution* dynamicResolution = nullptr;	// Deallocated in Shutdown(). nullptr if the viewport is always xRes x yRes
+		int viewportXRes					= -1;
+		int viewportYRes					= -1;
+		vector<Shader*> viewportShaders;				// Shaders that need screenParams/renderScale. Gathered in Initialize()
+
+		// Material texture mip streaming:
+		TextureStreamer* textureStreamer	= nullptr;	// Deallocated in Shutdown(). nullptr if textures are fully resident
+
+		// Material texture arrays:
+		MaterialTextureArrays* materialTextureArrays = nullptr;	// Created in Initialize(), deallocated in Shutdown(). nullptr if materials bind their own textures
+
+		struct ShadowAtlasRequest
+		{
+			Light*	light;
+			float	screenSize;		// Projected radius, in pixels
+			int		tileResolution;
+		};
+		vector<ShadowAtlasRequest> shadowAtlasRequests;	// Scratch space for UpdateShadowAtlas()
+
 		
 		// Private member functions:
 		//--------------------------
@@ -0,0 +1,231 @@
+#include "RenderQueue.h"
+#include "CoreEngine.h"
+#include "SceneManager.h"
+#include "Mesh.h"
+#include "Material.h"
+#include "Shader.h"
+#include "Camera.h"
+#include "MaterialTextureArrays.h"
+#include "WorkerPool.h"
+#include "BuildConfiguration.h"
+
+#include <algorithm>
+#include <cstring>
+
+
+namespace BlazeEngine
+{
+	// Sort key field widths and offsets:
+	#define RENDER_QUEUE_GEOMETRY_BITS		16
+	#define RENDER_QUEUE_DEPTH_BITS			16
+	#define RENDER_QUEUE_MATERIAL_BITS		16
+	#define RENDER_QUEUE_PROGRAM_BITS		12
+
+	#define RENDER_QUEUE_GEOMETRY_SHIFT		0
+	#define RENDER_QUEUE_DEPTH_SHIFT		(RENDER_QUEUE_GEOMETRY_SHIFT + RENDER_QUEUE_GEOMETRY_BITS)
+	#define RENDER_QUEUE_MATERIAL_SHIFT		(RENDER_QUEUE_DEPTH_SHIFT + RENDER_QUEUE_DEPTH_BITS)
+	#define RENDER_QUEUE_PROGRAM_SHIFT		(RENDER_QUEUE_MATERIAL_SHIFT + RENDER_QUEUE_MATERIAL_BITS)
+	#define RENDER_QUEUE_PASS_SHIFT			(RENDER_QUEUE_PROGRAM_SHIFT + RENDER_QUEUE_PROGRAM_BITS)
+
+	// Minimum number of commands each worker thread must process before we split key generation across threads
+	#define RENDER_QUEUE_MIN_COMMANDS_PER_THREAD	2048
+
+
+	void RenderQueue::Initialize(MaterialTextureArrays const* materialTextureArrays /*= nullptr*/)
+	{
+		this->materialIDs.clear();
+
+		std::unordered_map<string, Material*> const& sceneMaterials = CoreEngine::GetSceneManager()->GetMaterials();
+		this->materialIDs.reserve(sceneMaterials.size());
+
+		vector<Material*> materials;
+		materials.reserve(sceneMaterials.size());
+		for (auto const& currentElement : sceneMaterials)
+		{
+			materials.push_back(currentElement.second);
+		}
+
+		if (materialTextureArrays != nullptr)
+		{
+			std::stable_sort(materials.begin(), materials.end(), [materialTextureArrays](Material* lhs, Material* rhs)
+			{
+				return materialTextureArrays->BatchIndex(lhs) < materialTextureArrays->BatchIndex(rhs);
+			});
+		}
+
+		for (unsigned int i = 0; i < (unsigned int)materials.size(); i++)
+		{
+			// Material IDs only need to group identical materials; IDs beyond the field width wrap around
+			uint16_t materialID = (uint16_t)(i & ((1 << RENDER_QUEUE_MATERIAL_BITS) - 1));
+			this->materialIDs[materials[i]] = materialID;
+		}
+
+		vector<Mesh*> const* meshes = CoreEngine::GetSceneManager()->GetRenderMeshes(nullptr);
+		this->commands.reserve(meshes->size());
+		this->sortedIndices.reserve(meshes->size());
+		this->scratchIndices.reserve(meshes->size());
+	}
+
+
+	void RenderQueue::Build(RENDER_PASS renderPass, Camera* renderCam, vector<Mesh*> const& meshes, Shader* shaderOverride /*= nullptr*/)
+	{
+		this->commands.clear();
+
+		// Gather commands:
+		// Note: Transform::Model() lazily recomputes dirty hierarchies, so model matrices must be resolved on this thread
+		unsigned int numMeshes = (unsigned int)meshes.size();
+		for (unsigned int i = 0; i < numMeshes; i++)
+		{
+			Mesh* currentMesh = meshes[i];
+
+			Material* currentMaterial = currentMesh->MeshMaterial();
+			if (currentMaterial == nullptr)
+			{
+				continue;
+			}
+
+			RenderCommand newCommand;
+			newCommand.mesh		= currentMesh;
+			newCommand.material	= currentMaterial;
+			newCommand.shader	= shaderOverride != nullptr ? shaderOverride : currentMaterial->GetShader();
+			newCommand.model	= currentMesh->GetTransform().Model();
+
+			this->commands.emplace_back(newCommand);
+		}
+
+		// Compute the sort keys, in parallel if there's enough work:
+		mat4 const& view	= renderCam->View();
+		float nearDist		= renderCam->Near();
+		float farDist		= renderCam->Far();
+
+		size_t numCommands	= this->commands.size();
+		size_t numThreads	= this->workerPool == nullptr ? 1 :
+			glm::min<size_t>(this->workerPool->NumThreads(), numCommands / RENDER_QUEUE_MIN_COMMANDS_PER_THREAD);
+		if (numThreads > 1)
+		{
+			size_t commandsPerThread = (numCommands + numThreads - 1) / numThreads;
+
+			this->workerPool->ParallelFor((unsigned int)numThreads, [&](unsigned int currentThread)
+			{
+				size_t first	= currentThread * commandsPerThread;
+				size_t last		= glm::min(first + commandsPerThread, numCommands);
+
+				ComputeSortKeys(first, last, renderPass, view, nearDist, farDist);
+			});
+		}
+		else
+		{
+			ComputeSortKeys(0, numCommands, renderPass, view, nearDist, farDist);
+		}
+
+		// Sort:
+		this->sortedIndices.resize(numCommands);
+		for (size_t i = 0; i < numCommands; i++)
+		{
+			this->sortedIndices[i] = (uint32_t)i;
+		}
+
+		RadixSort();
+	}
+
+
+	void RenderQueue::ComputeSortKeys(size_t first, size_t last, RENDER_PASS renderPass, mat4 const& view, float nearDist, float farDist)
+	{
+		const uint64_t programMask	= (1ull << RENDER_QUEUE_PROGRAM_BITS) - 1;
+		const uint64_t geometryMask	= (1ull << RENDER_QUEUE_GEOMETRY_BITS) - 1;
+		const float maxDepthValue	= (float)((1 << RENDER_QUEUE_DEPTH_BITS) - 1);
+
+		for (size_t i = first; i < last; i++)
+		{
+			RenderCommand& currentCommand = this->commands[i];
+
+			// Shader programs and meshes are identified by their (small, sequentially allocated) OpenGL object names:
+			uint64_t programID	= currentCommand.shader->ShaderReference() & programMask;
+			uint64_t geometryID	= currentCommand.mesh->VAO() & geometryMask;
+
+			uint64_t materialID	= (1ull << RENDER_QUEUE_MATERIAL_BITS) - 1; // Materials added after Initialize() sort last
+			auto result = this->materialIDs.find(currentCommand.material);
+			if (result != this->materialIDs.end())
+			{
+				materialID = result->second;
+			}
+
+			// Depth-only passes don't bind materials, and bind the shared position-only stream: Sort purely front-to-back to
+			// maximize early-z rejection in the passes that follow
+			if (renderPass == RENDER_PASS_DEPTH_PREPASS)
+			{
+				materialID = 0;
+				geometryID = 0;
+			}
+
+			// Quantize the view-space depth of the mesh bounds center. Depth sits above the geometry ID, so smaller keys are closer
+			// within each material, giving front-to-back ordering:
+			Bounds const& localBounds	= currentCommand.mesh->localBounds;
+			vec4 localCenter			= vec4
+			(
+				(localBounds.xMin + localBounds.xMax) * 0.5f,
+				(localBounds.yMin + localBounds.yMax) * 0.5f,
+				(localBounds.zMin + localBounds.zMax) * 0.5f,
+				1.0f
+			);
+			float viewDepth				= -(view * (currentCommand.model * localCenter)).z; // Camera looks down -Z
+			float normalizedDepth		= glm::clamp((viewDepth - nearDist) / (farDist - nearDist), 0.0f, 1.0f);
+			uint64_t depthValue			= (uint64_t)(normalizedDepth * maxDepthValue);
+
+			currentCommand.sortKey =
+				((uint64_t)renderPass	<< RENDER_QUEUE_PASS_SHIFT)		|
+				(programID				<< RENDER_QUEUE_PROGRAM_SHIFT)	|
+				(materialID				<< RENDER_QUEUE_MATERIAL_SHIFT)	|
+				(depthValue				<< RENDER_QUEUE_DEPTH_SHIFT)	|
+				(geometryID				<< RENDER_QUEUE_GEOMETRY_SHIFT);
+		}
+	}
+
+
+	void RenderQueue::RadixSort()
+	{
+		size_t numIndices = this->sortedIndices.size();
+		if (numIndices < 2)
+		{
+			return;
+		}
+
+		this->scratchIndices.resize(numIndices);
+
+		for (int currentShift = 0; currentShift < 64; currentShift += 8)
+		{
+			// Build a histogram of the current digit:
+			size_t counts[256];
+			memset(counts, 0, sizeof(counts));
+			for (size_t i = 0; i < numIndices; i++)
+			{
+				counts[(this->commands[this->sortedIndices[i]].sortKey >> currentShift) & 0xFF]++;
+			}
+
+			// Skip passes where every key has the same digit:
+			uint64_t firstDigit = (this->commands[this->sortedIndices[0]].sortKey >> currentShift) & 0xFF;
+			if (counts[firstDigit] == numIndices)
+			{
+				continue;
+			}
+
+			// Convert counts to starting offsets:
+			size_t offset = 0;
+			for (int digit = 0; digit < 256; digit++)
+			{
+				size_t count	= counts[digit];
+				counts[digit]	= offset;
+				offset			+= count;
+			}
+
+			// Stable scatter:
+			for (size_t i = 0; i < numIndices; i++)
+			{
+				uint32_t currentIndex = this->sortedIndices[i];
+				this->scratchIndices[counts[(this->commands[currentIndex].sortKey >> currentShift) & 0xFF]++] = currentIndex;
+			}
+
+			this->sortedIndices.swap(this->scratchIndices);
+		}
+	}
+}
@@ -0,0 +1,92 @@
+// Render queue
+// Collects the draw calls for a render pass, tags each with a packed 64-bit sort key, and radix sorts them for submission.
+// Sort key layout (MSB -> LSB):	| Pass (4) | Shader program (12) | Material (16) | Quantized depth (16) | Geometry (16) |
+// Within a material, draws are ordered front-to-back. Geometry only groups draws of the same mesh at the same quantized depth
+
+#pragma once
+
+#include <GL/glew.h>
+
+#include "glm.hpp"
+
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+using glm::mat4;
+using std::vector;
+using std::unordered_map;
+
+
+namespace BlazeEngine
+{
+	// Pre-declarations:
+	class Mesh;
+	class Material;
+	class Shader;
+	class Camera;
+	class MaterialTextureArrays;
+	class WorkerPool;
+
+
+	// Render passes. Occupy the most significant bits of the sort key, so passes never interleave
+	enum RENDER_PASS
+	{
+		RENDER_PASS_GBUFFER,
+		RENDER_PASS_FORWARD,
+		RENDER_PASS_DEPTH_PREPASS,	// Depth only: Sorted front-to-back, ignoring material and geometry
+
+		RENDER_PASS_COUNT		// RESERVED: Number of render passes. Must be <= 16
+	};
+
+
+	// A single draw call
+	struct RenderCommand
+	{
+		uint64_t	sortKey		= 0;
+
+		Mesh*		mesh		= nullptr;
+		Material*	material	= nullptr;
+		Shader*		shader		= nullptr;
+
+		mat4		model		= mat4(1.0f);	// Cached world-space model matrix
+	};
+
+
+	class RenderQueue
+	{
+	public:
+		// workerPool: Splits the sort key computation of large queues across threads. Not owned. If null, keys are computed serially
+		RenderQueue(WorkerPool* workerPool = nullptr) : workerPool(workerPool) {}
+
+		// Assign compact sort key IDs to the materials of the currently loaded scene. Must be called after a scene is loaded.
+		// If materialTextureArrays is not null, IDs are assigned batch by batch, so materials sharing texture arrays draw consecutively
+		void Initialize(MaterialTextureArrays const* materialTextureArrays = nullptr);
+
+		// Fill the queue with a command for each of the (visible) meshes, then sort it.
+		// If shaderOverride is not null, it is used for every command instead of the mesh material's shader
+		void Build(RENDER_PASS renderPass, Camera* renderCam, vector<Mesh*> const& meshes, Shader* shaderOverride = nullptr);
+
+		// Sorted commands, valid until the next call to Build()
+		inline unsigned int				NumCommands() const					{ return (unsigned int)sortedIndices.size(); }
+		inline RenderCommand const&		GetCommand(unsigned int index) const { return commands[sortedIndices[index]]; }
+
+
+	private:
+		vector<RenderCommand>	commands;
+		vector<uint32_t>		sortedIndices;	// Indexes into commands, in sorted order
+		vector<uint32_t>		scratchIndices;	// Radix sort ping-pong buffer
+
+		unordered_map<Material*, uint16_t> materialIDs;	// Material sort key IDs. Written by Initialize() only, so Build() may read it from multiple threads
+
+		WorkerPool* workerPool = nullptr;	// Owned by the RenderManager
+
+		// Compute the sort keys for commands [first, last). Only reads shared state, so disjoint ranges can be processed concurrently
+		void ComputeSortKeys(size_t first, size_t last, RENDER_PASS renderPass, mat4 const& view, float nearDist, float farDist);
+
+		// LSD radix sort of sortedIndices by command sort key, 8 bits per pass. Passes where every key has the same digit are skipped
+		void RadixSort();
+	};
+}
+
+
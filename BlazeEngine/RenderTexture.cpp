@@ -2,6 +2,7 @@
 #include "CoreEngine.h"
 #include "BuildConfiguration.h"
 #include "Material.h"
+#include "GLState.h"
 
 
 namespace BlazeEngine
@@ -24,6 +25,7 @@ namespace BlazeEngine
 
 		this->texturePath			= name;
 
+		delete[] this->texels;			// Render textures live on the GPU only: Free the Texture() default allocation
 		this->texels				= nullptr;
 		this->resolutionHasChanged	= true;
 
@@ -31,7 +33,7 @@ namespace BlazeEngine
 		//-------------------------
 		this->internalFormat		= GL_DEPTH_COMPONENT32F;
 		this->format				= GL_DEPTH_COMPONENT;
-		this->type					= GL_FLOAT; // Same as Texture...
+		this->type					= GL_FLOAT;
 		
 		this->textureWrapS			= GL_CLAMP_TO_EDGE; // NOTE: Mandatory for non-power-of-two textures
 		this->textureWrapT			= GL_CLAMP_TO_EDGE;
@@ -125,6 +127,7 @@ namespace BlazeEngine
 		Texture::Destroy();
 
 		glDeleteFramebuffers(1, &frameBufferObject);
+		GLState::Instance().OnFramebufferDeleted(frameBufferObject);
 	}
 
 
@@ -167,7 +170,7 @@ namespace BlazeEngine
 
 			// Cleanup:
 			this->BindFramebuffer(false);
-			glBindTexture(this->texTarget, 0);
+			GLState::Instance().BindTexture(textureUnit, this->texTarget, 0);
 
 			return result;
 		}
@@ -233,7 +236,7 @@ namespace BlazeEngine
 		}
 
 		// Cleanup:
-		glBindTexture(cubeFaceRTs[0]->texTarget, 0); // Was still bound from Texture::BufferCubeMap()
+		GLState::Instance().BindTexture(textureUnit, cubeFaceRTs[0]->texTarget, 0); // Was still bound from Texture::BufferCubeMap()
 		cubeFaceRTs[0]->BindFramebuffer(false);
 
 		return result;
@@ -284,11 +287,11 @@ namespace BlazeEngine
 	{
 		if (doBind)
 		{
-			glBindFramebuffer(GL_FRAMEBUFFER, this->frameBufferObject);
+			GLState::Instance().BindFramebuffer(this->frameBufferObject);
 		}
 		else
 		{
-			glBindFramebuffer(GL_FRAMEBUFFER, 0);
+			GLState::Instance().BindFramebuffer(0);
 		}
 	}
 
@@ -17,6 +17,8 @@
 #include "Skybox.h"
 #include "Scene.h"
 #include "Shader.h"
+#include "TextureCompressor.h"
+#include "MaterialTextureArrays.h"
 
 
 #include "glm.hpp"
@@ -36,12 +38,53 @@ using glm::pi;
 #include <algorithm>
 #include <string>
 #include <stdio.h>
+#include <thread>
+#include <atomic>
+#include <functional>
 
 #define INVALID_TEXTURE_PATH "InvalidTexturePath"
 
 
 namespace BlazeEngine
 {
+	namespace
+	{
+		// Texture paths are compared case insensitively, with either separator: Exported scenes mix them, and Windows doesn't care.
+		// The same path used with another encoding is a different texture
+		string TextureKey(string texturePath, TEXTURE_ENCODING encoding)
+		{
+			std::transform(texturePath.begin(), texturePath.end(), texturePath.begin(), ::tolower);
+			std::replace(texturePath.begin(), texturePath.end(), '/', '\\');
+			return texturePath + "|" + to_string(encoding);
+		}
+
+
+		// Identical contents with different encodings are different textures. Mixing the encoding into the content hash keeps the keys
+		// of one encoding distinct, and makes collisions between encodings as unlikely as collisions between contents
+		unsigned long long ContentKey(unsigned long long contentHash, TEXTURE_ENCODING encoding)
+		{
+			return contentHash ^ ((unsigned long long)encoding * 0x9E3779B97F4A7C15ull);
+		}
+
+
+		// Encoding of the textures imported into a material slot. Must match the formats ImportMaterialsAndTexturesFromScene() selects
+		TEXTURE_ENCODING SlotEncoding(aiTextureType textureType)
+		{
+			switch (textureType)
+			{
+			case aiTextureType_DIFFUSE:
+				return CoreEngine::GetCoreEngine()->GetConfig()->GetValue<bool>("useForwardRendering") ? TEXTURE_ENCODING_LINEAR : TEXTURE_ENCODING_SRGB_COLOR;
+
+			case aiTextureType_NORMALS:
+				return TEXTURE_ENCODING_NORMAL_MAP;
+
+			default:
+				return TEXTURE_ENCODING_LINEAR;
+			}
+		}
+	}
+
+
 	SceneManager::SceneManager() : EngineComponent("SceneManager")
 	{
 		
@@ -88,8 +131,8 @@ namespace BlazeEngine
 			this->materials.clear();
 		}
 
-		// Texture cleanup:
-		for (std::pair<string, Texture*> currentTexture : textures)
+		// Texture cleanup: Several paths can share a texture, so they're destroyed via their (unique) content keys
+		for (std::pair<unsigned long long, Texture*> currentTexture : texturesByHash)
 		{
 			if (currentTexture.second != nullptr)
 			{
@@ -98,6 +141,7 @@ namespace BlazeEngine
 				currentTexture.second = nullptr;
 			}
 		}
+		texturesByHash.clear();
 		textures.clear();
 	}
 
@@ -353,7 +397,7 @@ namespace BlazeEngine
 	}
 
 
-	void SceneManager::AddTexture(Texture*& newTexture)
+	void SceneManager::AddTexture(Texture*& newTexture, TEXTURE_ENCODING encoding /*= TEXTURE_ENCODING_LINEAR*/)
 	{
 		if (newTexture == nullptr)
 		{
@@ -361,8 +405,29 @@ namespace BlazeEngine
 			return;
 		}
 
+		// Textures loaded from a file are identified by the file's contents, and generated textures by their texels:
+		unsigned long long contentHash;
+		if (!Texture::HashFile(newTexture->TexturePath(), contentHash))
+		{
+			contentHash = newTexture->ContentHash();
+		}
+
+		AddTexture(newTexture, contentHash, encoding);
+	}
+
+
+	void SceneManager::AddTexture(Texture*& newTexture, unsigned long long contentHash, TEXTURE_ENCODING encoding)
+	{
+		if (newTexture == nullptr)
+		{
+			LOG_ERROR("Cannot add null texture to textures table");
+			return;
+		}
+
+		string textureKey = TextureKey(newTexture->TexturePath(), encoding);
+
 		// Check if the texture already exists:
-		unordered_map<string, Texture*>::const_iterator texturePosition = textures.find(newTexture->TexturePath());
+		unordered_map<string, Texture*>::const_iterator texturePosition = textures.find(textureKey);
 		if (texturePosition != textures.end())
 		{
 			LOG_WARNING("Cannot add texture with an identical path. Deleting duplicate, and updating reference");
@@ -371,11 +436,27 @@ namespace BlazeEngine
 			delete newTexture;
 
 			newTexture = texturePosition->second;
+			return;
 		}
-		else // Insert the new texture:
+
+		// Share an identical texture with the same encoding under the new path:
+		unsigned long long contentKey = ContentKey(contentHash, encoding);
+		unordered_map<unsigned long long, Texture*>::const_iterator hashPosition = texturesByHash.find(contentKey);
+		if (hashPosition != texturesByHash.end())
 		{
-			textures[newTexture->TexturePath()] = newTexture;
+			LOG("Texture \"" + newTexture->TexturePath() + "\" is identical to \"" + hashPosition->second->TexturePath() + "\". Sharing it");
+
+			newTexture->Destroy();
+			delete newTexture;
+
+			newTexture				= hashPosition->second;
+			textures[textureKey]	= newTexture;
+			return;
 		}
+
+		// Insert the new texture:
+		textures[textureKey]			= newTexture;
+		texturesByHash[contentKey]		= newTexture;
 	}
 	
 	
@@ -536,11 +617,14 @@ namespace BlazeEngine
 	}
 
 
-	Texture* BlazeEngine::SceneManager::FindLoadTextureByPath(string texturePath, bool loadIfNotFound /*= true*/)
+	Texture* BlazeEngine::SceneManager::FindLoadTextureByPath(string texturePath, bool loadIfNotFound /*= true*/, TEXTURE_ENCODING encoding /*= TEXTURE_ENCODING_LINEAR*/)
 	{
-		// NOTE: Potential bug here: Since we store textureUnit per-texture, we can only share textures that live in the same slot. TODO: Move texture units into the Material?
+		// Note: Texture units are chosen when binding, but a texture's GPU format depends on its slot: Albedo is sRGB (and compressed
+		// to sRGB BC1/BC3/BC7), normal maps are compressed to BC5, and other data is linear. Textures that are already buffered aren't
+		// converted again, so textures are only shared between slots with the same encoding
+		string textureKey = TextureKey(texturePath, encoding);
 
-		unordered_map<string, Texture*>::const_iterator texturePosition = textures.find(texturePath);
+		unordered_map<string, Texture*>::const_iterator texturePosition = textures.find(textureKey);
 		if (texturePosition != textures.end())
 		{
 			LOG("Texture at path " + texturePath + " has already been loaded");
@@ -550,10 +634,42 @@ namespace BlazeEngine
 		// If we've made it this far, load the texture
 		if (loadIfNotFound)
 		{
-			Texture* result = Texture::LoadTextureFileFromPath(texturePath);
+			// Identical images under other paths are only decoded once: Hash the file before decoding it
+			unsigned long long contentHash	= 0;
+			bool hasContentHash				= Texture::HashFile(texturePath, contentHash);
+			if (hasContentHash)
+			{
+				unordered_map<unsigned long long, Texture*>::const_iterator hashPosition = texturesByHash.find(ContentKey(contentHash, encoding));
+				if (hashPosition != texturesByHash.end())
+				{
+					LOG("Texture at path " + texturePath + " is identical to \"" + hashPosition->second->TexturePath() + "\". Sharing it");
+					textures[textureKey] = hashPosition->second;
+					return hashPosition->second;
+				}
+			}
+
+			// Prefer an up to date block compressed container over decoding the source image:
+			Texture* result = nullptr;
+			if (CoreEngine::GetCoreEngine()->GetConfig()->GetValue<bool>("useTextureCompression"))
+			{
+				result = Texture::LoadTextureContainerFromPath(texturePath, CoreEngine::GetCoreEngine()->GetConfig()->GetValue<int>("textureCompressionQuality"));
+			}
+
+			if (result == nullptr)
+			{
+				result = Texture::LoadTextureFileFromPath(texturePath);
+			}
 			if (result != nullptr)
 			{
-				AddTexture(result);
+				// Note: If the file couldn't be hashed, the result is an error texture
+				if (hasContentHash)
+				{
+					AddTexture(result, contentHash, encoding);
+				}
+				else
+				{
+					AddTexture(result, encoding);
+				}
 			}
 			return result;
 		}
@@ -569,6 +685,9 @@ namespace BlazeEngine
 		int numMaterials = scene->mNumMaterials;
 		LOG("\nFound " + to_string(numMaterials) + " scene materials:");
 
+		// Decode the scene's textures in parallel, before the materials are assembled:
+		PreloadSceneTextures(scene, sceneName);
+
 		// Create Blaze Engine materials:
 		for (int currentMaterial = 0; currentMaterial < numMaterials; currentMaterial++)
 		{
@@ -618,9 +737,9 @@ namespace BlazeEngine
 					newMaterial->AccessTexture(TEXTURE_ALBEDO) = diffuseTexture;
 
 					// Set the diffuse texture's internal format to be encoded in sRGB color space, so OpenGL will apply gamma correction: (ie. color = pow(color, 2.2) )
-					if (CoreEngine::GetCoreEngine()->GetConfig()->GetValue<bool>("useForwardRendering") == false) // We don't do this in forward rendering, since we don't currently support tone mapping
+					if (CoreEngine::GetCoreEngine()->GetConfig()->GetValue<bool>("useForwardRendering") == false && !diffuseTexture->IsCompressed()) // We don't do this in forward rendering, since we don't currently support tone mapping
 					{
-						diffuseTexture->InternalFormat() = GL_SRGB8_ALPHA8;
+						diffuseTexture->InternalFormat() = GL_SRGB8_ALPHA8;	// Note: Compressed textures select their sRGB variant in CompressMaterialTexture()
 					}
 
 					// DOES THIS WORK??? SHOULD I BE DOING THIS, OR JUST HANDLING IT IN THE SHADER?!?!?!!?!?!?!?
@@ -746,12 +865,8 @@ namespace BlazeEngine
 					{
 						for (int currentTexture = 0; currentTexture < newMaterial->NumTextureSlots(); currentTexture++)
 						{
-							if (newMaterial->AccessTexture((TEXTURE_TYPE)currentTexture) != nullptr)
-							{
-								newMaterial->AccessTexture((TEXTURE_TYPE)currentTexture)->Destroy();
-								delete newMaterial->AccessTexture((TEXTURE_TYPE)currentTexture);
-								newMaterial->AccessTexture((TEXTURE_TYPE)currentTexture) = nullptr;
-							}
+							// Note: The textures are owned by (and may be shared via) the textures table, so they're not destroyed here
+							newMaterial->AccessTexture((TEXTURE_TYPE)currentTexture) = nullptr;
 						}
 
 						// Assign a pink error albedo texture:
@@ -761,9 +876,11 @@ namespace BlazeEngine
 						{
 							newMaterial->AccessTexture(TEXTURE_ALBEDO) = new Texture(1, 1, errorTextureName, true, vec4(1.0f, 0.0f, 1.0f, 1.0f));
 
-							if (newMaterial->AccessTexture(TEXTURE_ALBEDO)->Buffer(TEXTURE_0 + TEXTURE_ALBEDO))
+							// Add the texture before buffering it, so an identical texture is shared rather than uploaded again:
+							AddTexture(newMaterial->AccessTexture(TEXTURE_ALBEDO));
+							if (newMaterial->AccessTexture(TEXTURE_ALBEDO)->TextureID() == 0)
 							{
-								AddTexture(newMaterial->AccessTexture(TEXTURE_ALBEDO));
+								newMaterial->AccessTexture(TEXTURE_ALBEDO)->Buffer(TEXTURE_0 + TEXTURE_ALBEDO);
 							}
 						}
 					}
@@ -772,6 +889,24 @@ namespace BlazeEngine
 					newMaterial->GetShader()->UploadUniform(Material::MATERIAL_PROPERTY_NAMES[MATERIAL_PROPERTY_0].c_str(), &newMaterial->Property(MATERIAL_PROPERTY_0).x, UNIFORM_Vec4fv); // Upload matProperty0
 				}
 				
+				// Compress the textures before they're buffered, so they're uploaded as is:
+				for (int i = 0; i < newMaterial->NumTextureSlots(); i++)
+				{
+					Texture* currentTexture = newMaterial->AccessTexture((TEXTURE_TYPE)i);
+					if (currentTexture != nullptr)
+					{
+						bool isSRGB = i == TEXTURE_ALBEDO && CoreEngine::GetCoreEngine()->GetConfig()->GetValue<bool>("useForwardRendering") == false;
+						CompressMaterialTexture(currentTexture, isSRGB, i == TEXTURE_NORMAL);
+
+						// Streamed textures start with only their mip tail resident. The TextureStreamer loads the finer levels on demand.
+						// Material texture arrays copy whole textures, so aren't streamed:
+						if (CoreEngine::GetCoreEngine()->GetConfig()->GetValue<bool>("useTextureStreaming") && !MaterialTextureArrays::IsEnabled() && currentTexture->HasContainer() && currentTexture->TextureID() == 0)
+						{
+							currentTexture->SetResidentLevel(currentTexture->MipLevelForSize(CoreEngine::GetCoreEngine()->GetConfig()->GetValue<int>("textureStreamingTailSize")));
+						}
+					}
+				}
+
 				// Buffer all of the textures:
 				newMaterial->BufferAllTextures(TEXTURE_0);
 
@@ -790,7 +925,7 @@ namespace BlazeEngine
 			}
 		}
 
-		LOG("\nLoaded a total of " + to_string(textures.size()) + " textures (including error textures)\n");
+		LOG("\nLoaded a total of " + to_string(texturesByHash.size()) + " unique textures from " + to_string(textures.size()) + " paths (including error textures)\n");
 	}
 
 
@@ -800,9 +935,161 @@ namespace BlazeEngine
 	}
 
 
+	void SceneManager::PreloadSceneTextures(aiScene const* scene, string sceneName)
+	{
+		string sceneRoot = CoreEngine::GetCoreEngine()->GetConfig()->GetValue<string>("sceneRoot") + sceneName + "\\";
+
+		// Gather the unique path and encoding pairs ExtractLoadTextureFromAiMaterial() will load:
+		const aiTextureType slotTypes[] = { aiTextureType_DIFFUSE, aiTextureType_NORMALS, aiTextureType_EMISSIVE, aiTextureType_SPECULAR };
+
+		vector<string> texturePaths;
+		vector<TEXTURE_ENCODING> encodings;
+		unordered_map<string, unsigned int> pathIndexes; // Normalized path and encoding -> index in texturePaths
+		for (unsigned int currentMaterial = 0; currentMaterial < scene->mNumMaterials; currentMaterial++)
+		{
+			for (aiTextureType currentType : slotTypes)
+			{
+				aiString path;
+				if (scene->mMaterials[currentMaterial]->GetTexture(currentType, 0, &path) != AI_SUCCESS || path.length == 0)
+				{
+					continue;
+				}
+
+				string texturePath			= sceneRoot + string(path.C_Str());
+				TEXTURE_ENCODING encoding	= SlotEncoding(currentType);
+				string textureKey			= TextureKey(texturePath, encoding);
+				if (textures.find(textureKey) == textures.end() && pathIndexes.find(textureKey) == pathIndexes.end())
+				{
+					pathIndexes[textureKey] = (unsigned int)texturePaths.size();
+					texturePaths.push_back(texturePath);
+					encodings.push_back(encoding);
+				}
+			}
+		}
+
+		if (texturePaths.empty())
+		{
+			return;
+		}
+
+		// Config values are read here, as workers shouldn't touch the engine:
+		bool const useTextureCompression	= CoreEngine::GetCoreEngine()->GetConfig()->GetValue<bool>("useTextureCompression");
+		int const compressionQuality		= CoreEngine::GetCoreEngine()->GetConfig()->GetValue<int>("textureCompressionQuality");
+
+		// Run a job on the calling thread and the worker threads. Times vary a lot between images, so each job takes the next index
+		// from a shared counter rather than a fixed band:
+		unsigned int numThreads = glm::max(glm::min<unsigned int>(std::thread::hardware_concurrency(), (unsigned int)texturePaths.size()), 1u);
+		auto RunOnWorkers = [numThreads](unsigned int numItems, std::function<void(unsigned int)> const& job)
+		{
+			std::atomic<unsigned int> nextItem(0);
+			auto RunJobs = [&]()
+			{
+				for (unsigned int i = nextItem++; i < numItems; i = nextItem++)
+				{
+					job(i);
+				}
+			};
+
+			vector<std::thread> workers;
+			workers.reserve(numThreads - 1);
+			for (unsigned int currentThread = 1; currentThread < numThreads; currentThread++)
+			{
+				workers.emplace_back(RunJobs);
+			}
+
+			RunJobs(); // The calling thread works too
+
+			for (size_t i = 0; i < workers.size(); i++)
+			{
+				workers[i].join();
+			}
+		};
+
+		// Hash the files, so identical images under different paths are only decoded once:
+		vector<unsigned long long> contentHashes(texturePaths.size(), 0);
+		vector<char> hasContentHash(texturePaths.size(), false);	// Note: Not vector<bool>, as workers write neighbouring elements
+		RunOnWorkers((unsigned int)texturePaths.size(), [&](unsigned int i)
+		{
+			hasContentHash[i] = Texture::HashFile(texturePaths[i], contentHashes[i]);
+		});
+
+		vector<unsigned int> decodeIndexes;							// Paths with contents (and encodings) we haven't seen
+		unordered_map<unsigned long long, unsigned int> firstPaths;	// Content key -> first path in texturePaths with it
+		vector<unsigned int> duplicateIndexes;
+		for (unsigned int i = 0; i < (unsigned int)texturePaths.size(); i++)
+		{
+			if (!hasContentHash[i])
+			{
+				continue; // Left for the importer to report
+			}
+
+			unsigned long long contentKey = ContentKey(contentHashes[i], encodings[i]);
+
+			unordered_map<unsigned long long, Texture*>::const_iterator hashPosition = texturesByHash.find(contentKey);
+			if (hashPosition != texturesByHash.end())
+			{
+				textures[TextureKey(texturePaths[i], encodings[i])] = hashPosition->second;
+			}
+			else if (firstPaths.find(contentKey) != firstPaths.end())
+			{
+				duplicateIndexes.push_back(i);
+			}
+			else
+			{
+				firstPaths[contentKey] = i;
+				decodeIndexes.push_back(i);
+			}
+		}
+
+		// Decode each unique image:
+		vector<Texture*> results(decodeIndexes.size(), nullptr);
+		RunOnWorkers((unsigned int)decodeIndexes.size(), [&](unsigned int i)
+		{
+			string const& texturePath = texturePaths[decodeIndexes[i]];
+
+			// Prefer an up to date block compressed container over decoding the source image, as FindLoadTextureByPath() does:
+			if (useTextureCompression)
+			{
+				results[i] = Texture::LoadTextureContainerFromPath(texturePath, compressionQuality);
+			}
+			if (results[i] == nullptr)
+			{
+				results[i] = Texture::LoadTextureFileFromPath(texturePath, false);
+			}
+		});
+
+		// Add the results on this thread, as the textures table isn't thread safe:
+		unsigned int numLoaded = 0;
+		for (size_t i = 0; i < results.size(); i++)
+		{
+			if (results[i] != nullptr)
+			{
+				AddTexture(results[i], contentHashes[decodeIndexes[i]], encodings[decodeIndexes[i]]);
+				numLoaded++;
+			}
+		}
+
+		// Point the duplicate paths at the textures decoded for their contents:
+		for (unsigned int i = 0; i < (unsigned int)duplicateIndexes.size(); i++)
+		{
+			unsigned int duplicateIndex = duplicateIndexes[i];
+
+			unordered_map<unsigned long long, Texture*>::const_iterator hashPosition = texturesByHash.find(ContentKey(contentHashes[duplicateIndex], encodings[duplicateIndex]));
+			if (hashPosition != texturesByHash.end())
+			{
+				textures[TextureKey(texturePaths[duplicateIndex], encodings[duplicateIndex])] = hashPosition->second;
+			}
+		}
+
+		LOG("Preloaded " + to_string(numLoaded) + " scene textures for " + to_string(texturePaths.size()) + " paths (" + to_string(duplicateIndexes.size()) + 
+			" duplicates) using " + to_string(numThreads) + " threads");
+	}
+
+
 	Texture* BlazeEngine::SceneManager::ExtractLoadTextureFromAiMaterial(aiTextureType textureType, aiMaterial* material, string sceneName)
 	{
-		Texture* newTexture = nullptr;
+		Texture* newTexture			= nullptr;
+		TEXTURE_ENCODING encoding	= SlotEncoding(textureType);
 	
 		// Create 1x1 texture fallbacks:
 		int textureCount = material->GetTextureCount(textureType);
@@ -829,7 +1116,7 @@ namespace BlazeEngine
 			}
 			else if (textureType == aiTextureType_NORMALS)
 			{
-				newTexture = FindTextureByNameInAiMaterial("normal", material, sceneName); // Try and find any likely texture in the material
+				newTexture = FindTextureByNameInAiMaterial("normal", material, sceneName, encoding); // Try and find any likely texture in the material
 
 				if (newTexture == nullptr)
 				{
@@ -844,7 +1131,7 @@ namespace BlazeEngine
 			}
 			else if (textureType == aiTextureType_EMISSIVE)
 			{
-				newTexture = FindTextureByNameInAiMaterial("emissive", material, sceneName);
+				newTexture = FindTextureByNameInAiMaterial("emissive", material, sceneName, encoding);
 				if (newTexture == nullptr)
 				{
 					aiColor4D color;
@@ -878,7 +1165,7 @@ namespace BlazeEngine
 				int currentName = 0;
 				while (currentName < NUM_NAMES && newTexture == nullptr)
 				{
-					newTexture = FindTextureByNameInAiMaterial(possibleNames[currentName], material, sceneName);
+					newTexture = FindTextureByNameInAiMaterial(possibleNames[currentName], material, sceneName, encoding);
 
 					currentName++;
 				}
@@ -915,18 +1202,19 @@ namespace BlazeEngine
 			if (newTexture == nullptr)
 			{
 				// Try and find an already loaded version of our fallback texture
-				newTexture = FindLoadTextureByPath(newName, false);
+				newTexture = FindLoadTextureByPath(newName, false, encoding);
 
 				// None exists, so create one:
 				if (newTexture == nullptr)
 				{
-					newTexture = new Texture(1, 1, newName, true, newColor); // NOTE: Since we're storing the texUnit per-texture, we need unique textures incase they're in different slots...
+					newTexture = new Texture(1, 1, newName, true, newColor);
 
-					if (newTexture->Buffer(texUnit))
+					// Add the texture to our collection before buffering it: Fallbacks with the same color and encoding share a texture
+					this->AddTexture(newTexture, encoding);
+					if (newTexture->TextureID() == 0)
 					{
-						// Add the texture to our collection:
-						this->AddTexture(newTexture);
-					}				
+						newTexture->Buffer(texUnit);
+					}
 				}
 			}
 
@@ -951,7 +1239,7 @@ namespace BlazeEngine
 			#endif
 
 			// Find the texture if it has already been loaded, or load it otherwise:
-			newTexture = FindLoadTextureByPath(texturePath);
+			newTexture = FindLoadTextureByPath(texturePath, true, encoding);
 		}
 		else
 		{
@@ -960,14 +1248,65 @@ namespace BlazeEngine
 
 		if (newTexture == nullptr)
 		{
-			newTexture = FindLoadTextureByPath(INVALID_TEXTURE_PATH);
+			newTexture = FindLoadTextureByPath(INVALID_TEXTURE_PATH, true, encoding);
 		}
 
 		return newTexture; // Note: Texture is currently unbuffered
 	}
 
 
-	Texture* SceneManager::FindTextureByNameInAiMaterial(string nameSubstring, aiMaterial* material, string sceneName)
+	void SceneManager::CompressMaterialTexture(Texture* texture, bool isSRGB, bool isNormalMap)
+	{
+		// Textures already on the GPU are either shared with a previous slot with the same encoding, or 1x1 fallbacks that aren't worth compressing:
+		if (CoreEngine::GetCoreEngine()->GetConfig()->GetValue<bool>("useTextureCompression") == false || texture->TextureID() != 0)
+		{
+			return;
+		}
+
+		int quality = CoreEngine::GetCoreEngine()->GetConfig()->GetValue<int>("textureCompressionQuality");
+
+		if (texture->IsCompressed())
+		{
+			// Loaded from a container: Its contents determined the format, but it might have been encoded for a different slot
+			GLenum format			= texture->InternalFormat();
+			bool isNormalFormat		= format == GL_COMPRESSED_RG_RGTC2;
+			bool hasSRGBVariant		= format != GL_COMPRESSED_RED_RGTC1 && format != GL_COMPRESSED_RG_RGTC2 && format != GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT;
+			if (isNormalFormat == isNormalMap && (!hasSRGBVariant || TextureCompressor::IsSRGBFormat(format) == isSRGB))
+			{
+				return;
+			}
+
+			LOG_WARNING("Texture container for \"" + texture->TexturePath() + "\" was encoded for a different material slot. Re-encoding");
+
+			Texture* source = Texture::LoadTextureFileFromPath(texture->TexturePath(), false);
+			if (source == nullptr)
+			{
+				return;
+			}
+
+			if (TextureCompressor::Compress(source, texture, TextureCompressor::SelectFormat(source, quality, isNormalMap), quality, isSRGB, isNormalMap))
+			{
+				texture->WriteTextureContainer(quality);
+			}
+
+			source->Destroy();
+			delete source;
+			return;
+		}
+
+		if (texture->Width() < TEXTURE_COMPRESSOR_BLOCK_SIZE || texture->Height() < TEXTURE_COMPRESSOR_BLOCK_SIZE)
+		{
+			return;
+		}
+
+		if (TextureCompressor::Compress(texture, texture, TextureCompressor::SelectFormat(texture, quality, isNormalMap), quality, isSRGB, isNormalMap))
+		{
+			texture->WriteTextureContainer(quality);
+		}
+	}
+
+
+	Texture* SceneManager::FindTextureByNameInAiMaterial(string nameSubstring, aiMaterial* material, string sceneName, TEXTURE_ENCODING encoding)
 	{
 		std::transform(nameSubstring.begin(), nameSubstring.end(), nameSubstring.begin(), ::tolower);
 
@@ -987,7 +1326,7 @@ namespace BlazeEngine
 					string sceneRoot = CoreEngine::GetCoreEngine()->GetConfig()->GetValue<string>("sceneRoot") + sceneName + "\\";
 					string texturePath = sceneRoot + string(path.C_Str());
 					
-					return FindLoadTextureByPath(texturePath);					
+					return FindLoadTextureByPath(texturePath, true, encoding);
 				}
 			}
 		}
@@ -1441,13 +1780,24 @@ namespace BlazeEngine
 					shadowCamConfig.orthoBottom		= transformedBounds.yMin;
 					shadowCamConfig.orthoTop		= transformedBounds.yMax;
 
+					// Cascades are packed into the shadow map as a 2x2 grid of tiles. 2 cascades only need the top half:
+					int numCascades					= CoreEngine::GetCoreEngine()->GetConfig()->GetValue<int>("numShadowCascades");
+					int shadowMapHeight				= CoreEngine::GetCoreEngine()->GetConfig()->GetValue<int>("defaultShadowMapHeight");
+					if (numCascades == 2)
+					{
+						shadowMapHeight /= 2;
+					}
+
 					ShadowMap* keyLightShadowMap	= new ShadowMap // TEMP: We assume the key light will ALWAYS have a shadow
 					(
 						lightName,
 						CoreEngine::GetCoreEngine()->GetConfig()->GetValue<int>("defaultShadowMapWidth"),
-						CoreEngine::GetCoreEngine()->GetConfig()->GetValue<int>("defaultShadowMapHeight"),
+						shadowMapHeight,
 						shadowCamConfig,
-						&currentScene->keyLight->GetTransform()
+						&currentScene->keyLight->GetTransform(),
+						vec3(0.0f, 0.0f, 0.0f),
+						false,
+						numCascades
 					);
 
 					currentScene->keyLight->ActiveShadowMap(keyLightShadowMap);
@@ -1523,6 +1873,7 @@ namespace BlazeEngine
 				float shadowCamNear		= CoreEngine::GetCoreEngine()->GetConfig()->GetValue<float>("defaultNear");
 				int shadowCubeWidth		= CoreEngine::GetCoreEngine()->GetConfig()->GetValue<int>("defaultShadowCubeMapthWidth");
 				int shadowCubeHeight	= CoreEngine::GetCoreEngine()->GetConfig()->GetValue<int>("defaultShadowCubeMapthHeight");
+				string shadowModeName	= CoreEngine::GetCoreEngine()->GetConfig()->GetValue<string>("defaultPointShadowMode");
 
 				// Get ready to compute point light radius, if required:
 				float radius				= 1.0f;
@@ -1549,6 +1900,12 @@ namespace BlazeEngine
 					lightNode->mMetaData->Get("maxShadowBias",	maxShadowBias);
 					lightNode->mMetaData->Get("near",			shadowCamNear);
 
+					aiString importedShadowMode;
+					if (lightNode->mMetaData->Get("shadowMode", importedShadowMode))
+					{
+						shadowModeName = string(importedShadowMode.C_Str());
+					}
+
 					bool gotWidth	= lightNode->mMetaData->Get("shadowWidth",	shadowCubeWidth);
 					bool gotHeight	= lightNode->mMetaData->Get("shadowHeight",	shadowCubeHeight);
 					if ((gotWidth || gotHeight) && shadowCubeWidth != shadowCubeHeight)
@@ -1610,6 +1967,13 @@ namespace BlazeEngine
 
 				if (pointType == LIGHT_POINT)
 				{
+					POINT_SHADOW_MODE pointShadowMode = ShadowMap::GetPointShadowMode(shadowModeName);
+					if (pointShadowMode == POINT_SHADOW_MODE_COUNT)
+					{
+						LOG_WARNING("Invalid point shadow mode \"" + shadowModeName + "\". Using geometry shader point shadows");
+						pointShadowMode = POINT_SHADOW_GEOMETRY_SHADER;
+					}
+
 					// Create a cube shadow map:
 					CameraConfig shadowCamConfig;
 					shadowCamConfig.fieldOfView		= 90.0f;
@@ -1630,7 +1994,9 @@ namespace BlazeEngine
 						shadowCamConfig,
 						&pointLight->GetTransform(),
 						vec3(0.0f, 0.0f, 0.0f),		// Default value
-						true
+						true,
+						0,							// No cascades
+						pointShadowMode
 					);
 
 					cubeShadowMap->MinShadowBias() = minShadowBias; // Extracted from the .FBX metadata above
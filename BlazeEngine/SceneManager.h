@@ -35,6 +35,18 @@ namespace BlazeEngine
 	enum CAMERA_TYPE;
 
 
+	// GPU encoding of a texture's texels, which depends on the material slot it is used in. Textures are only shared between slots
+	// with the same encoding
+	enum TEXTURE_ENCODING
+	{
+		TEXTURE_ENCODING_LINEAR,		// Data (eg. RMAO, emissive), forward rendering albedo, and HDR images
+		TEXTURE_ENCODING_SRGB_COLOR,	// Deferred albedo: sRGB (compressed) formats
+		TEXTURE_ENCODING_NORMAL_MAP,	// Two channel normal map formats (eg. BC5)
+
+		TEXTURE_ENCODING_COUNT	// RESERVED: Number of texture encodings
+	};
+
+
 	// Scene Manager: Manages scenes
 	class SceneManager : public EngineComponent, public EventListener
 	{
@@ -75,8 +87,8 @@ namespace BlazeEngine
 		Camera*									GetMainCamera();
 		void									RegisterCamera(CAMERA_TYPE cameraType, Camera* newCamera);;
 
-		void									AddTexture(Texture*& newTexture); // If duplicate texture exists, it will be deleted and the newTexture pointer updated to the correct address
-		Texture*								FindLoadTextureByPath(string texturePath, bool loadIfNotFound = true);	// Find if a texture if it exists, or try and load it if it doesn't. Returns nullptr if file isn't/can't be loaded
+		void									AddTexture(Texture*& newTexture, TEXTURE_ENCODING encoding = TEXTURE_ENCODING_LINEAR); // If a texture with the same path or contents and encoding exists, newTexture will be deleted and the pointer updated to the existing texture
+		Texture*								FindLoadTextureByPath(string texturePath, bool loadIfNotFound = true, TEXTURE_ENCODING encoding = TEXTURE_ENCODING_LINEAR);	// Find if a texture if it exists, or try and load it if it doesn't. Returns nullptr if file isn't/can't be loaded
 
 		vector<Light*> const&					GetDeferredLights();
 
@@ -101,7 +113,11 @@ namespace BlazeEngine
 		//---------------------
 		unordered_map<string, Material*> materials;	// Hash table of scene Material pointers
 
-		unordered_map<string, Texture*> textures;	// Hash table of scene Texture pointers
+		unordered_map<string, Texture*> textures;	// Hash table of scene Texture pointers, by normalized path and encoding. Paths to identical images share a Texture
+		unordered_map<unsigned long long, Texture*> texturesByHash;	// Every scene Texture (once), by content hash and encoding: Owns the textures
+
+		// Add a texture with a known content hash (Eg. of its source file). See AddTexture(Texture*&, TEXTURE_ENCODING)
+		void				AddTexture(Texture*& newTexture, unsigned long long contentHash, TEXTURE_ENCODING encoding);
 
 		void				AddMaterial(Material*& newMaterial);	// Add a material to the material array. Note: Material name MUST be unique
 
@@ -115,12 +131,20 @@ namespace BlazeEngine
 		// Assimp scene material and texture import helper:
 		void			ImportMaterialsAndTexturesFromScene(aiScene const* scene, string sceneName);
 
+		// Decode the textures in the material slots of every scene material on worker threads, and add them to the textures table
+		// so they're found when the materials are imported. Textures that fail to load are left for the importer to report
+		void			PreloadSceneTextures(aiScene const* scene, string sceneName);
+
 		// Import and configure scene skybox:
 		void			ImportSky(string sceneName);
 		
 		// Assimp scene texture import helper:
 		Texture*		ExtractLoadTextureFromAiMaterial(aiTextureType textureType, aiMaterial* material, string sceneName);
-		Texture*		FindTextureByNameInAiMaterial(string nameSubstring, aiMaterial* material, string sceneName);
+		Texture*		FindTextureByNameInAiMaterial(string nameSubstring, aiMaterial* material, string sceneName, TEXTURE_ENCODING encoding);
+
+		// Block compress a material texture, using its cached container if it is up to date, or encoding (and caching) it otherwise.
+		// Does nothing if "useTextureCompression" is disabled
+		void			CompressMaterialTexture(Texture* texture, bool isSRGB, bool isNormalMap);
 
 		// Assimp scene material property helper:
 		bool			ExtractPropertyFromAiMaterial(aiMaterial* material, vec4& targetProperty, char const* AI_MATKEY_TYPE, int unused0 = 0, int unused1 = 0); // NOTE: unused0/unused1 are required to match #defined macros
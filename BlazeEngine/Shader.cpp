@@ -4,9 +4,11 @@
 #include "CoreEngine.h"
 #include "BuildConfiguration.h"
 #include "Material.h"
+#include "GLState.h"
 
 
 #include <fstream>
+#include <cstring>
 using std::ifstream;
 
 
@@ -34,76 +36,177 @@ namespace BlazeEngine
 	{
 		this->shaderName		= existingShader.shaderName;
 		this->shaderReference	= existingShader.shaderReference;
+		this->uniforms			= existingShader.uniforms;
+		this->uniformIndices	= existingShader.uniformIndices;
 	}
 
 
 	void Shader::Destroy()
 	{
 		glDeleteProgram(this->shaderReference);
+		GLState::Instance().OnProgramDeleted(this->shaderReference);
 		this->shaderReference = 0;
+
+		this->uniforms.clear();
+		this->uniformIndices.clear();
 	}
 
 
-		void Shader::UploadUniform(GLchar const* uniformName, void const* value, UNIFORM_TYPE const& type, int count /*= 1*/)
+	UniformHandle Shader::GetUniformHandle(GLchar const* uniformName, UNIFORM_TYPE const& type) const
 	{
-		GLint currentProgram;
-		bool isBound = true;	// Track if the current shader is bound or not
-		glGetIntegerv(GL_CURRENT_PROGRAM, &currentProgram);
-		if (currentProgram != this->shaderReference)
+		UniformHandle handle;
+		handle.type = type;
+
+		auto const& result = this->uniformIndices.find(uniformName);
+		if (result == this->uniformIndices.end())
 		{
-			glUseProgram(this->shaderReference);
-			isBound = false;
+			return handle;	// Inactive or unknown uniform: Return an invalid handle
 		}
 
-		GLuint uniformID = glGetUniformLocation(this->shaderReference, uniformName);
-		if (uniformID >= 0)
+		if (!IsCompatibleUniformType(type, this->uniforms[result->second].glType))
 		{
-			switch (type)
-			{
-			case UNIFORM_Matrix4fv:
-				glUniformMatrix4fv(uniformID, count, GL_FALSE, (GLfloat const*)value);
-				break;
+			LOG_ERROR("Shader \"" + this->shaderName + "\" uniform \"" + string(uniformName) + "\" does not match the requested UNIFORM_TYPE. Returning an invalid handle");
+			return handle;
+		}
+
+		handle.index = result->second;
+
+		return handle;
+	}
+
+
+	void Shader::UploadUniform(GLchar const* uniformName, void const* value, UNIFORM_TYPE const& type, int count /*= 1*/)
+	{
+		auto const& result = this->uniformIndices.find(uniformName);
+		if (result != this->uniformIndices.end())
+		{
+			UploadUniformInternal(result->second, value, type, count);
+		}
+	}
+
+
+	void Shader::UploadUniform(UniformHandle const& uniformHandle, void const* value, int count /*= 1*/)
+	{
+		if (uniformHandle.IsValid() && uniformHandle.index < (int)this->uniforms.size())
+		{
+			UploadUniformInternal(uniformHandle.index, value, uniformHandle.type, count);
+		}
+	}
 
-			case UNIFORM_Matrix3fv:
-				glUniformMatrix3fv(uniformID, count, GL_FALSE, (GLfloat const*)value);
-				break;
 
-			case UNIFORM_Vec3fv:
-				glUniform3fv(uniformID, count, (GLfloat const*)value);
-				break;
+	void Shader::UploadUniformInternal(int uniformIndex, void const* value, UNIFORM_TYPE const& type, int count)
+	{
+		ShaderUniform& uniform = this->uniforms[uniformIndex];
+
+		// Skip redundant uploads: Compare against the shadow copy of the last value we uploaded
+		size_t const numBytes = UniformTypeSize(type) * (size_t)count;
+		if (uniform.shadowValue.size() == numBytes && memcmp(uniform.shadowValue.data(), value, numBytes) == 0)
+		{
+			return;
+		}
+		uniform.shadowValue.assign((GLubyte const*)value, (GLubyte const*)value + numBytes);
+
+		switch (type)
+		{
+		case UNIFORM_Matrix4fv:
+			glProgramUniformMatrix4fv(this->shaderReference, uniform.location, count, GL_FALSE, (GLfloat const*)value);
+			break;
 
-			case UNIFORM_Vec4fv:
-				glUniform4fv(uniformID, count, (GLfloat const*)value);
-				break;
+		case UNIFORM_Matrix3fv:
+			glProgramUniformMatrix3fv(this->shaderReference, uniform.location, count, GL_FALSE, (GLfloat const*)value);
+			break;
+
+		case UNIFORM_Vec2fv:
+			glProgramUniform2fv(this->shaderReference, uniform.location, count, (GLfloat const*)value);
+			break;
+
+		case UNIFORM_Vec3fv:
+			glProgramUniform3fv(this->shaderReference, uniform.location, count, (GLfloat const*)value);
+			break;
+
+		case UNIFORM_Vec4fv:
+			glProgramUniform4fv(this->shaderReference, uniform.location, count, (GLfloat const*)value);
+			break;
 			
-			case UNIFORM_Float:
-				glUniform1f(uniformID, *(GLfloat const*)value);
-				break;
+		case UNIFORM_Float:
+			glProgramUniform1f(this->shaderReference, uniform.location, *(GLfloat const*)value);
+			break;
 
-			case UNIFORM_Int:
-				glUniform1i(uniformID, *(GLint const*)value);
-				break;
+		case UNIFORM_Int:
+			glProgramUniform1i(this->shaderReference, uniform.location, *(GLint const*)value);
+			break;
 
-			default:
-				LOG_ERROR("Shader uniform upload failed: Recieved unimplemented uniform type");
-			}
+		default:
+			LOG_ERROR("Shader uniform upload failed: Recieved unimplemented uniform type");
+			uniform.shadowValue.clear();
 		}
+	}
+
+
+	void Shader::ReflectUniforms()
+	{
+		this->uniforms.clear();
+		this->uniformIndices.clear();
 
-		if (!isBound)
+		GLint numUniforms	= 0;
+		GLint maxNameLength	= 0;
+		glGetProgramInterfaceiv(this->shaderReference, GL_UNIFORM, GL_ACTIVE_RESOURCES, &numUniforms);
+		glGetProgramInterfaceiv(this->shaderReference, GL_UNIFORM, GL_MAX_NAME_LENGTH, &maxNameLength);
+
+		this->uniforms.reserve(numUniforms);
+		vector<GLchar> nameBuffer(maxNameLength + 1, '\0');
+
+		GLenum const properties[]	= { GL_LOCATION, GL_TYPE, GL_ARRAY_SIZE };
+		const int NUM_PROPERTIES	= 3;
+
+		for (GLint currentUniform = 0; currentUniform < numUniforms; currentUniform++)
 		{
-			glUseProgram(currentProgram);
+			GLint values[NUM_PROPERTIES];
+			glGetProgramResourceiv(this->shaderReference, GL_UNIFORM, currentUniform, NUM_PROPERTIES, properties, NUM_PROPERTIES, nullptr, values);
+
+			// Uniform block members don't have a location, and can't be uploaded individually:
+			if (values[0] < 0)
+			{
+				continue;
+			}
+
+			GLsizei nameLength = 0;
+			glGetProgramResourceName(this->shaderReference, GL_UNIFORM, currentUniform, (GLsizei)nameBuffer.size(), &nameLength, nameBuffer.data());
+			string uniformName(nameBuffer.data(), nameLength);
+
+			ShaderUniform newUniform;
+			newUniform.location		= values[0];
+			newUniform.glType		= (GLenum)values[1];
+			newUniform.arraySize	= values[2];
+
+			int uniformIndex = (int)this->uniforms.size();
+			this->uniforms.push_back(newUniform);
+
+			this->uniformIndices[uniformName] = uniformIndex;
+
+			// Array uniforms are reported as "name[0]": Also map the base name, so arrays can be uploaded by name
+			const string ARRAY_SUFFIX = "[0]";
+			if (uniformName.length() > ARRAY_SUFFIX.length() && uniformName.compare(uniformName.length() - ARRAY_SUFFIX.length(), ARRAY_SUFFIX.length(), ARRAY_SUFFIX) == 0)
+			{
+				this->uniformIndices[uniformName.substr(0, uniformName.length() - ARRAY_SUFFIX.length())] = uniformIndex;
+			}
 		}
+
+		#if defined(DEBUG_SHADER_SETUP_LOGGING)
+			LOG("Reflected " + to_string(this->uniforms.size()) + " active uniforms for shader \"" + this->shaderName + "\"");
+		#endif
 	}
 
+
 	void Shader::Bind(bool doBind)
 	{
 		if (doBind)
 		{
-			glUseProgram(this->shaderReference);
+			GLState::Instance().UseProgram(this->shaderReference);
 		}
 		else
 		{
-			glUseProgram(0);
+			GLState::Instance().UseProgram(0);
 		}
 	}
 
@@ -240,50 +343,10 @@ namespace BlazeEngine
 		{
 			newShader = new Shader(shaderFileName, shaderReference);
 
-			// Initialize sampler locations:
-			newShader->Bind(true);
-
-			// Texture sampler locations. Note: These must align with the locations defined in Material.h
-			for (int currentTexture = 0; currentTexture < TEXTURE_COUNT; currentTexture++)
-			{
-				GLint samplerLocation = glGetUniformLocation(newShader->ShaderReference(), Material::TEXTURE_SAMPLER_NAMES[currentTexture].c_str());
-				if (samplerLocation >= 0)
-				{
-					glUniform1i(samplerLocation, (TEXTURE_TYPE)currentTexture);
-				}
-			}
-			// RenderTexture sampler locations:
-			for (int currentTexture = 0; currentTexture < RENDER_TEXTURE_COUNT; currentTexture++)
-			{
-				GLint samplerLocation = glGetUniformLocation(newShader->ShaderReference(), Material::RENDER_TEXTURE_SAMPLER_NAMES[currentTexture].c_str());
-				if (samplerLocation >= 0)
-				{
-					glUniform1i(samplerLocation, (int)(RENDER_TEXTURE_0 + (TEXTURE_TYPE)currentTexture));
-				}
-			}
-
-			// 2D shadow map textures sampler locations:
-			for (int currentTexture = 0; currentTexture < DEPTH_TEXTURE_COUNT; currentTexture++)
-			{
-				GLint samplerLocation = glGetUniformLocation(newShader->ShaderReference(), Material::DEPTH_TEXTURE_SAMPLER_NAMES[currentTexture].c_str());
-				if (samplerLocation >= 0)
-				{
-					glUniform1i(samplerLocation, DEPTH_TEXTURE_0 + (TEXTURE_TYPE)currentTexture);
-				}
-			}
-
-			// Cube map depth texture sampler locations
-			for (int currentCubeMap = 0; currentCubeMap < CUBE_MAP_COUNT; currentCubeMap++)
-			{
-				GLint samplerLocation = glGetUniformLocation(newShader->ShaderReference(), Material::CUBE_MAP_TEXTURE_SAMPLER_NAMES[currentCubeMap].c_str());
-				if (samplerLocation >= 0)
-				{
-					glUniform1i(samplerLocation, (TEXTURE_TYPE)(CUBE_MAP_0 + (currentCubeMap * CUBE_MAP_NUM_FACES)));
-				}
-			}
+			// Build our uniform location table:
+			newShader->ReflectUniforms();
 
-			// Cleanup:
-			newShader->Bind(false);
+			newShader->InitializeSamplerLocations();
 		}		
 
 		#if defined (DEBUG_SCENEMANAGER_SHADER_LOGGING)
@@ -293,6 +356,80 @@ namespace BlazeEngine
 		return newShader;
 	}
 
+
+	Shader* Shader::CreateComputeShader(string shaderFileName, vector<string> const* shaderKeywords /*= nullptr*/)
+	{
+		LOG("\nCreating compute shader \"" + shaderFileName + "\"");
+
+		string computeShader = LoadShaderFile(shaderFileName + ".comp");
+		if (computeShader == "")
+		{
+			LOG_ERROR("Creating compute shader \"" + shaderFileName + "\" failed while loading shader files. Returning nullptr");
+			return nullptr;
+		}
+
+		if (shaderKeywords != nullptr)
+		{
+			InsertDefines(computeShader, shaderKeywords);
+		}
+		LoadIncludes(computeShader);
+
+		GLuint shaderReference	= glCreateProgram();
+		GLuint shaderObject		= CreateGLShaderObject(computeShader, GL_COMPUTE_SHADER);
+
+		glAttachShader(shaderReference, shaderObject);
+		glLinkProgram(shaderReference);
+
+		bool shaderSuccess = CheckShaderError(shaderReference, GL_LINK_STATUS, true);
+
+		glDeleteShader(shaderObject);
+
+		if (!shaderSuccess)
+		{
+			LOG_ERROR("Linking compute shader \"" + shaderFileName + "\" failed. Returning nullptr");
+			glDeleteProgram(shaderReference);
+			return nullptr;
+		}
+
+		Shader* newShader = new Shader(shaderFileName, shaderReference);
+		newShader->ReflectUniforms();
+		newShader->InitializeSamplerLocations();
+
+		return newShader;
+	}
+
+
+	void Shader::InitializeSamplerLocations()
+	{
+		// Initialize sampler locations. Note: Uploaded directly to the program object, so we don't need to bind the shader
+		// Texture sampler locations. Note: These must align with the locations defined in Material.h
+		for (int currentTexture = 0; currentTexture < TEXTURE_COUNT; currentTexture++)
+		{
+			GLint textureUnit = (TEXTURE_TYPE)currentTexture;
+			UploadUniform(Material::TEXTURE_SAMPLER_NAMES[currentTexture].c_str(), &textureUnit, UNIFORM_Int);
+		}
+		// RenderTexture sampler locations:
+		for (int currentTexture = 0; currentTexture < RENDER_TEXTURE_COUNT; currentTexture++)
+		{
+			GLint textureUnit = (int)(RENDER_TEXTURE_0 + (TEXTURE_TYPE)currentTexture);
+			UploadUniform(Material::RENDER_TEXTURE_SAMPLER_NAMES[currentTexture].c_str(), &textureUnit, UNIFORM_Int);
+		}
+
+		// 2D shadow map textures sampler locations:
+		for (int currentTexture = 0; currentTexture < DEPTH_TEXTURE_COUNT; currentTexture++)
+		{
+			GLint textureUnit = DEPTH_TEXTURE_0 + (TEXTURE_TYPE)currentTexture;
+			UploadUniform(Material::DEPTH_TEXTURE_SAMPLER_NAMES[currentTexture].c_str(), &textureUnit, UNIFORM_Int);
+		}
+
+		// Cube map depth texture sampler locations
+		for (int currentCubeMap = 0; currentCubeMap < CUBE_MAP_COUNT; currentCubeMap++)
+		{
+			GLint textureUnit = (TEXTURE_TYPE)(CUBE_MAP_0 + (currentCubeMap * CUBE_MAP_NUM_FACES));
+			UploadUniform(Material::CUBE_MAP_TEXTURE_SAMPLER_NAMES[currentCubeMap].c_str(), &textureUnit, UNIFORM_Int);
+		}
+	}
+
 	Shader* BlazeEngine::Shader::ReturnErrorShader(string shaderName)
 	{
 		if (shaderName != CoreEngine::GetCoreEngine()->GetConfig()->GetValue<string>("errorShaderName"))
@@ -522,4 +659,66 @@ namespace BlazeEngine
 			return true;
 		}
 	}
+
+
+	size_t Shader::UniformTypeSize(UNIFORM_TYPE const& type)
+	{
+		switch (type)
+		{
+		case UNIFORM_Matrix4fv:
+			return sizeof(GLfloat) * 16;
+
+		case UNIFORM_Matrix3fv:
+			return sizeof(GLfloat) * 9;
+
+		case UNIFORM_Vec2fv:
+			return sizeof(GLfloat) * 2;
+
+		case UNIFORM_Vec3fv:
+			return sizeof(GLfloat) * 3;
+
+		case UNIFORM_Vec4fv:
+			return sizeof(GLfloat) * 4;
+
+		case UNIFORM_Float:
+			return sizeof(GLfloat);
+
+		case UNIFORM_Int:
+			return sizeof(GLint);
+
+		default:
+			return 0;
+		}
+	}
+
+
+	bool Shader::IsCompatibleUniformType(UNIFORM_TYPE const& type, GLenum glType)
+	{
+		switch (type)
+		{
+		case UNIFORM_Matrix4fv:
+			return glType == GL_FLOAT_MAT4;
+
+		case UNIFORM_Matrix3fv:
+			return glType == GL_FLOAT_MAT3;
+
+		case UNIFORM_Vec2fv:
+			return glType == GL_FLOAT_VEC2;
+
+		case UNIFORM_Vec3fv:
+			return glType == GL_FLOAT_VEC3;
+
+		case UNIFORM_Vec4fv:
+			return glType == GL_FLOAT_VEC4;
+
+		case UNIFORM_Float:
+			return glType == GL_FLOAT;
+
+		case UNIFORM_Int:
+			return glType == GL_INT || glType == GL_BOOL || glType == GL_SAMPLER_2D || glType == GL_SAMPLER_CUBE || glType == GL_SAMPLER_2D_SHADOW || glType == GL_SAMPLER_CUBE_SHADOW || glType == GL_SAMPLER_2D_ARRAY;
+
+		default:
+			return false;
+		}
+	}
 }
@@ -4,9 +4,11 @@
 
 #include <string>
 #include <vector>
+#include <unordered_map>
 
 using std::string;
 using std::vector;
+using std::unordered_map;
 
 
 namespace BlazeEngine
@@ -16,6 +18,7 @@ namespace BlazeEngine
 	{
 		UNIFORM_Matrix4fv,		// glUniformMatrix4fv
 		UNIFORM_Matrix3fv,		// glUniformMatrix3fv
+		UNIFORM_Vec2fv,			// glUniform2fv
 		UNIFORM_Vec3fv,			// glUniform3fv
 		UNIFORM_Vec4fv,			// glUniform4fv
 		UNIFORM_Float,			// glUniform1f
@@ -36,6 +39,16 @@ namespace BlazeEngine
 	}; // Note: If new enums are added, don't forget to update Shader::TEXTURE_SAMPLER_NAMES[] as well!
 
 
+	// Typed handle to a reflected shader uniform. Obtained via Shader::GetUniformHandle(), and only valid for the Shader that created it
+	struct UniformHandle
+	{
+		int				index	= -1;				// Index into the owning shader's reflected uniform table. -1 == inactive/unknown uniform
+		UNIFORM_TYPE	type	= UNIFORM_Float;	// Validated against the reflected GL type when the handle is created
+
+		inline bool IsValid() const { return index >= 0; }
+	};
+
+
 	class Shader
 	{
 	public:
@@ -51,7 +64,13 @@ namespace BlazeEngine
 		inline string const& Name()						{ return shaderName; }
 		inline GLuint const& ShaderReference() const	{ return shaderReference; }
 
+		// Get a typed handle to an active uniform. Returns an invalid handle if the uniform is inactive, or its type doesn't match
+		UniformHandle GetUniformHandle(GLchar const* uniformName, UNIFORM_TYPE const& type) const;
+
+		// Upload uniforms directly to the program object (via glProgramUniform*): The shader does not need to be bound.
+		// Uploads are skipped if the value matches the last value uploaded to the same uniform
 		void UploadUniform(GLchar const* uniformName, void const* value, UNIFORM_TYPE const& type, int count = 1);
+		void UploadUniform(UniformHandle const& uniformHandle, void const* value, int count = 1);
 
 		void Bind(bool doBind);
 
@@ -59,6 +78,9 @@ namespace BlazeEngine
 		//------------------
 		static Shader* CreateShader(string shaderFileName, vector<string> const*  shaderKeywords = nullptr);
 
+		// Create a compute shader from "shaderFileName.comp". Returns nullptr on failure (there's no error compute shader to fall back to)
+		static Shader* CreateComputeShader(string shaderFileName, vector<string> const* shaderKeywords = nullptr);
+
 
 		// Static members:
 		const static string SHADER_KEYWORDS[SHADER_KEYWORD_COUNT];
@@ -70,6 +92,27 @@ namespace BlazeEngine
 		string shaderName		= "uninitializedShader"; // Extensionless filename of the shader. Will have ".vert" / ".frag" appended
 		GLuint shaderReference	= 0;
 
+		// Uniforms reflected from the linked program:
+		struct ShaderUniform
+		{
+			GLint	location	= -1;
+			GLenum	glType		= GL_NONE;
+			GLint	arraySize	= 1;
+
+			vector<GLubyte> shadowValue;	// Copy of the last uploaded value. Empty until the first upload
+		};
+		vector<ShaderUniform>			uniforms;
+		unordered_map<string, int>		uniformIndices;	// Maps uniform names to indexes in uniforms. Array uniforms are mapped as both "name" and "name[0]"
+
+		// Populate the uniform table from the linked program object
+		void ReflectUniforms();
+
+		// Upload a value to a reflected uniform, if it differs from the shadow copy
+		void UploadUniformInternal(int uniformIndex, void const* value, UNIFORM_TYPE const& type, int count);
+
+		// Point the sampler uniforms at the texture units defined in Material.h
+		void InitializeSamplerLocations();
+
 
 		// Private static functions:
 		//--------------------------
@@ -89,6 +132,10 @@ namespace BlazeEngine
 		static GLuint	CreateGLShaderObject(const string& text, GLenum shaderType);
 		static bool		CheckShaderError(GLuint shader, GLuint flag, bool isProgram);
 
+		// Helper functions: Map UNIFORM_TYPE values to their size in bytes, and check them against reflected GL types
+		static size_t	UniformTypeSize(UNIFORM_TYPE const& type);
+		static bool		IsCompatibleUniformType(UNIFORM_TYPE const& type, GLenum glType);
+
 	};
 }
 
@@ -0,0 +1,87 @@
+#ifndef BLAZE_CLUSTERING
+#define BLAZE_CLUSTERING
+
+// Blaze Engine Clustered Lighting
+// Defines the light buffers and cluster (froxel) grid shared by the light assignment compute shader and the clustered lighting
+// pass. The view frustum is split into clusterGridSize.x * clusterGridSize.y screen tiles, and clusterGridSize.z exponential
+// depth slices
+//-------------------------------------------------------------------------------------------------------------------------------
+
+// Note: Bindings and layouts must match ClusteredLighting.h
+struct ClusterLight
+{
+	vec4	positionRadius;			// .xyz = World position, .w = Radius
+	vec3	color;
+	int		shadowIndex;			// Index into clusterShadows, or -1 if the light is unshadowed
+};
+
+struct ClusterShadow
+{
+	mat4	faceViewProjections[6];	// Cube faces only
+	vec4	tiles[6];				// Shadow atlas tiles: .xy = UV scale, .zw = UV offset
+	vec4	params;					// .x = Number of tiles (6 == cube, 2 == dual paraboloid), .y = Far, .z = Min bias, .w = Max bias
+};
+
+layout(std430, binding = 0) readonly buffer ClusterLightBuffer
+{
+	ClusterLight clusterLights[];
+};
+
+layout(std430, binding = 1) readonly buffer ClusterShadowBuffer
+{
+	ClusterShadow clusterShadows[];
+};
+
+#if defined(BLAZE_CLUSTER_ASSIGNMENT)
+	layout(std430, binding = 2) writeonly buffer ClusterLightCountBuffer
+	{
+		uint clusterLightCounts[];
+	};
+
+	layout(std430, binding = 3) writeonly buffer ClusterLightIndexBuffer
+	{
+		uint clusterLightIndices[];	// maxLightsPerCluster entries per cluster
+	};
+#else
+	layout(std430, binding = 2) readonly buffer ClusterLightCountBuffer
+	{
+		uint clusterLightCounts[];
+	};
+
+	layout(std430, binding = 3) readonly buffer ClusterLightIndexBuffer
+	{
+		uint clusterLightIndices[];	// maxLightsPerCluster entries per cluster
+	};
+#endif
+
+uniform int		numClusterLights;
+uniform vec4	clusterGridSize;		// .xyz = Clusters along each axis, .w = Max lights per cluster
+uniform vec4	clusterDepthParams;		// .x = Near, .y = Far, .z = Slices / log(far / near)
+
+
+// Get the depth slice containing a (positive) view-space depth
+int GetClusterSlice(float viewDepth)
+{
+	int slice = int(log(max(viewDepth, clusterDepthParams.x) / clusterDepthParams.x) * clusterDepthParams.z);
+	return clamp(slice, 0, int(clusterGridSize.z) - 1);
+}
+
+
+// Get the view-space depth of the near side of a depth slice
+float GetClusterSliceDepth(int slice)
+{
+	return clusterDepthParams.x * pow(clusterDepthParams.y / clusterDepthParams.x, float(slice) / clusterGridSize.z);
+}
+
+
+// Get the index of the cluster containing a fragment. screenUV = [0,1] screen position
+int GetClusterIndex(vec2 screenUV, float viewDepth)
+{
+	ivec3 gridSize	= ivec3(clusterGridSize.xyz);
+	ivec2 tile		= clamp(ivec2(screenUV * vec2(gridSize.xy)), ivec2(0), gridSize.xy - 1);
+
+	return (GetClusterSlice(viewDepth) * gridSize.y + tile.y) * gridSize.x + tile.x;
+}
+
+
+#endif
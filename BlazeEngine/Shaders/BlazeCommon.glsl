@@ -95,10 +95,18 @@ uniform mat4 in_inverse_vp;		// [Projection * View]^-1
 // NOTE: Binding locations must match the definitions in Material.h
 												// TEXTURE:								FBX MATERIAL SOURCE SLOT:
 												//---------								-------------------------
+#if defined(MATERIAL_TEXTURE_ARRAYS)
+// Material textures are layers of shared texture arrays. See MaterialTextureArrays.h
+layout(binding = 0) uniform sampler2DArray albedo;
+layout(binding = 1) uniform sampler2DArray normal;
+layout(binding = 2) uniform sampler2DArray RMAO;
+layout(binding = 3) uniform sampler2DArray emissive;
+#else
 layout(binding = 0) uniform sampler2D albedo;	// Albedo (RGB) + transparency (A)		Diffuse/color
 layout(binding = 1) uniform sampler2D normal;	// Tangent-space normals (RGB)			Bump
 layout(binding = 2) uniform sampler2D RMAO;		// Roughness, Metalic, albedo			Specular
 layout(binding = 3) uniform sampler2D emissive;	// Emissive (RGB)						Incandescence
+#endif
 
 
 
@@ -107,7 +115,7 @@ layout(binding = 4) uniform sampler2D GBuffer_Albedo;
 layout(binding = 5) uniform sampler2D GBuffer_WorldNormal;
 layout(binding = 6) uniform sampler2D GBuffer_RMAO;
 layout(binding = 7) uniform sampler2D GBuffer_Emissive;
-layout(binding = 8) uniform sampler2D GBuffer_WorldPos;
+layout(binding = 8) uniform sampler2D GBuffer_WorldPos;	// Unused: World positions are reconstructed from GBuffer_Depth
 layout(binding = 9) uniform sampler2D GBuffer_MatProp0;
 
 layout(binding = 10) uniform sampler2D	GBuffer_Depth;
@@ -133,6 +141,18 @@ uniform vec4		texelSize;				// Depth map/GBuffer texel size: .xyzw = (1/width, 1
 // Shadow map parameters:
 uniform mat4		shadowCam_vp;			// Shadow map: [Projection * View]
 
+// Cascaded shadow maps (key light):
+#define MAX_SHADOW_CASCADES 4				// Must match MAX_SHADOW_CASCADES in ShadowMap.h
+uniform int			numShadowCascades;		// 0 == Not cascaded: Use shadowCam_vp
+uniform mat4		shadowCascade_vp[MAX_SHADOW_CASCADES];
+uniform vec4		shadowCascadeSplits;	// View-space far distance of each cascade
+
+// Shadow map tiles (shadow cascades, or point light cube faces within the shadow atlas):
+#define MAX_SHADOW_MAP_TILES 6				// Must match MAX_SHADOW_MAP_TILES in ShadowMap.h
+uniform int			numShadowTiles;			// Point lights: 0 == No atlas tiles allocated: Unshadowed
+uniform vec4		shadowTiles[MAX_SHADOW_MAP_TILES];	// Tile in the shadow map: .xy = UV scale, .zw = UV offset
+uniform mat4		shadowCamCubeMap_vp[6];	// Point lights: [Projection * View] of each cube face, in cube map face order
+
 uniform float		maxShadowBias;			// Offsets for preventing shadow acne
 uniform float		minShadowBias;
 
@@ -152,9 +172,26 @@ uniform vec4		matProperty0;			// .rgb = F0 (Surface response at 0 degrees), .a =
 //uniform vec4		matProperty6;
 //uniform vec4		matProperty7;
 
+#if defined(MATERIAL_TEXTURE_ARRAYS) && defined(BLAZE_FRAGMENT_SHADER)
+// Material parameter buffer: Replaces matProperty0 and the per-material texture binds. Must match MaterialTextureArrays.cpp
+struct MaterialParameters
+{
+	ivec4 textureLayers;	// Array layer of the albedo, normal, RMAO and emissive textures
+	vec4 matProperty0;
+};
+
+layout(std430, binding = 4) readonly buffer MaterialParameterBuffer	// MATERIAL_PARAMETER_BUFFER_BINDING
+{
+	MaterialParameters materialParameters[];
+};
+
+uniform int materialIndex;	// Current material's element in materialParameters
+#endif
+
 
 // System variables:
-uniform vec4 screenParams;		// .x = xRes, .y = yRes, .z = 1/xRes, .w = 1/yRes
+uniform vec4 screenParams;		// .x = xRes, .y = yRes, .z = 1/xRes, .w = 1/yRes. The dynamic resolution viewport, for scene passes
+uniform vec2 renderScale = vec2(1.0);	// Fraction of the screen-sized render targets covered by the viewport: Scales screen UVs to target UVs
 //uniform vec4 zBufferParams;
 
 uniform vec3 cameraWorldPos;	// World-space camera position
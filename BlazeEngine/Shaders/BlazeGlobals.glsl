@@ -37,11 +37,18 @@ vec3 ObjectNormalFromTexture(mat3 TBN, vec3 textureNormal)
 }
 
 
+// Tangent space normals are rebuilt from their XY channels, so 2 channel (BC5) normal maps work as well as RGB ones
+vec3 DecodeTextureNormal(vec2 textureNormal)
+{
+	vec2 xy = (textureNormal * 2.0) - 1.0;	// Transform [0,1] -> [-1,1]
+
+	return vec3(xy, sqrt(max(1.0 - dot(xy, xy), 0.0)));
+}
+
+
 vec3 WorldNormalFromTexture(sampler2D normal, vec2 uv, mat3 TBN)
 {
-	vec3 textureNormal	= texture(normal, uv).xyz;
-	
-	textureNormal		= normalize((textureNormal * 2.0) - 1.0);	// Transform [0,1] -> [-1,1]
+	vec3 textureNormal	= DecodeTextureNormal(texture(normal, uv).xy);
 
 	vec3 result			= normalize(TBN * textureNormal);
 
@@ -49,6 +56,46 @@ vec3 WorldNormalFromTexture(sampler2D normal, vec2 uv, mat3 TBN)
 }
 
 
+// Octahedral normal encoding: Packs a unit vector into 2 channels, mapped to [0,1] for storage in a unorm texture
+vec2 EncodeOctahedralNormal(vec3 normal)
+{
+	normal		/= (abs(normal.x) + abs(normal.y) + abs(normal.z));
+
+	vec2 result	= normal.xy;
+	if (normal.z < 0.0)
+	{
+		// Fold the lower hemisphere over the diagonals:
+		result	= (1.0 - abs(normal.yx)) * vec2(normal.x >= 0.0 ? 1.0 : -1.0, normal.y >= 0.0 ? 1.0 : -1.0);
+	}
+
+	return (result * 0.5) + 0.5;
+}
+
+
+// Decode a normal packed with EncodeOctahedralNormal()
+vec3 DecodeOctahedralNormal(vec2 encoded)
+{
+	encoded		= (encoded * 2.0) - 1.0;
+
+	vec3 normal	= vec3(encoded.xy, 1.0 - abs(encoded.x) - abs(encoded.y));
+	float fold	= clamp(-normal.z, 0.0, 1.0);
+	normal.x	+= normal.x >= 0.0 ? -fold : fold;
+	normal.y	+= normal.y >= 0.0 ? -fold : fold;
+
+	return normalize(normal);
+}
+
+
+// Reconstruct a world-space position from a screen uv in [0,1], and a [0,1] depth buffer value
+vec4 WorldPositionFromDepth(vec2 uv, float depth, mat4 inverseViewProjection)
+{
+	vec4 ndcPosition	= vec4(vec3(uv, depth) * 2.0 - 1.0, 1.0);	// Note: Assumes the default glDepthRange(0, 1)
+	vec4 worldPosition	= inverseViewProjection * ndcPosition;
+
+	return vec4(worldPosition.xyz / worldPosition.w, 1.0);
+}
+
+
 // Convert a (normalized) view/cubemap direction to an equirectangular UV coordinate. Used to convert HDR maps to cubemaps
 vec2 DirectionToEquirectangularUV(vec3 view)
 {
@@ -95,14 +95,11 @@ vec3 HalfVector(vec3 light, vec3 view)
 
 
 // General PBR lighting: Called from specific deferred light shaders
-// FragColor = Non-linearized RGB
+// FragColor = Linear RGB (The sRGB GBuffer albedo is linearized when it's sampled)
 // lightWorldDir must be normalized
 // lightColor must have attenuation factored in
 vec4 ComputePBRLighting(vec4 FragColor, vec3 worldNormal, vec4 RMAO, vec4 worldPosition, vec3 F0, float NoL, vec3 lightWorldDir, vec3 lightViewDir, vec3 lightColor, float shadowFactor, mat4 in_view)
 {
-	// Convert non-linear RGB to linear:
-	FragColor.rgb = Degamma(FragColor.rgb);
-
 	vec4 viewPosition	= in_view * worldPosition;							// View-space position
 	vec3 viewEyeDir		= normalize(-viewPosition.xyz);						// View-space eye/camera direction
 	vec3 viewNormal		= normalize(in_view * vec4(worldNormal, 0)).xyz;	// View-space surface normal
@@ -191,9 +188,16 @@ float LightAttenuation(vec3 fragWorldPosition, vec3 lightWorldPosition)
 //---------------
 
 // Compute a depth map bias value based on surface orientation
+float GetSlopeScaleBias(float NoL, float minBias, float maxBias)
+{
+	return max( maxBias * (1.0 - NoL), minBias);
+}
+
+
+// Compute a depth map bias value for the current shadow map
 float GetSlopeScaleBias(float NoL)
 {
-	return max( maxShadowBias * (1.0 - NoL), minShadowBias);
+	return GetSlopeScaleBias(NoL, minShadowBias, maxShadowBias);
 }
 
 
@@ -233,27 +237,146 @@ float GetShadowFactor(vec3 shadowPos, sampler2D shadowMap, float NoL)
 }
 
 
-// Get shadow factor from a cube map:
-float GetShadowFactor(vec3 lightToFrag, samplerCube shadowMap, float NoL)
+// Find out if a fragment is in shadow, selecting the key light shadow cascade from the fragment's view depth.
+// Uses the single shadow map (and shadowPos) if the key light isn't cascaded
+float GetKeylightShadowFactor(vec4 worldPosition, vec3 shadowPos, sampler2D shadowMap, float NoL)
 {
-	float cubemapShadowDepth = texture(shadowMap, lightToFrag).r;
-	cubemapShadowDepth *= shadowCam_far;	// [0,1] -> [0, far]
+	if (numShadowCascades == 0)
+	{
+		return GetShadowFactor(shadowPos, shadowMap, NoL);
+	}
+
+	float viewDepth = -(in_view * worldPosition).z;
+
+	int cascade = 0;
+	while (cascade < numShadowCascades && viewDepth > shadowCascadeSplits[cascade])
+	{
+		cascade++;
+	}
+
+	if (cascade == numShadowCascades)
+	{
+		return 1.0; // Beyond the last cascade: Unshadowed
+	}
+
+	vec3 cascadePos		= (shadowCascade_vp[cascade] * worldPosition).xyz;
+	vec3 shadowScreen	= (cascadePos + 1.0) / 2.0; // Projection -> Screen/UV [0,1] space
+
+	// Compute a slope-scaled bias depth:
+	float biasedDepth	= shadowScreen.z - GetSlopeScaleBias(NoL);
 
-	float fragDepth = length(lightToFrag); // We're using linear depth, for now...
+	// Transform into the cascade's tile, and keep the samples from bleeding into neighbouring tiles:
+	vec4 tile			= shadowTiles[cascade];
+	vec2 tileMin		= tile.zw + (0.5 * texelSize.xy);
+	vec2 tileMax		= tile.zw + tile.xy - (0.5 * texelSize.xy);
+	vec2 tileUV			= shadowScreen.xy * tile.xy + tile.zw;
 
-	// Compute a slope-scaled bias:
-	float biasedDepth = fragDepth - GetSlopeScaleBias(NoL);
+	// 4x4 PCF, as per GetShadowFactor():
+	const int gridSize = 4;
+	const float offsetMultiplier = (float(gridSize) / 2.0) - 0.5;
+
+	float depthSum = 0;
+	for (int row = 0; row < gridSize; row++)
+	{
+		for (int col = 0; col < gridSize; col++)
+		{
+			vec2 sampleUV = tileUV + vec2(float(col) - offsetMultiplier, offsetMultiplier - float(row)) * texelSize.xy;
+
+			depthSum += (biasedDepth < texture(shadowMap, clamp(sampleUV, tileMin, tileMax)).r ? 1.0 : 0.0);
+		}
+	}
+
+	return depthSum / (gridSize * gridSize);
+}
 
-	// TODO: PCF cube map: (jitter the ray)
-	// https://www.gamedev.net/forums/topic/674852-pcf-in-cubemap/
 
-	float shadowFactor = 1.0;
-	if (biasedDepth > cubemapShadowDepth)
+// Point light shadows: Select the shadow atlas tile of a fragment. Point lights use either 6 cube face tiles (in cube map face
+// order: +X, -X, +Y, -Y, +Z, -Z), or 2 dual-paraboloid tiles (Z+, Z- hemispheres)
+int GetPointShadowTile(int numTiles, vec3 lightToFrag)
+{
+	if (numTiles == 2)
+	{
+		return lightToFrag.z >= 0.0 ? 0 : 1;
+	}
+
+	// Select the cube face from the major axis of the light -> fragment direction:
+	vec3 absDir = abs(lightToFrag);
+	if (absDir.x >= absDir.y && absDir.x >= absDir.z)
+	{
+		return lightToFrag.x >= 0.0 ? 0 : 1;
+	}
+	else if (absDir.y >= absDir.z)
 	{
-		shadowFactor = 0.0;
+		return lightToFrag.y >= 0.0 ? 2 : 3;
 	}
+	return lightToFrag.z >= 0.0 ? 4 : 5;
+}
+
+
+// Point light shadows: Project a light -> fragment direction onto its dual paraboloid tile (as per pointShadowDepthShader)
+vec2 GetParaboloidUV(vec3 lightToFrag)
+{
+	vec3 lightToFragDir	= normalize(lightToFrag);
+	lightToFragDir.z	= abs(lightToFragDir.z);
+
+	return ((lightToFragDir.xy / (1.0 + lightToFragDir.z)) + 1.0) / 2.0;
+}
+
+
+// Point light shadows: 2x2 PCF within a shadow atlas tile. Samples are clamped to the tile, so there's no filtering across
+// cube face/paraboloid edges. tileUV is the [0,1] position within the tile. biasedDepth and the stored depths are linear
+float SampleShadowAtlasTile(sampler2D shadowAtlas, vec4 tile, vec2 tileUV, float biasedDepth, float shadowCamFar)
+{
+	// Transform into the tile, and keep the samples from bleeding into neighbouring tiles:
+	vec2 tileMin		= tile.zw + (0.5 * texelSize.xy);
+	vec2 tileMax		= tile.zw + tile.xy - (0.5 * texelSize.xy);
+	vec2 atlasUV		= tileUV * tile.xy + tile.zw;
+
+	const int gridSize = 2;
+	const float offsetMultiplier = (float(gridSize) / 2.0) - 0.5;
+
+	float depthSum = 0;
+	for (int row = 0; row < gridSize; row++)
+	{
+		for (int col = 0; col < gridSize; col++)
+		{
+			vec2 sampleUV = atlasUV + vec2(float(col) - offsetMultiplier, offsetMultiplier - float(row)) * texelSize.xy;
+
+			float shadowDepth = texture(shadowAtlas, clamp(sampleUV, tileMin, tileMax)).r * shadowCamFar;	// [0,1] -> [0, far]
+
+			depthSum += (biasedDepth < shadowDepth ? 1.0 : 0.0);
+		}
+	}
+
+	return depthSum / (gridSize * gridSize);
+}
+
+
+// Get the shadow factor of the current point light, from the tiles it has been allocated in the shadow atlas
+float GetShadowFactor(vec4 worldPosition, vec3 lightToFrag, sampler2D shadowAtlas, float NoL)
+{
+	if (numShadowTiles == 0)
+	{
+		return 1.0; // No atlas tiles: Unshadowed
+	}
+
+	int tileIndex = GetPointShadowTile(numShadowTiles, lightToFrag);
+
+	vec2 tileUV;
+	if (numShadowTiles == 2)
+	{
+		tileUV = GetParaboloidUV(lightToFrag);
+	}
+	else
+	{
+		vec4 facePos	= shadowCamCubeMap_vp[tileIndex] * worldPosition;
+		tileUV			= ((facePos.xy / facePos.w) + 1.0) / 2.0; // Projection -> Screen/UV [0,1] space
+	}
+
+	// Compute a slope-scaled bias. We're using linear depth, for now...
+	float biasedDepth = length(lightToFrag) - GetSlopeScaleBias(NoL);
 
-	return shadowFactor;
+	return SampleShadowAtlasTile(shadowAtlas, shadowTiles[tileIndex], tileUV, biasedDepth, shadowCam_far);
 }
 
 
@@ -0,0 +1,122 @@
+#ifndef BLAZE_VISIBILITY
+#define BLAZE_VISIBILITY
+
+// Blaze Engine Visibility Buffer
+// Defines the visibility ID encoding shared by the visibility and resolve passes. The resolve pass fetches triangles directly from
+// the mesh vertex/index buffers, and reconstructs their attributes from analytic barycentrics
+//-------------------------------------------------------------------------------------------------------------------------------
+
+// Note: Must match VisibilityBuffer.h
+#define VISIBILITY_TRIANGLE_BITS	20
+#define VISIBILITY_TRIANGLE_MASK	((1u << VISIBILITY_TRIANGLE_BITS) - 1u)
+#define VISIBILITY_EMPTY			0xFFFFFFFFu
+
+uniform int instanceID;		// Index of the mesh being rendered/resolved
+
+
+#if defined(VISIBILITY_RESOLVE)
+
+// Mesh vertex layout, in floats: Must match the Vertex struct in Mesh.h
+#define VERTEX_STRIDE				32
+#define VERTEX_OFFSET_POSITION		0
+#define VERTEX_OFFSET_NORMAL		7
+#define VERTEX_OFFSET_TANGENT		10
+#define VERTEX_OFFSET_BITANGENT		13
+#define VERTEX_OFFSET_UV0			16
+
+layout(std430, binding = 0) readonly buffer MeshVertexBuffer
+{
+	float meshVertices[];
+};
+
+layout(std430, binding = 1) readonly buffer MeshIndexBuffer
+{
+	uint meshIndices[];
+};
+
+layout(binding = 19) uniform usampler2D visibilityBuffer;	// GENERIC_TEXTURE_7
+
+
+vec3 FetchVertexVec3(uint vertexIndex, int offset)
+{
+	uint base = vertexIndex * VERTEX_STRIDE + offset;
+	return vec3(meshVertices[base], meshVertices[base + 1], meshVertices[base + 2]);
+}
+
+
+vec4 FetchVertexVec4(uint vertexIndex, int offset)
+{
+	uint base = vertexIndex * VERTEX_STRIDE + offset;
+	return vec4(meshVertices[base], meshVertices[base + 1], meshVertices[base + 2], meshVertices[base + 3]);
+}
+
+
+// Perspective-correct barycentrics of a pixel within a triangle, and their screen-space derivatives (for texture LOD selection)
+struct Barycentrics
+{
+	vec3 lambda;
+	vec3 ddx;
+	vec3 ddy;
+};
+
+
+// clip0/1/2 = Clip-space triangle vertices, ndcPosition = Pixel center in NDC, resolution = Render target size in pixels
+Barycentrics ComputeBarycentrics(vec4 clip0, vec4 clip1, vec4 clip2, vec2 ndcPosition, vec2 resolution)
+{
+	Barycentrics result;
+
+	vec3 invW		= 1.0 / vec3(clip0.w, clip1.w, clip2.w);
+	vec2 ndc0		= clip0.xy * invW.x;
+	vec2 ndc1		= clip1.xy * invW.y;
+	vec2 ndc2		= clip2.xy * invW.z;
+
+	// Screen-space (ie. affine) barycentric gradients, pre-divided by w:
+	float invDet	= 1.0 / determinant(mat2(ndc2 - ndc1, ndc0 - ndc1));
+	vec3 ddx		= vec3(ndc1.y - ndc2.y, ndc2.y - ndc0.y, ndc0.y - ndc1.y) * invDet * invW;
+	vec3 ddy		= vec3(ndc2.x - ndc1.x, ndc0.x - ndc2.x, ndc1.x - ndc0.x) * invDet * invW;
+	float ddxSum	= dot(ddx, vec3(1.0));
+	float ddySum	= dot(ddy, vec3(1.0));
+
+	// Interpolate 1/w, and use it to recover the perspective-correct barycentrics:
+	vec2 delta			= ndcPosition - ndc0;
+	float interpInvW	= invW.x + delta.x * ddxSum + delta.y * ddySum;
+	float interpW		= 1.0 / interpInvW;
+
+	result.lambda.x		= interpW * (invW.x + delta.x * ddx.x + delta.y * ddy.x);
+	result.lambda.y		= interpW * (delta.x * ddx.y + delta.y * ddy.y);
+	result.lambda.z		= interpW * (delta.x * ddx.z + delta.y * ddy.z);
+
+	// Derivatives: Step 1 pixel in x/y (ie. 2 / resolution in NDC), and take the difference
+	ddx		*= 2.0 / resolution.x;
+	ddy		*= 2.0 / resolution.y;
+	ddxSum	*= 2.0 / resolution.x;
+	ddySum	*= 2.0 / resolution.y;
+
+	float interpW_ddx	= 1.0 / (interpInvW + ddxSum);
+	float interpW_ddy	= 1.0 / (interpInvW + ddySum);
+
+	result.ddx	= interpW_ddx * (result.lambda * interpInvW + ddx) - result.lambda;
+	result.ddy	= interpW_ddy * (result.lambda * interpInvW + ddy) - result.lambda;
+
+	return result;
+}
+
+
+vec3 Interpolate(Barycentrics bary, vec3 v0, vec3 v1, vec3 v2)
+{
+	return bary.lambda.x * v0 + bary.lambda.y * v1 + bary.lambda.z * v2;
+}
+
+
+// Interpolate a 2D attribute, and its screen-space derivatives
+vec2 Interpolate(Barycentrics bary, vec2 v0, vec2 v1, vec2 v2, out vec2 ddx, out vec2 ddy)
+{
+	ddx = bary.ddx.x * v0 + bary.ddx.y * v1 + bary.ddx.z * v2;
+	ddy = bary.ddy.x * v0 + bary.ddy.y * v1 + bary.ddy.z * v2;
+
+	return bary.lambda.x * v0 + bary.lambda.y * v1 + bary.lambda.z * v2;
+}
+
+#endif
+
+#endif
\ No newline at end of file
@@ -14,5 +14,5 @@
 
 void main()
 {	
-	FragColor = texture(GBuffer_Albedo, data.uv0.xy);
+	FragColor = texture(GBuffer_Albedo, data.uv0.xy * renderScale);
 } 
\ No newline at end of file
@@ -17,10 +17,32 @@
 
 uniform int maxMipLevel;	// Largest mip level in the PMREM cube map texture (CubeMap_1). Uploaded during ImageBasedLight setup
 
+// Diffuse irradiance as 3 bands of spherical harmonics, pre-scaled by the basis constants and the cosine lobe convolution. Uploaded
+// during ImageBasedLight setup. Must match IBL_SH_COEFFICIENT_COUNT
+uniform vec3 irradianceSH[9];
+
+
+// Evaluate the (cosine weighted mean) irradiance for a world-space normal
+vec3 IrradianceFromSH(vec3 n)
+{
+	return	irradianceSH[0] +
+			irradianceSH[1] * n.y +
+			irradianceSH[2] * n.z +
+			irradianceSH[3] * n.x +
+			irradianceSH[4] * (n.x * n.y) +
+			irradianceSH[5] * (n.y * n.z) +
+			irradianceSH[6] * (3.0 * n.z * n.z - 1.0) +
+			irradianceSH[7] * (n.x * n.z) +
+			irradianceSH[8] * (n.x * n.x - n.y * n.y);
+}
+
 void main()
 {	
+	vec2 targetUV			= data.uv0.xy * renderScale; // Screen -> GBuffer UVs
+
 	// Cull based on depth: Don't bother lighting unless the fragment is in front of the far plane (prevents ambient lighting of the far plane...)
-	if (texture( GBuffer_Depth, data.uv0.xy).r == 1.0)
+	float depth				= texture(GBuffer_Depth, targetUV).r;
+	if (depth == 1.0)
 	{
 		discard;
 	}
@@ -28,14 +50,13 @@ void main()
 	// TODO: Fix Ambient/Directional lights: Flip screen-aligned quad and render back faces (to be consistent with other deferred lights)
 
 
-	FragColor				= texture(GBuffer_Albedo, data.uv0.xy);		// Note: For PBR, we require all calculations to be performed in linear color
-	FragColor.rgb			= Degamma(FragColor.rgb);
+	FragColor				= texture(GBuffer_Albedo, targetUV);		// Note: For PBR, we require all calculations to be performed in linear color. Linearized by the sRGB GBuffer
 
 
-	vec3 worldNormal		= texture(GBuffer_WorldNormal, data.uv0.xy).xyz;
-	vec4 RMAO				= texture(GBuffer_RMAO, data.uv0.xy);
-	vec4 worldPosition		= texture(GBuffer_WorldPos, data.uv0.xy);
-	vec4 matProp0			= texture(GBuffer_MatProp0, data.uv0.xy);	// .rgb = F0 (Surface response at 0 degrees), .a = Phong exponent
+	vec3 worldNormal		= DecodeOctahedralNormal(texture(GBuffer_WorldNormal, targetUV).xy);
+	vec4 RMAO				= texture(GBuffer_RMAO, targetUV);
+	vec4 worldPosition		= WorldPositionFromDepth(data.uv0.xy, depth, in_inverse_vp);
+	vec4 matProp0			= texture(GBuffer_MatProp0, targetUV);	// .rgb = F0 (Surface response at 0 degrees), .a = Phong exponent
 
 	float AO				= RMAO.b;
 	float metalness			= RMAO.y;
@@ -53,8 +74,8 @@ void main()
 	vec3 fresnel_kS			= FresnelSchlick_Roughness(NoV, F0, RMAO.x);
 	vec3 k_d				= 1.0 - fresnel_kS;	
 
-	// Sample the diffuse irradiance from our prefiltered irradiance environment map:
-	vec3 irradiance			= texture(CubeMap_0, worldNormal).xyz * AO;
+	// Evaluate the diffuse irradiance from the spherical harmonics projection of the environment:
+	vec3 irradiance			= max(IrradianceFromSH(worldNormal), 0.0) * AO;
 
 
 	// Get the specular reflectance term:
@@ -75,10 +96,11 @@ void main()
 
 void main()
 {	
-	float AO = texture(GBuffer_RMAO, data.uv0.xy).b;
+	vec2 targetUV	= data.uv0.xy * renderScale; // Screen -> GBuffer UVs
+	float AO		= texture(GBuffer_RMAO, targetUV).b;
 
 	// Phong ambient contribution:
-	FragColor	= texture(GBuffer_Albedo, data.uv0.xy) * vec4(lightColor, 1) * AO;	
+	FragColor	= texture(GBuffer_Albedo, targetUV) * vec4(lightColor, 1) * AO;	
 }
 
 #endif
\ No newline at end of file
@@ -0,0 +1,92 @@
+#version 430 core
+
+#define BLAZE_FRAGMENT_SHADER
+#define BLAZE_VEC4_OUTPUT
+
+#include "BlazeCommon.glsl"
+#include "BlazeGlobals.glsl"
+#include "BlazeLighting.glsl"
+#include "BlazeClustering.glsl"
+
+// Built-in input variables:
+//layout(pixel_center_integer) in vec4 gl_FragCoord; //  Window space fragment location. (x,y,z,w) = window-relative (x,y,z,1/w)
+// in bool gl_FrontFacing;
+// in vec2 gl_PointCoord;
+
+in vec4 gl_FragCoord;
+
+
+// Clustered point lights: Shades every light assigned to the fragment's cluster in a single fullscreen pass
+void main()
+{	
+	vec2 uvs				= vec2(gl_FragCoord.x / screenParams.x, gl_FragCoord.y / screenParams.y); // [0, xRes/yRes] -> [0,1]
+	vec2 targetUV			= uvs * renderScale; // Screen -> GBuffer UVs
+
+	// Skip pixels without any geometry:
+	float depth				= texture(GBuffer_Depth, targetUV).r;
+	if (depth >= 1.0)
+	{
+		discard;
+	}
+	
+	// Sample textures once inside the main shader flow, and pass the values as required:
+	vec4 albedo				= texture(GBuffer_Albedo, targetUV);
+	vec3 worldNormal		= DecodeOctahedralNormal(texture(GBuffer_WorldNormal, targetUV).xy);
+	vec4 RMAO				= texture(GBuffer_RMAO, targetUV);
+	vec4 worldPosition		= WorldPositionFromDepth(uvs, depth, in_inverse_vp);
+	vec4 matProp0			= texture(GBuffer_MatProp0, targetUV); // .rgb = F0 (Surface response at 0 degrees), .a = Phong exponent
+
+	float viewDepth			= -(in_view * worldPosition).z;
+	int clusterIndex		= GetClusterIndex(uvs, viewDepth);
+
+	uint numLights			= clusterLightCounts[clusterIndex];
+	uint listOffset			= uint(clusterIndex) * uint(clusterGridSize.w);
+
+	vec3 totalLight			= vec3(0.0);
+	for (uint i = 0; i < numLights; i++)
+	{
+		ClusterLight light	= clusterLights[clusterLightIndices[listOffset + i]];
+		vec3 lightPosition	= light.positionRadius.xyz;
+
+		vec3 lightToFrag	= worldPosition.xyz - lightPosition;
+		float lightDist		= length(lightToFrag);
+		if (lightDist >= light.positionRadius.w)
+		{
+			continue; // Outside the light's volume
+		}
+
+		vec3 lightWorldDir	= -lightToFrag / max(lightDist, 0.00001);
+		vec3 lightViewDir	= normalize((in_view * vec4(lightWorldDir, 0.0)).xyz);
+		float NoL			= max(0.0, dot(worldNormal, lightWorldDir));
+
+		// Shadows, from the light's shadow atlas tiles:
+		float shadowFactor	= 1.0;
+		if (light.shadowIndex >= 0)
+		{
+			ClusterShadow shadow	= clusterShadows[light.shadowIndex];
+			int numTiles			= int(shadow.params.x);
+			int tileIndex			= GetPointShadowTile(numTiles, lightToFrag);
+
+			vec2 tileUV;
+			if (numTiles == 2)
+			{
+				tileUV = GetParaboloidUV(lightToFrag);
+			}
+			else
+			{
+				vec4 facePos	= shadow.faceViewProjections[tileIndex] * worldPosition;
+				tileUV			= ((facePos.xy / facePos.w) + 1.0) / 2.0; // Projection -> Screen/UV [0,1] space
+			}
+
+			float biasedDepth	= lightDist - GetSlopeScaleBias(NoL, shadow.params.z, shadow.params.w);
+			shadowFactor		= SampleShadowAtlasTile(shadowDepth, shadow.tiles[tileIndex], tileUV, biasedDepth, shadow.params.y);
+		}
+
+		// Factor in light attenuation:
+		vec3 fragLight		= light.color * LightAttenuation(worldPosition.xyz, lightPosition);
+
+		totalLight += ComputePBRLighting(albedo, worldNormal, RMAO, worldPosition, matProp0.rgb, NoL, lightWorldDir, lightViewDir, fragLight, shadowFactor, in_view).rgb;
+	}
+
+	FragColor = vec4(totalLight, albedo.a);
+}
@@ -9,6 +9,6 @@
 // Phong vertex shader
 void main()
 {
-	gl_Position		= vec4(in_position, 1);	// Our screen aligned quad is already in clip space
-	data.uv0		= in_uv0;
+	gl_Position = vec4(in_position, 1);	// Our screen aligned quad is already in clip space
+	data.uv0	= in_uv0;
 }
\ No newline at end of file
@@ -15,17 +15,19 @@
 
 void main()
 {
+	vec2 targetUV			= data.uv0.xy * renderScale; // Screen -> GBuffer UVs
+
 	// Sample textures once inside the main shader flow, and pass the values as required:
-	FragColor				= texture(GBuffer_Albedo, data.uv0.xy); // Note: For PBR, we require all calculations to be performed in linear color
-	vec3 worldNormal		= texture(GBuffer_WorldNormal, data.uv0.xy).xyz;
-	vec4 RMAO				= texture(GBuffer_RMAO, data.uv0.xy);
-	vec4 worldPosition		= texture(GBuffer_WorldPos, data.uv0.xy);
-	vec4 matProp0			= texture(GBuffer_MatProp0, data.uv0.xy);	// .rgb = F0 (Surface response at 0 degrees), .a = Phong exponent
+	FragColor				= texture(GBuffer_Albedo, targetUV); // Note: For PBR, we require all calculations to be performed in linear color
+	vec3 worldNormal		= DecodeOctahedralNormal(texture(GBuffer_WorldNormal, targetUV).xy);
+	vec4 RMAO				= texture(GBuffer_RMAO, targetUV);
+	vec4 worldPosition		= WorldPositionFromDepth(data.uv0.xy, texture(GBuffer_Depth, targetUV).r, in_inverse_vp);
+	vec4 matProp0			= texture(GBuffer_MatProp0, targetUV);	// .rgb = F0 (Surface response at 0 degrees), .a = Phong exponent
 
 	// Read from 2D shadow map:
 	float NoL				= max(0.0, dot(worldNormal, keylightWorldDir));
 	vec3 shadowPos			= (shadowCam_vp * worldPosition).xyz;
-	float shadowFactor		= GetShadowFactor(shadowPos, shadowDepth, NoL);
+	float shadowFactor		= GetKeylightShadowFactor(worldPosition, shadowPos, shadowDepth, NoL);
 
 	// Note: Keylight lightColor doesn't need any attenuation to be factored in
 	FragColor = ComputePBRLighting(FragColor, worldNormal, RMAO, worldPosition, matProp0.rgb, NoL, keylightWorldDir, keylightViewDir, lightColor, shadowFactor, in_view);
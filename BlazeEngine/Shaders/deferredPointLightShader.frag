@@ -17,27 +17,29 @@ in vec4 gl_FragCoord;
 void main()
 {	
 	vec2 uvs		= vec2(gl_FragCoord.x / screenParams.x, gl_FragCoord.y / screenParams.y); // [0, xRes/yRes] -> [0,1]
+	vec2 targetUV	= uvs * renderScale; // Screen -> GBuffer UVs
 
 	// Cull based on depth:
-	if (gl_FragCoord.z < texture( GBuffer_Depth, uvs).r)
+	float depth				= texture(GBuffer_Depth, targetUV).r;
+	if (gl_FragCoord.z < depth)
 	{
 		discard;
 	}
 	
 	// Sample textures once inside the main shader flow, and pass the values as required:
-	FragColor				= texture(GBuffer_Albedo, uvs);
-	vec3 worldNormal		= texture(GBuffer_WorldNormal, uvs).xyz;
-	vec4 RMAO				= texture(GBuffer_RMAO, uvs);
-	vec4 worldPosition		= texture(GBuffer_WorldPos, uvs);
-	vec4 matProp0			= texture(GBuffer_MatProp0, uvs); // .rgb = F0 (Surface response at 0 degrees), .a = Phong exponent
+	FragColor				= texture(GBuffer_Albedo, targetUV);
+	vec3 worldNormal		= DecodeOctahedralNormal(texture(GBuffer_WorldNormal, targetUV).xy);
+	vec4 RMAO				= texture(GBuffer_RMAO, targetUV);
+	vec4 worldPosition		= WorldPositionFromDepth(uvs, depth, in_inverse_vp);
+	vec4 matProp0			= texture(GBuffer_MatProp0, targetUV); // .rgb = F0 (Surface response at 0 degrees), .a = Phong exponent
 
 	vec3 lightWorldDir		= normalize(lightWorldPos - worldPosition.xyz);
 	vec3 lightViewDir		= normalize((in_view * vec4(lightWorldDir, 0.0)).xyz);
 
-	// Cube-map shadows:
+	// Cube-map shadows, from the shadow atlas:
 	float NoL				= max(0.0, dot(worldNormal, lightWorldDir));
-	vec3 lightToFrag		= worldPosition.xyz - lightWorldPos; // Cubemap sampler direction length matters, so we can't use -fragToLight
-	float shadowFactor		= GetShadowFactor(lightToFrag, CubeMap_0, NoL);
+	vec3 lightToFrag		= worldPosition.xyz - lightWorldPos; // Selects the cube face, and gives the linear fragment depth
+	float shadowFactor		= GetShadowFactor(worldPosition, lightToFrag, shadowDepth, NoL);
 
 	// Factor in light attenuation:
 	float lightAtten		= LightAttenuation(worldPosition.xyz, lightWorldPos);
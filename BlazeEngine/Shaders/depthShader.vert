@@ -7,6 +7,9 @@ layout (location = 0) in vec3 in_position;
 
 uniform mat4 in_mvp;
 
+// The depth pre-pass relies on the GBuffer pass reproducing its depth exactly (for GL_EQUAL depth testing):
+invariant gl_Position;
+
 void main()
 {
 	// Assign our position data to the predefined gl_Position output
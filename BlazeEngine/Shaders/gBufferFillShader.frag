@@ -10,38 +10,46 @@
 // in bool gl_FrontFacing;
 // in vec2 gl_PointCoord;
 
-// Note: Locations must match the order defined in material.h
+// Note: Locations must match the order of the GBuffer attachments created in Camera::AttachGBuffer(). World position isn't
+// stored: It's reconstructed from depth
 layout (location = 0) out vec4 gBuffer_out_albedo;
-layout (location = 1) out vec4 gBuffer_out_worldNormal;
+layout (location = 1) out vec2 gBuffer_out_worldNormal;
 layout (location = 2) out vec4 gBuffer_out_RMAO;
-layout (location = 3) out vec4 gBuffer_out_emissive;
-layout (location = 4) out vec4 gBuffer_out_position; // TODO: Rename this as gBuffer_out_worldPosition
-layout (location = 5) out vec4 gBuffer_out_matProp0;
-layout (location = 6) out vec4 gBuffer_out_depth;
+layout (location = 3) out vec3 gBuffer_out_emissive;
+layout (location = 4) out vec4 gBuffer_out_matProp0;
 
 uniform float emissiveIntensity = 1.0;	// Overwritten during RenderManager.Initialize()
 
 
 void main()
 {
-	// Albedo:
+#if defined(MATERIAL_TEXTURE_ARRAYS)
+	MaterialParameters material = materialParameters[materialIndex];
+
+	gBuffer_out_albedo		= texture(albedo, vec3(data.uv0.xy, material.textureLayers.x));
+
+	vec3 textureNormal		= DecodeTextureNormal(texture(normal, vec3(data.uv0.xy, material.textureLayers.y)).xy);
+	gBuffer_out_worldNormal = EncodeOctahedralNormal(normalize(data.TBN * textureNormal));
+
+	gBuffer_out_RMAO		= texture(RMAO, vec3(data.uv0.xy, material.textureLayers.z));
+
+	gBuffer_out_emissive	= texture(emissive, vec3(data.uv0.xy, material.textureLayers.w)).rgb * emissiveIntensity;
+
+	gBuffer_out_matProp0	= material.matProperty0;
+#else
+	// Albedo: Written as-is. The sRGB target linearizes it when it's sampled
 	gBuffer_out_albedo		= texture(albedo, data.uv0.xy);
 
 	// Normal:
-	gBuffer_out_worldNormal = vec4( WorldNormalFromTexture(normal, data.uv0.xy, data.TBN), 0);
+	gBuffer_out_worldNormal = EncodeOctahedralNormal(WorldNormalFromTexture(normal, data.uv0.xy, data.TBN));
 
 	// RMAO:
 	gBuffer_out_RMAO		= texture(RMAO, data.uv0.xy);
 
 	// Emissive:
-	gBuffer_out_emissive	= texture(emissive, data.uv0.xy) * emissiveIntensity;
-
-	// Position:
-	gBuffer_out_position	= vec4(data.worldPos.xyz, 1);
+	gBuffer_out_emissive	= texture(emissive, data.uv0.xy).rgb * emissiveIntensity;
 
 	// Material properties:
-	gBuffer_out_matProp0	= matProperty0;
-
-	// Depth:
-	gBuffer_out_depth		= vec4(gl_FragCoord.z, gl_FragCoord.z, gl_FragCoord.z, 1.0);	// Doesn't actually do anything...
+	gBuffer_out_matProp0	= matProperty0;	// Note: Stored as unorm: .rgb = F0 is in [0,1]. The .a Phong exponent isn't used by the PBR lighting
+#endif
 }
\ No newline at end of file
@@ -7,6 +7,9 @@
 #include "BlazeCommon.glsl"
 #include "BlazeGlobals.glsl"
 
+// Must match the depth pre-pass exactly (for GL_EQUAL depth testing):
+invariant gl_Position;
+
 void main()
 {
 	// Assign position to the predefined gl_Position clip-space output:
@@ -28,7 +28,7 @@ void main()
 
 	// Shadow:
 	float NoL					= max(0.0, dot(data.vertexWorldNormal, keylightWorldDir));
-	float shadowFactor			= GetShadowFactor(data.shadowPos, shadowDepth, NoL);
+	float shadowFactor			= GetKeylightShadowFactor(vec4(data.worldPos, 1.0), data.shadowPos, shadowDepth, NoL);
 
 	// Final result:
 	FragColor = ambientContribution + (diffuseContribution * shadowFactor);
@@ -34,7 +34,7 @@ void main()
 
 	// Shadows:
 	float NoL					= max(0.0, dot(worldNormal, keylightWorldDir));
-	float shadowFactor			= GetShadowFactor(data.shadowPos, shadowDepth, NoL);
+	float shadowFactor			= GetKeylightShadowFactor(vec4(data.worldPos, 1.0), data.shadowPos, shadowDepth, NoL);
 	
 	// Final result:
 	FragColor = ambientContribution + ((diffuseContribution + specContribution) * shadowFactor);
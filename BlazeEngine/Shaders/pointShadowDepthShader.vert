@@ -0,0 +1,72 @@
+// Blaze Engine Point Light Shadow Depth Shader
+// Renders point light shadows into shadow atlas tiles without a geometry shader. Compiled with one of these keywords:
+// POINT_SHADOW_INSTANCED:			1 instance per cube face. The vertex shader selects the face's tile viewport
+// POINT_SHADOW_MULTIPASS:			1 draw per cube face. The tile viewport is set by the RenderManager
+// POINT_SHADOW_DUAL_PARABOLOID:	1 draw per hemisphere, projected onto a paraboloid. The tile viewport is set by the RenderManager
+
+#version 430 core
+
+#if defined(POINT_SHADOW_INSTANCED)
+	#extension GL_ARB_shader_viewport_layer_array : require
+#endif
+
+// Set the location of the position input variable
+layout (location = 0) in vec3 in_position;
+
+uniform mat4 in_model;
+
+#if defined(POINT_SHADOW_INSTANCED)
+	uniform mat4 shadowCamCubeMap_vp[6];
+	uniform int cubeFaceMask;			// Bit i is set if the mesh touches cube face i. 1 instance is drawn per set bit
+#elif defined(POINT_SHADOW_MULTIPASS)
+	uniform mat4 in_mvp;				// [Projection * View] of the current cube face * Model
+#elif defined(POINT_SHADOW_DUAL_PARABOLOID)
+	uniform vec3 lightWorldPos;
+	uniform float shadowCam_near;
+	uniform float shadowCam_far;
+	uniform float paraboloidDirection;	// 1.0 = Z+ hemisphere, -1.0 = Z- hemisphere
+#endif
+
+out vec4 FragPos; // World space
+
+void main()
+{
+	FragPos = in_model * vec4(in_position.xyz, 1.0);
+
+#if defined(POINT_SHADOW_INSTANCED)
+	// Find this instance's cube face: The (gl_InstanceID)th set bit of the mask
+	int cubeFace		= 0;
+	int remainingFaces	= gl_InstanceID;
+	for (; cubeFace < 5; cubeFace++)
+	{
+		if ((cubeFaceMask & (1 << cubeFace)) != 0)
+		{
+			if (remainingFaces == 0)
+			{
+				break;
+			}
+			remainingFaces--;
+		}
+	}
+
+	gl_ViewportIndex	= cubeFace; // Select the viewport of the shadow atlas tile we're rendering this face to
+	gl_Position			= shadowCamCubeMap_vp[cubeFace] * FragPos;
+
+#elif defined(POINT_SHADOW_MULTIPASS)
+	gl_Position = in_mvp * vec4(in_position.xyz, 1.0);
+
+#elif defined(POINT_SHADOW_DUAL_PARABOLOID)
+	vec3 lightToVert	= FragPos.xyz - lightWorldPos;
+	lightToVert.z		*= paraboloidDirection;
+
+	float lightDist		= length(lightToVert);
+	vec3 lightToVertDir	= lightToVert / max(lightDist, 0.00001);
+
+	// Project onto the paraboloid, mapping the hemisphere to the unit disc. Note: The projection is non-linear, so large
+	// triangles are distorted. The fragment shader writes the actual (linear) depth
+	gl_Position			= vec4(lightToVertDir.xy / (1.0 + lightToVertDir.z), ((lightDist - shadowCam_near) / (shadowCam_far - shadowCam_near)) * 2.0 - 1.0, 1.0);
+
+	// Clip everything behind the paraboloid:
+	gl_ClipDistance[0]	= lightToVertDir.z;
+#endif
+}
@@ -21,9 +21,10 @@
 void main()
 {	
 	vec2 uvs		= vec2(gl_FragCoord.x / screenParams.x, gl_FragCoord.y / screenParams.y); // [0, xRes/yRes] -> [0,1]
+	vec2 targetUV	= uvs * renderScale; // Screen -> GBuffer UVs
 
 	// Cull based on depth:
-	if (texture( GBuffer_Depth, uvs).r < gl_FragCoord.z)	// Is the GBuffer depth < the screen aligned quad sitting on the far plane?
+	if (texture(GBuffer_Depth, targetUV).r < gl_FragCoord.z)	// Is the GBuffer depth < the screen aligned quad sitting on the far plane?
 	{
 		discard;
 	}
@@ -11,7 +11,9 @@ uniform float exposure = 1.0;	// Uploaded in PostFXManager.Initialize()
 
 void main()
 {	
-	vec4 color = texture(GBuffer_Albedo, data.uv0.xy);
+	// Upscale the dynamic resolution viewport to the window. Clamp, so the bilinear footprint never reaches the stale texels outside it:
+	vec2 maxUV	= renderScale - (0.5 / vec2(textureSize(GBuffer_Albedo, 0)));
+	vec4 color	= texture(GBuffer_Albedo, min(data.uv0.xy * renderScale, maxUV));
 
 	vec3 toneMappedColor = vec3(1.0, 1.0, 1.0) - exp(-color.rgb * exposure);
 
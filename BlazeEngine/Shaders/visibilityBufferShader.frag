@@ -0,0 +1,11 @@
+#version 430 core
+
+#include "BlazeVisibility.glsl"
+
+layout (location = 0) out uint visibilityID;
+
+
+void main()
+{
+	visibilityID = (uint(instanceID) << VISIBILITY_TRIANGLE_BITS) | (uint(gl_PrimitiveID) & VISIBILITY_TRIANGLE_MASK);
+}
\ No newline at end of file
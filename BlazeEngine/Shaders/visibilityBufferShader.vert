@@ -0,0 +1,12 @@
+#version 430 core
+
+#define BLAZE_VERTEX_SHADER
+
+#include "BlazeCommon.glsl"
+
+
+// Visibility buffer: Position only. No other attributes are interpolated
+void main()
+{
+	gl_Position = in_mvp * vec4(in_position, 1.0);
+}
\ No newline at end of file
@@ -0,0 +1,79 @@
+#version 430 core
+
+#define BLAZE_FRAGMENT_SHADER
+#define VISIBILITY_RESOLVE
+
+#include "BlazeCommon.glsl"
+#include "BlazeGlobals.glsl"
+#include "BlazeVisibility.glsl"
+
+// Built-in input variables:
+in vec4 gl_FragCoord;
+
+// Note: Outputs must match gBufferFillShader.frag
+layout (location = 0) out vec4 gBuffer_out_albedo;
+layout (location = 1) out vec2 gBuffer_out_worldNormal;
+layout (location = 2) out vec4 gBuffer_out_RMAO;
+layout (location = 3) out vec3 gBuffer_out_emissive;
+layout (location = 4) out vec4 gBuffer_out_matProp0;
+
+uniform float emissiveIntensity = 1.0;	// Overwritten during RenderManager.Initialize()
+
+
+// Fill the GBuffer from the visibility buffer, for the pixels covered by the current mesh instance
+void main()
+{
+	uint visibilityID = texelFetch(visibilityBuffer, ivec2(gl_FragCoord.xy), 0).r;
+	if (visibilityID == VISIBILITY_EMPTY || (visibilityID >> VISIBILITY_TRIANGLE_BITS) != uint(instanceID))
+	{
+		discard;
+	}
+
+	// Fetch the triangle:
+	uint triangleIndex	= visibilityID & VISIBILITY_TRIANGLE_MASK;
+	uint index0			= meshIndices[triangleIndex * 3];
+	uint index1			= meshIndices[triangleIndex * 3 + 1];
+	uint index2			= meshIndices[triangleIndex * 3 + 2];
+
+	vec4 clip0			= in_mvp * vec4(FetchVertexVec3(index0, VERTEX_OFFSET_POSITION), 1.0);
+	vec4 clip1			= in_mvp * vec4(FetchVertexVec3(index1, VERTEX_OFFSET_POSITION), 1.0);
+	vec4 clip2			= in_mvp * vec4(FetchVertexVec3(index2, VERTEX_OFFSET_POSITION), 1.0);
+
+	vec2 ndcPosition	= ((gl_FragCoord.xy * screenParams.zw) * 2.0) - 1.0;
+	Barycentrics bary	= ComputeBarycentrics(clip0, clip1, clip2, ndcPosition, screenParams.xy);
+
+	// Interpolate the vertex attributes:
+	vec2 uvDdx, uvDdy;
+	vec2 uv				= Interpolate(bary, FetchVertexVec4(index0, VERTEX_OFFSET_UV0).xy, FetchVertexVec4(index1, VERTEX_OFFSET_UV0).xy, FetchVertexVec4(index2, VERTEX_OFFSET_UV0).xy, uvDdx, uvDdy);
+	vec3 localTangent	= Interpolate(bary, FetchVertexVec3(index0, VERTEX_OFFSET_TANGENT), FetchVertexVec3(index1, VERTEX_OFFSET_TANGENT), FetchVertexVec3(index2, VERTEX_OFFSET_TANGENT));
+	vec3 localBitangent	= Interpolate(bary, FetchVertexVec3(index0, VERTEX_OFFSET_BITANGENT), FetchVertexVec3(index1, VERTEX_OFFSET_BITANGENT), FetchVertexVec3(index2, VERTEX_OFFSET_BITANGENT));
+
+	mat3 TBN			= AssembleTBN(localTangent, localBitangent, in_modelRotation);
+
+	// Sample the material once per pixel, using the analytic derivatives for mip selection:
+#if defined(MATERIAL_TEXTURE_ARRAYS)
+	MaterialParameters material = materialParameters[materialIndex];
+
+	gBuffer_out_albedo		= textureGrad(albedo, vec3(uv, material.textureLayers.x), uvDdx, uvDdy);
+
+	vec3 textureNormal		= DecodeTextureNormal(textureGrad(normal, vec3(uv, material.textureLayers.y), uvDdx, uvDdy).xy);
+	gBuffer_out_worldNormal	= EncodeOctahedralNormal(normalize(TBN * textureNormal));
+
+	gBuffer_out_RMAO		= textureGrad(RMAO, vec3(uv, material.textureLayers.z), uvDdx, uvDdy);
+
+	gBuffer_out_emissive	= textureGrad(emissive, vec3(uv, material.textureLayers.w), uvDdx, uvDdy).rgb * emissiveIntensity;
+
+	gBuffer_out_matProp0	= material.matProperty0;
+#else
+	gBuffer_out_albedo		= textureGrad(albedo, uv, uvDdx, uvDdy);
+
+	vec3 textureNormal		= DecodeTextureNormal(textureGrad(normal, uv, uvDdx, uvDdy).xy);
+	gBuffer_out_worldNormal	= EncodeOctahedralNormal(normalize(TBN * textureNormal));
+
+	gBuffer_out_RMAO		= textureGrad(RMAO, uv, uvDdx, uvDdy);
+
+	gBuffer_out_emissive	= textureGrad(emissive, uv, uvDdx, uvDdy).rgb * emissiveIntensity;
+
+	gBuffer_out_matProp0	= matProperty0;
+#endif
+}
\ No newline at end of file
@@ -0,0 +1,14 @@
+#version 430 core
+
+#define BLAZE_VERTEX_SHADER
+
+#include "BlazeCommon.glsl"
+#include "BlazeGlobals.glsl"
+
+
+// Visibility buffer resolve: Screen aligned quad
+void main()
+{
+	gl_Position = vec4(in_position, 1);	// Our screen aligned quad is already in clip space
+	data.uv0	= in_uv0;
+}
\ No newline at end of file
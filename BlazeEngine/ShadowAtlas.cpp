@@ -0,0 +1,204 @@
+#include "ShadowAtlas.h"
+#include "ShadowMap.h"
+#include "RenderTexture.h"
+#include "Material.h"
+#include "CoreEngine.h"
+#include "BuildConfiguration.h"
+
+#include <string>
+
+using std::to_string;
+
+
+namespace BlazeEngine
+{
+	ShadowAtlas::ShadowAtlas(int resolution, int minTileResolution)
+	{
+		this->resolution		= resolution;
+		this->minTileResolution	= glm::min(minTileResolution, resolution);
+
+		// Count the quadtree levels between the full atlas and the smallest tile:
+		this->numLevels = 1;
+		while ((this->resolution >> (this->numLevels - 1)) > this->minTileResolution)
+		{
+			this->numLevels++;
+		}
+
+		this->freeTiles.resize(this->numLevels);
+		this->freeTiles[0].emplace_back(0, 0);
+
+		this->depthTexture = new RenderTexture(resolution, resolution, "ShadowAtlas_RenderTexture");
+
+		// Don't filter across tile boundaries:
+		this->depthTexture->TextureMinFilter() = GL_NEAREST;
+		this->depthTexture->TextureMaxFilter() = GL_NEAREST;
+
+		this->depthTexture->Buffer(DEPTH_TEXTURE_0 + DEPTH_TEXTURE_SHADOW);
+
+		LOG("Created " + to_string(resolution) + "x" + to_string(resolution) + " shadow atlas");
+	}
+
+
+	ShadowAtlas::~ShadowAtlas()
+	{
+		// Note: We don't touch the allocated ShadowMaps here, as they may have already been deallocated
+		this->allocations.clear();
+
+		if (this->depthTexture != nullptr)
+		{
+			this->depthTexture->Destroy();
+			delete this->depthTexture;
+			this->depthTexture = nullptr;
+		}
+	}
+
+
+	bool ShadowAtlas::Allocate(ShadowMap* shadowMap, int tileResolution, int numTiles)
+	{
+		int level = 0;
+		while (level < this->numLevels - 1 && (this->resolution >> level) > tileResolution)
+		{
+			level++;
+		}
+
+		// Keep existing allocations of the same size:
+		auto existingAllocation = this->allocations.find(shadowMap);
+		if (existingAllocation != this->allocations.end())
+		{
+			if (existingAllocation->second.level == level && (int)existingAllocation->second.tiles.size() == numTiles)
+			{
+				return true;
+			}
+
+			Release(shadowMap);
+		}
+
+		Allocation newAllocation;
+		newAllocation.level = level;
+		for (int i = 0; i < numTiles; i++)
+		{
+			ivec2 position;
+			if (!AllocateTile(level, position))
+			{
+				// Out of space: Return whatever we managed to allocate
+				for (unsigned int j = 0; j < (unsigned int)newAllocation.tiles.size(); j++)
+				{
+					FreeTile(level, newAllocation.tiles[j]);
+				}
+				shadowMap->ClearAtlasTiles();
+				return false;
+			}
+			newAllocation.tiles.emplace_back(position);
+		}
+
+		shadowMap->SetAtlasTiles(this->depthTexture, &newAllocation.tiles[0], numTiles, this->resolution >> level);
+
+		this->allocations[shadowMap] = newAllocation;
+
+		return true;
+	}
+
+
+	void ShadowAtlas::Release(ShadowMap* shadowMap)
+	{
+		auto existingAllocation = this->allocations.find(shadowMap);
+		if (existingAllocation == this->allocations.end())
+		{
+			return;
+		}
+
+		for (unsigned int i = 0; i < (unsigned int)existingAllocation->second.tiles.size(); i++)
+		{
+			FreeTile(existingAllocation->second.level, existingAllocation->second.tiles[i]);
+		}
+		this->allocations.erase(existingAllocation);
+
+		shadowMap->ClearAtlasTiles();
+	}
+
+
+	int ShadowAtlas::TileResolution(ShadowMap* shadowMap) const
+	{
+		auto existingAllocation = this->allocations.find(shadowMap);
+		if (existingAllocation == this->allocations.end())
+		{
+			return 0;
+		}
+		return this->resolution >> existingAllocation->second.level;
+	}
+
+
+	int ShadowAtlas::ClampTileResolution(float desiredResolution, int maxResolution) const
+	{
+		int tileResolution = this->minTileResolution;
+		while (tileResolution < desiredResolution && tileResolution * 2 <= maxResolution && tileResolution * 2 <= this->resolution)
+		{
+			tileResolution *= 2;
+		}
+		return tileResolution;
+	}
+
+
+	bool ShadowAtlas::AllocateTile(int level, ivec2& position)
+	{
+		if (!this->freeTiles[level].empty())
+		{
+			position = this->freeTiles[level].back();
+			this->freeTiles[level].pop_back();
+			return true;
+		}
+
+		// Split a tile from the level above into 4 children: Keep the first, and free the others
+		ivec2 parentPosition;
+		if (level == 0 || !AllocateTile(level - 1, parentPosition))
+		{
+			return false;
+		}
+
+		int childResolution = this->resolution >> level;
+		this->freeTiles[level].emplace_back(parentPosition + ivec2(childResolution, childResolution));
+		this->freeTiles[level].emplace_back(parentPosition + ivec2(0, childResolution));
+		this->freeTiles[level].emplace_back(parentPosition + ivec2(childResolution, 0));
+
+		position = parentPosition;
+		return true;
+	}
+
+
+	void ShadowAtlas::FreeTile(int level, ivec2 const& position)
+	{
+		if (level > 0)
+		{
+			// Find the siblings of this tile. If they're all free, merge them back into their parent:
+			int parentResolution	= this->resolution >> (level - 1);
+			ivec2 parentPosition	= (position / parentResolution) * parentResolution;
+
+			vector<ivec2>& levelTiles = this->freeTiles[level];
+			int siblingIndices[3];
+			int numFreeSiblings = 0;
+			for (int i = 0; i < (int)levelTiles.size() && numFreeSiblings < 3; i++)
+			{
+				if (levelTiles[i] != position && (levelTiles[i] / parentResolution) * parentResolution == parentPosition)
+				{
+					siblingIndices[numFreeSiblings++] = i;
+				}
+			}
+
+			if (numFreeSiblings == 3)
+			{
+				// Erase from the back, so the remaining indices stay valid:
+				for (int i = 2; i >= 0; i--)
+				{
+					levelTiles.erase(levelTiles.begin() + siblingIndices[i]);
+				}
+
+				FreeTile(level - 1, parentPosition);
+				return;
+			}
+		}
+
+		this->freeTiles[level].emplace_back(position);
+	}
+}
+
+
@@ -0,0 +1,78 @@
+// Shadow atlas
+// Packs the shadow maps of local (point) lights into a single depth texture. Square, power-of-two tiles are allocated from a
+// quadtree, with each light's tile resolution chosen from its projected screen coverage. Tiles are reallocated or evicted as the
+// camera moves, which bounds the total shadow memory and lets every local light render into the same framebuffer
+
+#pragma once
+
+#include "glm.hpp"
+
+#include <vector>
+#include <unordered_map>
+
+using glm::ivec2;
+using std::vector;
+using std::unordered_map;
+
+
+namespace BlazeEngine
+{
+	// Pre-declarations:
+	class ShadowMap;
+	class RenderTexture;
+
+
+	class ShadowAtlas
+	{
+	public:
+		// resolution and minTileResolution must be powers of two
+		ShadowAtlas(int resolution, int minTileResolution);
+
+		~ShadowAtlas();
+
+		// Allocate numTiles square tiles for a shadow map, and assign them to it. If the shadow map already has tiles of the requested
+		// resolution, they're kept. Returns false (and leaves the shadow map without tiles) if there isn't enough free space
+		bool Allocate(ShadowMap* shadowMap, int tileResolution, int numTiles);
+
+		// Return a shadow map's tiles to the atlas
+		void Release(ShadowMap* shadowMap);
+
+		// Get the resolution of the tiles allocated to a shadow map. Returns 0 if it has no tiles
+		int TileResolution(ShadowMap* shadowMap) const;
+
+		// Round a desired tile resolution to a power of two the atlas can allocate, clamped to [minTileResolution, maxResolution]
+		int ClampTileResolution(float desiredResolution, int maxResolution) const;
+
+		// Getters:
+		inline RenderTexture*	DepthTexture() const	{ return depthTexture; }
+		inline int				Resolution() const		{ return resolution; }
+
+
+	private:
+		struct Allocation
+		{
+			int				level;	// Tile resolution == resolution >> level
+			vector<ivec2>	tiles;	// Pixel positions
+		};
+
+		RenderTexture*	depthTexture		= nullptr;	// Deallocated in ~ShadowAtlas()
+		int				resolution			= 0;
+		int				minTileResolution	= 0;
+		int				numLevels			= 0;		// Level 0 is the entire atlas
+
+		vector<vector<ivec2>>					freeTiles;	// Free tile positions, per level
+		unordered_map<ShadowMap*, Allocation>	allocations;
+
+
+		// Private member functions:
+		//--------------------------
+
+		// Allocate a single tile, splitting larger free tiles as required. Returns false if there's no space
+		bool AllocateTile(int level, ivec2& position);
+
+		// Free a single tile, merging it with its siblings if they're all free
+		void FreeTile(int level, ivec2 const& position);
+	};
+}
+
+
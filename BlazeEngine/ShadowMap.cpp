@@ -4,10 +4,29 @@
 #include "RenderTexture.h"
 #include "Material.h"
 #include "Scene.h"
+#include "BuildConfiguration.h"
+#include "GLState.h"
+#include "Mesh.h"
+#include "Shader.h"
+
+#include <limits>
+
+using glm::vec2;
+using glm::ivec2;
+using glm::ivec4;
 
 
 namespace BlazeEngine
 {
+	const string ShadowMap::POINT_SHADOW_MODE_NAMES[POINT_SHADOW_MODE_COUNT] =
+	{
+		"geometryShader",	// POINT_SHADOW_GEOMETRY_SHADER
+		"instanced",		// POINT_SHADOW_INSTANCED
+		"multiPass",		// POINT_SHADOW_MULTIPASS
+		"dualParaboloid",	// POINT_SHADOW_DUAL_PARABOLOID
+	};
+
+
 	ShadowMap::ShadowMap()
 	{
 		this->shadowCam		= new Camera("Unnamed_ShadowMapCam");
@@ -22,22 +41,54 @@ namespace BlazeEngine
 	}
 
 
-	ShadowMap::ShadowMap(string lightName, int xRes, int yRes, CameraConfig shadowCamConfig, Transform* shadowCamParent /*= nullptr*/, vec3 shadowCamPosition /* = vec3(0.0f, 0.0f, 0.0f)*/, bool useCubeMap /*= false*/)
+	ShadowMap::ShadowMap(string lightName, int xRes, int yRes, CameraConfig shadowCamConfig, Transform* shadowCamParent /*= nullptr*/, vec3 shadowCamPosition /* = vec3(0.0f, 0.0f, 0.0f)*/, bool useCubeMap /*= false*/, int numCascades /*= 0*/, POINT_SHADOW_MODE pointShadowMode /*= POINT_SHADOW_GEOMETRY_SHADER*/)
 	{
 		this->shadowCam = new Camera(lightName + "_ShadowMapCam", shadowCamConfig, shadowCamParent);
 		this->shadowCam->GetTransform()->SetWorldPosition(shadowCamPosition);
 
-		// Omni-directional (Cube map) shadowmap setup:
+		this->isCubeMap = useCubeMap;
+
+		// Omni-directional shadowmap setup: Rendered into tiles of the RenderManager's ShadowAtlas, so we don't own a depth texture
 		if (useCubeMap)
 		{
-			this->shadowCam->RenderMaterial() = new Material(shadowCam->GetName() + "_Material", CoreEngine::GetCoreEngine()->GetConfig()->GetValue<string>("cubeDepthShaderName"), CUBE_MAP_NUM_FACES, true);
+			// Vertex shader viewport selection is an extension: Fall back to the geometry shader if it's unavailable
+			if (pointShadowMode == POINT_SHADOW_INSTANCED && !GLEW_ARB_shader_viewport_layer_array)
+			{
+				LOG_WARNING("ARB_shader_viewport_layer_array is not supported. Light \"" + lightName + "\" will use geometry shader point shadows");
+				pointShadowMode = POINT_SHADOW_GEOMETRY_SHADER;
+			}
+			this->pointShadowMode = pointShadowMode;
+
+			if (pointShadowMode == POINT_SHADOW_GEOMETRY_SHADER)
+			{
+				this->shadowCam->RenderMaterial() = new Material(shadowCam->GetName() + "_Material", CoreEngine::GetCoreEngine()->GetConfig()->GetValue<string>("cubeDepthShaderName"), CUBE_MAP_NUM_FACES, true);
+			}
+			else
+			{
+				// The other modes share a single vertex/fragment shader, specialized via keywords:
+				vector<string> shaderKeywords;
+				switch (pointShadowMode)
+				{
+				case POINT_SHADOW_INSTANCED:
+					shaderKeywords.emplace_back("POINT_SHADOW_INSTANCED");
+					break;
+
+				case POINT_SHADOW_MULTIPASS:
+					shaderKeywords.emplace_back("POINT_SHADOW_MULTIPASS");
+					break;
 
-			RenderTexture** cubeFaces = RenderTexture::CreateCubeMap(xRes, yRes, lightName);
+				case POINT_SHADOW_DUAL_PARABOLOID:
+				default:
+					shaderKeywords.emplace_back("POINT_SHADOW_DUAL_PARABOLOID");
+					break;
+				}
 
-			this->shadowCam->RenderMaterial()->AttachCubeMapTextures((Texture**)cubeFaces);
+				Shader* pointShadowShader = Shader::CreateShader(CoreEngine::GetCoreEngine()->GetConfig()->GetValue<string>("pointShadowDepthShaderName"), &shaderKeywords);
 
-			// Buffer the cube map:
-			RenderTexture::BufferCubeMap(cubeFaces, CUBE_MAP_0);
+				this->shadowCam->RenderMaterial() = new Material(shadowCam->GetName() + "_Material", pointShadowShader, CUBE_MAP_NUM_FACES, true);
+			}
+
+			this->maxTileResolution = glm::min(xRes, yRes);
 
 			CoreEngine::GetSceneManager()->RegisterCamera(CAMERA_TYPE_SHADOW, this->shadowCam);
 		}
@@ -53,10 +104,329 @@ namespace BlazeEngine
 			depthRenderTexture->Buffer(RENDER_TEXTURE_0 + RENDER_TEXTURE_DEPTH);
 
 			InitializeShadowCam(depthRenderTexture);
+
+			// Cascade setup:
+			if (numCascades > 1)
+			{
+				this->numCascades		= glm::min(numCascades, MAX_SHADOW_CASCADES);
+				this->cascadeColumns	= 2;
+				this->cascadeRows		= this->numCascades > 2 ? 2 : 1;
+
+				this->numTiles			= this->numCascades;
+
+				int tileWidth			= xRes / this->cascadeColumns;
+				int tileHeight			= yRes / this->cascadeRows;
+				for (int i = 0; i < this->numCascades; i++)
+				{
+					vec2 scale	= vec2(1.0f / this->cascadeColumns, 1.0f / this->cascadeRows);
+					vec2 offset	= vec2((float)(i % this->cascadeColumns), (float)(i / this->cascadeColumns)) * scale;
+
+					this->tiles[i]					= vec4(scale, offset);
+					this->tileViewports[i]			= ivec4((i % this->cascadeColumns) * tileWidth, (i / this->cascadeColumns) * tileHeight, tileWidth, tileHeight);
+					this->cascadeViewProjections[i]	= mat4(1.0f);	// Computed in UpdateCascades()
+				}
+
+				this->cascadeSplitLambda	= CoreEngine::GetCoreEngine()->GetConfig()->GetValue<float>("shadowCascadeSplitLambda");
+				this->cascadeMaxDistance	= CoreEngine::GetCoreEngine()->GetConfig()->GetValue<float>("shadowCascadeMaxDistance");
+			}
 		}		
 	}
 
 
+	ShadowMap::~ShadowMap()
+	{
+		if (this->staticCacheTextureID != 0)
+		{
+			glDeleteTextures(1, &this->staticCacheTextureID);
+			GLState::Instance().OnTextureDeleted(this->staticCacheTextureID);
+			this->staticCacheTextureID = 0;
+		}
+	}
+
+
+	POINT_SHADOW_MODE ShadowMap::GetPointShadowMode(string const& modeName)
+	{
+		for (int i = 0; i < POINT_SHADOW_MODE_COUNT; i++)
+		{
+			if (modeName == POINT_SHADOW_MODE_NAMES[i])
+			{
+				return (POINT_SHADOW_MODE)i;
+			}
+		}
+		return POINT_SHADOW_MODE_COUNT;
+	}
+
+
+	RenderTexture* ShadowMap::DepthTexture()
+	{
+		if (this->isCubeMap)
+		{
+			return this->atlasTexture;
+		}
+		return (RenderTexture*)this->shadowCam->RenderMaterial()->AccessTexture(RENDER_TEXTURE_DEPTH);
+	}
+
+
+	void ShadowMap::SetAtlasTiles(RenderTexture* atlasTexture, ivec2 const* tilePositions, int numTiles, int tileResolution)
+	{
+		this->atlasTexture		= atlasTexture;
+		this->numTiles			= glm::min(numTiles, MAX_SHADOW_MAP_TILES);
+		this->tileResolution	= tileResolution;
+
+		vec2 atlasSize = vec2((float)atlasTexture->Width(), (float)atlasTexture->Height());
+		for (int i = 0; i < this->numTiles; i++)
+		{
+			this->tileViewports[i]	= ivec4(tilePositions[i], tileResolution, tileResolution);
+			this->tiles[i]			= vec4(vec2((float)tileResolution) / atlasSize, vec2(tilePositions[i]) / atlasSize);
+		}
+
+		this->projectionRevision++; // The tile contents must be re-rendered
+		this->framesSinceUpdate = -1;	// ...immediately, regardless of the update interval
+	}
+
+
+	void ShadowMap::ClearAtlasTiles()
+	{
+		this->atlasTexture		= nullptr;
+		this->numTiles			= 0;
+		this->tileResolution	= 0;
+
+		this->projectionRevision++;
+	}
+
+
+	void ShadowMap::UpdateCascades(Camera* renderCam, Bounds const& sceneBounds)
+	{
+		if (this->numCascades == 0)
+		{
+			return;
+		}
+
+		// Compute the split distances using the practical split scheme: A blend of uniform and logarithmic splits
+		float nearDist	= renderCam->Near();
+		float farDist	= glm::min(renderCam->Far(), this->cascadeMaxDistance);
+
+		float splits[MAX_SHADOW_CASCADES + 1];
+		splits[0] = nearDist;
+		for (int i = 1; i <= this->numCascades; i++)
+		{
+			float fraction		= (float)i / (float)this->numCascades;
+			float uniformSplit	= nearDist + (farDist - nearDist) * fraction;
+			float logSplit		= nearDist * glm::pow(farDist / nearDist, fraction);
+
+			splits[i]			= glm::mix(uniformSplit, logSplit, this->cascadeSplitLambda);
+			this->cascadeSplits[i - 1] = splits[i];
+		}
+
+		// Get the world-space corners of the render camera's frustum, as rays from the near plane to the far plane:
+		mat4 inverseViewProjection = glm::inverse(renderCam->ViewProjection());
+		vec3 nearCorners[4];
+		vec3 farCorners[4];
+		for (int i = 0; i < 4; i++)
+		{
+			vec2 ndc		= vec2((i & 1) ? 1.0f : -1.0f, (i & 2) ? 1.0f : -1.0f);
+
+			vec4 nearCorner	= inverseViewProjection * vec4(ndc, -1.0f, 1.0f);
+			vec4 farCorner	= inverseViewProjection * vec4(ndc, 1.0f, 1.0f);
+
+			nearCorners[i]	= vec3(nearCorner) / nearCorner.w;
+			farCorners[i]	= vec3(farCorner) / farCorner.w;
+		}
+
+		// Get the depth range of the scene in light space, so casters between the light and the cascades are included:
+		mat4 const& lightView		= this->shadowCam->View();
+		Bounds lightSceneBounds;	// Empty: Only the cascades' own depth ranges are used if the scene is empty
+		if (sceneBounds.xMin <= sceneBounds.xMax)
+		{
+			lightSceneBounds = Bounds(sceneBounds).GetTransformedBounds(lightView);
+		}
+
+		float cascadeResolution		= (float)glm::min(this->tileViewports[0].z, this->tileViewports[0].w);
+
+		bool hasChanged			= false;
+		vec2 casterMin			= vec2(std::numeric_limits<float>::max());
+		vec2 casterMax			= vec2(-std::numeric_limits<float>::max());
+		float casterNear		= std::numeric_limits<float>::max();
+		float casterFar			= -std::numeric_limits<float>::max();
+		for (int cascade = 0; cascade < this->numCascades; cascade++)
+		{
+			// Get the corners of the frustum slice:
+			float sliceNear	= (splits[cascade] - renderCam->Near()) / (renderCam->Far() - renderCam->Near());
+			float sliceFar	= (splits[cascade + 1] - renderCam->Near()) / (renderCam->Far() - renderCam->Near());
+
+			vec3 sliceCorners[8];
+			vec3 center(0.0f);
+			for (int i = 0; i < 4; i++)
+			{
+				sliceCorners[i]		= glm::mix(nearCorners[i], farCorners[i], sliceNear);
+				sliceCorners[i + 4]	= glm::mix(nearCorners[i], farCorners[i], sliceFar);
+
+				center += sliceCorners[i] + sliceCorners[i + 4];
+			}
+			center /= 8.0f;
+
+			// Bound the slice with a sphere, so the cascade's size doesn't change as the camera rotates. Round the radius up to reduce
+			// precision noise:
+			float radius = 0.0f;
+			for (int i = 0; i < 8; i++)
+			{
+				radius = glm::max(radius, glm::length(sliceCorners[i] - center));
+			}
+			radius = glm::ceil(radius * 16.0f) / 16.0f;
+
+			// Snap the center to the shadow map texel grid (in light space), so the cascade only moves in whole texel increments:
+			vec3 lightCenter	= vec3(lightView * vec4(center, 1.0f));
+			float texelSize		= (2.0f * radius) / cascadeResolution;
+			lightCenter.x		= glm::floor(lightCenter.x / texelSize) * texelSize;
+			lightCenter.y		= glm::floor(lightCenter.y / texelSize) * texelSize;
+
+			// The light looks down -Z: Extend the near plane back to the furthest caster, and the far plane to cover the slice
+			float nearPlane		= -glm::max(lightSceneBounds.zMax, lightCenter.z + radius);
+			float farPlane		= -glm::min(lightSceneBounds.zMin, lightCenter.z - radius);
+
+			mat4 projection = glm::ortho
+			(
+				lightCenter.x - radius,
+				lightCenter.x + radius,
+				lightCenter.y - radius,
+				lightCenter.y + radius,
+				nearPlane,
+				farPlane
+			);
+
+			mat4 viewProjection = projection * lightView;
+			if (viewProjection != this->cascadeViewProjections[cascade])
+			{
+				this->cascadeViewProjections[cascade]	= viewProjection;
+				hasChanged								= true;
+			}
+
+			Camera::ExtractFrustumPlanes(viewProjection, &this->cascadeFrustumPlanes[cascade * 6]);
+
+			casterMin	= glm::min(casterMin, vec2(lightCenter) - radius);
+			casterMax	= glm::max(casterMax, vec2(lightCenter) + radius);
+			casterNear	= glm::min(casterNear, nearPlane);
+			casterFar	= glm::max(casterFar, farPlane);
+		}
+
+		if (hasChanged)
+		{
+			this->projectionRevision++;
+
+			// Planes enclosing every cascade, for gathering casters:
+			mat4 casterViewProjection = glm::ortho(casterMin.x, casterMax.x, casterMin.y, casterMax.y, casterNear, casterFar) * lightView;
+			Camera::ExtractFrustumPlanes(casterViewProjection, &this->cascadeCasterPlanes[0]);
+		}
+	}
+
+
+	bool ShadowMap::IsStaticCacheValid(unsigned int lightRevision, unsigned int staticRevision) const
+	{
+		return this->isStaticCacheValid && 
+			this->staticCacheLightRevision == lightRevision && 
+			this->staticCacheStaticRevision == staticRevision && 
+			this->staticCacheProjectionRevision == this->projectionRevision;
+	}
+
+
+	void ShadowMap::StoreStaticCache(unsigned int lightRevision, unsigned int staticRevision)
+	{
+		RenderTexture* depthTexture = DepthTexture();
+
+		// Atlas tiles are cached side by side. Otherwise, the cache matches the depth texture:
+		int cacheWidth	= this->isCubeMap ? this->numTiles * this->tileResolution : depthTexture->Width();
+		int cacheHeight	= this->isCubeMap ? this->tileResolution : depthTexture->Height();
+
+		// (Re)allocate the cache when it's first needed, or if the tiles have changed size:
+		if (this->staticCacheTextureID == 0 || this->staticCacheWidth != cacheWidth || this->staticCacheHeight != cacheHeight)
+		{
+			GLState& glState	= GLState::Instance();
+			int textureUnit		= glState.ActiveTextureUnit();
+
+			if (this->staticCacheTextureID != 0)
+			{
+				glDeleteTextures(1, &this->staticCacheTextureID);
+				glState.OnTextureDeleted(this->staticCacheTextureID);
+			}
+
+			glGenTextures(1, &this->staticCacheTextureID);
+			glState.BindTexture(textureUnit, GL_TEXTURE_2D, this->staticCacheTextureID);
+			glTexStorage2D(GL_TEXTURE_2D, 1, depthTexture->InternalFormat(), cacheWidth, cacheHeight);
+			glState.BindTexture(textureUnit, GL_TEXTURE_2D, 0);
+
+			this->staticCacheWidth	= cacheWidth;
+			this->staticCacheHeight	= cacheHeight;
+
+			LOG("Allocated static shadow caster cache for \"" + this->shadowCam->GetName() + "\"");
+		}
+
+		CopyDepth(true);
+
+		this->isStaticCacheValid			= true;
+		this->staticCacheLightRevision		= lightRevision;
+		this->staticCacheStaticRevision		= staticRevision;
+		this->staticCacheProjectionRevision	= this->projectionRevision;
+	}
+
+
+	void ShadowMap::RestoreStaticCache()
+	{
+		CopyDepth(false);
+	}
+
+
+	bool ShadowMap::ShouldUpdate()
+	{
+		if (this->framesSinceUpdate < 0 || this->framesSinceUpdate + 1 >= this->updateInterval)
+		{
+			this->framesSinceUpdate = 0;
+			return true;
+		}
+
+		this->framesSinceUpdate++;
+		return false;
+	}
+
+
+	void ShadowMap::CopyDepth(bool toCache)
+	{
+		RenderTexture* depthTexture = DepthTexture();
+
+		// Atlas tiles: Copy each tile to/from its slot in the cache
+		if (this->isCubeMap)
+		{
+			for (int i = 0; i < this->numTiles; i++)
+			{
+				ivec2 atlasPosition = ivec2(this->tileViewports[i].x, this->tileViewports[i].y);
+				ivec2 cachePosition = ivec2(i * this->tileResolution, 0);
+
+				ivec2 srcPosition	= toCache ? atlasPosition : cachePosition;
+				ivec2 dstPosition	= toCache ? cachePosition : atlasPosition;
+				GLuint srcTexture	= toCache ? depthTexture->TextureID() : this->staticCacheTextureID;
+				GLuint dstTexture	= toCache ? this->staticCacheTextureID : depthTexture->TextureID();
+
+				glCopyImageSubData
+				(
+					srcTexture, GL_TEXTURE_2D, 0, srcPosition.x, srcPosition.y, 0,
+					dstTexture, GL_TEXTURE_2D, 0, dstPosition.x, dstPosition.y, 0,
+					this->tileResolution, this->tileResolution, 1
+				);
+			}
+			return;
+		}
+
+		GLuint srcTexture	= toCache ? depthTexture->TextureID() : this->staticCacheTextureID;
+		GLuint dstTexture	= toCache ? this->staticCacheTextureID : depthTexture->TextureID();
+
+		glCopyImageSubData
+		(
+			srcTexture, GL_TEXTURE_2D, 0, 0, 0, 0,
+			dstTexture, GL_TEXTURE_2D, 0, 0, 0, 0,
+			depthTexture->Width(), depthTexture->Height(), 1
+		);
+	}
+
+
 	// Helper function: Reduces some duplicate code for non-cube map depth textures
 	void ShadowMap::InitializeShadowCam(RenderTexture* renderTexture)
 	{
@@ -2,23 +2,44 @@
 
 #include <string>
 
+#include <GL/glew.h>
 #include "glm.hpp"
 
 using glm::vec3;
+using glm::vec4;
+using glm::mat4;
+using glm::ivec2;
+using glm::ivec4;
 using std::string;
 
 
 #define DEFAULT_SHADOWMAP_TEXPATH	"ShadowMap"		// Shadow maps don't have a filepath...
 #define DEFAULT_SHADOWMAP_COLOR		vec4(1,1,1,1)	// Default to white (max far)
 
+#define MAX_SHADOW_CASCADES			4				// Must match MAX_SHADOW_CASCADES in BlazeCommon.glsl
+#define MAX_SHADOW_MAP_TILES		6				// Cascades, or one per cube face for point lights
+
 
 namespace BlazeEngine
 {
+	// Point light shadow rendering techniques. Selectable per light, so they can be compared:
+	enum POINT_SHADOW_MODE
+	{
+		POINT_SHADOW_GEOMETRY_SHADER,	// 1 draw per caster: A geometry shader emits each triangle to the cube faces it touches
+		POINT_SHADOW_INSTANCED,			// 1 instanced draw per caster, 1 instance per cube face: The vertex shader selects the face's viewport. Requires ARB_shader_viewport_layer_array
+		POINT_SHADOW_MULTIPASS,			// 6 passes: Each caster is drawn once per cube face it touches
+		POINT_SHADOW_DUAL_PARABOLOID,	// 2 passes: Each hemisphere is projected onto a paraboloid. Only 2 atlas tiles, at the cost of some distortion
+
+		POINT_SHADOW_MODE_COUNT
+	}; // Note: If new enums are added, don't forget to update ShadowMap::POINT_SHADOW_MODE_NAMES[] as well!
+
+
 	// Pre-declarations:
 	class Camera;
 	class Transform;
 	struct CameraConfig;
 	class RenderTexture;
+	struct Bounds;
 
 	class ShadowMap
 	{
@@ -27,19 +48,121 @@ namespace BlazeEngine
 		// Default constructor (perspective shadowcam):
 		ShadowMap();
 
-		ShadowMap(string lightName, int xRes, int yRes, CameraConfig shadowCamConfig, Transform* shadowCamParent = nullptr, vec3 shadowCamPosition = vec3(0.0f, 0.0f, 0.0f), bool useCubeMap = false);
+		// numCascades: Directional lights only. If > 1, the depth texture is split into a grid of cascade tiles (2x1 for 2 cascades, 2x2 for 3-4)
+		// pointShadowMode: Cube map (point light) shadows only
+		ShadowMap(string lightName, int xRes, int yRes, CameraConfig shadowCamConfig, Transform* shadowCamParent = nullptr, vec3 shadowCamPosition = vec3(0.0f, 0.0f, 0.0f), bool useCubeMap = false, int numCascades = 0, POINT_SHADOW_MODE pointShadowMode = POINT_SHADOW_GEOMETRY_SHADER);
+
+		~ShadowMap();
 
 		// Get the current shadow camera
 		inline Camera* ShadowCamera()		{ return shadowCam; }
 
+		// Get the depth texture the shadow camera renders into. For point lights, this is the ShadowAtlas texture (or nullptr if the
+		// light hasn't been allocated any atlas tiles)
+		RenderTexture* DepthTexture();
+
+		inline bool IsCubeMap() const		{ return isCubeMap; }
+
+		// Point lights: The technique used to render the shadow, and the number of atlas tiles it requires (6 cube faces, or 2 paraboloids)
+		inline POINT_SHADOW_MODE PointShadowMode() const	{ return pointShadowMode; }
+		inline int NumAtlasTiles() const	{ return pointShadowMode == POINT_SHADOW_DUAL_PARABOLOID ? 2 : 6; }
+
+		// Convert a point shadow mode name (as used in the engine config/scene metadata) to its enum. Returns POINT_SHADOW_MODE_COUNT if invalid
+		static POINT_SHADOW_MODE GetPointShadowMode(string const& modeName);
+		const static string POINT_SHADOW_MODE_NAMES[POINT_SHADOW_MODE_COUNT];
+
 		inline float& MaxShadowBias()		{ return maxShadowBias; }
 		inline float& MinShadowBias()		{ return minShadowBias; }
 
+		// Cascaded shadow maps:
+		//----------------------
+
+		// Fit the cascades to slices of renderCam's frustum. sceneBounds (world space) extends each cascade's depth range to include
+		// every potential caster. Cascade extents are rounded, and their positions snapped to shadow map texels to prevent shimmering
+		void UpdateCascades(Camera* renderCam, Bounds const& sceneBounds);
+
+		inline int			NumCascades() const				{ return numCascades; }	// 0 == No cascades: Use the shadow camera
+		inline mat4 const*	CascadeViewProjections() const	{ return &cascadeViewProjections[0]; }
+		inline vec4 const*	CascadeFrustumPlanes() const	{ return &cascadeFrustumPlanes[0]; }	// 6 consecutive planes per cascade
+		inline vec4 const*	CascadeCasterPlanes() const		{ return &cascadeCasterPlanes[0]; }	// 6 planes enclosing every cascade
+		inline vec4 const&	CascadeSplits() const			{ return cascadeSplits; }				// View-space far distance of each cascade
+
+
+		// Tiles:
+		//-------
+		// Regions of the depth texture rendered by the shadow map: One per cascade (directional lights), or one per cube face
+		// (point lights, within the ShadowAtlas)
+
+		inline int			NumTiles() const						{ return numTiles; }
+		inline vec4 const*	Tiles() const							{ return &tiles[0]; }			// Per tile UV transform: .xy = scale, .zw = offset
+		inline ivec4 const&	TileViewport(int tile) const			{ return tileViewports[tile]; }	// Pixels: .xy = position, .zw = size
+		inline int			MaxTileResolution() const				{ return maxTileResolution; }	// Point lights: Atlas tile resolution limit
+
+		// Point lights: Assign/remove the ShadowAtlas tiles to render into. Invalidates the static cache
+		void SetAtlasTiles(RenderTexture* atlasTexture, ivec2 const* tilePositions, int numTiles, int tileResolution);
+		void ClearAtlasTiles();
+
+
+		// Static caster cache: Static casters are rendered once, and copied into the shadow map each update before dynamic casters
+		// are drawn on top. The cache is valid until the light, the set of static meshes (as identified by their revisions), or the
+		// cascade projections change
+		bool IsStaticCacheValid(unsigned int lightRevision, unsigned int staticRevision) const;
+		void StoreStaticCache(unsigned int lightRevision, unsigned int staticRevision);	// Copy the shadow map into the cache
+		void RestoreStaticCache();														// Copy the cache into the shadow map
+
+		// Number of dynamic casters drawn during the last update. If both this and the current count are 0, the shadow map is unchanged
+		inline unsigned int& NumDynamicCasters()	{ return numDynamicCasters; }
+
+		// Update rate: The shadow map is re-rendered every updateInterval frames
+		inline int& UpdateInterval()		{ return updateInterval; }
+
+		// Advance the frame counter. Returns true if the shadow map should be re-rendered this frame
+		bool ShouldUpdate();
+
 	protected:
 
 
 	private:
 		Camera*			shadowCam		= nullptr;	// Registed in the SceneManager's currentScene, & deallocated when currentScene calls ClearCameras()
+		bool			isCubeMap		= false;
+		POINT_SHADOW_MODE pointShadowMode = POINT_SHADOW_GEOMETRY_SHADER;
+
+		// Cascaded shadow maps:
+		int				numCascades				= 0;
+		int				cascadeColumns			= 1;
+		int				cascadeRows				= 1;
+		mat4			cascadeViewProjections[MAX_SHADOW_CASCADES];
+		vec4			cascadeFrustumPlanes[MAX_SHADOW_CASCADES * 6];
+		vec4			cascadeCasterPlanes[6];
+		vec4			cascadeSplits			= vec4(0.0f);
+		float			cascadeSplitLambda		= 0.75f;	// Practical split scheme blend: 0 = uniform, 1 = logarithmic
+		float			cascadeMaxDistance		= 100.0f;	// Shadows are not rendered beyond this distance from the camera
+		unsigned int	projectionRevision		= 1;		// Incremented whenever the cascade projections or atlas tiles change
+
+		// Tiles:
+		int				numTiles				= 0;
+		vec4			tiles[MAX_SHADOW_MAP_TILES];
+		ivec4			tileViewports[MAX_SHADOW_MAP_TILES];
+		int				tileResolution			= 0;		// Point lights only
+		int				maxTileResolution		= 0;
+		RenderTexture*	atlasTexture			= nullptr;	// Owned by the RenderManager's ShadowAtlas
+
+		// Static caster cache:
+		GLuint			staticCacheTextureID			= 0;	// Deallocated in ~ShadowMap()
+		int				staticCacheWidth				= 0;
+		int				staticCacheHeight				= 0;
+		bool			isStaticCacheValid				= false;
+		unsigned int	staticCacheLightRevision		= 0;
+		unsigned int	staticCacheStaticRevision		= 0;
+		unsigned int	staticCacheProjectionRevision	= 0;
+		unsigned int	numDynamicCasters				= 0;
+
+		// Update rate:
+		int				updateInterval					= 1;
+		int				framesSinceUpdate				= -1;	// -1 == Never updated
+
+		// Helper function: Copy the depth texture (or our atlas tiles) to the static cache, or vice versa
+		void CopyDepth(bool toCache);
 
 		// Helper function: Init the shadow cam's material, register it, etc
 		void InitializeShadowCam(RenderTexture* renderTexture);
@@ -5,12 +5,22 @@
 #include "CoreEngine.h"
 #include "BuildConfiguration.h"
 #include "Material.h"
+#include "GLState.h"
+#include "TextureCompressor.h"
 
 
 #define STBI_FAILURE_USERMSG
 #include "stb_image.h"				// STB image loader. No need to #define STB_IMAGE_IMPLEMENTATION, as it was already defined in SceneManager
 
+#include "gtc/packing.hpp"
+#include "gtc/color_space.hpp"
+
+#include <emmintrin.h>				// SSE2: Always available on x64
+
 #include <string>
+#include <cstring>
+#include <fstream>
+#include <filesystem>
 
 using std::to_string;
 
@@ -20,10 +30,337 @@ using std::to_string;
 
 namespace BlazeEngine
 {
+	// Block compressed texture container layout: Header, the size of each mip level, then each level's blocks
+	struct TextureContainerHeader
+	{
+		char			magic[4];			// "BTEX"
+		unsigned int	version;
+		unsigned int	width;
+		unsigned int	height;
+		unsigned int	internalFormat;
+		int				quality;
+		unsigned int	numMips;
+		long long		sourceWriteTime;	// Last write time of the source image when encoded: Newer sources are re-encoded
+	};
+
+
+	// Texel conversion kernels. These only use SSE2, as F16C isn't available on every x64 CPU: Half floats are converted with
+	// integer operations instead
+	namespace
+	{
+		inline __m128i Select(__m128i mask, __m128i a, __m128i b)
+		{
+			return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+		}
+
+
+		// Convert 4 floats to half floats, rounding to nearest even. Each half is returned in the low 16 bits of its lane
+		inline __m128i FloatsToHalfs(__m128 values)
+		{
+			__m128i const bits		= _mm_castps_si128(values);
+			__m128i const sign		= _mm_and_si128(bits, _mm_set1_epi32((int)0x80000000));
+			__m128i const absBits	= _mm_xor_si128(bits, sign);
+
+			// Too large for a half (or Inf/NaN):
+			__m128i const isOverflow	= _mm_cmpgt_epi32(absBits, _mm_set1_epi32(((127 + 16) << 23) - 1));
+			__m128i const isNaN			= _mm_cmpgt_epi32(absBits, _mm_set1_epi32(255 << 23));
+			__m128i const infOrNaN		= _mm_or_si128(_mm_set1_epi32(0x7C00), _mm_and_si128(isNaN, _mm_set1_epi32(0x0200)));
+
+			// Half denormals: Adding a magic number lets the FPU do the shift and rounding
+			__m128i const isDenormal	= _mm_cmplt_epi32(absBits, _mm_set1_epi32(113 << 23));
+			__m128i const denormalMagic	= _mm_set1_epi32(126 << 23);
+			__m128i const denormal		= _mm_sub_epi32(_mm_castps_si128(_mm_add_ps(_mm_castsi128_ps(absBits), _mm_castsi128_ps(denormalMagic))), denormalMagic);
+
+			// Normals: Rebias the exponent, and round the dropped mantissa bits
+			__m128i const mantissaOdd	= _mm_and_si128(_mm_srli_epi32(absBits, 13), _mm_set1_epi32(1));
+			__m128i normal				= _mm_add_epi32(absBits, _mm_set1_epi32((int)((unsigned int)(15 - 127) << 23) + 0xFFF));
+			normal						= _mm_srli_epi32(_mm_add_epi32(normal, mantissaOdd), 13);
+
+			__m128i const result = Select(isOverflow, infOrNaN, Select(isDenormal, denormal, normal));
+			return _mm_or_si128(result, _mm_srli_epi32(sign, 16));
+		}
+
+
+		// Convert 4 half floats, in the low 16 bits of each lane, to floats. Exact
+		inline __m128 HalfsToFloats(__m128i halfs)
+		{
+			__m128i const exponentMask	= _mm_set1_epi32(0x7C00 << 13);
+			__m128i bits				= _mm_slli_epi32(_mm_and_si128(halfs, _mm_set1_epi32(0x7FFF)), 13);
+			__m128i const exponent		= _mm_and_si128(bits, exponentMask);
+			bits						= _mm_add_epi32(bits, _mm_set1_epi32((127 - 15) << 23));
+
+			// Inf/NaN get the maximum exponent, and denormals are renormalized by the FPU:
+			bits = _mm_add_epi32(bits, _mm_and_si128(_mm_cmpeq_epi32(exponent, exponentMask), _mm_set1_epi32((128 - 16) << 23)));
+
+			__m128i const denormal = _mm_castps_si128(_mm_sub_ps(_mm_castsi128_ps(_mm_add_epi32(bits, _mm_set1_epi32(1 << 23))), _mm_castsi128_ps(_mm_set1_epi32(113 << 23))));
+			bits = Select(_mm_cmpeq_epi32(exponent, _mm_setzero_si128()), denormal, bits);
+
+			return _mm_castsi128_ps(_mm_or_si128(bits, _mm_slli_epi32(_mm_and_si128(halfs, _mm_set1_epi32(0x8000)), 16)));
+		}
+
+
+		// Convert count floats to half floats
+		void PackHalfs(float const* source, unsigned short* destination, unsigned int count)
+		{
+			unsigned int i = 0;
+			for (; i + 8 <= count; i += 8)
+			{
+				// Sign extend, so the signed saturating pack keeps all 16 bits:
+				__m128i const low	= _mm_srai_epi32(_mm_slli_epi32(FloatsToHalfs(_mm_loadu_ps(source + i)), 16), 16);
+				__m128i const high	= _mm_srai_epi32(_mm_slli_epi32(FloatsToHalfs(_mm_loadu_ps(source + i + 4)), 16), 16);
+
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i), _mm_packs_epi32(low, high));
+			}
+
+			for (; i < count; i++)
+			{
+				destination[i] = (unsigned short)_mm_cvtsi128_si32(FloatsToHalfs(_mm_set_ss(source[i])));
+			}
+		}
+
+
+		// Pack a texel with 1-4 8-bit channels into an RGBA8 word. Missing channels are (0, 0, 0, 255)
+		inline int PackRGBA8(unsigned char const* texel, unsigned int numChannels)
+		{
+			unsigned int packed = 0xFF000000u;
+			for (unsigned int channel = 0; channel < numChannels; channel++)
+			{
+				packed = (packed & ~(0xFFu << (channel * 8))) | ((unsigned int)texel[channel] << (channel * 8));
+			}
+			return (int)packed;
+		}
+
+
+		// Expand a row of texels with 1-4 channels to RGBA floats, 4 texels at a time. Missing channels are (0, 0, 0, 1)
+		void ExpandRowUnsignedByte(unsigned char const* source, unsigned int numChannels, unsigned int width, float* destination)
+		{
+			__m128 const scale	= _mm_set1_ps(1.0f / 255.0f);
+			__m128i const zero	= _mm_setzero_si128();
+
+			for (unsigned int x = 0; x < width; x += 4)
+			{
+				unsigned int const numTexels = glm::min(width - x, 4u);
+
+				__m128i texels;
+				if (numChannels == 4 && numTexels == 4)
+				{
+					texels = _mm_loadu_si128(reinterpret_cast<__m128i const*>(source + (x * 4)));
+				}
+				else
+				{
+					int words[4] = { 0, 0, 0, 0 };
+					for (unsigned int i = 0; i < numTexels; i++)
+					{
+						words[i] = PackRGBA8(source + ((x + i) * numChannels), numChannels);
+					}
+					texels = _mm_setr_epi32(words[0], words[1], words[2], words[3]);
+				}
+
+				__m128i const low	= _mm_unpacklo_epi8(texels, zero);
+				__m128i const high	= _mm_unpackhi_epi8(texels, zero);
+
+				__m128 const results[4] =
+				{
+					_mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(low, zero)), scale),
+					_mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(low, zero)), scale),
+					_mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(high, zero)), scale),
+					_mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(high, zero)), scale),
+				};
+				for (unsigned int i = 0; i < numTexels; i++)
+				{
+					_mm_storeu_ps(destination + ((x + i) * 4), results[i]);
+				}
+			}
+		}
+
+
+		// Expand a row of 8-bit sRGB texels with 1-4 channels to linear RGBA floats, via a lookup table. Alpha is always linear
+		void ExpandRowSRGB(unsigned char const* source, unsigned int numChannels, unsigned int width, float* destination)
+		{
+			static struct SRGBTable
+			{
+				SRGBTable()
+				{
+					for (int i = 0; i < 256; i++)
+					{
+						toLinear[i] = glm::convertSRGBToLinear(glm::vec3((float)i / 255.0f)).x;
+					}
+				}
+				float toLinear[256];
+			} const srgbTable;
+
+			for (unsigned int x = 0; x < width; x++)
+			{
+				unsigned char const* texel	= source + (x * numChannels);
+				float* result				= destination + (x * 4);
+
+				result[0] = srgbTable.toLinear[texel[0]];
+				result[1] = numChannels > 1 ? srgbTable.toLinear[texel[1]] : 0.0f;
+				result[2] = numChannels > 2 ? srgbTable.toLinear[texel[2]] : 0.0f;
+				result[3] = numChannels > 3 ? (float)texel[3] / 255.0f : DEFAULT_ALPHA;
+			}
+		}
+
+
+		// Expand a row of half float texels with 1-4 channels to RGBA floats. Missing channels are (0, 0, 0, 1)
+		void ExpandRowHalfFloat(unsigned short const* source, unsigned int numChannels, unsigned int width, float* destination)
+		{
+			__m128i const zero = _mm_setzero_si128();
+
+			for (unsigned int x = 0; x < width; x++)
+			{
+				unsigned short texel[4] = { 0, 0, 0, 0x3C00 }; // 0x3C00 == 1.0
+				memcpy(texel, source + (x * numChannels), numChannels * sizeof(unsigned short));
+
+				__m128i const halfs = _mm_unpacklo_epi16(_mm_loadl_epi64(reinterpret_cast<__m128i const*>(texel)), zero);
+				_mm_storeu_ps(destination + (x * 4), HalfsToFloats(halfs));
+			}
+		}
+
+
+		// Expand a row of float texels with 1-4 channels to RGBA floats. Missing channels are (0, 0, 0, 1)
+		void ExpandRowFloat(float const* source, unsigned int numChannels, unsigned int width, float* destination)
+		{
+			if (numChannels == 4)
+			{
+				memcpy(destination, source, width * 4 * sizeof(float));
+				return;
+			}
+
+			for (unsigned int x = 0; x < width; x++)
+			{
+				float texel[4] = { 0.0f, 0.0f, 0.0f, DEFAULT_ALPHA };
+				memcpy(texel, source + (x * numChannels), numChannels * sizeof(float));
+
+				_mm_storeu_ps(destination + (x * 4), _mm_loadu_ps(texel));
+			}
+		}
+
+
+		// 64-bit xxHash (XXH64) of a buffer
+		unsigned long long XXHash64(void const* data, size_t length, unsigned long long seed)
+		{
+			unsigned long long const prime1 = 0x9E3779B185EBCA87ULL;
+			unsigned long long const prime2 = 0xC2B2AE3D27D4EB4FULL;
+			unsigned long long const prime3 = 0x165667B19E3779F9ULL;
+			unsigned long long const prime4 = 0x85EBCA77C2B2AE63ULL;
+			unsigned long long const prime5 = 0x27D4EB2F165667C5ULL;
+
+			auto RotateLeft = [](unsigned long long value, int bits) { return (value << bits) | (value >> (64 - bits)); };
+			auto Round = [&](unsigned long long accumulator, unsigned long long input)
+			{
+				return RotateLeft(accumulator + (input * prime2), 31) * prime1;
+			};
+			auto Read64 = [](unsigned char const* bytes) { unsigned long long value; memcpy(&value, bytes, sizeof(value)); return value; };
+			auto Read32 = [](unsigned char const* bytes) { unsigned int value; memcpy(&value, bytes, sizeof(value)); return (unsigned long long)value; };
+
+			unsigned char const* current	= static_cast<unsigned char const*>(data);
+			unsigned char const* end		= current + length;
+
+			unsigned long long hash;
+			if (length >= 32)
+			{
+				// 4 independent lanes, 32 bytes per stripe:
+				unsigned long long lanes[4] = { seed + prime1 + prime2, seed + prime2, seed, seed - prime1 };
+				for (; current + 32 <= end; current += 32)
+				{
+					for (int lane = 0; lane < 4; lane++)
+					{
+						lanes[lane] = Round(lanes[lane], Read64(current + (lane * 8)));
+					}
+				}
+
+				hash = RotateLeft(lanes[0], 1) + RotateLeft(lanes[1], 7) + RotateLeft(lanes[2], 12) + RotateLeft(lanes[3], 18);
+				for (int lane = 0; lane < 4; lane++)
+				{
+					hash = ((hash ^ Round(0, lanes[lane])) * prime1) + prime4;
+				}
+			}
+			else
+			{
+				hash = seed + prime5;
+			}
+
+			hash += (unsigned long long)length;
+
+			for (; current + 8 <= end; current += 8)
+			{
+				hash = (RotateLeft(hash ^ Round(0, Read64(current)), 27) * prime1) + prime4;
+			}
+			if (current + 4 <= end)
+			{
+				hash = (RotateLeft(hash ^ (Read32(current) * prime1), 23) * prime2) + prime3;
+				current += 4;
+			}
+			for (; current < end; current++)
+			{
+				hash = RotateLeft(hash ^ (*current * prime5), 11) * prime1;
+			}
+
+			// Avalanche:
+			hash ^= hash >> 33;
+			hash *= prime2;
+			hash ^= hash >> 29;
+			hash *= prime3;
+			hash ^= hash >> 32;
+
+			return hash;
+		}
+
+
+		// Read the mip sizes that follow a texture container's header. Returns false if the header doesn't describe a valid mip chain of
+		// a BC format, if any size doesn't match its level's dimensions, or if the file is too short to contain every level
+		bool ReadContainerMipSizes(std::ifstream& containerFile, TextureContainerHeader const& header, vector<unsigned int>& mipSizes)
+		{
+			BC_FORMAT format;
+			if (header.width == 0 || header.height == 0 || !TextureCompressor::GetFormat(header.internalFormat, format))
+			{
+				return false;
+			}
+
+			// A full mip chain has floor(log2(max(width, height))) + 1 levels:
+			unsigned int maxMips = 0;
+			for (unsigned int dimension = glm::max(header.width, header.height); dimension > 0; dimension >>= 1)
+			{
+				maxMips++;
+			}
+			if (header.numMips == 0 || header.numMips > maxMips)
+			{
+				return false;
+			}
+
+			mipSizes.resize(header.numMips);
+			containerFile.read(reinterpret_cast<char*>(&mipSizes[0]), mipSizes.size() * sizeof(unsigned int));
+			if (!containerFile.good())
+			{
+				return false;
+			}
+
+			unsigned long long totalSize = 0;
+			for (unsigned int i = 0; i < header.numMips; i++)
+			{
+				if (mipSizes[i] != TextureCompressor::LevelBytes(format, glm::max(header.width >> i, 1u), glm::max(header.height >> i, 1u)))
+				{
+					return false;
+				}
+				totalSize += mipSizes[i];
+			}
+
+			// Check the levels are all there before anything is allocated for them:
+			std::streampos dataStart = containerFile.tellg();
+			containerFile.seekg(0, std::ios::end);
+			std::streamoff dataSize = containerFile.tellg() - dataStart;
+			containerFile.seekg(dataStart);
+
+			return containerFile.good() && dataSize >= 0 && (unsigned long long)dataSize >= totalSize;
+		}
+	}
+
+
 	Texture::Texture()
 	{
 		numTexels				= width * height;
-		texels					= new vec4[numTexels];	// Allocate the default size
+		AllocateTexels();	// Allocate the default size
 		resolutionHasChanged	= true;
 		
 		Fill(TEXTURE_ERROR_COLOR_VEC4);
@@ -39,7 +376,7 @@ namespace BlazeEngine
 		this->texturePath		= texturePath;
 
 		// Initialize the texture:
-		texels					= new vec4[numTexels];
+		AllocateTexels();
 		resolutionHasChanged	= true;
 		if (doFill)
 		{
@@ -82,15 +419,18 @@ namespace BlazeEngine
 
 		this->numTexels				= rhs.numTexels;
 
+		this->mipSizes				= rhs.mipSizes;
+
 		if (rhs.texels != nullptr && this->numTexels > 0)
 		{
-			this->texels				= new vec4[this->numTexels];
+			this->texels				= new unsigned char[rhs.TexelsSize()];
 			this->resolutionHasChanged	= true;
 
-			for (unsigned int i = 0; i < this->numTexels; i++)
-			{
-				this->texels[i] = rhs.texels[i];
-			}
+			memcpy(this->texels, rhs.texels, rhs.TexelsSize());
+		}
+		else if (rhs.isReleased)
+		{
+			LOG_ERROR("Copying texture \"" + rhs.texturePath + "\" after its texels were released. The copy will not contain any texel data");
 		}
 
 		this->texturePath = rhs.texturePath;
@@ -102,6 +442,7 @@ namespace BlazeEngine
 		if (glIsTexture(textureID))
 		{
 			glDeleteTextures(1, &textureID);
+			GLState::Instance().OnTextureDeleted(textureID);
 		}
 
 		if (texels != nullptr)
@@ -111,8 +452,10 @@ namespace BlazeEngine
 			numTexels = 0;
 			resolutionHasChanged = true;
 		}
+		isReleased = false;
 
 		glDeleteSamplers(1, &this->samplerID);
+		GLState::Instance().OnSamplerDeleted(this->samplerID);
 	}
 
 
@@ -152,15 +495,18 @@ namespace BlazeEngine
 
 		this->numTexels			= rhs.numTexels;
 
+		this->mipSizes			= rhs.mipSizes;
+
 		if (rhs.texels != nullptr && numTexels > 0)
 		{
-			this->texels				= new vec4[this->numTexels];
+			this->texels				= new unsigned char[rhs.TexelsSize()];
 			this->resolutionHasChanged	= true;
 
-			for (unsigned int i = 0; i < this->numTexels; i++)
-			{
-				this->texels[i] = rhs.texels[i];
-			}
+			memcpy(this->texels, rhs.texels, rhs.TexelsSize());
+		}
+		else if (rhs.isReleased)
+		{
+			LOG_ERROR("Copying texture \"" + rhs.texturePath + "\" after its texels were released. The copy will not contain any texel data");
 		}
 
 		this->texturePath = rhs.texturePath;
@@ -169,29 +515,229 @@ namespace BlazeEngine
 	}
 
 
-	vec4& BlazeEngine::Texture::Texel(unsigned int u, unsigned int v)
+	vec4 BlazeEngine::Texture::GetTexel(unsigned int u, unsigned int v) const
 	{
-		if (u >= width || v >= height)
+		if (u >= width || v >= height || texels == nullptr || IsCompressed())
+		{
+			LOG_ERROR("Invalid texture access! Cannot access texel (" + to_string(u) + ", " + to_string(v) + ") in a texture of size " + to_string(width) + "x" + to_string(height) + (IsCompressed() ? " (block compressed)" : ""));
+
+			return TEXTURE_ERROR_COLOR_VEC4;
+		}
+
+		unsigned int const numChannels	= NumChannels(this->format);
+		unsigned int const texelIndex	= (v * this->width) + u; // Number of elements in v rows, + uth element in next row
+
+		vec4 texel(0.0f, 0.0f, 0.0f, DEFAULT_ALPHA);
+		for (unsigned int channel = 0; channel < numChannels; channel++)
 		{
-			LOG_ERROR("Invalid texture access! Cannot access texel (" + to_string(u) + ", " + to_string(v) + " in a texture of size " + to_string(width) + "x" + to_string(height));
+			unsigned int const componentIndex = (texelIndex * numChannels) + channel;
+			switch (this->type)
+			{
+			case GL_UNSIGNED_BYTE:
+				texel[channel] = (float)texels[componentIndex] / 255.0f;
+				break;
+
+			case GL_HALF_FLOAT:
+				texel[channel] = glm::unpackHalf1x16(reinterpret_cast<unsigned short const*>(texels)[componentIndex]);
+				break;
 
-			// Try and return the safest option:
-			return texels[0];
+			case GL_FLOAT:
+				texel[channel] = reinterpret_cast<float const*>(texels)[componentIndex];
+				break;
+			}
 		}
 
-		return texels[(v * this->width) + u]; // Number of elements in v rows, + uth element in next row
+		return texel;
 	}
 
 
-	void BlazeEngine::Texture::Fill(vec4 color)
+	void BlazeEngine::Texture::SetTexel(unsigned int u, unsigned int v, vec4 const& value)
+	{
+		if (u >= width || v >= height || texels == nullptr || IsCompressed())
+		{
+			LOG_ERROR("Invalid texture access! Cannot access texel (" + to_string(u) + ", " + to_string(v) + ") in a texture of size " + to_string(width) + "x" + to_string(height) + (IsCompressed() ? " (block compressed)" : ""));
+			return;
+		}
+
+		unsigned int const numChannels	= NumChannels(this->format);
+		unsigned int const texelIndex	= (v * this->width) + u;
+
+		for (unsigned int channel = 0; channel < numChannels; channel++)
+		{
+			unsigned int const componentIndex = (texelIndex * numChannels) + channel;
+			switch (this->type)
+			{
+			case GL_UNSIGNED_BYTE:
+				texels[componentIndex] = (unsigned char)((glm::clamp(value[channel], 0.0f, 1.0f) * 255.0f) + 0.5f);
+				break;
+
+			case GL_HALF_FLOAT:
+				reinterpret_cast<unsigned short*>(texels)[componentIndex] = glm::packHalf1x16(value[channel]);
+				break;
+
+			case GL_FLOAT:
+				reinterpret_cast<float*>(texels)[componentIndex] = value[channel];
+				break;
+			}
+		}
+	}
+
+
+	bool Texture::GetTexelsRGBA(float* destination, bool convertSRGBToLinear /*= false*/) const
 	{
+		if (this->texels == nullptr || IsCompressed())
+		{
+			LOG_ERROR("Cannot read the texels of texture \"" + this->texturePath + "\": " + (IsCompressed() ? "It is block compressed" : "They were released"));
+			return false;
+		}
+
+		unsigned int const numChannels	= NumChannels(this->format);
+		unsigned int const rowSize		= this->width * BytesPerTexel(this->format, this->type);
+
 		for (unsigned int row = 0; row < this->height; row++)
 		{
-			for (unsigned int col = 0; col < this->width; col++)
+			unsigned char const* source	= this->texels + (row * rowSize);
+			float* rowDestination		= destination + (row * this->width * 4);
+
+			switch (this->type)
+			{
+			case GL_UNSIGNED_BYTE:
+				if (convertSRGBToLinear)
+				{
+					ExpandRowSRGB(source, numChannels, this->width, rowDestination);
+					continue;
+				}
+				ExpandRowUnsignedByte(source, numChannels, this->width, rowDestination);
+				break;
+
+			case GL_HALF_FLOAT:
+				ExpandRowHalfFloat(reinterpret_cast<unsigned short const*>(source), numChannels, this->width, rowDestination);
+				break;
+
+			case GL_FLOAT:
+				ExpandRowFloat(reinterpret_cast<float const*>(source), numChannels, this->width, rowDestination);
+				break;
+			}
+
+			// Float sources are rarely sRGB, so they don't get a vectorized path:
+			if (convertSRGBToLinear)
 			{
-				Texel(row, col) = color;
+				for (unsigned int x = 0; x < this->width; x++)
+				{
+					float* texel = rowDestination + (x * 4);
+					glm::vec3 linear = glm::convertSRGBToLinear(glm::clamp(glm::vec3(texel[0], texel[1], texel[2]), 0.0f, 1.0f));
+					texel[0] = linear.x;
+					texel[1] = linear.y;
+					texel[2] = linear.z;
+				}
 			}
 		}
+
+		return true;
+	}
+
+
+	bool Texture::IsOpaque() const
+	{
+		if (this->format != GL_RGBA || this->texels == nullptr || IsCompressed())
+		{
+			return true;
+		}
+
+		if (this->type == GL_UNSIGNED_BYTE)
+		{
+			// Compare 4 texels at a time: Alpha is every 4th byte
+			__m128i const opaque = _mm_set1_epi8((char)0xFF);
+
+			unsigned int i = 0;
+			for (; i + 4 <= this->numTexels; i += 4)
+			{
+				__m128i const texels = _mm_loadu_si128(reinterpret_cast<__m128i const*>(this->texels + (i * 4)));
+				if ((_mm_movemask_epi8(_mm_cmpeq_epi8(texels, opaque)) & 0x8888) != 0x8888)
+				{
+					return false;
+				}
+			}
+			for (; i < this->numTexels; i++)
+			{
+				if (this->texels[(i * 4) + 3] != 0xFF)
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+
+		for (unsigned int i = 0; i < this->numTexels; i++)
+		{
+			float alpha = this->type == GL_HALF_FLOAT ?
+				glm::unpackHalf1x16(reinterpret_cast<unsigned short const*>(this->texels)[(i * 4) + 3]) :
+				reinterpret_cast<float const*>(this->texels)[(i * 4) + 3];
+
+			if (alpha < 1.0f)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+
+	unsigned long long Texture::ContentHash() const
+	{
+		// Hash the description first, so identical bytes with a different layout don't match:
+		unsigned int const description[5] = { this->width, this->height, this->format, this->type, this->internalFormat };
+		unsigned long long const descriptionHash = XXHash64(description, sizeof(description), 0);
+
+		if (this->texels == nullptr)
+		{
+			LOG_WARNING("Texture \"" + this->texturePath + "\" has no texels to hash. Only its description was hashed");
+			return descriptionHash;
+		}
+
+		return XXHash64(this->texels, TexelsSize(), descriptionHash);
+	}
+
+
+	bool Texture::HashFile(string const& filePath, unsigned long long& hash)
+	{
+		std::ifstream file(filePath, std::ios::binary | std::ios::ate);
+		if (!file.is_open())
+		{
+			return false;
+		}
+
+		vector<char> fileData((size_t)file.tellg());
+		file.seekg(0);
+		if (!fileData.empty() && !file.read(&fileData[0], fileData.size()))
+		{
+			return false;
+		}
+
+		hash = XXHash64(fileData.data(), fileData.size(), 0);
+		return true;
+	}
+
+
+	void BlazeEngine::Texture::Fill(vec4 color)
+	{
+		if (this->texels == nullptr || IsCompressed())
+		{
+			LOG_ERROR("Cannot fill texture \"" + this->texturePath + "\": It has no uncompressed texels");
+			return;
+		}
+
+		// Convert the color once, and replicate it, doubling the filled region each copy:
+		SetTexel(0, 0, color);
+
+		unsigned int const totalSize	= TexelsSize();
+		unsigned int filledSize			= BytesPerTexel(this->format, this->type);
+		while (filledSize < totalSize)
+		{
+			unsigned int copySize = glm::min(filledSize, totalSize - filledSize);
+			memcpy(this->texels + filledSize, this->texels, copySize);
+			filledSize += copySize;
+		}
 	}
 
 
@@ -207,7 +753,7 @@ namespace BlazeEngine
 			{
 				float horDelta = (float)((float)col / (float)width);
 
-				Texel(row, col) = (horDelta * endCol) + ((1.0f - horDelta) * startCol);
+				SetTexel(col, row, (horDelta * endCol) + ((1.0f - horDelta) * startCol));
 			}
 		}
 	}
@@ -219,8 +765,6 @@ namespace BlazeEngine
 
 	Texture* Texture::LoadTextureFileFromPath(string texturePath, bool returnErrorTexIfNotFound /*= false*/, bool flipY /*= true*/)
 	{
-		stbi_set_flip_vertically_on_load(flipY);	// Set stb_image to flip the y-axis on loading to match OpenGL's style (So pixel (0,0) is in the bottom-left of the image)
-
 		LOG("Attempting to load texture \"" + texturePath + "\"");
 
 		int width, height, numChannels;
@@ -243,17 +787,41 @@ namespace BlazeEngine
 		{
 			LOG("Found " + to_string(width) + "x" + to_string(height) + (isHDR?" HDR ":" LDR ") + "texture with " + to_string(numChannels) + " channels");
 
-			Texture* texture = new Texture(width, height, texturePath, false);
+			// Keep the image's own channel count and bit depth, rather than expanding every texel to 4 floats:
+			const GLenum channelFormats[4]	= { GL_RED,		GL_RG,		GL_RGB,		GL_RGBA };
+			const GLenum ldrFormats[4]		= { GL_R8,		GL_RG8,		GL_RGBA8,	GL_RGBA8 };	// Note: RGB8 is typically padded to RGBA8 by the driver anyway
+			const GLenum hdrFormats[4]		= { GL_R16F,	GL_RG16F,	GL_RGB16F,	GL_RGBA16F };
 
-			if (isHDR)
-			{
-				float* castImageData = static_cast<float*>(imageData);
-				LoadHDRHelper(*texture, castImageData, width, height, numChannels);
-			}
-			else
+			int const formatIndex = glm::clamp(numChannels, 1, 4) - 1;
+
+			Texture* texture		= new Texture();
+			texture->width			= width;
+			texture->height			= height;
+			texture->numTexels		= width * height;
+			texture->texturePath	= texturePath;
+
+			texture->format			= channelFormats[formatIndex];
+			texture->type			= isHDR ? GL_HALF_FLOAT : GL_UNSIGNED_BYTE;
+			texture->internalFormat	= isHDR ? hdrFormats[formatIndex] : ldrFormats[formatIndex];
+
+			texture->AllocateTexels();
+
+			// Flip the y-axis while copying to match OpenGL's style (So pixel (0,0) is in the bottom-left of the image). Note: We don't use
+			// stbi_set_flip_vertically_on_load(), as it's global state: This way, textures can be decoded on multiple threads at once
+			unsigned int const rowElements = width * numChannels;
+			for (int row = 0; row < height; row++)
 			{
-				unsigned char* castImageData = static_cast<unsigned char*>(imageData);
-				LoadLDRHelper(*texture, castImageData, width, height, numChannels);
+				int const sourceRow = flipY ? (height - 1 - row) : row;
+
+				if (isHDR)
+				{
+					// Half precision covers the range of HDR environment maps, at half the size:
+					PackHalfs(static_cast<float const*>(imageData) + (sourceRow * rowElements), reinterpret_cast<unsigned short*>(texture->texels) + (row * rowElements), rowElements);
+				}
+				else
+				{
+					memcpy(texture->texels + (row * rowElements), static_cast<unsigned char const*>(imageData) + (sourceRow * rowElements), rowElements);
+				}
 			}
 
 			// Cleanup:
@@ -281,47 +849,103 @@ namespace BlazeEngine
 	}
 
 
-	void Texture::LoadLDRHelper(Texture& targetTexture, const unsigned char* imageData, int width, int height, int numChannels)
+	Texture* Texture::LoadTextureContainerFromPath(string texturePath, int quality)
 	{
-		// Read texel values:
-		const unsigned char* currentElement = imageData;
-		for (int row = 0; row < height; row++)
+		string containerPath = texturePath + TEXTURE_CONTAINER_EXTENSION;
+
+		std::ifstream containerFile(containerPath, std::ios::binary);
+		if (!containerFile.is_open())
 		{
-			for (int col = 0; col < width; col++)
-			{
-				vec4 currentPixel(0.0f, 0.0f, 0.0f, DEFAULT_ALPHA);
+			return nullptr;
+		}
 
-				for (int channel = 0; channel < numChannels; channel++)
-				{
-					currentPixel[channel] = (float)((float)((unsigned int)*currentElement) / 255.0f);
-					currentElement++;
-				}
+		TextureContainerHeader header;
+		containerFile.read(reinterpret_cast<char*>(&header), sizeof(header));
+		if (!containerFile.good() || memcmp(header.magic, "BTEX", 4) != 0 || header.version != TEXTURE_CONTAINER_VERSION)
+		{
+			LOG_WARNING("Ignoring invalid texture container \"" + containerPath + "\"");
+			return nullptr;
+		}
 
-				targetTexture.Texel(col, row) = currentPixel;
-			}
+		// Only use the container if it was encoded from the current version of the source, with the current settings:
+		std::error_code errorCode;
+		std::filesystem::file_time_type sourceWriteTime = std::filesystem::last_write_time(texturePath, errorCode);
+		if (errorCode || header.sourceWriteTime != (long long)sourceWriteTime.time_since_epoch().count() || header.quality != quality)
+		{
+			LOG("Texture container \"" + containerPath + "\" is out of date");
+			return nullptr;
+		}
+
+		vector<unsigned int> mipSizes;
+		if (!ReadContainerMipSizes(containerFile, header, mipSizes))
+		{
+			LOG_WARNING("Ignoring invalid or truncated texture container \"" + containerPath + "\"");
+			return nullptr;
+		}
+
+		unsigned int totalSize = 0;
+		for (size_t i = 0; i < mipSizes.size(); i++)
+		{
+			totalSize += mipSizes[i];
+		}
+
+		unsigned char* data = new unsigned char[totalSize];
+		containerFile.read(reinterpret_cast<char*>(data), totalSize);
+		if (!containerFile.good())
+		{
+			LOG_ERROR("Texture container \"" + containerPath + "\" is truncated");
+			delete[] data;
+			return nullptr;
 		}
+
+		LOG("Loaded " + to_string(header.width) + "x" + to_string(header.height) + " block compressed texture container \"" + containerPath + "\"");
+
+		Texture* texture		= new Texture();
+		texture->width			= header.width;
+		texture->height			= header.height;
+		texture->numTexels		= header.width * header.height;
+		texture->texturePath	= texturePath;
+
+		texture->SetCompressedTexels(header.internalFormat, data, mipSizes);
+		texture->hasContainer = true;
+
+		return texture;
 	}
 
-	void Texture::LoadHDRHelper(Texture& targetTexture, const float* imageData, int width, int height, int numChannels)
+
+	bool Texture::LoadTextureContainerLevel(string texturePath, unsigned int level, vector<unsigned char>& levelData)
 	{
-		// Read texel values:
-		const float* currentElement = imageData;
-		for (int row = 0; row < height; row++)
+		std::ifstream containerFile(texturePath + TEXTURE_CONTAINER_EXTENSION, std::ios::binary);
+		if (!containerFile.is_open())
 		{
-			for (int col = 0; col < width; col++)
-			{
-				vec4 currentPixel(0.0f, 0.0f, 0.0f, DEFAULT_ALPHA);
+			return false;
+		}
 
-				for (int channel = 0; channel < numChannels; channel++)
-				{
-					currentPixel[channel] = *currentElement;
+		TextureContainerHeader header;
+		containerFile.read(reinterpret_cast<char*>(&header), sizeof(header));
+		if (!containerFile.good() || memcmp(header.magic, "BTEX", 4) != 0 || header.version != TEXTURE_CONTAINER_VERSION || level >= header.numMips)
+		{
+			return false;
+		}
 
-					currentElement++;
-				}
+		vector<unsigned int> mipSizes;
+		if (!ReadContainerMipSizes(containerFile, header, mipSizes))
+		{
+			return false;
+		}
 
-				targetTexture.Texel(col, row) = currentPixel;
-			}
-		}		
+		// Skip the finer levels:
+		std::streamoff levelOffset = 0;
+		for (unsigned int i = 0; i < level; i++)
+		{
+			levelOffset += mipSizes[i];
+		}
+		containerFile.seekg(levelOffset, std::ios::cur);
+
+		levelData.resize(mipSizes[level]);
+		containerFile.read(reinterpret_cast<char*>(&levelData[0]), levelData.size());
+
+		return containerFile.good();
 	}
 
 
@@ -329,7 +953,21 @@ namespace BlazeEngine
 	{
 		LOG("Buffering texture: \"" + this->TexturePath() + "\"");
 
-		glBindTexture(this->texTarget, this->textureID);
+		GLState& glState = GLState::Instance();
+
+		// Released textures can't be re-created, but are already on the GPU:
+		if (this->isReleased)
+		{
+			if (!glIsTexture(this->textureID))
+			{
+				LOG_ERROR("Cannot buffer texture \"" + this->TexturePath() + "\": Its texels were released before it was uploaded");
+				return false;
+			}
+
+			return true;
+		}
+
+		glState.BindTexture(textureUnit, this->texTarget, this->textureID);
 
 		// If the texture hasn't been created, create a new name:
 		if (!glIsTexture(this->textureID))
@@ -339,11 +977,11 @@ namespace BlazeEngine
 			#endif
 
 			glGenTextures(1, &this->textureID);
-			glBindTexture(this->texTarget, this->textureID);
+			glState.BindTexture(textureUnit, this->texTarget, this->textureID);
 			if (glIsTexture(this->textureID) != GL_TRUE)
 			{
 				LOG_ERROR("OpenGL failed to generate new texture name. Texture buffering failed");
-				glBindTexture(this->texTarget, 0);
+				glState.BindTexture(textureUnit, this->texTarget, 0);
 				return false;
 			}
 
@@ -364,7 +1002,35 @@ namespace BlazeEngine
 
 
 		// Upload to the GPU:
-		if (texels != nullptr) // I.e. Texture:
+		if (texels != nullptr && IsCompressed()) // I.e. Block compressed Texture: Upload the encoded mip chain as is
+		{
+			// Only levels from the resident level onwards are allocated (see SetResidentLevel()):
+			if (resolutionHasChanged)
+			{
+				glTexStorage2D(this->texTarget, NumMipLevels() - this->residentLevel, this->internalFormat, 
+					glm::max(this->width >> this->residentLevel, 1u), glm::max(this->height >> this->residentLevel, 1u));
+
+				resolutionHasChanged = false;
+			}
+
+			unsigned char const* currentLevel = this->texels;
+			for (unsigned int level = 0; level < NumMipLevels(); level++)
+			{
+				if (level >= this->residentLevel)
+				{
+					GLsizei levelWidth	= glm::max(this->width >> level, 1u);
+					GLsizei levelHeight	= glm::max(this->height >> level, 1u);
+
+					glCompressedTexSubImage2D(this->texTarget, level - this->residentLevel, 0, 0, levelWidth, levelHeight, this->internalFormat, this->mipSizes[level], currentLevel);
+				}
+
+				currentLevel += this->mipSizes[level];
+			}
+
+			// Cleanup:
+			glState.BindTexture(textureUnit, this->texTarget, 0);
+		}
+		else if (texels != nullptr) // I.e. Texture:
 		{
 			if (resolutionHasChanged)
 			{
@@ -381,8 +1047,9 @@ namespace BlazeEngine
 				resolutionHasChanged = false;
 			}
 
-			glTexSubImage2D(this->texTarget, 0, 0, 0, this->width, this->height, this->format, this->type, &this->Texel(0, 0).r);
-			//glTexImage2D(this->texTarget, 0, this->internalFormat, this->width, this->height, 0, this->format, this->type, &this->Texel(0, 0).r); // Won't work if glTexStorage2D has been called
+			// Note: Rows are tightly packed, so GL_UNPACK_ALIGNMENT must be 1 (set by the RenderManager)
+			glTexSubImage2D(this->texTarget, 0, 0, 0, this->width, this->height, this->format, this->type, this->texels);
+			//glTexImage2D(this->texTarget, 0, this->internalFormat, this->width, this->height, 0, this->format, this->type, this->texels); // Won't work if glTexStorage2D has been called
 
 			glGenerateMipmap(this->texTarget);
 
@@ -391,7 +1058,7 @@ namespace BlazeEngine
 			#endif
 
 			// Cleanup:
-			glBindTexture(this->texTarget, 0);
+			glState.BindTexture(textureUnit, this->texTarget, 0);
 		}
 		else // I.e. RenderTexture:
 		{			
@@ -405,11 +1072,11 @@ namespace BlazeEngine
 		}
 
 		// Configure the Texture sampler:
-		glBindSampler(textureUnit, this->samplerID);
+		glState.BindSampler(textureUnit, this->samplerID);
 		if (!glIsSampler(this->samplerID))
 		{
 			glGenSamplers(1, &this->samplerID);
-			glBindSampler(textureUnit, this->samplerID);
+			glState.BindSampler(textureUnit, this->samplerID);
 		}
 
 		glSamplerParameteri(this->samplerID, GL_TEXTURE_WRAP_S, this->textureWrapS);
@@ -418,7 +1085,192 @@ namespace BlazeEngine
 		glSamplerParameteri(this->samplerID, GL_TEXTURE_MIN_FILTER, this->textureMinFilter);
 		glSamplerParameteri(this->samplerID, GL_TEXTURE_MAG_FILTER, this->textureMaxFilter);
 
-		glBindSampler(textureUnit, 0);
+		glState.BindSampler(textureUnit, 0);
+
+		// The GPU copy is all we need from here on:
+		if (this->texels != nullptr && CoreEngine::GetCoreEngine()->GetConfig()->GetValue<bool>("releaseTextureCPUData"))
+		{
+			ReleaseTexels();
+		}
+
+		return true;
+	}
+
+
+	void Texture::ReleaseTexels()
+	{
+		if (this->texels == nullptr)
+		{
+			return;
+		}
+
+		#if defined(DEBUG_SCENEMANAGER_TEXTURE_LOGGING)
+			LOG("Releasing " + to_string(TexelsSize()) + " bytes of texels for \"" + this->texturePath + "\"");
+		#endif
+
+		delete[] this->texels;
+		this->texels		= nullptr;
+		this->isReleased	= true;
+	}
+
+
+	void Texture::ReleaseGPUTexture()
+	{
+		if (glIsTexture(this->textureID))
+		{
+			glDeleteTextures(1, &this->textureID);
+			GLState::Instance().OnTextureDeleted(this->textureID);
+		}
+		this->textureID = 0;
+	}
+
+
+	void Texture::SetCompressedTexels(GLenum compressedFormat, unsigned char* data, vector<unsigned int> const& mipSizes)
+	{
+		if (this->texels != nullptr)
+		{
+			delete[] this->texels;
+		}
+
+		this->texels				= data;
+		this->mipSizes				= mipSizes;
+		this->internalFormat		= compressedFormat;
+		this->isReleased			= false;
+		this->resolutionHasChanged	= true;
+	}
+
+
+	bool Texture::WriteTextureContainer(int quality)
+	{
+		if (!IsCompressed() || this->texels == nullptr)
+		{
+			LOG_ERROR("Cannot write a texture container for \"" + this->texturePath + "\": It has no block compressed texels");
+			return false;
+		}
+
+		std::error_code errorCode;
+		std::filesystem::file_time_type sourceWriteTime = std::filesystem::last_write_time(this->texturePath, errorCode);
+		if (errorCode)
+		{
+			LOG_WARNING("Cannot write a texture container for \"" + this->texturePath + "\": It has no source image on disk");
+			return false;
+		}
+
+		string containerPath = this->texturePath + TEXTURE_CONTAINER_EXTENSION;
+		std::ofstream containerFile(containerPath, std::ios::binary);
+		if (!containerFile.is_open())
+		{
+			LOG_ERROR("Could not open texture container \"" + containerPath + "\" for writing");
+			return false;
+		}
+
+		TextureContainerHeader header;
+		memcpy(header.magic, "BTEX", 4);
+		header.version			= TEXTURE_CONTAINER_VERSION;
+		header.width			= this->width;
+		header.height			= this->height;
+		header.internalFormat	= this->internalFormat;
+		header.quality			= quality;
+		header.numMips			= (unsigned int)this->mipSizes.size();
+		header.sourceWriteTime	= (long long)sourceWriteTime.time_since_epoch().count();
+
+		containerFile.write(reinterpret_cast<char const*>(&header), sizeof(header));
+		containerFile.write(reinterpret_cast<char const*>(&this->mipSizes[0]), this->mipSizes.size() * sizeof(unsigned int));
+		containerFile.write(reinterpret_cast<char const*>(this->texels), TexelsSize());
+
+		LOG("Wrote " + to_string(TexelsSize()) + " byte texture container \"" + containerPath + "\"");
+
+		this->hasContainer = containerFile.good();
+
+		return this->hasContainer;
+	}
+
+
+	unsigned int Texture::MipLevelForSize(unsigned int maxSize) const
+	{
+		unsigned int level = 0;
+		while (level + 1 < NumMipLevels() && glm::max(this->width >> level, this->height >> level) > maxSize)
+		{
+			level++;
+		}
+		return level;
+	}
+
+
+	size_t Texture::ResidentSize() const
+	{
+		size_t residentSize = 0;
+		for (unsigned int level = this->residentLevel; level < NumMipLevels(); level++)
+		{
+			residentSize += this->mipSizes[level];
+		}
+		return residentSize;
+	}
+
+
+	bool Texture::SetResidentLevel(unsigned int newResidentLevel, unsigned char const* levelData /*= nullptr*/)
+	{
+		if (!IsCompressed() || newResidentLevel >= NumMipLevels())
+		{
+			LOG_ERROR("Cannot make level " + to_string(newResidentLevel) + " of texture \"" + this->texturePath + "\" resident");
+			return false;
+		}
+
+		// Not on the GPU yet: Buffer() will upload from the new level
+		if (!glIsTexture(this->textureID))
+		{
+			this->residentLevel = newResidentLevel;
+			return true;
+		}
+
+		if (newResidentLevel == this->residentLevel)
+		{
+			return true;
+		}
+		else if (newResidentLevel < this->residentLevel && (levelData == nullptr || newResidentLevel != this->residentLevel - 1))
+		{
+			LOG_ERROR("Texture \"" + this->texturePath + "\" can only stream in one level at a time");
+			return false;
+		}
+
+		// Immutable storage can't be resized, so reallocate it for the new levels, and copy the levels both have in common:
+		GLState& glState = GLState::Instance();
+		int const textureUnit = glm::max(glState.ActiveTextureUnit(), 0);
+
+		GLuint newTextureID = 0;
+		glGenTextures(1, &newTextureID);
+		glState.BindTexture(textureUnit, this->texTarget, newTextureID);
+
+		glTexStorage2D(this->texTarget, NumMipLevels() - newResidentLevel, this->internalFormat, glm::max(this->width >> newResidentLevel, 1u), glm::max(this->height >> newResidentLevel, 1u));
+
+		glTexParameteri(this->texTarget, GL_TEXTURE_WRAP_S, this->textureWrapS);
+		glTexParameteri(this->texTarget, GL_TEXTURE_WRAP_T, this->textureWrapT);
+		glTexParameteri(this->texTarget, GL_TEXTURE_MIN_FILTER, this->textureMinFilter);
+		glTexParameteri(this->texTarget, GL_TEXTURE_MAG_FILTER, this->textureMaxFilter);
+
+		for (unsigned int level = glm::max(newResidentLevel, this->residentLevel); level < NumMipLevels(); level++)
+		{
+			glCopyImageSubData
+			(
+				this->textureID,	this->texTarget, level - this->residentLevel,	0, 0, 0,
+				newTextureID,		this->texTarget, level - newResidentLevel,		0, 0, 0,
+				glm::max(this->width >> level, 1u), glm::max(this->height >> level, 1u), 1
+			);
+		}
+
+		if (newResidentLevel < this->residentLevel)
+		{
+			glCompressedTexSubImage2D(this->texTarget, 0, 0, 0, glm::max(this->width >> newResidentLevel, 1u), glm::max(this->height >> newResidentLevel, 1u),
+				this->internalFormat, this->mipSizes[newResidentLevel], levelData);
+		}
+
+		glState.BindTexture(textureUnit, this->texTarget, 0);
+
+		glDeleteTextures(1, &this->textureID);
+		glState.OnTextureDeleted(this->textureID);
+
+		this->textureID		= newTextureID;
+		this->residentLevel	= newResidentLevel;
 
 		return true;
 	}
@@ -430,17 +1282,19 @@ namespace BlazeEngine
 
 		LOG("Buffering cube map: \"" + cubeFaces[0]->TexturePath() + "\"");
 
+		GLState& glState = GLState::Instance();
+
 		// Bind Texture:
-		glBindTexture(cubeFaces[0]->texTarget, cubeFaces[0]->textureID);
+		glState.BindTexture(textureUnit, cubeFaces[0]->texTarget, cubeFaces[0]->textureID);
 		if (!glIsTexture(cubeFaces[0]->textureID))
 		{
 			glGenTextures(1, &cubeFaces[0]->textureID);
-			glBindTexture(cubeFaces[0]->texTarget, cubeFaces[0]->textureID);
+			glState.BindTexture(textureUnit, cubeFaces[0]->texTarget, cubeFaces[0]->textureID);
 
 			if (!glIsTexture(cubeFaces[0]->textureID))
 			{
 				LOG_ERROR("OpenGL failed to generate new cube map texture name. Texture buffering failed");
-				glBindTexture(cubeFaces[0]->texTarget, 0);
+				glState.BindTexture(textureUnit, cubeFaces[0]->texTarget, 0);
 				return false;
 			}
 		}
@@ -454,11 +1308,11 @@ namespace BlazeEngine
 		glTexParameteri(cubeFaces[0]->texTarget, GL_TEXTURE_MIN_FILTER, cubeFaces[0]->textureMinFilter);
 
 		// Bind sampler:
-		glBindSampler(textureUnit, cubeFaces[0]->samplerID);
+		glState.BindSampler(textureUnit, cubeFaces[0]->samplerID);
 		if (!glIsSampler(cubeFaces[0]->samplerID))
 		{
 			glGenSamplers(1, &cubeFaces[0]->samplerID);
-			glBindSampler(textureUnit, cubeFaces[0]->samplerID);
+			glState.BindSampler(textureUnit, cubeFaces[0]->samplerID);
 
 			if (!glIsSampler(cubeFaces[0]->samplerID))
 			{
@@ -474,16 +1328,16 @@ namespace BlazeEngine
 		glSamplerParameteri(cubeFaces[0]->samplerID, GL_TEXTURE_MIN_FILTER, cubeFaces[0]->textureMinFilter);
 		glSamplerParameteri(cubeFaces[0]->samplerID, GL_TEXTURE_MAG_FILTER, cubeFaces[0]->textureMaxFilter);
 
-		glBindSampler(textureUnit, 0);
+		glState.BindSampler(textureUnit, 0);
 
 
 		// Texture cube map specific setup:
 		if (cubeFaces[0]->texels != nullptr)
 		{
-			// Generate faces:
+			// Generate faces: Each face supplies its own texel layout, as the source images may differ
 			for (int i = 0; i < CUBE_MAP_NUM_FACES; i++)
 			{
-				glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, cubeFaces[0]->internalFormat, cubeFaces[0]->width, cubeFaces[0]->height, 0, cubeFaces[0]->format, cubeFaces[0]->type, &cubeFaces[i]->Texel(0, 0).r);
+				glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, cubeFaces[0]->internalFormat, cubeFaces[0]->width, cubeFaces[0]->height, 0, cubeFaces[i]->format, cubeFaces[i]->type, cubeFaces[i]->texels);
 			}
 
 
@@ -494,8 +1348,16 @@ namespace BlazeEngine
 				cubeFaces[i]->samplerID = cubeFaces[0]->samplerID;
 			}
 
+			if (CoreEngine::GetCoreEngine()->GetConfig()->GetValue<bool>("releaseTextureCPUData"))
+			{
+				for (int i = 0; i < CUBE_MAP_NUM_FACES; i++)
+				{
+					cubeFaces[i]->ReleaseTexels();
+				}
+			}
+
 			// Cleanup:
-			glBindTexture(cubeFaces[0]->texTarget, 0); // Otherwise, we leave the texture bound for the remaining RenderTexture BufferCubeMap()
+			glState.BindTexture(textureUnit, cubeFaces[0]->texTarget, 0); // Otherwise, we leave the texture bound for the remaining RenderTexture BufferCubeMap()
 		}
 
 		return true;
@@ -504,19 +1366,19 @@ namespace BlazeEngine
 
 	void Texture::Bind(int textureUnit, bool doBind)
 	{
-		glActiveTexture(GL_TEXTURE0 + textureUnit);
+		GLState& glState = GLState::Instance();
 
 		// Handle unbinding:
 		if (doBind == false)
 		{
-			glBindTexture(this->texTarget, 0);
-			glBindSampler(textureUnit, 0); // Assign to index/unit 0
+			glState.BindTexture(textureUnit, this->texTarget, 0);
+			glState.BindSampler(textureUnit, 0); // Assign to index/unit 0
 
 		}
 		else // Handle binding:
 		{			
-			glBindTexture(this->texTarget, this->textureID);
-			glBindSampler(textureUnit, this->samplerID); // Assign our named sampler to the texture
+			glState.BindTexture(textureUnit, this->texTarget, this->textureID);
+			glState.BindSampler(textureUnit, this->samplerID); // Assign our named sampler to the texture
 		}
 	}
 
@@ -535,9 +1397,85 @@ namespace BlazeEngine
 
 	void Texture::GenerateMipMaps()
 	{
-		glBindTexture(this->texTarget, this->textureID);
+		// Block compressed textures contain their own mip chain, and can't be rendered to:
+		if (IsCompressed())
+		{
+			return;
+		}
+
+		GLState& glState = GLState::Instance();
+
+		int const textureUnit = glm::max(glState.ActiveTextureUnit(), 0);
+
+		glState.BindTexture(textureUnit, this->texTarget, this->textureID);
 		glGenerateMipmap(this->texTarget);
-		glBindTexture(this->texTarget, 0);
+		glState.BindTexture(textureUnit, this->texTarget, 0);
+	}
+
+
+	void Texture::AllocateTexels()
+	{
+		if (this->texels != nullptr)
+		{
+			delete[] this->texels;
+		}
+
+		this->texels		= new unsigned char[this->numTexels * BytesPerTexel(this->format, this->type)];
+		this->isReleased	= false;
+		this->mipSizes.clear();
+	}
+
+
+	unsigned int Texture::TexelsSize() const
+	{
+		if (IsCompressed())
+		{
+			unsigned int totalSize = 0;
+			for (size_t i = 0; i < this->mipSizes.size(); i++)
+			{
+				totalSize += this->mipSizes[i];
+			}
+			return totalSize;
+		}
+
+		return this->numTexels * BytesPerTexel(this->format, this->type);
+	}
+
+
+	unsigned int Texture::NumChannels(GLenum format)
+	{
+		switch (format)
+		{
+		case GL_RED:
+			return 1;
+		case GL_RG:
+			return 2;
+		case GL_RGB:
+			return 3;
+		case GL_RGBA:
+		default:
+			return 4;
+		}
+	}
+
+
+	unsigned int Texture::BytesPerTexel(GLenum format, GLenum type)
+	{
+		unsigned int componentSize;
+		switch (type)
+		{
+		case GL_UNSIGNED_BYTE:
+			componentSize = 1;
+			break;
+		case GL_HALF_FLOAT:
+			componentSize = 2;
+			break;
+		case GL_FLOAT:
+		default:
+			componentSize = 4;
+		}
+
+		return NumChannels(format) * componentSize;
 	}
 }
 
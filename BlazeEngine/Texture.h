@@ -4,13 +4,18 @@
 #include "glm.hpp"
 
 #include <string>
+#include <vector>
 
 using glm::vec4;
 using std::string;
+using std::vector;
 
 
 #define TEXTURE_ERROR_COLOR_VEC4	vec4(1.0f, 0.0f, 0.0f, 1.0f)
 
+#define TEXTURE_CONTAINER_EXTENSION	".btex"		// Block compressed texture containers are cached next to their source image
+#define TEXTURE_CONTAINER_VERSION	1
+
 
 namespace BlazeEngine
 {
@@ -49,9 +54,28 @@ namespace BlazeEngine
 
 		inline string&				TexturePath()		{ return texturePath; }
 
-		// Get/set a texel value:
-		// Returns texels[0] if u = [0, width - 1], v = [0, height - 1] are out of localBounds.
-		vec4& Texel(unsigned int u, unsigned int v); // u == x == col, v == y == row
+		inline bool					IsCompressed() const	{ return !mipSizes.empty(); }
+		inline bool					HasContainer() const	{ return hasContainer; }
+
+		// Block compressed textures only: Mip chain sizes, in bytes
+		inline unsigned int			NumMipLevels() const				{ return (unsigned int)mipSizes.size(); }
+		inline unsigned int			MipSize(unsigned int level) const	{ return mipSizes[level]; }
+		unsigned int				MipLevelForSize(unsigned int maxSize) const;	// Largest level with both dimensions <= maxSize
+
+		// Get/set a texel value, converted from/to the texture's native format. Missing channels read as (0, 0, 0, 1)
+		// Out of bounds accesses (u = [0, width - 1], v = [0, height - 1]) are logged, and return the error color/are ignored
+		vec4 GetTexel(unsigned int u, unsigned int v) const; // u == x == col, v == y == row
+		void SetTexel(unsigned int u, unsigned int v, vec4 const& value);
+
+		// Convert every texel to RGBA floats, row by row, into destination (Width() * Height() * 4 floats). Vectorized: Prefer this to
+		// GetTexel() for whole textures. Returns false if the texels were released or are block compressed
+		bool GetTexelsRGBA(float* destination, bool convertSRGBToLinear = false) const;
+
+		// Returns false if any texel has alpha < 1. Textures without an alpha channel are always opaque
+		bool IsOpaque() const;
+
+		// 64-bit xxHash of the texels and their dimensions/format. Used to share identical textures that aren't backed by a file
+		unsigned long long ContentHash() const;
 
 		// Fill texture with a solid color
 		void Fill(vec4 color);
@@ -62,6 +86,26 @@ namespace BlazeEngine
 		// Initialization:
 		bool Buffer(int textureUnit);	// Upload a texture to the GPU. Returns true if successful, false otherwise
 
+		// Replace the texels with block compressed data, containing every mip level (largest first) back to back. Takes ownership of data
+		void SetCompressedTexels(GLenum compressedFormat, unsigned char* data, vector<unsigned int> const& mipSizes);
+
+		// Write the block compressed texels to a container at TexturePath() + TEXTURE_CONTAINER_EXTENSION. Returns true if successful
+		bool WriteTextureContainer(int quality);
+
+		// Streaming: Only levels [ResidentLevel(), NumMipLevels()) of a block compressed texture are on the GPU. Before the texture
+		// is buffered, this just sets the levels Buffer() uploads. Afterwards, the GPU storage is reallocated to fit: Either dropping
+		// levels, or adding the next finer level from levelData (ie. newResidentLevel == ResidentLevel() - 1). Returns true if successful
+		bool SetResidentLevel(unsigned int newResidentLevel, unsigned char const* levelData = nullptr);
+		inline unsigned int ResidentLevel() const	{ return residentLevel; }
+		size_t ResidentSize() const;				// Size of the resident levels, in bytes
+
+		// Free the CPU copy of the texels. The GPU copy is unaffected, but can't be re-uploaded. Called by Buffer() if the
+		// "releaseTextureCPUData" config value is set
+		void ReleaseTexels();
+
+		// Delete the GPU copy of the texture (eg. once it has been copied into a texture array). TextureID() is 0 afterwards
+		void ReleaseGPUTexture();
+
 		// Bind the texture to its sampler for Shader sampling
 		void Bind(int textureUnit, bool doBind); // NOTE: GL_TEXTURE0 + textureUnit is what is bound when calling glActiveTexture()
 
@@ -81,14 +125,25 @@ namespace BlazeEngine
 		// NOTE: Use SceneManager::FindLoadTextureByPath() instead of accessing this function directly, to ensure duplicate textures can be shared
 		static Texture* LoadTextureFileFromPath(string texturePath, bool returnErrorTexIfNotFound = true, bool flipY = true);
 
+		// Load the block compressed container cached for a texture path. Returns nullptr if there is no container, or if it is older
+		// than the source image or was encoded at a different quality
+		static Texture* LoadTextureContainerFromPath(string texturePath, int quality);
+
+		// Read a single mip level from the container cached for a texture path. Safe to call from any thread. Returns true if successful
+		static bool LoadTextureContainerLevel(string texturePath, unsigned int level, vector<unsigned char>& levelData);
+
+		// 64-bit xxHash of a file's bytes: Identical images share a hash, whatever their path. Safe to call from any thread.
+		// Returns false if the file can't be read
+		static bool HashFile(string const& filePath, unsigned long long& hash);
+
 
 	protected:
 		GLuint textureID			= 0;
 		
 		GLenum texTarget			= GL_TEXTURE_2D;
-		GLenum format				= GL_RGBA;		// NOTE: Currently, BlazeEngine assumes all textures contain 4-channel vec4's (except for depth). If format != GL_RGBA, buffer will be packed with the wrong stride
-		GLenum internalFormat		= GL_RGBA32F;
-		GLenum type					= GL_FLOAT;
+		GLenum format				= GL_RGBA;			// Channels of the CPU texels: GL_RED, GL_RG, GL_RGB, or GL_RGBA
+		GLenum internalFormat		= GL_RGBA8;
+		GLenum type					= GL_UNSIGNED_BYTE;	// Component type of the CPU texels: GL_UNSIGNED_BYTE, GL_HALF_FLOAT, or GL_FLOAT
 
 		GLenum textureWrapS			= GL_REPEAT;
 		GLenum textureWrapT			= GL_REPEAT;
@@ -102,8 +157,13 @@ namespace BlazeEngine
 		unsigned int	width		= 1;		// # Cols
 		unsigned int	height		= 1;		// # Rows
 
-		vec4*			texels		= nullptr;
+		unsigned char*	texels		= nullptr;	// Tightly packed rows of format/type texels. nullptr for render textures, or once released
 		unsigned int	numTexels	= 0;
+		bool			isReleased	= false;	// The texels were uploaded, then released
+
+		vector<unsigned int> mipSizes;			// Block compressed textures only: Size of each level in texels, in bytes
+		unsigned int	residentLevel	= 0;	// Finest mip level on the GPU
+		bool			hasContainer	= false;	// The block compressed texels are cached on disk
 
 		vec4 texelSize				= vec4(-1, -1, -1, -1);
 
@@ -114,13 +174,19 @@ namespace BlazeEngine
 
 	private:	
 
+		// (Re)allocate the texels for the current dimensions, format and type. Contents are undefined
+		void AllocateTexels();
+
+		// Size of the texels, in bytes
+		unsigned int TexelsSize() const;
+
+
 		// Private static functions:
 		//--------------------------
 
-		// Helper functions for loading Low/High Dynamic Range image formats in LoadTextureFileFromPath()
-		// Note: targetTexture and imageData must be valid
-		static void LoadLDRHelper(Texture& targetTexture, const unsigned char* imageData, int width, int height, int numChannels);
-		static void LoadHDRHelper(Texture& targetTexture, const float* imageData, int width, int height, int numChannels);
+		// Size of a texel with the given CPU format and type, in bytes
+		static unsigned int BytesPerTexel(GLenum format, GLenum type);
+		static unsigned int NumChannels(GLenum format);
 	};
 }
 
@@ -0,0 +1,894 @@
+#include "TextureCompressor.h"
+#include "Texture.h"
+#include "BuildConfiguration.h"
+
+#include "glm.hpp"
+#include "gtc/packing.hpp"
+#include "gtc/color_space.hpp"
+
+#include <xmmintrin.h>	// SSE is always available on x64
+#include <thread>
+#include <vector>
+#include <limits>
+#include <cstring>
+
+using glm::vec3;
+using glm::vec4;
+using glm::mat4;
+using std::vector;
+
+
+namespace BlazeEngine
+{
+	namespace
+	{
+		// A block's texels, stored as channel planes so the index search can process 4 texels at once. Unused channels are 0
+		struct BlockTexels
+		{
+			alignas(16) float channels[4][16];
+		};
+
+		// Interpolation weights of 4-bit BC6H/BC7 indices, out of 64
+		const int BPTC_WEIGHTS_4[16] = { 0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64 };
+
+
+		// Find the closest palette entry to each texel. Returns the total squared error of the block
+		float FindIndices(BlockTexels const& block, int numChannels, vec4 const* palette, int numEntries, unsigned char indices[16])
+		{
+			float totalError = 0.0f;
+
+			for (int texel = 0; texel < 16; texel += 4)
+			{
+				__m128 values[4];
+				for (int channel = 0; channel < numChannels; channel++)
+				{
+					values[channel] = _mm_load_ps(&block.channels[channel][texel]);
+				}
+
+				__m128 bestError = _mm_set1_ps(std::numeric_limits<float>::max());
+				__m128 bestIndex = _mm_setzero_ps();
+				for (int entry = 0; entry < numEntries; entry++)
+				{
+					__m128 error = _mm_setzero_ps();
+					for (int channel = 0; channel < numChannels; channel++)
+					{
+						__m128 difference = _mm_sub_ps(values[channel], _mm_set1_ps(palette[entry][channel]));
+						error = _mm_add_ps(error, _mm_mul_ps(difference, difference));
+					}
+
+					__m128 isCloser	= _mm_cmplt_ps(error, bestError);
+					bestError		= _mm_min_ps(error, bestError);
+					bestIndex		= _mm_or_ps(_mm_and_ps(isCloser, _mm_set1_ps((float)entry)), _mm_andnot_ps(isCloser, bestIndex));
+				}
+
+				alignas(16) float errors[4];
+				alignas(16) float closest[4];
+				_mm_store_ps(errors, bestError);
+				_mm_store_ps(closest, bestIndex);
+
+				for (int i = 0; i < 4; i++)
+				{
+					indices[texel + i] = (unsigned char)closest[i];
+					totalError += errors[i];
+				}
+			}
+
+			return totalError;
+		}
+
+
+		// Fit a pair of endpoints, and the palette indices, to a block. The format policy describes how the endpoints are encoded:
+		//	NUM_ENTRIES:		Palette size. Palette entries are ordered by their interpolation weight
+		//	Weight(i):			Interpolation weight of palette entry i, in [0, 1]
+		//	Quantize(e0, e1):	Encode the endpoints into the policy, and replace them with their decoded values
+		//	Palette(palette):	Decode the palette from the encoded endpoints
+		// Returns the total squared error of the block
+		template<typename Policy>
+		float FitBlock(BlockTexels const& block, int numChannels, int quality, Policy& policy, unsigned char indices[16])
+		{
+			vec4 minValue(std::numeric_limits<float>::max());
+			vec4 maxValue(-std::numeric_limits<float>::max());
+			vec4 mean(0.0f);
+			for (int texel = 0; texel < 16; texel++)
+			{
+				for (int channel = 0; channel < numChannels; channel++)
+				{
+					float value			= block.channels[channel][texel];
+					minValue[channel]	= glm::min(minValue[channel], value);
+					maxValue[channel]	= glm::max(maxValue[channel], value);
+					mean[channel]		+= value;
+				}
+			}
+			mean /= 16.0f;
+
+			for (int channel = numChannels; channel < 4; channel++)
+			{
+				minValue[channel] = maxValue[channel] = 0.0f;
+			}
+
+			vec4 endpoint0 = minValue;
+			vec4 endpoint1 = maxValue;
+			if (quality > TEXTURE_COMPRESSOR_QUALITY_FAST)
+			{
+				// Principal axis of the texels, via power iteration on their covariance:
+				mat4 covariance(0.0f);
+				for (int texel = 0; texel < 16; texel++)
+				{
+					vec4 offset(0.0f);
+					for (int channel = 0; channel < numChannels; channel++)
+					{
+						offset[channel] = block.channels[channel][texel] - mean[channel];
+					}
+					covariance += glm::outerProduct(offset, offset);
+				}
+
+				vec4 axis = maxValue - minValue;
+				for (int channel = numChannels; channel < 4; channel++)
+				{
+					axis[channel] = 0.0f;
+				}
+				for (int iteration = 0; iteration < 8; iteration++)
+				{
+					vec4 nextAxis	= covariance * axis;
+					float scale		= glm::max(glm::max(glm::abs(nextAxis.x), glm::abs(nextAxis.y)), glm::max(glm::abs(nextAxis.z), glm::abs(nextAxis.w)));
+					if (scale <= 0.0f)
+					{
+						break; // Flat block: Keep the bounding box diagonal
+					}
+					axis = nextAxis / scale;
+				}
+
+				float axisLength2 = glm::dot(axis, axis);
+				if (axisLength2 > 0.0f)
+				{
+					// Endpoints span the texels' projections onto the axis:
+					float minProjection = std::numeric_limits<float>::max();
+					float maxProjection = -std::numeric_limits<float>::max();
+					for (int texel = 0; texel < 16; texel++)
+					{
+						vec4 offset(0.0f);
+						for (int channel = 0; channel < numChannels; channel++)
+						{
+							offset[channel] = block.channels[channel][texel] - mean[channel];
+						}
+
+						float projection	= glm::dot(offset, axis) / axisLength2;
+						minProjection		= glm::min(minProjection, projection);
+						maxProjection		= glm::max(maxProjection, projection);
+					}
+
+					endpoint0 = mean + (axis * minProjection);
+					endpoint1 = mean + (axis * maxProjection);
+				}
+			}
+
+			vec4 palette[Policy::NUM_ENTRIES];
+			policy.Quantize(endpoint0, endpoint1);
+			policy.Palette(palette);
+			float bestError = FindIndices(block, numChannels, palette, Policy::NUM_ENTRIES, indices);
+
+			// Refine: Solve for the endpoints that minimize the error of the chosen indices, and keep them while they improve the block
+			const int numIterations = quality == TEXTURE_COMPRESSOR_QUALITY_FAST ? 0 : (quality == TEXTURE_COMPRESSOR_QUALITY_NORMAL ? 1 : 4);
+			for (int iteration = 0; iteration < numIterations && bestError > 0.0f; iteration++)
+			{
+				float a = 0.0f, b = 0.0f, c = 0.0f;
+				vec4 ax(0.0f), bx(0.0f);
+				for (int texel = 0; texel < 16; texel++)
+				{
+					float weight		= Policy::Weight(indices[texel]);
+					float inverseWeight	= 1.0f - weight;
+
+					a += inverseWeight * inverseWeight;
+					b += inverseWeight * weight;
+					c += weight * weight;
+					for (int channel = 0; channel < numChannels; channel++)
+					{
+						ax[channel] += inverseWeight * block.channels[channel][texel];
+						bx[channel] += weight * block.channels[channel][texel];
+					}
+				}
+
+				float determinant = (a * c) - (b * b);
+				if (glm::abs(determinant) < 1e-6f)
+				{
+					break; // Every texel uses the same index
+				}
+
+				endpoint0 = ((c * ax) - (b * bx)) / determinant;
+				endpoint1 = ((a * bx) - (b * ax)) / determinant;
+
+				Policy candidate = policy;
+				candidate.Quantize(endpoint0, endpoint1);
+				candidate.Palette(palette);
+
+				unsigned char candidateIndices[16];
+				float candidateError = FindIndices(block, numChannels, palette, Policy::NUM_ENTRIES, candidateIndices);
+				if (candidateError >= bestError)
+				{
+					break;
+				}
+
+				bestError	= candidateError;
+				policy		= candidate;
+				memcpy(indices, candidateIndices, 16);
+			}
+
+			return bestError;
+		}
+
+
+		// Format policies:
+		//-----------------
+
+		// BC1: RGB565 endpoints, 2 interpolated colors
+		struct BC1Policy
+		{
+			static const int NUM_ENTRIES = 4;
+
+			unsigned short	color0		= 0;
+			unsigned short	color1		= 0;
+			vec4			endpoints[2];
+
+			static float Weight(int index) { return (float)index / 3.0f; }
+
+			static unsigned short Encode565(vec4 const& color)
+			{
+				vec4 clamped = glm::clamp(color, 0.0f, 255.0f);
+				unsigned int r = (unsigned int)((clamped.r * 31.0f / 255.0f) + 0.5f);
+				unsigned int g = (unsigned int)((clamped.g * 63.0f / 255.0f) + 0.5f);
+				unsigned int b = (unsigned int)((clamped.b * 31.0f / 255.0f) + 0.5f);
+				return (unsigned short)((r << 11) | (g << 5) | b);
+			}
+
+			static vec4 Decode565(unsigned short color)
+			{
+				unsigned int r = (color >> 11) & 31;
+				unsigned int g = (color >> 5) & 63;
+				unsigned int b = color & 31;
+				return vec4((float)((r << 3) | (r >> 2)), (float)((g << 2) | (g >> 4)), (float)((b << 3) | (b >> 2)), 0.0f);
+			}
+
+			void Quantize(vec4& endpoint0, vec4& endpoint1)
+			{
+				color0			= Encode565(endpoint0);
+				color1			= Encode565(endpoint1);
+				endpoints[0]	= endpoint0 = Decode565(color0);
+				endpoints[1]	= endpoint1 = Decode565(color1);
+			}
+
+			void Palette(vec4* palette) const
+			{
+				for (int i = 0; i < NUM_ENTRIES; i++)
+				{
+					palette[i] = glm::mix(endpoints[0], endpoints[1], Weight(i));
+				}
+			}
+		};
+
+
+		// BC4: 8-bit endpoints, 6 interpolated values
+		struct BC4Policy
+		{
+			static const int NUM_ENTRIES = 8;
+
+			unsigned char	value0		= 0;
+			unsigned char	value1		= 0;
+
+			static float Weight(int index) { return (float)index / 7.0f; }
+
+			void Quantize(vec4& endpoint0, vec4& endpoint1)
+			{
+				value0		= (unsigned char)(glm::clamp(endpoint0.x, 0.0f, 255.0f) + 0.5f);
+				value1		= (unsigned char)(glm::clamp(endpoint1.x, 0.0f, 255.0f) + 0.5f);
+				endpoint0	= vec4((float)value0, 0.0f, 0.0f, 0.0f);
+				endpoint1	= vec4((float)value1, 0.0f, 0.0f, 0.0f);
+			}
+
+			void Palette(vec4* palette) const
+			{
+				for (int i = 0; i < NUM_ENTRIES; i++)
+				{
+					palette[i] = vec4(glm::mix((float)value0, (float)value1, Weight(i)), 0.0f, 0.0f, 0.0f);
+				}
+			}
+		};
+
+
+		// BC7 mode 6: A single subset of RGBA 7-bit endpoints with a p-bit each, and 4-bit indices
+		struct BC7Policy
+		{
+			static const int NUM_ENTRIES = 16;
+
+			unsigned char	codes[2][4]	= {};
+			unsigned char	pBits[2]	= {};
+			int				values[2][4] = {};	// Decoded 8-bit endpoints
+
+			static float Weight(int index) { return (float)BPTC_WEIGHTS_4[index] / 64.0f; }
+
+			// Choose the p-bit that best fits all 4 channels of an endpoint
+			void QuantizeEndpoint(int endpoint, vec4& value)
+			{
+				vec4 clamped		= glm::clamp(value, 0.0f, 255.0f);
+				float bestError		= std::numeric_limits<float>::max();
+				for (int pBit = 0; pBit < 2; pBit++)
+				{
+					unsigned char candidate[4];
+					float error = 0.0f;
+					for (int channel = 0; channel < 4; channel++)
+					{
+						int code			= glm::clamp((int)(((clamped[channel] - pBit) * 0.5f) + 0.5f), 0, 127);
+						float difference	= (float)((code << 1) | pBit) - clamped[channel];
+
+						candidate[channel]	= (unsigned char)code;
+						error				+= difference * difference;
+					}
+
+					if (error < bestError)
+					{
+						bestError		= error;
+						pBits[endpoint]	= (unsigned char)pBit;
+						memcpy(codes[endpoint], candidate, 4);
+					}
+				}
+
+				for (int channel = 0; channel < 4; channel++)
+				{
+					values[endpoint][channel]	= (codes[endpoint][channel] << 1) | pBits[endpoint];
+					value[channel]				= (float)values[endpoint][channel];
+				}
+			}
+
+			void Quantize(vec4& endpoint0, vec4& endpoint1)
+			{
+				QuantizeEndpoint(0, endpoint0);
+				QuantizeEndpoint(1, endpoint1);
+			}
+
+			void Palette(vec4* palette) const
+			{
+				for (int i = 0; i < NUM_ENTRIES; i++)
+				{
+					for (int channel = 0; channel < 4; channel++)
+					{
+						palette[i][channel] = (float)((((64 - BPTC_WEIGHTS_4[i]) * values[0][channel]) + (BPTC_WEIGHTS_4[i] * values[1][channel]) + 32) >> 6);
+					}
+				}
+			}
+		};
+
+
+		// BC6H mode 11: A single region of unsigned 10-bit RGB endpoints, and 4-bit indices. Texels are half float bit patterns,
+		// prescaled by 64/31 so they match the interpolated values the decoder rescales by 31/64
+		struct BC6HPolicy
+		{
+			static const int NUM_ENTRIES = 16;
+
+			unsigned short	codes[2][3]		= {};
+			int				values[2][3]	= {};	// Unquantized 16-bit endpoints
+
+			static float Weight(int index) { return (float)BPTC_WEIGHTS_4[index] / 64.0f; }
+
+			static int Unquantize(int code)
+			{
+				if (code == 0)
+				{
+					return 0;
+				}
+				else if (code == 1023)
+				{
+					return 0xFFFF;
+				}
+				return ((code << 16) + 0x8000) >> 10;
+			}
+
+			void Quantize(vec4& endpoint0, vec4& endpoint1)
+			{
+				vec4* endpoints[2] = { &endpoint0, &endpoint1 };
+				for (int endpoint = 0; endpoint < 2; endpoint++)
+				{
+					for (int channel = 0; channel < 3; channel++)
+					{
+						int code = glm::clamp((int)(((*endpoints[endpoint])[channel] - 32.0f) / 64.0f + 0.5f), 0, 1023);
+
+						codes[endpoint][channel]		= (unsigned short)code;
+						values[endpoint][channel]		= Unquantize(code);
+						(*endpoints[endpoint])[channel]	= (float)values[endpoint][channel];
+					}
+				}
+			}
+
+			void Palette(vec4* palette) const
+			{
+				for (int i = 0; i < NUM_ENTRIES; i++)
+				{
+					for (int channel = 0; channel < 3; channel++)
+					{
+						palette[i][channel] = (float)((((64 - BPTC_WEIGHTS_4[i]) * values[0][channel]) + (BPTC_WEIGHTS_4[i] * values[1][channel]) + 32) >> 6);
+					}
+					palette[i].w = 0.0f;
+				}
+			}
+		};
+
+
+		// Block packing:
+		//---------------
+
+		// Write numBits of value into a block, least significant bit first
+		void WriteBits(unsigned char* block, int& bitOffset, unsigned int value, int numBits)
+		{
+			for (int bit = 0; bit < numBits; bit++, bitOffset++)
+			{
+				if ((value >> bit) & 1)
+				{
+					block[bitOffset >> 3] |= (unsigned char)(1 << (bitOffset & 7));
+				}
+			}
+		}
+
+
+		void EncodeBC1Block(BlockTexels const& block, int quality, unsigned char* output)
+		{
+			BC1Policy policy;
+			unsigned char indices[16];
+			FitBlock(block, 3, quality, policy, indices);
+
+			// color0 > color1 selects the 4 color mode. Palette entries, by weight, map to indices 0, 2, 3, 1:
+			const unsigned char BC1_INDICES[4] = { 0, 2, 3, 1 };
+			bool isSwapped = policy.color0 < policy.color1;
+			if (isSwapped)
+			{
+				std::swap(policy.color0, policy.color1);
+			}
+
+			unsigned int indexBits = 0;
+			if (policy.color0 != policy.color1) // Otherwise, every texel is color0
+			{
+				for (int texel = 0; texel < 16; texel++)
+				{
+					int entry = isSwapped ? 3 - indices[texel] : indices[texel];
+					indexBits |= (unsigned int)BC1_INDICES[entry] << (texel * 2);
+				}
+			}
+
+			output[0] = (unsigned char)(policy.color0 & 0xFF);
+			output[1] = (unsigned char)(policy.color0 >> 8);
+			output[2] = (unsigned char)(policy.color1 & 0xFF);
+			output[3] = (unsigned char)(policy.color1 >> 8);
+			memcpy(output + 4, &indexBits, 4);
+		}
+
+
+		// Encodes the given channel of the block
+		void EncodeBC4Block(BlockTexels const& block, int channel, int quality, unsigned char* output)
+		{
+			BlockTexels channelBlock = {};
+			memcpy(channelBlock.channels[0], block.channels[channel], sizeof(channelBlock.channels[0]));
+
+			BC4Policy policy;
+			unsigned char indices[16];
+			FitBlock(channelBlock, 1, quality, policy, indices);
+
+			// value0 > value1 selects the 8 value mode. Palette entries, by weight, map to indices 0, 2, 3, 4, 5, 6, 7, 1:
+			const unsigned char BC4_INDICES[8] = { 0, 2, 3, 4, 5, 6, 7, 1 };
+			bool isSwapped = policy.value0 < policy.value1;
+			if (isSwapped)
+			{
+				std::swap(policy.value0, policy.value1);
+			}
+
+			unsigned long long indexBits = 0;
+			if (policy.value0 != policy.value1) // Otherwise, every texel is value0
+			{
+				for (int texel = 0; texel < 16; texel++)
+				{
+					int entry = isSwapped ? 7 - indices[texel] : indices[texel];
+					indexBits |= (unsigned long long)BC4_INDICES[entry] << (texel * 3);
+				}
+			}
+
+			output[0] = policy.value0;
+			output[1] = policy.value1;
+			memcpy(output + 2, &indexBits, 6);
+		}
+
+
+		void EncodeBC7Block(BlockTexels const& block, int quality, unsigned char* output)
+		{
+			BC7Policy policy;
+			unsigned char indices[16];
+			FitBlock(block, 4, quality, policy, indices);
+
+			// The first texel's index is stored without its most significant bit, which must be 0: Swap the endpoints if it isn't
+			if (indices[0] >= 8)
+			{
+				std::swap(policy.codes[0], policy.codes[1]);
+				std::swap(policy.pBits[0], policy.pBits[1]);
+				for (int texel = 0; texel < 16; texel++)
+				{
+					indices[texel] = 15 - indices[texel];
+				}
+			}
+
+			memset(output, 0, 16);
+			int bitOffset = 0;
+			WriteBits(output, bitOffset, 1 << 6, 7);	// Mode 6
+			for (int channel = 0; channel < 4; channel++)
+			{
+				WriteBits(output, bitOffset, policy.codes[0][channel], 7);
+				WriteBits(output, bitOffset, policy.codes[1][channel], 7);
+			}
+			WriteBits(output, bitOffset, policy.pBits[0], 1);
+			WriteBits(output, bitOffset, policy.pBits[1], 1);
+			for (int texel = 0; texel < 16; texel++)
+			{
+				WriteBits(output, bitOffset, indices[texel], texel == 0 ? 3 : 4);
+			}
+		}
+
+
+		void EncodeBC6HBlock(BlockTexels const& block, int quality, unsigned char* output)
+		{
+			BC6HPolicy policy;
+			unsigned char indices[16];
+			FitBlock(block, 3, quality, policy, indices);
+
+			// The first texel's index is stored without its most significant bit, which must be 0: Swap the endpoints if it isn't
+			if (indices[0] >= 8)
+			{
+				std::swap(policy.codes[0], policy.codes[1]);
+				for (int texel = 0; texel < 16; texel++)
+				{
+					indices[texel] = 15 - indices[texel];
+				}
+			}
+
+			memset(output, 0, 16);
+			int bitOffset = 0;
+			WriteBits(output, bitOffset, 0x03, 5);		// Mode 11
+			for (int endpoint = 0; endpoint < 2; endpoint++)
+			{
+				for (int channel = 0; channel < 3; channel++)
+				{
+					WriteBits(output, bitOffset, policy.codes[endpoint][channel], 10);
+				}
+			}
+			for (int texel = 0; texel < 16; texel++)
+			{
+				WriteBits(output, bitOffset, indices[texel], texel == 0 ? 3 : 4);
+			}
+		}
+
+
+		// Mip chain helpers:
+		//-------------------
+
+		// Box filter a level of linear RGBA texels to half its size. Odd texels at the edges are folded into the last output texel
+		vector<float> DownsampleLevel(vector<float> const& texels, unsigned int width, unsigned int height, bool isNormalMap)
+		{
+			unsigned int nextWidth	= glm::max(width / 2, 1u);
+			unsigned int nextHeight	= glm::max(height / 2, 1u);
+
+			vector<float> nextTexels(nextWidth * nextHeight * 4, 0.0f);
+			for (unsigned int y = 0; y < nextHeight; y++)
+			{
+				unsigned int firstY	= y * 2;
+				unsigned int lastY	= (y == nextHeight - 1) ? height - 1 : glm::min(firstY + 1, height - 1);
+
+				for (unsigned int x = 0; x < nextWidth; x++)
+				{
+					unsigned int firstX	= x * 2;
+					unsigned int lastX	= (x == nextWidth - 1) ? width - 1 : glm::min(firstX + 1, width - 1);
+
+					vec4 sum(0.0f);
+					for (unsigned int sourceY = firstY; sourceY <= lastY; sourceY++)
+					{
+						for (unsigned int sourceX = firstX; sourceX <= lastX; sourceX++)
+						{
+							float const* source = &texels[((sourceY * width) + sourceX) * 4];
+							sum += vec4(source[0], source[1], source[2], source[3]);
+						}
+					}
+					vec4 average = sum / (float)((lastX - firstX + 1) * (lastY - firstY + 1));
+
+					// Averaged normals are shorter than unit length:
+					if (isNormalMap)
+					{
+						vec3 normal = (vec3(average) * 2.0f) - 1.0f;
+						if (glm::dot(normal, normal) > 0.0f)
+						{
+							average = vec4((glm::normalize(normal) * 0.5f) + 0.5f, average.w);
+						}
+					}
+
+					float* destination = &nextTexels[((y * nextWidth) + x) * 4];
+					destination[0] = average.x;
+					destination[1] = average.y;
+					destination[2] = average.z;
+					destination[3] = average.w;
+				}
+			}
+
+			return nextTexels;
+		}
+
+
+		// Convert linear RGBA texels into the space a format's blocks are fit in
+		vector<float> ToEncodingSpace(vector<float> const& texels, BC_FORMAT format, bool isSRGB)
+		{
+			vector<float> encoded(texels.size());
+			for (size_t i = 0; i < texels.size(); i += 4)
+			{
+				vec4 texel(texels[i], texels[i + 1], texels[i + 2], texels[i + 3]);
+
+				if (format == BC_FORMAT_BC6H)
+				{
+					// Half float bit patterns are roughly logarithmic, so fitting them directly spreads the error across the range:
+					for (int channel = 0; channel < 3; channel++)
+					{
+						float halfBits	= (float)glm::packHalf1x16(glm::clamp(texel[channel], 0.0f, 65504.0f));
+						texel[channel]	= halfBits * 64.0f / 31.0f;
+					}
+					texel.w = 0.0f;
+				}
+				else
+				{
+					if (isSRGB)
+					{
+						texel = vec4(glm::convertLinearToSRGB(glm::clamp(vec3(texel), 0.0f, 1.0f)), texel.w);
+					}
+					texel = glm::clamp(texel, 0.0f, 1.0f) * 255.0f;
+				}
+
+				encoded[i]		= texel.x;
+				encoded[i + 1]	= texel.y;
+				encoded[i + 2]	= texel.z;
+				encoded[i + 3]	= texel.w;
+			}
+
+			return encoded;
+		}
+	}
+
+
+	bool TextureCompressor::Compress(Texture* source, Texture* target, BC_FORMAT format, int quality, bool isSRGB, bool isNormalMap /*= false*/)
+	{
+		if (source->IsCompressed() || source->Width() == 0 || source->Height() == 0)
+		{
+			LOG_ERROR("Cannot compress texture \"" + source->TexturePath() + "\": It has no uncompressed texels");
+			return false;
+		}
+
+		isSRGB = isSRGB && format != BC_FORMAT_BC4 && format != BC_FORMAT_BC5 && format != BC_FORMAT_BC6H; // No sRGB variants
+
+		unsigned int width	= source->Width();
+		unsigned int height	= source->Height();
+
+		// Read the texels as linear RGBA, so the mips are filtered correctly:
+		vector<float> level(width * height * 4);
+		if (!source->GetTexelsRGBA(&level[0], isSRGB))
+		{
+			return false;
+		}
+
+		// Match the full mip chain Texture::Buffer() allocates:
+		int numMipLevels = (int)glm::log2((float)glm::max(width, height)) + 1;
+
+		vector<unsigned int> mipSizes(numMipLevels);
+		unsigned int totalSize = 0;
+		for (int mip = 0; mip < numMipLevels; mip++)
+		{
+			mipSizes[mip]	= LevelBytes(format, glm::max(width >> mip, 1u), glm::max(height >> mip, 1u));
+			totalSize		+= mipSizes[mip];
+		}
+
+		unsigned char* data				= new unsigned char[totalSize];
+		unsigned char* currentOutput	= data;
+		for (int mip = 0; mip < numMipLevels; mip++)
+		{
+			unsigned int levelWidth		= glm::max(width >> mip, 1u);
+			unsigned int levelHeight	= glm::max(height >> mip, 1u);
+
+			vector<float> encodingTexels = ToEncodingSpace(level, format, isSRGB);
+
+			// Encode in parallel. Threads process disjoint bands of block rows:
+			unsigned int numBlockRows	= (levelHeight + TEXTURE_COMPRESSOR_BLOCK_SIZE - 1) / TEXTURE_COMPRESSOR_BLOCK_SIZE;
+			unsigned int numThreads		= glm::min<unsigned int>(std::thread::hardware_concurrency(), numBlockRows / TEXTURE_COMPRESSOR_MIN_ROWS_PER_THREAD);
+			if (numThreads > 1)
+			{
+				unsigned int rowsPerThread = (numBlockRows + numThreads - 1) / numThreads;
+
+				vector<std::thread> workers;
+				workers.reserve(numThreads - 1);
+				for (unsigned int currentThread = 1; currentThread < numThreads; currentThread++)
+				{
+					unsigned int firstRow	= currentThread * rowsPerThread;
+					unsigned int lastRow	= glm::min(firstRow + rowsPerThread, numBlockRows);
+
+					workers.emplace_back(&TextureCompressor::EncodeRows, format, quality, &encodingTexels[0], levelWidth, levelHeight, firstRow, lastRow, currentOutput);
+				}
+
+				EncodeRows(format, quality, &encodingTexels[0], levelWidth, levelHeight, 0, rowsPerThread, currentOutput); // The calling thread encodes the first band
+
+				for (size_t i = 0; i < workers.size(); i++)
+				{
+					workers[i].join();
+				}
+			}
+			else
+			{
+				EncodeRows(format, quality, &encodingTexels[0], levelWidth, levelHeight, 0, numBlockRows, currentOutput);
+			}
+
+			currentOutput += mipSizes[mip];
+
+			if (mip < numMipLevels - 1)
+			{
+				level = DownsampleLevel(level, levelWidth, levelHeight, isNormalMap);
+			}
+		}
+
+		LOG("Compressed \"" + source->TexturePath() + "\" to " + to_string(totalSize) + " bytes (" + to_string(numMipLevels) + " mip levels)");
+
+		target->SetCompressedTexels(CompressedFormat(format, isSRGB), data, mipSizes);
+
+		return true;
+	}
+
+
+	void TextureCompressor::EncodeRows(BC_FORMAT format, int quality, float const* texels, unsigned int width, unsigned int height, unsigned int firstRow, unsigned int lastRow, unsigned char* output)
+	{
+		unsigned int const numBlockColumns	= (width + TEXTURE_COMPRESSOR_BLOCK_SIZE - 1) / TEXTURE_COMPRESSOR_BLOCK_SIZE;
+		unsigned int const blockBytes		= BlockBytes(format);
+
+		BlockTexels block;
+		for (unsigned int blockRow = firstRow; blockRow < lastRow; blockRow++)
+		{
+			for (unsigned int blockColumn = 0; blockColumn < numBlockColumns; blockColumn++)
+			{
+				// Gather the block. Blocks overhanging the edges repeat the last row/column:
+				for (unsigned int y = 0; y < TEXTURE_COMPRESSOR_BLOCK_SIZE; y++)
+				{
+					unsigned int sourceY = glm::min((blockRow * TEXTURE_COMPRESSOR_BLOCK_SIZE) + y, height - 1);
+					for (unsigned int x = 0; x < TEXTURE_COMPRESSOR_BLOCK_SIZE; x++)
+					{
+						unsigned int sourceX	= glm::min((blockColumn * TEXTURE_COMPRESSOR_BLOCK_SIZE) + x, width - 1);
+						float const* source		= &texels[((sourceY * width) + sourceX) * 4];
+
+						unsigned int texel = (y * TEXTURE_COMPRESSOR_BLOCK_SIZE) + x;
+						for (int channel = 0; channel < 4; channel++)
+						{
+							block.channels[channel][texel] = source[channel];
+						}
+					}
+				}
+
+				unsigned char* blockOutput = output + (((blockRow * numBlockColumns) + blockColumn) * blockBytes);
+				switch (format)
+				{
+				case BC_FORMAT_BC1:
+					EncodeBC1Block(block, quality, blockOutput);
+					break;
+
+				case BC_FORMAT_BC3:
+					EncodeBC4Block(block, 3, quality, blockOutput);		// Alpha
+					EncodeBC1Block(block, quality, blockOutput + 8);	// Color
+					break;
+
+				case BC_FORMAT_BC4:
+					EncodeBC4Block(block, 0, quality, blockOutput);
+					break;
+
+				case BC_FORMAT_BC5:
+					EncodeBC4Block(block, 0, quality, blockOutput);
+					EncodeBC4Block(block, 1, quality, blockOutput + 8);
+					break;
+
+				case BC_FORMAT_BC6H:
+					EncodeBC6HBlock(block, quality, blockOutput);
+					break;
+
+				case BC_FORMAT_BC7:
+					EncodeBC7Block(block, quality, blockOutput);
+					break;
+
+				default:
+					break;
+				}
+			}
+		}
+	}
+
+
+	BC_FORMAT TextureCompressor::SelectFormat(Texture* texture, int quality, bool isNormalMap)
+	{
+		if (texture->Type() == GL_HALF_FLOAT || texture->Type() == GL_FLOAT)
+		{
+			return BC_FORMAT_BC6H;
+		}
+		else if (isNormalMap)
+		{
+			return BC_FORMAT_BC5;
+		}
+		else if (texture->Format() == GL_RED)
+		{
+			return BC_FORMAT_BC4;
+		}
+		else if (quality >= TEXTURE_COMPRESSOR_QUALITY_HIGH)
+		{
+			return BC_FORMAT_BC7;
+		}
+
+		// Only spend the extra bits on alpha if some texels aren't opaque:
+		if (!texture->IsOpaque())
+		{
+			return BC_FORMAT_BC3;
+		}
+
+		return BC_FORMAT_BC1;
+	}
+
+
+	GLenum TextureCompressor::CompressedFormat(BC_FORMAT format, bool isSRGB)
+	{
+		switch (format)
+		{
+		case BC_FORMAT_BC1:
+			return isSRGB ? GL_COMPRESSED_SRGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+
+		case BC_FORMAT_BC3:
+			return isSRGB ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+
+		case BC_FORMAT_BC4:
+			return GL_COMPRESSED_RED_RGTC1;
+
+		case BC_FORMAT_BC5:
+			return GL_COMPRESSED_RG_RGTC2;
+
+		case BC_FORMAT_BC6H:
+			return GL_COMPRESSED_RGB_BPTC_UNSIGNED_FLOAT;
+
+		case BC_FORMAT_BC7:
+		default:
+			return isSRGB ? GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM : GL_COMPRESSED_RGBA_BPTC_UNORM;
+		}
+	}
+
+
+	bool TextureCompressor::IsSRGBFormat(GLenum compressedFormat)
+	{
+		return compressedFormat == GL_COMPRESSED_SRGB_S3TC_DXT1_EXT || compressedFormat == GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT ||
+			compressedFormat == GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM;
+	}
+
+
+	bool TextureCompressor::GetFormat(GLenum compressedFormat, BC_FORMAT& format)
+	{
+		for (int currentFormat = 0; currentFormat < BC_FORMAT_COUNT; currentFormat++)
+		{
+			if (CompressedFormat((BC_FORMAT)currentFormat, false) == compressedFormat || CompressedFormat((BC_FORMAT)currentFormat, true) == compressedFormat)
+			{
+				format = (BC_FORMAT)currentFormat;
+				return true;
+			}
+		}
+		return false;
+	}
+
+
+	unsigned int TextureCompressor::BlockBytes(BC_FORMAT format)
+	{
+		return (format == BC_FORMAT_BC1 || format == BC_FORMAT_BC4) ? 8 : 16;
+	}
+
+
+	unsigned int TextureCompressor::LevelBytes(BC_FORMAT format, unsigned int width, unsigned int height)
+	{
+		unsigned int numBlocksX = (width + TEXTURE_COMPRESSOR_BLOCK_SIZE - 1) / TEXTURE_COMPRESSOR_BLOCK_SIZE;
+		unsigned int numBlocksY = (height + TEXTURE_COMPRESSOR_BLOCK_SIZE - 1) / TEXTURE_COMPRESSOR_BLOCK_SIZE;
+
+		return numBlocksX * numBlocksY * BlockBytes(format);
+	}
+}
+
+
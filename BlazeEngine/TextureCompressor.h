@@ -0,0 +1,68 @@
+// Block compression texture encoder
+// Encodes Texture texels into BCn formats on the CPU, including a full mip chain, so the results can be cached on disk in a texture
+// container and uploaded directly with glCompressedTexSubImage2D. Blocks are fit using the principal axis of their texels, refined
+// with least squares iterations depending on the quality level. Block rows are encoded in parallel, and the index search uses SSE
+
+#pragma once
+
+#include <GL/glew.h>
+
+
+#define TEXTURE_COMPRESSOR_BLOCK_SIZE				4		// BCn blocks are 4x4 texels
+#define TEXTURE_COMPRESSOR_MIN_ROWS_PER_THREAD		16		// Minimum number of block rows to give a worker thread
+
+#define TEXTURE_COMPRESSOR_QUALITY_FAST				0		// Bounding box endpoints, no refinement
+#define TEXTURE_COMPRESSOR_QUALITY_NORMAL			1		// Principal axis endpoints, 1 refinement iteration
+#define TEXTURE_COMPRESSOR_QUALITY_HIGH				2		// Principal axis endpoints, 4 refinement iterations. Also selects BC7 over BC1/BC3
+
+
+namespace BlazeEngine
+{
+	class Texture;
+
+	enum BC_FORMAT
+	{
+		BC_FORMAT_BC1,		// RGB, 4bpp. Albedo without alpha
+		BC_FORMAT_BC3,		// RGBA, 8bpp. Albedo with alpha
+		BC_FORMAT_BC4,		// R, 4bpp. Single channel data
+		BC_FORMAT_BC5,		// RG, 8bpp. Tangent space normal maps: Z is reconstructed in the shader
+		BC_FORMAT_BC6H,		// HDR RGB, 8bpp. Unsigned half floats
+		BC_FORMAT_BC7,		// RGBA, 8bpp. High quality LDR color
+
+		BC_FORMAT_COUNT
+	};
+
+
+	class TextureCompressor
+	{
+	public:
+		// Encode the source texture's texels and mip chain, and store the result in the target texture. Source and target may be the
+		// same texture. Normal maps are renormalized as their mips are filtered. sRGB formats are filtered in linear space.
+		// Returns true if successful, false otherwise (eg. the source is already compressed)
+		static bool Compress(Texture* source, Texture* target, BC_FORMAT format, int quality, bool isSRGB, bool isNormalMap = false);
+
+		// Choose a format for a texture's contents: BC6H for HDR, BC5 for normal maps, BC4 for single channels, and BC1/BC3 (opaque/
+		// translucent) or BC7 (high quality) for color
+		static BC_FORMAT SelectFormat(Texture* texture, int quality, bool isNormalMap);
+
+		// Get the GL compressed internal format for a BC format. Formats without an sRGB variant ignore isSRGB
+		static GLenum CompressedFormat(BC_FORMAT format, bool isSRGB);
+		static bool IsSRGBFormat(GLenum compressedFormat);
+
+		// Get the BC format of a GL compressed internal format. Returns false if it isn't one returned by CompressedFormat()
+		static bool GetFormat(GLenum compressedFormat, BC_FORMAT& format);
+
+		// Size of an encoded block, in bytes
+		static unsigned int BlockBytes(BC_FORMAT format);
+
+		// Size of an encoded level with the given dimensions, in bytes
+		static unsigned int LevelBytes(BC_FORMAT format, unsigned int width, unsigned int height);
+
+
+	private:
+		// Encode the blocks in rows [firstRow, lastRow) of a level. Texels are RGBA floats, in the format's encoding space
+		static void EncodeRows(BC_FORMAT format, int quality, float const* texels, unsigned int width, unsigned int height, unsigned int firstRow, unsigned int lastRow, unsigned char* output);
+	};
+}
+
+
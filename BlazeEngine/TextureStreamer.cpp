@@ -0,0 +1,296 @@
+// Member class of the RenderManager. Streams material texture mip levels within a GPU memory budget
+
+#include "TextureStreamer.h"
+#include "BuildConfiguration.h"
+#include "Texture.h"
+#include "Material.h"
+#include "Mesh.h"
+#include "WorldBounds.h"
+
+#include <algorithm>
+
+
+namespace BlazeEngine
+{
+	TextureStreamer::TextureStreamer(size_t budgetBytes)
+	{
+		this->budgetBytes	= budgetBytes;
+		this->loaderThread	= std::thread(&TextureStreamer::LoaderMain, this);
+	}
+
+
+	TextureStreamer::~TextureStreamer()
+	{
+		{
+			std::lock_guard<std::mutex> lock(this->loadMutex);
+			this->isStopping = true;
+		}
+		this->loadCondition.notify_one();
+
+		this->loaderThread.join();
+	}
+
+
+	void TextureStreamer::Initialize(unordered_map<string, Material*> const& materials)
+	{
+		this->textures.clear();
+		this->materialTextures.clear();
+
+		// Textures can be shared between materials: Register each one once
+		unordered_map<Texture*, unsigned int> textureIndexes;
+
+		for (auto const& currentMaterial : materials)
+		{
+			vector<unsigned int>& currentIndexes = this->materialTextures[currentMaterial.second];
+
+			for (int i = 0; i < currentMaterial.second->NumTextureSlots(); i++)
+			{
+				Texture* currentTexture = currentMaterial.second->AccessTexture((TEXTURE_TYPE)i);
+				// Note: Textures copied into material texture arrays no longer have a GPU texture of their own
+				if (currentTexture == nullptr || !currentTexture->IsCompressed() || !currentTexture->HasContainer() || currentTexture->TextureID() == 0)
+				{
+					continue;
+				}
+
+				unordered_map<Texture*, unsigned int>::iterator result = textureIndexes.find(currentTexture);
+				if (result == textureIndexes.end())
+				{
+					StreamedTexture newTexture;
+					newTexture.texture		= currentTexture;
+					newTexture.tailLevel	= currentTexture->ResidentLevel();
+					newTexture.desiredLevel	= currentTexture->ResidentLevel();
+
+					result = textureIndexes.emplace(currentTexture, (unsigned int)this->textures.size()).first;
+					this->textures.push_back(newTexture);
+				}
+
+				currentIndexes.push_back(result->second);
+			}
+		}
+
+		LOG("Texture streamer registered " + to_string(this->textures.size()) + " textures");
+	}
+
+
+	void TextureStreamer::Update(vector<Mesh*> const& visibleMeshes, WorldBounds const& worldBounds, vec3 camPosition, float projectionScale, float maxScreenSize)
+	{
+		if (this->textures.empty())
+		{
+			return;
+		}
+
+		this->frameNumber++;
+
+		// Unused textures only need their tails:
+		for (unsigned int i = 0; i < (unsigned int)this->textures.size(); i++)
+		{
+			this->textures[i].desiredLevel = this->textures[i].tailLevel;
+		}
+
+		// Find the finest level each texture needs, from the projected size of the meshes using it. This assumes the texture spans
+		// the mesh once: A level is needed if it has fewer texels than the mesh covers pixels
+		for (unsigned int i = 0; i < (unsigned int)visibleMeshes.size(); i++)
+		{
+			unordered_map<Material*, vector<unsigned int>>::const_iterator result = this->materialTextures.find(visibleMeshes[i]->MeshMaterial());
+			int boundsIndex = worldBounds.IndexOf(visibleMeshes[i]);
+			if (result == this->materialTextures.end() || result->second.empty() || boundsIndex < 0)
+			{
+				continue;
+			}
+
+			Bounds meshBounds	= worldBounds.GetBounds(boundsIndex);
+			vec3 boundsMin		= vec3(meshBounds.xMin, meshBounds.yMin, meshBounds.zMin);
+			vec3 boundsMax		= vec3(meshBounds.xMax, meshBounds.yMax, meshBounds.zMax);
+
+			float radius		= 0.5f * glm::length(boundsMax - boundsMin);
+			float distance		= glm::length(0.5f * (boundsMin + boundsMax) - camPosition);
+			float screenSize	= distance <= radius ? maxScreenSize : glm::min(2.0f * (radius / distance) * projectionScale, maxScreenSize);
+
+			for (unsigned int j = 0; j < (unsigned int)result->second.size(); j++)
+			{
+				StreamedTexture& currentTexture = this->textures[result->second[j]];
+
+				float textureSize		= (float)glm::max(currentTexture.texture->Width(), currentTexture.texture->Height());
+				unsigned int level		= (unsigned int)glm::max(glm::floor(glm::log2(textureSize / glm::max(screenSize, 1.0f))), 0.0f);
+
+				currentTexture.desiredLevel		= glm::min(currentTexture.desiredLevel, level);
+				currentTexture.lastUsedFrame	= this->frameNumber;
+			}
+		}
+
+		UploadCompletedLoads();
+
+		this->residentSize = 0;
+		for (unsigned int i = 0; i < (unsigned int)this->textures.size(); i++)
+		{
+			this->residentSize += this->textures[i].texture->ResidentSize();
+		}
+
+		// Enforce the budget (eg. if the levels that were needed changed since they were loaded):
+		while (this->residentSize > this->budgetBytes && EvictLevel());
+
+		RequestLoads();
+	}
+
+
+	void TextureStreamer::UploadCompletedLoads()
+	{
+		deque<LoadRequest> uploads;
+		{
+			std::lock_guard<std::mutex> lock(this->loadMutex);
+			while (!this->completedLoads.empty() && uploads.size() < TEXTURE_STREAMER_MAX_UPLOADS_PER_FRAME)
+			{
+				uploads.push_back(std::move(this->completedLoads.front()));
+				this->completedLoads.pop_front();
+			}
+		}
+
+		for (LoadRequest& currentLoad : uploads)
+		{
+			StreamedTexture& currentTexture = this->textures[currentLoad.textureIndex];
+			currentTexture.isLoading	= false;
+			this->numLoadsInFlight--;
+			this->loadsInFlightSize		-= currentTexture.texture->MipSize(currentLoad.level);
+
+			if (!currentLoad.isSuccessful || currentLoad.levelData.size() != currentTexture.texture->MipSize(currentLoad.level))
+			{
+				LOG_WARNING("Could not stream level " + to_string(currentLoad.level) + " of texture \"" + currentLoad.texturePath + "\". It will stay at its current resolution");
+				currentTexture.hasFailed = true;
+				continue;
+			}
+
+			// The texture may have been evicted since the load was queued: The level can only be added to the next coarser one
+			if (currentTexture.texture->ResidentLevel() == currentLoad.level + 1)
+			{
+				currentTexture.texture->SetResidentLevel(currentLoad.level, &currentLoad.levelData[0]);
+
+				#if defined(DEBUG_RENDERMANAGER_TEXTURE_STREAMING_LOGGING)
+					LOG("Streamed in level " + to_string(currentLoad.level) + " of texture \"" + currentLoad.texturePath + "\"");
+				#endif
+			}
+		}
+	}
+
+
+	bool TextureStreamer::EvictLevel()
+	{
+		// Find the least recently used texture with a level it doesn't need this frame:
+		int evictIndex = -1;
+		for (unsigned int i = 0; i < (unsigned int)this->textures.size(); i++)
+		{
+			StreamedTexture const& currentTexture = this->textures[i];
+			unsigned int residentLevel = currentTexture.texture->ResidentLevel();
+
+			if (residentLevel >= currentTexture.tailLevel || (residentLevel >= currentTexture.desiredLevel && currentTexture.lastUsedFrame == this->frameNumber))
+			{
+				continue;
+			}
+
+			if (evictIndex < 0 || currentTexture.lastUsedFrame < this->textures[evictIndex].lastUsedFrame)
+			{
+				evictIndex = i;
+			}
+		}
+
+		if (evictIndex < 0)
+		{
+			return false;
+		}
+
+		Texture* evictTexture		= this->textures[evictIndex].texture;
+		unsigned int evictLevel		= evictTexture->ResidentLevel();
+
+		if (!evictTexture->SetResidentLevel(evictLevel + 1))
+		{
+			return false;
+		}
+		this->residentSize -= evictTexture->MipSize(evictLevel);
+
+		#if defined(DEBUG_RENDERMANAGER_TEXTURE_STREAMING_LOGGING)
+			LOG("Evicted level " + to_string(evictLevel) + " of texture \"" + evictTexture->TexturePath() + "\"");
+		#endif
+
+		return true;
+	}
+
+
+	void TextureStreamer::RequestLoads()
+	{
+		// Sort the textures that need finer levels by how many levels they're missing, most first:
+		vector<unsigned int> candidates;
+		for (unsigned int i = 0; i < (unsigned int)this->textures.size(); i++)
+		{
+			StreamedTexture const& currentTexture = this->textures[i];
+			if (!currentTexture.isLoading && !currentTexture.hasFailed && currentTexture.desiredLevel < currentTexture.texture->ResidentLevel())
+			{
+				candidates.push_back(i);
+			}
+		}
+
+		std::sort(candidates.begin(), candidates.end(), [this](unsigned int lhs, unsigned int rhs)
+		{
+			return this->textures[lhs].texture->ResidentLevel() - this->textures[lhs].desiredLevel >
+				this->textures[rhs].texture->ResidentLevel() - this->textures[rhs].desiredLevel;
+		});
+
+		std::unique_lock<std::mutex> lock(this->loadMutex);
+		for (unsigned int i = 0; i < (unsigned int)candidates.size() && this->numLoadsInFlight < TEXTURE_STREAMER_MAX_LOADS_IN_FLIGHT; i++)
+		{
+			StreamedTexture& currentTexture = this->textures[candidates[i]];
+			unsigned int level				= currentTexture.texture->ResidentLevel() - 1;
+			size_t levelSize				= currentTexture.texture->MipSize(level);
+
+			// Make space for the level, once it's loaded. Eviction reallocates GPU textures, so we don't hold the lock while doing it:
+			bool hasSpace = true;
+			while (hasSpace && this->residentSize + this->loadsInFlightSize + levelSize > this->budgetBytes)
+			{
+				lock.unlock();
+				hasSpace = EvictLevel();
+				lock.lock();
+			}
+			if (!hasSpace)
+			{
+				break; // Lower priority textures won't fit either
+			}
+
+			LoadRequest newRequest;
+			newRequest.textureIndex	= candidates[i];
+			newRequest.texturePath	= currentTexture.texture->TexturePath();
+			newRequest.level		= level;
+
+			this->pendingLoads.push_back(std::move(newRequest));
+			this->numLoadsInFlight++;
+			this->loadsInFlightSize		+= levelSize;
+			currentTexture.isLoading	= true;
+		}
+		lock.unlock();
+
+		this->loadCondition.notify_one();
+	}
+
+
+	void TextureStreamer::LoaderMain()
+	{
+		std::unique_lock<std::mutex> lock(this->loadMutex);
+		while (true)
+		{
+			this->loadCondition.wait(lock, [this]() { return this->isStopping || !this->pendingLoads.empty(); });
+			if (this->isStopping)
+			{
+				return;
+			}
+
+			LoadRequest currentLoad = std::move(this->pendingLoads.front());
+			this->pendingLoads.pop_front();
+
+			// Read the level without holding the lock, so the render thread is never blocked on file IO:
+			lock.unlock();
+			currentLoad.isSuccessful = Texture::LoadTextureContainerLevel(currentLoad.texturePath, currentLoad.level, currentLoad.levelData);
+			lock.lock();
+
+			this->completedLoads.push_back(std::move(currentLoad));
+		}
+	}
+}
+
+
@@ -0,0 +1,116 @@
+// Texture mip level streaming
+// Block compressed material textures backed by a container start with only their mip tail resident. Each frame, the level each texture
+// needs is estimated from the projected size of the visible meshes using it, and the next finer level of textures that need more detail
+// is read from their container by a background loader thread. Uploads happen on the render thread. Resident levels are kept within a
+// GPU memory budget by evicting the finest level of the least recently used textures
+
+#pragma once
+
+#include "glm.hpp"
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+using glm::vec3;
+using std::string;
+using std::vector;
+using std::deque;
+using std::unordered_map;
+
+
+#define TEXTURE_STREAMER_MAX_LOADS_IN_FLIGHT	8		// Levels queued on, or being read by, the loader thread
+#define TEXTURE_STREAMER_MAX_UPLOADS_PER_FRAME	4		// Loaded levels uploaded to the GPU per frame, to bound the per-frame upload cost
+
+
+namespace BlazeEngine
+{
+	// Pre-declarations:
+	class Texture;
+	class Material;
+	class Mesh;
+	class WorldBounds;
+
+
+	class TextureStreamer
+	{
+	public:
+		// budgetBytes: GPU memory the streamed textures' resident levels may use. Mip tails are never evicted, so may exceed it
+		TextureStreamer(size_t budgetBytes);
+
+		~TextureStreamer(); // Stops and joins the loader thread
+
+		// Register every streamable texture used by the materials. Call after the scene's textures have been buffered
+		void Initialize(unordered_map<string, Material*> const& materials);
+
+		// Update the levels each texture needs from the visible meshes, upload finished loads, evict levels to stay within the budget,
+		// and queue new loads. projectionScale converts a (radius / distance) ratio to pixels. Call once per frame, from the render thread
+		void Update(vector<Mesh*> const& visibleMeshes, WorldBounds const& worldBounds, vec3 camPosition, float projectionScale, float maxScreenSize);
+
+		// Getters:
+		inline size_t ResidentSize() const			{ return residentSize; }
+		inline unsigned int NumTextures() const		{ return (unsigned int)textures.size(); }
+
+
+	private:
+		struct StreamedTexture
+		{
+			Texture*		texture;
+			unsigned int	tailLevel;				// Coarsest streamed level: Levels from here on are always resident
+			unsigned int	desiredLevel;			// Finest level needed this frame
+			unsigned int	lastUsedFrame	= 0;	// Last frame a visible mesh used the texture
+			bool			isLoading		= false;
+			bool			hasFailed		= false;	// The container couldn't be read: Don't retry
+		};
+		vector<StreamedTexture> textures;
+		unordered_map<Material*, vector<unsigned int>> materialTextures;	// Indexes of the streamed textures each material uses
+
+		size_t budgetBytes;
+		size_t residentSize				= 0;	// Bytes of resident levels, across all streamed textures
+		unsigned int frameNumber		= 0;
+
+
+		// Loader thread:
+		struct LoadRequest
+		{
+			unsigned int			textureIndex;
+			string					texturePath;
+			unsigned int			level;
+			vector<unsigned char>	levelData;
+			bool					isSuccessful	= false;
+		};
+
+		std::thread				loaderThread;
+		std::mutex				loadMutex;			// Guards everything below
+		std::condition_variable	loadCondition;
+		deque<LoadRequest>		pendingLoads;
+		deque<LoadRequest>		completedLoads;
+		bool					isStopping			= false;
+
+		unsigned int			numLoadsInFlight	= 0;	// Render thread only
+		size_t					loadsInFlightSize	= 0;	// Bytes the in flight loads will add once they're uploaded
+
+		// Loader thread entry point: Reads the requested levels from their containers until the streamer is destroyed
+		void LoaderMain();
+
+
+		// Private member functions:
+		//--------------------------
+
+		// Upload up to TEXTURE_STREAMER_MAX_UPLOADS_PER_FRAME of the levels read by the loader thread
+		void UploadCompletedLoads();
+
+		// Drop the finest resident level of the least recently used texture that doesn't need it this frame. Returns false if
+		// there are no evictable levels
+		bool EvictLevel();
+
+		// Queue the next finer level of the textures with the largest deficit between their resident and desired levels
+		void RequestLoads();
+	};
+}
+
+
@@ -194,6 +194,17 @@ namespace BlazeEngine
 	}
 
 
+	unsigned int Transform::Revision()
+	{
+		if (isDirty)
+		{
+			Recompute();
+		}
+
+		return revision;
+	}
+
+
 	void Transform::DebugPrint()
 	{
 		#if defined(DEBUG_TRANSFORMS)
@@ -280,6 +291,7 @@ namespace BlazeEngine
 		}
 
 		isDirty = false;
+		revision++;
 	}
 
 
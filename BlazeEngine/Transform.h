@@ -68,6 +68,9 @@ namespace BlazeEngine
 		// Mark this transform as dirty, requiring a recomputation of it's local matrices
 		void MarkDirty();
 
+		// Get a counter that is incremented every time the model matrices are recomputed. Resolves any pending changes first
+		unsigned int	Revision();
+
 
 		// Getters/Setters:
 		//-----------------
@@ -130,6 +133,7 @@ namespace BlazeEngine
 		quat worldRotation;		// Rotation of this transform. Used to assemble rotation matrix
 
 		bool isDirty;			// Do our model or combinedModel matrices need to be recomputed?
+		unsigned int revision	= 0;	// Incremented by Recompute(). Allows caches of derived data to detect changes
 
 
 		// Private functions:
@@ -0,0 +1,242 @@
+#include "VisibilityBuffer.h"
+#include "CoreEngine.h"
+#include "BuildConfiguration.h"
+#include "Camera.h"
+#include "Shader.h"
+#include "Mesh.h"
+#include "Material.h"
+#include "RenderTexture.h"
+#include "GLState.h"
+#include "MaterialTextureArrays.h"
+
+#include <string>
+
+using std::string;
+using std::to_string;
+
+
+// The resolve shader reads vertices directly from the mesh vertex buffers. Must match the layout in BlazeVisibility.glsl
+#define VISIBILITY_VERTEX_STRIDE	32	// Floats per vertex
+static_assert(sizeof(BlazeEngine::Vertex) == VISIBILITY_VERTEX_STRIDE * sizeof(float), "Vertex layout doesn't match BlazeVisibility.glsl");
+
+
+namespace BlazeEngine
+{
+	VisibilityBuffer::VisibilityBuffer(Camera* renderCam)
+	{
+		RenderTexture* gBufferDepth = (RenderTexture*)renderCam->RenderMaterial()->AccessTexture(RENDER_TEXTURE_DEPTH);
+		if (gBufferDepth == nullptr)
+		{
+			LOG_ERROR("Cannot create a visibility buffer for camera \"" + renderCam->GetName() + "\": It doesn't have a GBuffer");
+			return;
+		}
+
+		this->visibilityShader	= Shader::CreateShader(CoreEngine::GetCoreEngine()->GetConfig()->GetValue<string>("visibilityBufferShaderName"));
+
+		// The resolve shader samples the material textures, so must match the GBuffer fill shader's texture source:
+		vector<string> resolveKeywords;
+		if (MaterialTextureArrays::IsEnabled())
+		{
+			resolveKeywords.push_back(MaterialTextureArrays::MATERIAL_TEXTURE_ARRAYS_KEYWORD);
+		}
+		this->resolveShader		= Shader::CreateShader(CoreEngine::GetCoreEngine()->GetConfig()->GetValue<string>("visibilityResolveShaderName"), &resolveKeywords);
+
+		this->visibilityTexture = new RenderTexture
+		(
+			gBufferDepth->Width(),
+			gBufferDepth->Height(),
+			renderCam->GetName() + "_VisibilityBuffer"
+		);
+
+		this->visibilityTexture->Format()			= GL_RED_INTEGER;
+		this->visibilityTexture->InternalFormat()	= GL_R32UI;
+		this->visibilityTexture->Type()				= GL_UNSIGNED_INT;
+
+		this->visibilityTexture->TextureMinFilter()	= GL_NEAREST;	// Note: Integer textures can't be filtered
+		this->visibilityTexture->TextureMaxFilter()	= GL_NEAREST;
+
+		this->visibilityTexture->AttachmentPoint()	= GL_COLOR_ATTACHMENT0 + 0;
+		this->visibilityTexture->ReadBuffer()		= GL_COLOR_ATTACHMENT0 + 0;
+		this->visibilityTexture->DrawBuffer()		= GL_COLOR_ATTACHMENT0 + 0;
+
+		if (!this->visibilityTexture->Buffer(GENERIC_TEXTURE_7))
+		{
+			LOG_ERROR("Failed to buffer the visibility buffer render texture");
+			this->visibilityTexture->Destroy();
+			delete this->visibilityTexture;
+			this->visibilityTexture = nullptr;
+			return;
+		}
+
+		// Share the GBuffer depth, so the deferred lights and skybox can use the depth written by the visibility pass:
+		this->visibilityTexture->AttachAdditionalRenderTexturesToFramebuffer(&gBufferDepth, 1, true);
+
+		LOG("Created " + to_string(gBufferDepth->Width()) + "x" + to_string(gBufferDepth->Height()) + " visibility buffer");
+	}
+
+
+	VisibilityBuffer::~VisibilityBuffer()
+	{
+		// Note: The GBuffer depth texture is owned by the camera, and is not deleted with our framebuffer
+		if (this->visibilityTexture != nullptr)
+		{
+			this->visibilityTexture->Destroy();
+			delete this->visibilityTexture;
+			this->visibilityTexture = nullptr;
+		}
+
+		if (this->visibilityShader != nullptr)
+		{
+			this->visibilityShader->Destroy();
+			delete this->visibilityShader;
+			this->visibilityShader = nullptr;
+		}
+
+		if (this->resolveShader != nullptr)
+		{
+			this->resolveShader->Destroy();
+			delete this->resolveShader;
+			this->resolveShader = nullptr;
+		}
+	}
+
+
+	bool VisibilityBuffer::CanRender(vector<Mesh*> const& meshes) const
+	{
+		if (!IsValid() || (unsigned int)meshes.size() > VISIBILITY_MAX_INSTANCES)
+		{
+			return false;
+		}
+
+		for (unsigned int i = 0; i < (unsigned int)meshes.size(); i++)
+		{
+			if (meshes[i]->NumIndices() / 3 > VISIBILITY_MAX_TRIANGLES)
+			{
+				#if defined(DEBUG_RENDERMANAGER_SHADER_LOGGING)
+					LOG_WARNING("Mesh \"" + meshes[i]->Name() + "\" has too many triangles for the visibility buffer. Filling the GBuffer directly");
+				#endif
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+
+	bool VisibilityBuffer::Render(Camera* renderCam, vector<Mesh*> const& meshes, int viewportXRes, int viewportYRes)
+	{
+		if (!CanRender(meshes))
+		{
+			return false;
+		}
+
+		GLState& glState = GLState::Instance();
+
+		this->visibilityTexture->BindFramebuffer(true);
+		glState.Viewport(0, 0, viewportXRes, viewportYRes);
+
+		GLuint const emptyID[4] = { 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF };
+		glClearBufferuiv(GL_COLOR, 0, &emptyID[0]);
+		glClear(GL_DEPTH_BUFFER_BIT);
+
+		this->visibilityShader->Bind(true);
+
+		mat4 const& viewProjection = renderCam->ViewProjection();
+
+		for (int i = 0; i < (int)meshes.size(); i++)
+		{
+			Mesh* currentMesh = meshes[i];
+			currentMesh->Bind(true);
+
+			mat4 mvp = viewProjection * currentMesh->GetTransform().Model();
+			this->visibilityShader->UploadUniform("in_mvp",		&mvp[0][0],	UNIFORM_Matrix4fv);
+			this->visibilityShader->UploadUniform("instanceID",	&i,			UNIFORM_Int);
+
+			glDrawElements(GL_TRIANGLES, currentMesh->NumIndices(), GL_UNSIGNED_INT, (void*)(0));
+		}
+
+		return true;
+	}
+
+
+	void VisibilityBuffer::Resolve(Camera* renderCam, vector<Mesh*> const& meshes, Mesh* screenAlignedQuad, int viewportXRes, int viewportYRes, MaterialTextureArrays* materialTextureArrays /*= nullptr*/)
+	{
+		GLState& glState = GLState::Instance();
+
+		RenderTexture* gBufferTarget = (RenderTexture*)renderCam->RenderMaterial()->AccessTexture(RENDER_TEXTURE_ALBEDO);
+		gBufferTarget->BindFramebuffer(true);
+		glState.Viewport(0, 0, viewportXRes, viewportYRes);
+
+		glClear(GL_COLOR_BUFFER_BIT); // Note: Depth was already written by the visibility pass
+
+		this->resolveShader->Bind(true);
+		this->visibilityTexture->Bind(GENERIC_TEXTURE_7, true);
+		screenAlignedQuad->Bind(true);
+
+		glState.SetCapability(GL_DEPTH_TEST, false);
+		glState.SetCapability(GL_SCISSOR_TEST, true);
+		glState.SetCapability(GL_FRAMEBUFFER_SRGB, true); // The resolve shader writes linear albedo: Encode it into the sRGB albedo target
+
+		if (materialTextureArrays != nullptr)
+		{
+			materialTextureArrays->BeginPass();
+		}
+
+		mat4 const& viewProjection = renderCam->ViewProjection();
+
+		// Resolve each mesh with a fullscreen quad, scissored to its screen bounds. Pixels belonging to other meshes are discarded:
+		Material* currentMaterial = nullptr;
+		for (int i = 0; i < (int)meshes.size(); i++)
+		{
+			Mesh* currentMesh = meshes[i];
+			if (currentMesh->MeshMaterial() == nullptr)
+			{
+				continue;
+			}
+
+			ivec4 rect;
+			Bounds worldBounds = currentMesh->localBounds.GetTransformedBounds(currentMesh->GetTransform().Model());
+			if (!renderCam->ScreenRect(worldBounds, viewportXRes, viewportYRes, rect))
+			{
+				continue;
+			}
+			glState.Scissor(rect.x, rect.y, rect.z, rect.w);
+
+			if (currentMesh->MeshMaterial() != currentMaterial)
+			{
+				currentMaterial = currentMesh->MeshMaterial();
+
+				if (materialTextureArrays != nullptr)
+				{
+					materialTextureArrays->BindMaterial(currentMaterial, this->resolveShader);
+				}
+				else
+				{
+					currentMaterial->BindAllTextures(TEXTURE_0, true);
+					this->resolveShader->UploadUniform(Material::MATERIAL_PROPERTY_NAMES[MATERIAL_PROPERTY_0].c_str(), &currentMaterial->Property(MATERIAL_PROPERTY_0).x, UNIFORM_Vec4fv);
+				}
+			}
+
+			// The mesh's vertex and index buffers are read as shader storage buffers:
+			glBindBufferBase(GL_SHADER_STORAGE_BUFFER, VISIBILITY_BUFFER_VERTICES,	currentMesh->VBO(BUFFER_VERTICES));
+			glBindBufferBase(GL_SHADER_STORAGE_BUFFER, VISIBILITY_BUFFER_INDICES,	currentMesh->VBO(BUFFER_INDEXES));
+
+			mat4 model			= currentMesh->GetTransform().Model();
+			mat4 modelRotation	= currentMesh->GetTransform().Model(WORLD_ROTATION);
+			mat4 mvp			= viewProjection * model;
+
+			this->resolveShader->UploadUniform("in_modelRotation",	&modelRotation[0][0],	UNIFORM_Matrix4fv);
+			this->resolveShader->UploadUniform("in_mvp",			&mvp[0][0],				UNIFORM_Matrix4fv);
+			this->resolveShader->UploadUniform("instanceID",		&i,						UNIFORM_Int);
+
+			glDrawElements(GL_TRIANGLES, screenAlignedQuad->NumIndices(), GL_UNSIGNED_INT, (void*)(0));
+		}
+
+		// Cleanup:
+		glState.SetCapability(GL_FRAMEBUFFER_SRGB, false);
+		glState.SetCapability(GL_SCISSOR_TEST, false);
+		glState.SetCapability(GL_DEPTH_TEST, true);
+	}
+}
+
+
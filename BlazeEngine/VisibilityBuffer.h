@@ -0,0 +1,74 @@
+// Visibility buffer
+// An alternative to filling the GBuffer directly: Meshes are rasterized into a single 32-bit instance/triangle ID target (plus
+// depth), so overdrawn fragments only cost a depth test and an ID write. A resolve pass then fetches each visible pixel's triangle
+// from the mesh vertex/index buffers, computes its barycentrics analytically, and samples the material once per pixel to fill the
+// GBuffer. Deferred lighting is unchanged
+
+#pragma once
+
+#include "glm.hpp"
+
+#include <GL/glew.h>
+
+#include <vector>
+
+using glm::ivec4;
+using glm::mat4;
+using std::vector;
+
+
+// Visibility IDs pack (instance << VISIBILITY_TRIANGLE_BITS) | triangle. Must match BlazeVisibility.glsl
+#define VISIBILITY_TRIANGLE_BITS	20
+#define VISIBILITY_MAX_INSTANCES	((1u << (32 - VISIBILITY_TRIANGLE_BITS)) - 1)	// The all-ones ID marks empty pixels
+#define VISIBILITY_MAX_TRIANGLES	(1u << VISIBILITY_TRIANGLE_BITS)
+
+
+namespace BlazeEngine
+{
+	// Pre-declarations:
+	class Camera;
+	class Shader;
+	class Mesh;
+	class RenderTexture;
+	class MaterialTextureArrays;
+
+
+	class VisibilityBuffer
+	{
+	public:
+		// renderCam must have an attached GBuffer: The visibility pass shares its depth texture
+		VisibilityBuffer(Camera* renderCam);
+
+		~VisibilityBuffer();
+
+		// Returns false if the meshes can't be encoded in a visibility ID: The GBuffer must be filled directly instead
+		bool CanRender(vector<Mesh*> const& meshes) const;
+
+		// Rasterize the meshes into the visibility buffer, and the GBuffer depth, within the viewportXRes x viewportYRes viewport (the
+		// dynamic resolution viewport). Returns false (without rendering) if CanRender() fails for the meshes
+		bool Render(Camera* renderCam, vector<Mesh*> const& meshes, int viewportXRes, int viewportYRes);
+
+		// Fill the GBuffer color targets from the visibility buffer. Must follow a successful call to Render() with the same meshes
+		// and viewport. Materials are bound through materialTextureArrays if it isn't null
+		void Resolve(Camera* renderCam, vector<Mesh*> const& meshes, Mesh* screenAlignedQuad, int viewportXRes, int viewportYRes, MaterialTextureArrays* materialTextureArrays = nullptr);
+
+		// Returns false if the shaders or render target failed to initialize: The GBuffer must be filled directly instead
+		inline bool		IsValid() const		{ return visibilityShader != nullptr && resolveShader != nullptr && visibilityTexture != nullptr; }
+		inline Shader*	ResolveShader()		{ return resolveShader; }
+
+
+	private:
+		// SSBO binding points for the mesh being resolved:
+		enum VISIBILITY_BUFFER
+		{
+			VISIBILITY_BUFFER_VERTICES	= 0,
+			VISIBILITY_BUFFER_INDICES	= 1,
+		};
+
+		RenderTexture*	visibilityTexture	= nullptr;	// Deallocated in ~VisibilityBuffer()
+		Shader*			visibilityShader	= nullptr;	// Deallocated in ~VisibilityBuffer()
+		Shader*			resolveShader		= nullptr;	// Deallocated in ~VisibilityBuffer()
+	};
+}
+
+
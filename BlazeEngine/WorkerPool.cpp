@@ -0,0 +1,112 @@
+// Member class of the RenderManager. Runs per-frame jobs on persistent worker threads
+
+#include "WorkerPool.h"
+#include "BuildConfiguration.h"
+
+#include "glm.hpp"
+
+
+namespace BlazeEngine
+{
+	WorkerPool::WorkerPool(unsigned int numWorkers /*= 0*/)
+	{
+		this->nextJob = 0;
+
+		if (numWorkers == 0)
+		{
+			numWorkers = glm::max(std::thread::hardware_concurrency(), 1u) - 1;
+		}
+
+		this->workers.reserve(numWorkers);
+		for (unsigned int i = 0; i < numWorkers; i++)
+		{
+			this->workers.emplace_back(&WorkerPool::WorkerMain, this);
+		}
+	}
+
+
+	WorkerPool::~WorkerPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(this->poolMutex);
+			this->isShuttingDown = true;
+		}
+		this->workAvailable.notify_all();
+
+		for (size_t i = 0; i < this->workers.size(); i++)
+		{
+			this->workers[i].join();
+		}
+		this->workers.clear();
+	}
+
+
+	void WorkerPool::ParallelFor(unsigned int numJobs, std::function<void(unsigned int)> const& job)
+	{
+		// Not worth waking the workers for a single job:
+		if (numJobs <= 1 || this->workers.empty())
+		{
+			for (unsigned int i = 0; i < numJobs; i++)
+			{
+				job(i);
+			}
+			return;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(this->poolMutex);
+			this->currentJob		= &job;
+			this->numJobs			= numJobs;
+			this->nextJob			= 0;
+			this->numBusyWorkers	= (unsigned int)this->workers.size();
+			this->generation++;
+		}
+		this->workAvailable.notify_all();
+
+		RunJobs(); // The calling thread works too
+
+		// Every worker must finish (or see there's nothing left to take) before job goes out of scope:
+		std::unique_lock<std::mutex> lock(this->poolMutex);
+		this->workFinished.wait(lock, [this]() { return this->numBusyWorkers == 0; });
+		this->currentJob = nullptr;
+	}
+
+
+	void WorkerPool::WorkerMain()
+	{
+		unsigned long long lastGeneration = 0;
+		while (true)
+		{
+			{
+				std::unique_lock<std::mutex> lock(this->poolMutex);
+				this->workAvailable.wait(lock, [this, lastGeneration]() { return this->isShuttingDown || this->generation != lastGeneration; });
+				if (this->isShuttingDown)
+				{
+					return;
+				}
+				lastGeneration = this->generation;
+			}
+
+			RunJobs();
+
+			std::lock_guard<std::mutex> lock(this->poolMutex);
+			if (--this->numBusyWorkers == 0)
+			{
+				this->workFinished.notify_one();
+			}
+		}
+	}
+
+
+	void WorkerPool::RunJobs()
+	{
+		// Note: currentJob and numJobs don't change until every worker has finished the current call
+		std::function<void(unsigned int)> const& job = *this->currentJob;
+		for (unsigned int i = this->nextJob++; i < this->numJobs; i = this->nextJob++)
+		{
+			job(i);
+		}
+	}
+}
+
+
@@ -0,0 +1,60 @@
+// Worker pool
+// Persistent worker threads for splitting per-frame CPU work (eg. render queue sort keys) into independent jobs. The threads are
+// created once, and sleep between calls, so each call only pays for waking them rather than for creating and joining threads
+
+#pragma once
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+
+using std::vector;
+
+
+namespace BlazeEngine
+{
+	class WorkerPool
+	{
+	public:
+		// numWorkers: Threads created in addition to the calling thread. 0 == std::thread::hardware_concurrency() - 1
+		WorkerPool(unsigned int numWorkers = 0);
+
+		~WorkerPool(); // Stops and joins the worker threads
+
+		WorkerPool(WorkerPool const&) = delete;
+		void operator=(WorkerPool const&) = delete;
+
+		// Run job(i) for each i in [0, numJobs) on the workers and the calling thread, and return once every job has finished.
+		// Each thread takes the next index from a shared counter. Note: Must only be called from one thread at a time (eg. the render
+		// thread), and jobs must not call ParallelFor() themselves
+		void ParallelFor(unsigned int numJobs, std::function<void(unsigned int)> const& job);
+
+		// Threads that run jobs: The workers, plus the calling thread
+		inline unsigned int NumThreads() const { return (unsigned int)workers.size() + 1; }
+
+
+	private:
+		void WorkerMain();
+
+		// Take and run jobs from the current ParallelFor() call until there are none left
+		void RunJobs();
+
+		vector<std::thread>		workers;
+
+		std::mutex				poolMutex;			// Guards everything below, except nextJob
+		std::condition_variable	workAvailable;
+		std::condition_variable	workFinished;
+
+		std::function<void(unsigned int)> const* currentJob = nullptr;
+		unsigned int			numJobs				= 0;
+		std::atomic<unsigned int> nextJob;
+		unsigned int			numBusyWorkers		= 0;	// Workers that haven't finished the current ParallelFor() call
+		unsigned long long		generation			= 0;	// Incremented by each ParallelFor() call, to wake the workers
+		bool					isShuttingDown		= false;
+	};
+}
+
+
@@ -0,0 +1,203 @@
+#include "WorldBounds.h"
+#include "Mesh.h"
+#include "BuildConfiguration.h"
+
+#if defined(__AVX__)
+	#include <immintrin.h>
+#else
+	#include <xmmintrin.h>
+#endif
+
+#include <limits>
+
+
+namespace BlazeEngine
+{
+	void WorldBounds::Update(vector<Mesh*> const& meshes)
+	{
+		this->updatedIndices.clear();
+		this->wasRebuilt = false;
+
+		// Rebuild everything if the mesh list has changed:
+		if (meshes != this->meshes)
+		{
+			this->meshes		= meshes;
+			this->wasRebuilt	= true;
+
+			this->meshIndices.clear();
+			for (unsigned int i = 0; i < (unsigned int)meshes.size(); i++)
+			{
+				this->meshIndices[meshes[i]] = i;
+			}
+
+			size_t paddedSize = ((meshes.size() + WORLD_BOUNDS_SIMD_WIDTH - 1) / WORLD_BOUNDS_SIMD_WIDTH) * WORLD_BOUNDS_SIMD_WIDTH;
+
+			// Padding entries are empty (inverted) bounds, which are outside of every plane:
+			this->xMin.assign(paddedSize, std::numeric_limits<float>::max());
+			this->yMin.assign(paddedSize, std::numeric_limits<float>::max());
+			this->zMin.assign(paddedSize, std::numeric_limits<float>::max());
+			this->xMax.assign(paddedSize, -std::numeric_limits<float>::max());
+			this->yMax.assign(paddedSize, -std::numeric_limits<float>::max());
+			this->zMax.assign(paddedSize, -std::numeric_limits<float>::max());
+
+			this->transformRevisions.assign(meshes.size(), 0); // Transform revisions start at 1, so everything will be updated below
+
+			// Every mesh starts out static:
+			this->isDynamic.assign(meshes.size(), false);
+			this->staticRevision++;
+		}
+
+		for (unsigned int i = 0; i < (unsigned int)this->meshes.size(); i++)
+		{
+			if (this->meshes[i]->GetTransform().Revision() != this->transformRevisions[i])
+			{
+				// A static mesh that has moved since it was first seen is dynamic from now on:
+				if (!this->wasRebuilt && !this->isDynamic[i])
+				{
+					this->isDynamic[i] = true;
+					this->staticRevision++;
+				}
+
+				UpdateBounds(i);
+				this->updatedIndices.emplace_back(i);
+			}
+		}
+	}
+
+
+	unsigned int WorldBounds::OutsideFrustumMask(vec4 const* frustumPlanes, float const* xMin, float const* xMax, float const* yMin, float const* yMax,
+		float const* zMin, float const* zMax, unsigned int* insideMask /*= nullptr*/)
+	{
+		// An AABB is outside of the frustum if the corner furthest along any plane normal (the "positive vertex") is behind that plane,
+		// and inside if the nearest corner (the "negative vertex") is in front of every plane. The corners only depend on the sign of the
+		// normal, so they are selected once per plane rather than per AABB
+		#if defined(__AVX__)
+			__m256 outside		= _mm256_setzero_ps();
+			__m256 notInside	= _mm256_setzero_ps();
+			for (int plane = 0; plane < 6; plane++)
+			{
+				__m256 normalX			= _mm256_set1_ps(frustumPlanes[plane].x);
+				__m256 normalY			= _mm256_set1_ps(frustumPlanes[plane].y);
+				__m256 normalZ			= _mm256_set1_ps(frustumPlanes[plane].z);
+				__m256 planeDistance	= _mm256_set1_ps(frustumPlanes[plane].w);
+
+				__m256 distance = planeDistance;
+				distance = _mm256_add_ps(distance, _mm256_mul_ps(normalX, _mm256_loadu_ps(frustumPlanes[plane].x >= 0.0f ? xMax : xMin)));
+				distance = _mm256_add_ps(distance, _mm256_mul_ps(normalY, _mm256_loadu_ps(frustumPlanes[plane].y >= 0.0f ? yMax : yMin)));
+				distance = _mm256_add_ps(distance, _mm256_mul_ps(normalZ, _mm256_loadu_ps(frustumPlanes[plane].z >= 0.0f ? zMax : zMin)));
+				outside = _mm256_or_ps(outside, _mm256_cmp_ps(distance, _mm256_setzero_ps(), _CMP_LT_OQ));
+
+				if (insideMask != nullptr)
+				{
+					distance = planeDistance;
+					distance = _mm256_add_ps(distance, _mm256_mul_ps(normalX, _mm256_loadu_ps(frustumPlanes[plane].x >= 0.0f ? xMin : xMax)));
+					distance = _mm256_add_ps(distance, _mm256_mul_ps(normalY, _mm256_loadu_ps(frustumPlanes[plane].y >= 0.0f ? yMin : yMax)));
+					distance = _mm256_add_ps(distance, _mm256_mul_ps(normalZ, _mm256_loadu_ps(frustumPlanes[plane].z >= 0.0f ? zMin : zMax)));
+					notInside = _mm256_or_ps(notInside, _mm256_cmp_ps(distance, _mm256_setzero_ps(), _CMP_LT_OQ));
+				}
+			}
+			unsigned int outsideMask	= (unsigned int)_mm256_movemask_ps(outside);
+			unsigned int notInsideMask	= (unsigned int)_mm256_movemask_ps(notInside);
+		#else
+			__m128 outside		= _mm_setzero_ps();
+			__m128 notInside	= _mm_setzero_ps();
+			for (int plane = 0; plane < 6; plane++)
+			{
+				__m128 normalX			= _mm_set1_ps(frustumPlanes[plane].x);
+				__m128 normalY			= _mm_set1_ps(frustumPlanes[plane].y);
+				__m128 normalZ			= _mm_set1_ps(frustumPlanes[plane].z);
+				__m128 planeDistance	= _mm_set1_ps(frustumPlanes[plane].w);
+
+				__m128 distance = planeDistance;
+				distance = _mm_add_ps(distance, _mm_mul_ps(normalX, _mm_loadu_ps(frustumPlanes[plane].x >= 0.0f ? xMax : xMin)));
+				distance = _mm_add_ps(distance, _mm_mul_ps(normalY, _mm_loadu_ps(frustumPlanes[plane].y >= 0.0f ? yMax : yMin)));
+				distance = _mm_add_ps(distance, _mm_mul_ps(normalZ, _mm_loadu_ps(frustumPlanes[plane].z >= 0.0f ? zMax : zMin)));
+				outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, _mm_setzero_ps()));
+
+				if (insideMask != nullptr)
+				{
+					distance = planeDistance;
+					distance = _mm_add_ps(distance, _mm_mul_ps(normalX, _mm_loadu_ps(frustumPlanes[plane].x >= 0.0f ? xMin : xMax)));
+					distance = _mm_add_ps(distance, _mm_mul_ps(normalY, _mm_loadu_ps(frustumPlanes[plane].y >= 0.0f ? yMin : yMax)));
+					distance = _mm_add_ps(distance, _mm_mul_ps(normalZ, _mm_loadu_ps(frustumPlanes[plane].z >= 0.0f ? zMin : zMax)));
+					notInside = _mm_or_ps(notInside, _mm_cmplt_ps(distance, _mm_setzero_ps()));
+				}
+			}
+			unsigned int outsideMask	= (unsigned int)_mm_movemask_ps(outside);
+			unsigned int notInsideMask	= (unsigned int)_mm_movemask_ps(notInside);
+		#endif
+
+		if (insideMask != nullptr)
+		{
+			*insideMask = ~notInsideMask & ((1u << WORLD_BOUNDS_SIMD_WIDTH) - 1);
+		}
+		return outsideMask;
+	}
+
+
+	Bounds WorldBounds::GetBounds(unsigned int index) const
+	{
+		Bounds result;
+		result.xMin = this->xMin[index];
+		result.xMax = this->xMax[index];
+		result.yMin = this->yMin[index];
+		result.yMax = this->yMax[index];
+		result.zMin = this->zMin[index];
+		result.zMax = this->zMax[index];
+
+		return result;
+	}
+
+
+	int WorldBounds::IndexOf(Mesh* mesh) const
+	{
+		auto result = this->meshIndices.find(mesh);
+		if (result == this->meshIndices.end())
+		{
+			return -1;
+		}
+		return (int)result->second;
+	}
+
+
+	unsigned int WorldBounds::FrustaMask(unsigned int index, vec4 const* frustaPlanes, unsigned int numFrusta) const
+	{
+		unsigned int mask = 0;
+		for (unsigned int currentFrustum = 0; currentFrustum < numFrusta; currentFrustum++)
+		{
+			vec4 const* planes	= &frustaPlanes[currentFrustum * 6];
+			bool isOutside		= false;
+			for (int currentPlane = 0; currentPlane < 6 && !isOutside; currentPlane++)
+			{
+				// Test the corner furthest along the plane normal (the "positive vertex"):
+				float x = planes[currentPlane].x >= 0.0f ? this->xMax[index] : this->xMin[index];
+				float y = planes[currentPlane].y >= 0.0f ? this->yMax[index] : this->yMin[index];
+				float z = planes[currentPlane].z >= 0.0f ? this->zMax[index] : this->zMin[index];
+
+				isOutside = planes[currentPlane].x * x + planes[currentPlane].y * y + planes[currentPlane].z * z + planes[currentPlane].w < 0.0f;
+			}
+
+			if (!isOutside)
+			{
+				mask |= 1u << currentFrustum;
+			}
+		}
+		return mask;
+	}
+
+
+	void WorldBounds::UpdateBounds(unsigned int index)
+	{
+		Mesh* currentMesh		= this->meshes[index];
+		Bounds worldBounds		= currentMesh->localBounds.GetTransformedBounds(currentMesh->GetTransform().Model());
+
+		this->xMin[index]		= worldBounds.xMin;
+		this->xMax[index]		= worldBounds.xMax;
+		this->yMin[index]		= worldBounds.yMin;
+		this->yMax[index]		= worldBounds.yMax;
+		this->zMin[index]		= worldBounds.zMin;
+		this->zMax[index]		= worldBounds.zMax;
+
+		this->transformRevisions[index] = currentMesh->GetTransform().Revision();
+	}
+}
@@ -0,0 +1,87 @@
+// World-space mesh bounds
+// Caches the world-space AABB of every scene mesh in a structure-of-arrays layout, and performs SIMD culling tests against them
+
+#pragma once
+
+#include "glm.hpp"
+
+#include <vector>
+#include <unordered_map>
+
+using glm::vec4;
+using std::vector;
+using std::unordered_map;
+
+#if defined(__AVX__)
+	#define WORLD_BOUNDS_SIMD_WIDTH	8
+#else
+	#define WORLD_BOUNDS_SIMD_WIDTH	4		// SSE is always available on x64
+#endif
+
+
+namespace BlazeEngine
+{
+	// Pre-declarations:
+	class Mesh;
+	struct Bounds;
+
+
+	class WorldBounds
+	{
+	public:
+		WorldBounds() {}
+
+		// Update the cached bounds of meshes. Only meshes whose Transform has changed since the last update are recomputed.
+		// If the list of meshes has changed, all bounds are rebuilt
+		void Update(vector<Mesh*> const& meshes);
+
+		// SIMD test of WORLD_BOUNDS_SIMD_WIDTH consecutive AABBs, stored as separate component arrays (which must be readable for that
+		// many entries). Returns a mask with bit i set if AABB i is entirely behind any plane. If insideMask isn't null, bit i of it is
+		// set if AABB i is entirely in front of every plane
+		// frustumPlanes: 6 planes, as (normal.xyz, distance) with normals pointing inwards (See Camera::FrustumPlanes())
+		static unsigned int OutsideFrustumMask(vec4 const* frustumPlanes, float const* xMin, float const* xMax, float const* yMin, float const* yMax,
+			float const* zMin, float const* zMax, unsigned int* insideMask = nullptr);
+
+		// Test the bounds at index against numFrusta consecutive sets of 6 planes (eg. Camera::CubeFrustumPlanes()).
+		// Returns a mask with bit i set if the bounds intersect frustum i
+		unsigned int FrustaMask(unsigned int index, vec4 const* frustaPlanes, unsigned int numFrusta) const;
+
+		// Getters:
+		inline unsigned int		NumBounds() const						{ return (unsigned int)meshes.size(); }
+		inline Mesh*			GetMesh(unsigned int index) const		{ return meshes[index]; }
+		Bounds					GetBounds(unsigned int index) const;
+		int						IndexOf(Mesh* mesh) const;				// Returns -1 if the mesh isn't tracked
+
+		// Indexes of the bounds changed by the last call to Update(), and whether the last Update() rebuilt every entry
+		inline vector<unsigned int> const&	UpdatedIndices() const	{ return updatedIndices; }
+		inline bool							WasRebuilt() const		{ return wasRebuilt; }
+
+		// Static/dynamic classification: Meshes are static until their Transform changes after they were first seen, and dynamic
+		// from then on. StaticRevision() changes whenever the set of static meshes changes (eg. to invalidate cached shadow maps)
+		inline bool							IsDynamic(unsigned int index) const	{ return isDynamic[index]; }
+		inline unsigned int					StaticRevision() const	{ return staticRevision; }
+
+
+	private:
+		vector<Mesh*>			meshes;
+		unordered_map<Mesh*, unsigned int> meshIndices;
+		vector<unsigned int>	transformRevisions;	// Transform revision each AABB was computed from
+		vector<unsigned int>	updatedIndices;
+		bool					wasRebuilt = false;
+		vector<bool>			isDynamic;
+		unsigned int			staticRevision = 0;
+
+		// AABB components. Padded to a multiple of the SIMD width with empty bounds:
+		vector<float>			xMin;
+		vector<float>			xMax;
+		vector<float>			yMin;
+		vector<float>			yMax;
+		vector<float>			zMin;
+		vector<float>			zMax;
+
+		// Helper function: Recompute the world AABB of the mesh at index
+		void UpdateBounds(unsigned int index);
+	};
+}
+
+